@@ -0,0 +1,100 @@
+/**
+ * Rate-limited power limit actuator.
+ *
+ * Controllers that write every decision straight to a constraint's power_limit_uw file can oscillate and cause
+ * performance cliffs, and each write is a (relatively expensive) MSR update in the kernel.
+ * An actuator sits between a controller and a constraint:
+ *  - Requests within a dead-band of the current limit are ignored (hysteresis).
+ *  - Changes are ramped at no more than a maximum slew rate, one step per interval.
+ *  - Requests that arrive before the next step is due are coalesced; only the latest value is pursued.
+ *
+ * Intermediate steps are driven by a timerfd: add `timer_fd` to a poll/select/epoll loop and call
+ * powercap_actuator_step() whenever it's readable.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_ACTUATOR_H_
+#define _POWERCAP_ACTUATOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+#include "powercap.h"
+
+/**
+ * Actuator configuration.
+ */
+typedef struct powercap_actuator_config {
+  /* Maximum rate of change in uW per second; 0 for no limit */
+  uint64_t max_slew_uw_per_s;
+  /* Requests within this distance of the current limit are ignored */
+  uint64_t deadband_uw;
+  /* Minimum time between writes, must be > 0 */
+  uint64_t step_interval_us;
+  /* If non-zero, decreases are applied in a single step (e.g., to enforce a lowered budget promptly) */
+  int fast_decrease;
+} powercap_actuator_config;
+
+/**
+ * Actuator state.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_actuator {
+  const powercap_constraint* constraint;
+  powercap_actuator_config config;
+  /* readable when a step is due */
+  int timer_fd;
+  /* last value written (or read during initialization) */
+  uint64_t limit_uw;
+  /* latest requested value */
+  uint64_t target_uw;
+  /* non-zero while ramping toward the target */
+  int pending;
+  struct timespec last_write;
+  /* number of requests received and writes issued */
+  uint64_t requests;
+  uint64_t writes;
+} powercap_actuator;
+
+/**
+ * Populate a configuration with defaults: no slew limit, no dead-band, 10 ms step interval, no fast decrease.
+ */
+void powercap_actuator_config_default(powercap_actuator_config* config);
+
+/**
+ * Initialize an actuator for a constraint, which must remain valid for the actuator's lifetime.
+ * The current power limit is read; nothing is written.
+ */
+int powercap_actuator_init(powercap_actuator* act, const powercap_constraint* constraint,
+                           const powercap_actuator_config* config);
+
+/**
+ * Close the timer; any step still pending is abandoned.
+ */
+int powercap_actuator_destroy(powercap_actuator* act);
+
+/**
+ * Request a new power limit.
+ * The first step is written immediately if the step interval has elapsed since the last write, otherwise the request
+ * replaces any earlier pending request and is pursued when the timer fires.
+ */
+int powercap_actuator_request(powercap_actuator* act, uint64_t limit_uw);
+
+/**
+ * Issue the next step if one is due and re-arm the timer.
+ * If writing the step fails, the timer is still re-armed so the step is retried after the step interval.
+ * Safe to call at any time, e.g., whenever timer_fd is readable.
+ */
+int powercap_actuator_step(powercap_actuator* act);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
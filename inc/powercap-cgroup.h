@@ -0,0 +1,103 @@
+/**
+ * Attribute RAPL package and core energy to cgroups (v2) by their CPU usage.
+ *
+ * Each sample reads the energy consumed by all packages since the previous sample, and each cgroup's CPU usage
+ * (usage_usec in cpu.stat) over the same interval.
+ * Every cgroup is attributed the share of energy equal to its share of the root cgroup's CPU usage (or, if the root
+ * has no cpu.stat, of the sum of its children's usage).
+ * Like CPU usage, attributed energy is hierarchical: a cgroup's energy includes that of its descendants.
+ * Energy is summed over all packages, since cgroups aren't bound to packages.
+ *
+ * Cgroups are kept in a hash table keyed by their path, with their cpu.stat files held open, so the cost of a sample
+ * is one directory listing and one read per cgroup.
+ * Cgroups created since the previous sample start accruing energy from the next one.
+ * Cgroups removed since the previous sample are kept for one more sample, with alive set to 0, so that their final
+ * totals can be collected.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_CGROUP_H_
+#define _POWERCAP_CGROUP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "powercap-rapl.h"
+
+#define POWERCAP_CGROUP_DEFAULT_ROOT "/sys/fs/cgroup"
+
+/**
+ * A cgroup's running totals.
+ */
+typedef struct powercap_cgroup_entry {
+  /* relative to the root, e.g., "system.slice/foo.service"; "" for the root cgroup itself */
+  char* path;
+  uint64_t hash;
+  uint32_t depth;
+  int alive;
+  /* cpu.stat */
+  int fd;
+  uint64_t usage_usec;
+  /* usage over the last interval */
+  uint64_t usage_delta_usec;
+  uint64_t pkg_energy_uj;
+  uint64_t core_energy_uj;
+  /* the sample in which the cgroup was last seen */
+  uint64_t seen;
+} powercap_cgroup_entry;
+
+/**
+ * Energy attribution state.
+ * Fields are managed by the library and should be treated as read-only.
+ * Entries are stored in an open-addressing hash table; slots with a NULL path are empty.
+ */
+typedef struct powercap_cgroup {
+  int root_fd;
+  const powercap_rapl_pkg* pkgs;
+  uint32_t npkgs;
+  /* per package: package zone, then core zone */
+  uint64_t* energy_uj;
+  uint64_t* max_energy_range_uj;
+  powercap_cgroup_entry* slots;
+  uint32_t nslots;
+  uint32_t nentries;
+  uint64_t samples;
+  /* energy over the last interval, summed over packages */
+  uint64_t pkg_delta_uj;
+  uint64_t core_delta_uj;
+} powercap_cgroup;
+
+/**
+ * Initialize attribution for the cgroup hierarchy mounted at root (POWERCAP_CGROUP_DEFAULT_ROOT if NULL), using the
+ * energy counters of the given packages, which must remain valid until the state is destroyed.
+ * No energy is attributed until the second sample.
+ */
+int powercap_cgroup_init(powercap_cgroup* cg, const char* root, const powercap_rapl_pkg* pkgs, uint32_t npkgs);
+
+/**
+ * Release resources.
+ */
+int powercap_cgroup_destroy(powercap_cgroup* cg);
+
+/**
+ * Read energy counters, discover cgroups and read their CPU usage, and attribute the energy consumed since the
+ * previous sample.
+ */
+int powercap_cgroup_sample(powercap_cgroup* cg);
+
+/**
+ * Find a cgroup by its path relative to the root ("" for the root cgroup).
+ * Returns NULL if the cgroup isn't known.
+ */
+const powercap_cgroup_entry* powercap_cgroup_get(const powercap_cgroup* cg, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
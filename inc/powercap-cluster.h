@@ -0,0 +1,199 @@
+/**
+ * Distribute a cluster-wide power budget between nodes.
+ *
+ * A coordinator accepts connections from agents over any stream socket (Unix or TCP).
+ * Each agent speaks for one or more nodes: it registers their power bounds, then periodically reports their measured
+ * power and demand (the power they would use if allowed).
+ * The coordinator divides its budget with a max-min fair allocation: every node gets its minimum, remaining power is
+ * shared equally among nodes whose demand isn't met, and any surplus is shared up to each node's maximum.
+ * Each rebalance computes the final allocation directly in O(n log n) time and sends it in a single round, so caps
+ * converge in one round trip regardless of the number of nodes.
+ *
+ * Messages are length-prefixed frames.
+ * Reports from many nodes are batched into a single frame, and both reports and caps are delta-encoded as variable-length
+ * integers against the last values sent on the connection; nodes whose values didn't change are omitted entirely.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_CLUSTER_H_
+#define _POWERCAP_CLUSTER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define POWERCAP_CLUSTER_PROTOCOL_VERSION 1
+
+/* Connections that send larger frames are dropped */
+#define POWERCAP_CLUSTER_MAX_FRAME_SIZE (1 << 20)
+
+/**
+ * A node's power bounds, sent when an agent registers it.
+ */
+typedef struct powercap_cluster_node_info {
+  uint32_t id;
+  uint64_t min_power_uw;
+  uint64_t max_power_uw;
+} powercap_cluster_node_info;
+
+/**
+ * A node's measured power and demand.
+ */
+typedef struct powercap_cluster_report {
+  uint32_t id;
+  uint64_t power_uw;
+  uint64_t demand_uw;
+} powercap_cluster_report;
+
+/**
+ * Growable byte buffer, used internally.
+ */
+typedef struct powercap_cluster_buf {
+  unsigned char* data;
+  size_t len;
+  size_t size;
+} powercap_cluster_buf;
+
+/**
+ * Coordinator view of a node.
+ */
+typedef struct powercap_cluster_node {
+  uint32_t id;
+  /* connection the node is registered on */
+  int fd;
+  uint64_t min_power_uw;
+  uint64_t max_power_uw;
+  /* last reported values */
+  uint64_t power_uw;
+  uint64_t demand_uw;
+  /* allocated cap and the last cap sent to the agent */
+  uint64_t cap_uw;
+  uint64_t sent_cap_uw;
+} powercap_cluster_node;
+
+/**
+ * Coordinator view of an agent connection.
+ */
+typedef struct powercap_cluster_conn {
+  int fd;
+  powercap_cluster_buf in;
+  powercap_cluster_buf out;
+} powercap_cluster_conn;
+
+/**
+ * Coordinator state.
+ * Fields are managed by the library and should be treated as read-only.
+ * Nodes are sorted by ID.
+ */
+typedef struct powercap_cluster_coord {
+  int listen_fd;
+  uint64_t budget_uw;
+  powercap_cluster_node* nodes;
+  uint32_t nnodes;
+  uint32_t nodes_size;
+  powercap_cluster_conn* conns;
+  uint32_t nconns;
+  uint32_t conns_size;
+} powercap_cluster_coord;
+
+/**
+ * Agent view of a node.
+ */
+typedef struct powercap_cluster_agent_node {
+  uint32_t id;
+  /* last reported values */
+  uint64_t power_uw;
+  uint64_t demand_uw;
+  /* most recent cap received from the coordinator, 0 until one arrives */
+  uint64_t cap_uw;
+} powercap_cluster_agent_node;
+
+/**
+ * Agent state.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_cluster_agent {
+  int fd;
+  powercap_cluster_agent_node* nodes;
+  uint32_t nnodes;
+  powercap_cluster_buf in;
+} powercap_cluster_agent;
+
+/**
+ * Initialize a coordinator.
+ * If listen_fd >= 0, it must be a listening stream socket; new connections are accepted during polling.
+ * The listening socket is not closed by the coordinator.
+ */
+int powercap_cluster_coord_init(powercap_cluster_coord* coord, int listen_fd, uint64_t budget_uw);
+
+/**
+ * Close all agent connections and release resources.
+ */
+int powercap_cluster_coord_destroy(powercap_cluster_coord* coord);
+
+/**
+ * Add a connected stream socket; the coordinator takes ownership of the file descriptor and makes it non-blocking.
+ */
+int powercap_cluster_coord_add_conn(powercap_cluster_coord* coord, int fd);
+
+/**
+ * Change the cluster-wide budget; takes effect on the next rebalance.
+ */
+int powercap_cluster_coord_set_budget(powercap_cluster_coord* coord, uint64_t budget_uw);
+
+/**
+ * Wait up to timeout_ms milliseconds (-1 to block) for activity, then accept new connections, process received
+ * registrations and reports, and send queued caps.
+ * Connections that close or violate the protocol are dropped along with their nodes.
+ */
+int powercap_cluster_coord_poll(powercap_cluster_coord* coord, int timeout_ms);
+
+/**
+ * Reallocate the budget using the latest reports and queue the caps that changed for sending.
+ * If the budget is smaller than the sum of the nodes' minimums, every node is capped at its minimum.
+ */
+int powercap_cluster_coord_rebalance(powercap_cluster_coord* coord);
+
+/**
+ * Initialize an agent on a connected (blocking) stream socket and register nodes with the coordinator.
+ * The agent does not take ownership of the file descriptor.
+ */
+int powercap_cluster_agent_init(powercap_cluster_agent* agent, int fd, const powercap_cluster_node_info* nodes,
+                                uint32_t nnodes);
+
+/**
+ * Release resources.
+ */
+int powercap_cluster_agent_destroy(powercap_cluster_agent* agent);
+
+/**
+ * Send a batch of reports in a single frame.
+ * Reports for unregistered nodes fail with EINVAL; nodes whose values haven't changed are not sent.
+ */
+int powercap_cluster_agent_report(powercap_cluster_agent* agent, const powercap_cluster_report* reports,
+                                  uint32_t nreports);
+
+/**
+ * Wait up to timeout_ms milliseconds (-1 to block) for caps from the coordinator and apply any that arrive.
+ * Returns the number of node caps that were updated, or a negative value on error.
+ * Fails with EPIPE if the coordinator closed the connection.
+ */
+int powercap_cluster_agent_recv(powercap_cluster_agent* agent, int timeout_ms);
+
+/**
+ * Get the most recent cap received for a node.
+ * Fails with ENOENT if the node isn't registered.
+ */
+int powercap_cluster_agent_get_cap(const powercap_cluster_agent* agent, uint32_t id, uint64_t* cap_uw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,153 @@
+/**
+ * Compact columnar files of energy counter samples.
+ *
+ * Rows (a timestamp and a raw energy counter for each zone) are grouped into blocks of a fixed number of rows.
+ * Within a block, each column is stored separately: timestamps as delta-of-delta varints, and each zone's counter
+ * deltas bit-packed relative to the block's smallest delta.
+ * Regular sampling makes most timestamps a single byte and most counter deltas only a few bits.
+ *
+ * An index at the end of the file records each block's time range and the minimum and maximum of each counter, so
+ * readers can find blocks without decoding the ones before them.
+ * Readers map the file into memory and only decode the blocks they ask for.
+ *
+ * Counters are stored raw; use the zones' max_energy_range_uj (kept in the file header) to correct overflows.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_COLUMN_H_
+#define _POWERCAP_COLUMN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "powercap-sampler.h"
+
+#define POWERCAP_COLUMN_DEFAULT_BLOCK_ROWS 4096
+#define POWERCAP_COLUMN_MAX_BLOCK_ROWS (1 << 20)
+#define POWERCAP_COLUMN_MAX_ZONES 4096
+/* Limits the memory needed to buffer a block */
+#define POWERCAP_COLUMN_MAX_BLOCK_VALUES (1 << 24)
+
+/**
+ * A file being written.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_column_writer {
+  int fd;
+  uint32_t nzones;
+  uint32_t block_rows;
+  /* rows of the current block, column-major: zone z's counters start at energy_uj[z * block_rows] */
+  int64_t* time_ns;
+  uint64_t* energy_uj;
+  uint32_t nrows;
+  int64_t last_ns;
+  /* encoded block */
+  unsigned char* buf;
+  /* encoded index of the blocks written so far */
+  unsigned char* index;
+  size_t index_size;
+  size_t index_cap;
+  uint32_t nblocks;
+  uint64_t offset;
+  uint64_t total_rows;
+  int err;
+} powercap_column_writer;
+
+/**
+ * A block's place in the index.
+ */
+typedef struct powercap_column_block {
+  int64_t start_ns;
+  int64_t end_ns;
+  uint32_t nrows;
+} powercap_column_block;
+
+/**
+ * A file being read.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_column_reader {
+  unsigned char* map;
+  size_t size;
+  uint32_t nzones;
+  uint32_t block_rows;
+  uint64_t* max_energy_range_uj;
+  const unsigned char* index;
+  uint32_t nblocks;
+  uint64_t total_rows;
+} powercap_column_reader;
+
+/**
+ * Start a file on fd, which should be empty and open for writing (it isn't closed by the library).
+ * max_energy_range_uj has a value for each zone, and may be NULL if unknown (0 is stored).
+ * A block_rows of 0 selects POWERCAP_COLUMN_DEFAULT_BLOCK_ROWS.
+ * There may be at most POWERCAP_COLUMN_MAX_ZONES zones, and nzones * block_rows may be at most
+ * POWERCAP_COLUMN_MAX_BLOCK_VALUES.
+ */
+int powercap_column_writer_init(powercap_column_writer* w, int fd, uint32_t nzones,
+                                const uint64_t* max_energy_range_uj, uint32_t block_rows);
+
+/**
+ * Write any buffered rows and the index, then release resources.
+ * The file is only complete if this succeeds.
+ */
+int powercap_column_writer_destroy(powercap_column_writer* w);
+
+/**
+ * Append a row with a counter for each zone.
+ * Timestamps must not decrease.
+ * A full block is written before returning.
+ */
+int powercap_column_writer_append(powercap_column_writer* w, int64_t time_ns, const uint64_t* energy_uj);
+
+/**
+ * Append a snapshot's time and raw zone counters.
+ * The snapshot must have the same number of zones as the writer.
+ * Zones without a valid energy reading repeat their previous counter.
+ */
+int powercap_column_writer_append_snapshot(powercap_column_writer* w, const powercap_sampler_snapshot* snap);
+
+/**
+ * Map a complete file from fd, which may be closed afterward.
+ * Fails with EINVAL if the file isn't valid.
+ */
+int powercap_column_reader_open(powercap_column_reader* r, int fd);
+
+/**
+ * Unmap the file and release resources.
+ */
+int powercap_column_reader_close(powercap_column_reader* r);
+
+/**
+ * Get a block's time range and row count from the index, and optionally the minimum and maximum of each zone's
+ * counters (arrays of nzones values, either of which may be NULL).
+ */
+int powercap_column_reader_get_block(const powercap_column_reader* r, uint32_t block, powercap_column_block* info,
+                                     uint64_t* min_uj, uint64_t* max_uj);
+
+/**
+ * Find the first block that ends at or after time_ns using the index.
+ * Returns the block number, or nblocks if all blocks end before time_ns.
+ */
+uint32_t powercap_column_reader_find(const powercap_column_reader* r, int64_t time_ns);
+
+/**
+ * Decode a block.
+ * time_ns has room for block_rows values, and energy_uj for nzones * block_rows values, column-major as in the writer.
+ * Either may be NULL to skip decoding those columns.
+ * Returns the number of rows decoded, or a negative value on error, e.g., EINVAL if the block is corrupt.
+ */
+int powercap_column_reader_decode(const powercap_column_reader* r, uint32_t block, int64_t* time_ns,
+                                  uint64_t* energy_uj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * Capture and restore the writable configuration of all zones of a control type.
+ *
+ * A configuration holds each zone's enabled state and each of its constraints' power limit and time window.
+ * Restoring reads the current values through persistent file descriptors, then writes only the values that differ,
+ * so restoring an unchanged configuration performs no writes.
+ *
+ * Configurations can be saved to and loaded from a compact text format, one zone or constraint per line:
+ *
+ *   ZONE(S) z-enabled=1|0
+ *   ZONE(S) constraint=NUM [c-power-limit=UW] [c-time-window=US]
+ *
+ * where ZONE(S) are colon-separated zone numbers, e.g., "0:1".
+ * The first line is "# powercap-config CONTROL_TYPE"; other blank lines and text following '#' are ignored.
+ * Saved configurations are also valid powercap-set batch files.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_CONFIG_H_
+#define _POWERCAP_CONFIG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Zone value validity flags */
+#define POWERCAP_CONFIG_ZONE_ENABLED              0x1
+
+/* Constraint value validity flags */
+#define POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT    0x1
+#define POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW    0x2
+
+/**
+ * A constraint's writable values; constraints without any valid values are not restored.
+ */
+typedef struct powercap_config_constraint {
+  uint32_t valid;
+  uint64_t power_limit_uw;
+  uint64_t time_window_us;
+} powercap_config_constraint;
+
+/**
+ * A zone's writable values, indexed by constraint number.
+ */
+typedef struct powercap_config_zone {
+  uint32_t* zones;
+  uint32_t depth;
+  uint32_t valid;
+  int enabled;
+  powercap_config_constraint* constraints;
+  uint32_t nconstraints;
+} powercap_config_zone;
+
+/**
+ * A control type's configuration.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_config {
+  char* control_type;
+  powercap_config_zone* zones;
+  uint32_t nzones;
+} powercap_config;
+
+/**
+ * Initialize a configuration with the current values of all zones of a control type.
+ * Values that can't be read (e.g., missing files) are left invalid.
+ */
+int powercap_config_capture(powercap_config* cfg, const char* control_type);
+
+/**
+ * Release resources.
+ */
+int powercap_config_destroy(powercap_config* cfg);
+
+/**
+ * Initialize diff with the values of "to" that are different from, or missing in, "from".
+ * Zones and constraints without any such values are omitted.
+ */
+int powercap_config_diff(const powercap_config* from, const powercap_config* to, powercap_config* diff);
+
+/**
+ * Write the values of a configuration that differ from the current values.
+ * Every zone and constraint is opened and read before anything is written, so a missing zone or constraint fails
+ * without changing anything.
+ * If nwritten is not NULL, it is set to the number of values written.
+ */
+int powercap_config_restore(const powercap_config* cfg, uint32_t* nwritten);
+
+/**
+ * Save a configuration to a stream in the text format.
+ */
+int powercap_config_write(const powercap_config* cfg, FILE* f);
+
+/**
+ * Initialize a configuration from a stream in the text format.
+ * On a syntax error, returns -EINVAL and sets bad_line (if not NULL) to the 1-based line number.
+ * Lines longer than 254 characters and control type names containing '/', or that are "." or "..", are syntax errors.
+ */
+int powercap_config_read(powercap_config* cfg, FILE* f, uint32_t* bad_line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,238 @@
+/**
+ * Share RAPL packages between local, unprivileged clients through a privileged daemon.
+ *
+ * The daemon owns the packages' file descriptors and serves clients over a Unix sequenced-packet socket, so clients
+ * need no access to sysfs (where energy_uj may only be readable by root).
+ * Clients can read zones' energy counters and power limits, and request power caps.
+ *
+ * Cap requests are arbitrated min-wins: a constraint's power limit is the lowest of its active requests, but never
+ * higher than the limit found when the daemon started (its baseline), so clients can only lower power limits.
+ * Each request holds a lease that expires unless renewed and is dropped when its client disconnects; when a
+ * constraint has no active requests, its baseline is restored.
+ *
+ * Requests are batched: all requests received in one poll are served from at most one read of each file, and the
+ * resulting power limits are written once, and only if they changed.
+ *
+ * The daemon can also act as a broker: authorized clients receive read-only file descriptors for a package's files,
+ * passed over the socket, and then read them directly without any further requests.
+ * Clients are identified by their socket credentials, and every request for file descriptors or caps is passed to one
+ * authorization function, which is also the place to audit them; read requests are not authorized or audited.
+ *
+ * Messages are a header followed by count fixed-size items, one message per packet, in host byte order.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_DAEMON_H_
+#define _POWERCAP_DAEMON_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "powercap-rapl.h"
+
+#define POWERCAP_DAEMON_PROTOCOL_VERSION 1
+
+#define POWERCAP_DAEMON_DEFAULT_PATH "/run/powercapd.sock"
+
+/* Maximum items in a single message */
+#define POWERCAP_DAEMON_MAX_ITEMS 1024
+
+/* Number of zones per package, i.e., the number of powercap_rapl_zone values */
+#define POWERCAP_DAEMON_PKG_ZONES 5
+
+/* Reading validity flags */
+#define POWERCAP_DAEMON_ENERGY                0x1
+#define POWERCAP_DAEMON_MAX_ENERGY_RANGE      0x2
+#define POWERCAP_DAEMON_POWER_LIMIT_LONG      0x4
+#define POWERCAP_DAEMON_POWER_LIMIT_SHORT     0x8
+
+/**
+ * Identifies a zone (a powercap_rapl_zone) of a package.
+ */
+typedef struct powercap_daemon_zone_id {
+  uint32_t pkg;
+  uint32_t zone;
+} powercap_daemon_zone_id;
+
+/**
+ * A zone's values; power limits are indexed by powercap_rapl_constraint.
+ */
+typedef struct powercap_daemon_reading {
+  uint32_t pkg;
+  uint16_t zone;
+  uint16_t valid;
+  uint64_t energy_uj;
+  uint64_t max_energy_range_uj;
+  uint64_t power_limit_uw[2];
+} powercap_daemon_reading;
+
+/**
+ * A cap request for a constraint.
+ * A lease of 0 releases the client's request for the constraint.
+ */
+typedef struct powercap_daemon_cap {
+  uint32_t pkg;
+  uint16_t zone;
+  uint16_t constraint;
+  uint64_t power_limit_uw;
+  uint64_t lease_ms;
+} powercap_daemon_cap;
+
+/**
+ * Daemon view of a constraint.
+ */
+typedef struct powercap_daemon_slot {
+  int supported;
+  uint64_t baseline_uw;
+  /* the power limit most recently written (or the baseline) */
+  uint64_t limit_uw;
+  /* the constraint's bounds, or 0 if unknown */
+  uint64_t min_uw;
+  uint64_t max_uw;
+  /* 0, or the negative error of this poll's failed write, which is retried the next poll */
+  int write_err;
+} powercap_daemon_slot;
+
+/**
+ * Daemon view of a client connection.
+ */
+typedef struct powercap_daemon_conn {
+  int fd;
+  /* cap requests accepted this poll, answered once power limits are written */
+  uint32_t pending_caps;
+  /* per-slot flags for the constraints the pending cap requests touched */
+  unsigned char* pending_slots;
+} powercap_daemon_conn;
+
+/**
+ * A client's cap request.
+ */
+typedef struct powercap_daemon_lease {
+  int fd;
+  uint32_t slot;
+  uint64_t power_limit_uw;
+  int64_t expires_ms;
+} powercap_daemon_lease;
+
+/**
+ * Requests that are authorized.
+ */
+typedef enum powercap_daemon_request {
+  /* receive read-only file descriptors for a package's files */
+  POWERCAP_DAEMON_REQUEST_OPEN,
+  /* request caps on a package's constraints */
+  POWERCAP_DAEMON_REQUEST_CAPS
+} powercap_daemon_request;
+
+/**
+ * Decide whether a client may make a request for a package; returns nonzero to allow.
+ */
+typedef int (*powercap_daemon_authorize_fn)(void* ctx, powercap_daemon_request request, pid_t pid, uid_t uid,
+                                            gid_t gid, uint32_t pkg);
+
+/**
+ * Daemon state.
+ * Fields are managed by the library and should be treated as read-only.
+ * Slots are indexed by (pkg * POWERCAP_DAEMON_PKG_ZONES + zone) * 2 + constraint.
+ */
+typedef struct powercap_daemon {
+  int listen_fd;
+  powercap_rapl_pkg* pkgs;
+  uint32_t npkgs;
+  powercap_daemon_slot* slots;
+  /* per-zone readings, valid for the poll they were read in */
+  powercap_daemon_reading* cache;
+  uint64_t* cache_round;
+  uint64_t round;
+  powercap_daemon_conn* conns;
+  uint32_t nconns;
+  uint32_t conns_size;
+  powercap_daemon_lease* leases;
+  uint32_t nleases;
+  uint32_t leases_size;
+  powercap_daemon_authorize_fn authorize;
+  void* authorize_ctx;
+} powercap_daemon;
+
+/**
+ * Initialize a daemon; on success, it takes ownership of the packages (which are destroyed with the daemon).
+ * The current power limit of every supported constraint is read as its baseline.
+ * If listen_fd >= 0, it must be a listening sequenced-packet socket; new connections are accepted during polling.
+ * The listening socket is not closed by the daemon.
+ */
+int powercap_daemon_init(powercap_daemon* d, int listen_fd, powercap_rapl_pkg* pkgs, uint32_t npkgs);
+
+/**
+ * Close all client connections, restore baselines, destroy the packages, and release resources.
+ */
+int powercap_daemon_destroy(powercap_daemon* d);
+
+/**
+ * Authorize requests to open packages' files and to request caps with authorize, which is called once for each
+ * package a request touches; a request is denied with EPERM if any call returns 0.
+ * If authorize is NULL (the default), clients can't open packages' files, and all cap requests are allowed.
+ */
+int powercap_daemon_set_broker(powercap_daemon* d, powercap_daemon_authorize_fn authorize, void* ctx);
+
+/**
+ * Add a connected sequenced-packet socket; the daemon takes ownership of the file descriptor.
+ */
+int powercap_daemon_add_conn(powercap_daemon* d, int fd);
+
+/**
+ * Wait up to timeout_ms milliseconds (-1 to block) for activity, then accept new connections, serve all received
+ * requests, expire leases, and write power limits that changed.
+ * Connections that close, violate the protocol, or don't keep up with responses are dropped along with their leases.
+ * Failing to write a power limit is not an error of the poll: cap requests that touched the constraint are answered
+ * with the write's error, and the write is retried the next poll.
+ */
+int powercap_daemon_poll(powercap_daemon* d, int timeout_ms);
+
+/**
+ * Create a listening socket at path, replacing any existing socket file.
+ * Returns the file descriptor, or a negative value on error.
+ */
+int powercap_daemon_listen(const char* path);
+
+/**
+ * Connect to a daemon at path (POWERCAP_DAEMON_DEFAULT_PATH if NULL).
+ * Returns the file descriptor, or a negative value on error.
+ */
+int powercap_daemon_connect(const char* path);
+
+/**
+ * Read zones through a daemon; if nids is 0, reads every supported zone of every package.
+ * Returns the number of readings, at most nreadings, or a negative value on error.
+ * Fails with ENOENT if a zone doesn't exist.
+ */
+int powercap_daemon_read(int fd, const powercap_daemon_zone_id* ids, uint32_t nids,
+                         powercap_daemon_reading* readings, uint32_t nreadings);
+
+/**
+ * Request caps through a daemon, replacing this connection's previous requests for the same constraints.
+ * Requests are applied all together or not at all; fails with ENOENT if a constraint doesn't exist, EINVAL if a
+ * power limit is 0 or outside the constraint's min/max power bounds, or EPERM if the daemon doesn't authorize the
+ * client.
+ * Requests above a constraint's baseline are accepted, but have no effect.
+ */
+int powercap_daemon_request_caps(int fd, const powercap_daemon_cap* caps, uint32_t ncaps);
+
+/**
+ * Receive read-only file descriptors for a package's files from a daemon.
+ * Files that aren't available are left as 0, as with powercap_rapl_init(...); use powercap_rapl_destroy(...) to
+ * close them.
+ * Fails with EPERM if the daemon doesn't authorize the client, or ENOENT if the package doesn't exist.
+ */
+int powercap_daemon_open_pkg(int fd, uint32_t pkg, powercap_rapl_pkg* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+/**
+ * Streaming statistics over power samples in constant memory.
+ *
+ * A digest keeps the count, mean, variance, minimum, and maximum of the values added to it, and a log-linear
+ * histogram (like HDR histograms) for quantiles.
+ * Values below 2^POWERCAP_DIGEST_SUB_BITS are counted exactly; larger values fall into buckets whose width is at most
+ * 1/2^(POWERCAP_DIGEST_SUB_BITS - 1) of their lower bound, which bounds the relative error of quantiles.
+ * Values of 2^POWERCAP_DIGEST_MAX_BITS or more share the last bucket (minimums and maximums remain exact).
+ *
+ * Digests never allocate memory, so adding values is cheap enough for every sample.
+ * They aren't synchronized: keep one digest per thread (e.g., per sampler) and merge them when reporting.
+ * Merging is exact: merging digests gives the same histogram as adding all of their values to one digest.
+ * Digests can be serialized in a portable format to merge them across nodes.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_DIGEST_H_
+#define _POWERCAP_DIGEST_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "powercap-sampler.h"
+
+#define POWERCAP_DIGEST_SUB_BITS 7
+#define POWERCAP_DIGEST_MAX_BITS 48
+/* Exact values below 2^SUB_BITS, then 2^(SUB_BITS - 1) buckets for each power of 2 up to 2^MAX_BITS */
+#define POWERCAP_DIGEST_BUCKETS \
+  ((1 << POWERCAP_DIGEST_SUB_BITS) + \
+   (POWERCAP_DIGEST_MAX_BITS - POWERCAP_DIGEST_SUB_BITS) * (1 << (POWERCAP_DIGEST_SUB_BITS - 1)))
+
+/**
+ * A digest.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_digest {
+  uint64_t count;
+  /* running mean and sum of squared differences from it (Welford's method) */
+  double mean;
+  double m2;
+  uint64_t min;
+  uint64_t max;
+  uint64_t buckets[POWERCAP_DIGEST_BUCKETS];
+} powercap_digest;
+
+/**
+ * Initialize (or reset) a digest.
+ */
+int powercap_digest_init(powercap_digest* d);
+
+/**
+ * Add a value.
+ */
+int powercap_digest_add(powercap_digest* d, uint64_t val);
+
+/**
+ * Add the derived power (in uW) of each zone in a snapshot that has it to the corresponding digest.
+ * There must be a digest for each of the snapshot's zones.
+ */
+int powercap_digest_add_snapshot(powercap_digest* digests, const powercap_sampler_snapshot* snap);
+
+/**
+ * Merge src into dst.
+ */
+int powercap_digest_merge(powercap_digest* dst, const powercap_digest* src);
+
+/**
+ * Get the sample variance of the values.
+ * Returns 0 if there are fewer than two values (or on error).
+ */
+double powercap_digest_variance(const powercap_digest* d);
+
+/**
+ * Estimate the q-quantile (0 <= q <= 1) of the values, e.g., 0.99 for p99.
+ * The estimate is the midpoint of the bucket holding the quantile, limited to the minimum and maximum.
+ * Fails with ENODATA if the digest is empty.
+ */
+int powercap_digest_quantile(const powercap_digest* d, double q, uint64_t* val);
+
+/**
+ * Get the size of a digest when serialized, which only grows with the number of non-empty buckets.
+ * Returns 0 on error.
+ */
+size_t powercap_digest_serialized_size(const powercap_digest* d);
+
+/**
+ * Serialize a digest in a portable (little-endian) format.
+ * Returns the number of bytes written, or a negative value on error, e.g., ENOBUFS if size is too small.
+ */
+ssize_t powercap_digest_serialize(const powercap_digest* d, void* buf, size_t size);
+
+/**
+ * Deserialize a digest.
+ * Fails with EINVAL if the data isn't a valid digest.
+ */
+int powercap_digest_deserialize(powercap_digest* d, const void* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
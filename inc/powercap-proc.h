@@ -0,0 +1,117 @@
+/**
+ * Estimate per-process energy from RAPL package and core energy counters.
+ *
+ * Each sample reads the energy consumed by all packages since the previous sample, and each process's CPU time
+ * (utime + stime in /proc/<pid>/stat) over the same interval.
+ * Every process is attributed the share of energy equal to its share of the system's busy CPU time (from /proc/stat),
+ * or, if that's unavailable or smaller due to sampling skew, of the sum of all processes' CPU time.
+ * Energy is summed over all packages, since processes aren't bound to packages.
+ *
+ * Processes are kept in a hash table keyed by PID, with their stat files held open, so a sample costs one directory
+ * listing and one read per process; only processes that appeared since the previous sample are opened.
+ * A process whose stat file can't be held open (e.g., when out of file descriptors) is opened for each read instead.
+ * Reused PIDs are detected and start over as new processes.
+ * Processes started since the previous sample start accruing energy from the next one.
+ * Processes that exited since the previous sample are kept for one more sample, with alive set to 0, so that their
+ * final totals can be collected.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_PROC_H_
+#define _POWERCAP_PROC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <dirent.h>
+#include <stdint.h>
+#include "powercap-rapl.h"
+
+#define POWERCAP_PROC_DEFAULT_ROOT "/proc"
+
+/* Includes the terminating NUL byte, as in the kernel */
+#define POWERCAP_PROC_COMM_LEN 16
+
+/**
+ * A process's running totals.
+ */
+typedef struct powercap_proc_entry {
+  /* 0 for empty slots */
+  uint32_t pid;
+  int alive;
+  /* stat, or -1 if it's opened for each read */
+  int fd;
+  char comm[POWERCAP_PROC_COMM_LEN];
+  /* in clock ticks since boot, to detect PID reuse */
+  uint64_t start_time;
+  /* utime + stime, in clock ticks */
+  uint64_t cpu_ticks;
+  /* CPU time over the last interval */
+  uint64_t cpu_delta_ticks;
+  uint64_t pkg_energy_uj;
+  uint64_t core_energy_uj;
+  /* the sample in which the process was last seen */
+  uint64_t seen;
+} powercap_proc_entry;
+
+/**
+ * Energy estimation state.
+ * Fields are managed by the library and should be treated as read-only.
+ * Entries are stored in an open-addressing hash table; slots with a pid of 0 are empty.
+ */
+typedef struct powercap_proc {
+  DIR* dir;
+  /* the file descriptor of dir */
+  int root_fd;
+  /* /proc/stat, or -1 if unavailable */
+  int stat_fd;
+  const powercap_rapl_pkg* pkgs;
+  uint32_t npkgs;
+  /* per package: package zone, then core zone */
+  uint64_t* energy_uj;
+  uint64_t* max_energy_range_uj;
+  powercap_proc_entry* slots;
+  uint32_t nslots;
+  uint32_t nentries;
+  uint64_t samples;
+  /* busy CPU time of all CPUs, in clock ticks */
+  uint64_t busy_ticks;
+  uint64_t busy_delta_ticks;
+  /* energy over the last interval, summed over packages */
+  uint64_t pkg_delta_uj;
+  uint64_t core_delta_uj;
+} powercap_proc;
+
+/**
+ * Initialize estimation for the processes in the procfs mounted at root (POWERCAP_PROC_DEFAULT_ROOT if NULL), using
+ * the energy counters of the given packages, which must remain valid until the state is destroyed.
+ * No energy is attributed until the second sample.
+ */
+int powercap_proc_init(powercap_proc* p, const char* root, const powercap_rapl_pkg* pkgs, uint32_t npkgs);
+
+/**
+ * Release resources.
+ */
+int powercap_proc_destroy(powercap_proc* p);
+
+/**
+ * Read energy counters, discover processes and read their CPU time, and attribute the energy consumed since the
+ * previous sample.
+ */
+int powercap_proc_sample(powercap_proc* p);
+
+/**
+ * Find a process by its PID.
+ * Returns NULL if the process isn't known.
+ */
+const powercap_proc_entry* powercap_proc_get(const powercap_proc* p, uint32_t pid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * Shift a node-wide power budget between RAPL packages.
+ *
+ * Each control period, the package power consumed since the previous period is computed from the energy counters.
+ * Packages that are running close to their long-term power limit are considered constrained and are allowed to
+ * demand as much power as their bounds permit; other packages only demand their measured power plus some headroom.
+ * The budget is then divided with a max-min fair allocation: every package first gets its minimum, then remaining
+ * power is shared equally among packages whose demand isn't met yet.
+ * Any power left over after all demands are met is shared equally up to each package's maximum.
+ * The sum of package limits never exceeds the budget.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-18
+ */
+#ifndef _POWERCAP_RAPL_BUDGET_H_
+#define _POWERCAP_RAPL_BUDGET_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+#include "powercap-rapl.h"
+
+/**
+ * Budget configuration.
+ */
+typedef struct powercap_rapl_budget_config {
+  /* Node-wide budget for all packages */
+  uint64_t budget_uw;
+  /* Per-package power limit bounds; 0 to use each package's constraint files */
+  uint64_t min_power_uw;
+  uint64_t max_power_uw;
+  /* A package is constrained when its power is at least this fraction of its limit, in (0, 1] */
+  double cap_threshold;
+  /* Fraction of measured power that unconstrained packages keep as headroom, >= 0 */
+  double headroom;
+} powercap_rapl_budget_config;
+
+/**
+ * Per-package state.
+ */
+typedef struct powercap_rapl_budget_pkg {
+  const powercap_rapl_pkg* pkg;
+  uint64_t min_power_uw;
+  uint64_t max_power_uw;
+  uint64_t max_energy_range_uj;
+  uint64_t energy_uj;
+  /* power measured during the last period */
+  uint64_t power_uw;
+  /* power the package asked for during the last allocation */
+  uint64_t demand_uw;
+  /* current long-term power limit */
+  uint64_t power_limit_uw;
+} powercap_rapl_budget_pkg;
+
+/**
+ * Budget state.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_rapl_budget {
+  powercap_rapl_budget_pkg* pkgs;
+  uint32_t npkgs;
+  powercap_rapl_budget_config config;
+  struct timespec last;
+} powercap_rapl_budget;
+
+/**
+ * Populate a configuration with defaults: cap_threshold=0.95, headroom=0.1, all bounds from constraint files.
+ * The budget must still be set.
+ */
+void powercap_rapl_budget_config_default(powercap_rapl_budget_config* config);
+
+/**
+ * Initialize budget shifting for the given packages, which must be initialized with write access and must remain
+ * valid until the budget is destroyed.
+ * The budget is initially split equally (within bounds) and the package limits are written.
+ * Fails with EINVAL if the budget is smaller than the sum of the packages' minimum power.
+ */
+int powercap_rapl_budget_init(powercap_rapl_budget* budget, const powercap_rapl_pkg* pkgs, uint32_t npkgs,
+                              const powercap_rapl_budget_config* config);
+
+/**
+ * Release resources; does not modify power limits.
+ */
+int powercap_rapl_budget_destroy(powercap_rapl_budget* budget);
+
+/**
+ * Change the node-wide budget; takes effect on the next update or allocation.
+ */
+int powercap_rapl_budget_set_budget(powercap_rapl_budget* budget, uint64_t budget_uw);
+
+/**
+ * Measure package power since the last update (or initialization), then redistribute the budget.
+ * Call once per control period.
+ */
+int powercap_rapl_budget_update(powercap_rapl_budget* budget);
+
+/**
+ * Redistribute the budget given externally measured package power (one value per package, in package order).
+ * Limits are only written when their values change.
+ */
+int powercap_rapl_budget_allocate(powercap_rapl_budget* budget, const uint64_t* power_uw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * Closed-loop controller that adjusts RAPL long-term power limits to meet an application performance target.
+ *
+ * Applications periodically report a performance signal (e.g., iterations/sec or heartbeats/sec) in whatever units
+ * the target is specified in.
+ * The controller models performance as proportional to the package power limit, estimates the proportionality
+ * online, and adjusts the limit so that performance converges to the target.
+ * Because it converges to the target rather than exceeding it, power is minimized while the target is met.
+ * The package long-term limit is always controlled; the DRAM long-term limit can optionally follow as a fixed ratio of
+ * the package limit.
+ *
+ * Limits are clamped to bounds that are read once during initialization (or provided in the configuration).
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-18
+ */
+#ifndef _POWERCAP_RAPL_CONTROLLER_H_
+#define _POWERCAP_RAPL_CONTROLLER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "powercap-rapl.h"
+
+/**
+ * Controller configuration.
+ */
+typedef struct powercap_rapl_controller_config {
+  /* Performance target, must be > 0 */
+  double target;
+  /* Closed-loop pole in [0, 1): 0 converges fastest, larger values are slower but more robust to noise */
+  double pole;
+  /* Weight in (0, 1] given to new observations when estimating performance per watt */
+  double alpha;
+  /* Package power limit bounds; 0 to use the zone's constraint files */
+  uint64_t min_power_uw;
+  uint64_t max_power_uw;
+  /* DRAM limit as a fraction of the package limit; 0 to leave the DRAM limit unmodified */
+  double dram_ratio;
+  /* DRAM power limit bounds; 0 to use the zone's constraint files */
+  uint64_t dram_min_power_uw;
+  uint64_t dram_max_power_uw;
+} powercap_rapl_controller_config;
+
+/**
+ * Controller state.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_rapl_controller {
+  const powercap_rapl_pkg* pkg;
+  powercap_rapl_controller_config config;
+  /* current limits */
+  uint64_t power_limit_uw;
+  uint64_t dram_power_limit_uw;
+  /* estimated performance per watt, 0 if no estimate yet */
+  double perf_per_w;
+} powercap_rapl_controller;
+
+/**
+ * Populate a configuration with defaults: pole=0.5, alpha=0.5, all bounds from constraint files, no DRAM control.
+ * The target must still be set.
+ */
+void powercap_rapl_controller_config_default(powercap_rapl_controller_config* config);
+
+/**
+ * Initialize a controller for a package.
+ * The package must be initialized with write access and must remain valid for the controller's lifetime.
+ * Bounds not provided in the configuration are read from the max_power_uw/min_power_uw constraint files.
+ * RAPL does not currently expose min_power_uw, so config->min_power_uw (and config->dram_min_power_uw, if using DRAM
+ * control) usually must be set.
+ * The controller starts from the zones' current long-term limits; no limits are written during initialization.
+ */
+int powercap_rapl_controller_init(powercap_rapl_controller* ctl, const powercap_rapl_pkg* pkg,
+                                  const powercap_rapl_controller_config* config);
+
+/**
+ * Change the performance target, which must be > 0.
+ */
+int powercap_rapl_controller_set_target(powercap_rapl_controller* ctl, double target);
+
+/**
+ * Report the performance achieved since the last update and apply new limits.
+ * Limits are only written when their values change.
+ * Performance <= 0 is treated as "no progress" and raises the limit to its maximum until a valid estimate exists.
+ */
+int powercap_rapl_controller_update(powercap_rapl_controller* ctl, double perf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
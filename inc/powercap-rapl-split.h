@@ -0,0 +1,129 @@
+/**
+ * Online optimizer for splitting a socket power budget between the RAPL package and DRAM zones.
+ *
+ * Memory-bound workloads are sensitive to how a combined budget is divided between the package and DRAM long-term
+ * limits.
+ * Given a combined budget and a periodic application progress signal (e.g., iterations/sec), the optimizer searches
+ * for the DRAM limit that maximizes progress, with package limit = budget - DRAM limit.
+ *
+ * The search is an adaptive pattern search: probe one step away from the best known split, keep the move if progress
+ * improves, otherwise try the other direction, and halve the step once neither direction helps.
+ * Measured power from both zones' energy counters prunes the search: giving more power to a zone that isn't using
+ * the power it already has can't help, so those probes are skipped.
+ * Once the step falls below a minimum, the optimizer holds the split and watches progress; a large relative change in
+ * progress signals a new application phase and restarts the search.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_RAPL_SPLIT_H_
+#define _POWERCAP_RAPL_SPLIT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+#include "powercap-rapl.h"
+
+/**
+ * Optimizer configuration.
+ */
+typedef struct powercap_rapl_split_config {
+  /* Combined package + DRAM budget */
+  uint64_t budget_uw;
+  /* Long-term limit bounds; 0 to use the zone's constraint files, or 0 (min) and the budget (max) if unavailable */
+  uint64_t pkg_min_power_uw;
+  uint64_t pkg_max_power_uw;
+  uint64_t dram_min_power_uw;
+  uint64_t dram_max_power_uw;
+  /* Initial search step; 0 for budget / 8 */
+  uint64_t initial_step_uw;
+  /* The search has converged once the step is smaller than this; 0 for budget / 64 */
+  uint64_t min_step_uw;
+  /* A probe must improve progress by more than this fraction to be accepted, >= 0 */
+  double tolerance;
+  /* Relative change in progress at a converged split that restarts the search, > 0 */
+  double phase_threshold;
+  /* A zone is using its limit when its power is at least this fraction of the limit, in (0, 1] */
+  double cap_threshold;
+} powercap_rapl_split_config;
+
+/**
+ * Optimizer state.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_rapl_split {
+  const powercap_rapl_pkg* pkg;
+  powercap_rapl_split_config config;
+  /* current limits */
+  uint64_t pkg_limit_uw;
+  uint64_t dram_limit_uw;
+  /* best known split, the progress measured there, and whether each zone used less than its limit there */
+  uint64_t best_dram_uw;
+  double best_perf;
+  int best_pkg_idle;
+  int best_dram_idle;
+  /* current search step and direction (+1 gives DRAM more power) */
+  uint64_t step_uw;
+  int dir;
+  /* non-zero while the current limits are a probe away from the best split */
+  int probing;
+  /* non-zero after one direction failed at the current step */
+  int flipped;
+  /* non-zero once the search has converged */
+  int converged;
+  /* number of times a phase change restarted the search */
+  uint32_t phases;
+  /* power measured during the last period */
+  uint64_t pkg_power_uw;
+  uint64_t dram_power_uw;
+  uint64_t pkg_energy_uj;
+  uint64_t dram_energy_uj;
+  uint64_t pkg_max_energy_range_uj;
+  uint64_t dram_max_energy_range_uj;
+  struct timespec last;
+} powercap_rapl_split;
+
+/**
+ * Populate a configuration with defaults: tolerance=0.01, phase_threshold=0.15, cap_threshold=0.9, all bounds from
+ * constraint files, and steps derived from the budget.
+ * The budget must still be set.
+ */
+void powercap_rapl_split_config_default(powercap_rapl_split_config* config);
+
+/**
+ * Initialize the optimizer for a package with a DRAM zone (ENOTSUP otherwise).
+ * The package must be initialized with write access and must remain valid for the optimizer's lifetime.
+ * The search starts from the current DRAM limit (clamped to its bounds) and writes both limits.
+ * Fails with EINVAL if the budget can't satisfy both zones' minimums.
+ */
+int powercap_rapl_split_init(powercap_rapl_split* split, const powercap_rapl_pkg* pkg,
+                             const powercap_rapl_split_config* config);
+
+/**
+ * Change the combined budget; the current split ratio is kept and the search restarts.
+ */
+int powercap_rapl_split_set_budget(powercap_rapl_split* split, uint64_t budget_uw);
+
+/**
+ * Measure zone power since the last update (or initialization), then report the progress achieved since the last
+ * update and apply the next split.
+ * Call once per control period.
+ */
+int powercap_rapl_split_update(powercap_rapl_split* split, double perf);
+
+/**
+ * Like powercap_rapl_split_update(...), but with externally measured zone power.
+ */
+int powercap_rapl_split_update_power(powercap_rapl_split* split, double perf, uint64_t pkg_power_uw,
+                                     uint64_t dram_power_uw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,296 @@
+/**
+ * Sample zone energy, power, and limits through persistent file descriptors.
+ *
+ * Zones (and all of their constraints) are opened once when added to a sampler, and static values (names, energy
+ * and power ranges, and constraint bounds) are read at that time.
+ * Each call to powercap_sampler_sample() then re-reads only dynamic files into a snapshot, with a single timestamp.
+ * Energy counter overflow is corrected to maintain a monotonic total, from which power is derived between samples.
+ *
+ * Other telemetry can be added to the same snapshots, so it's read through persistent file descriptors at the same
+ * time as power: CPU frequencies (cpufreq), idle state residencies (cpuidle), and thermal zone temperatures.
+ * Snapshots record when reading started and finished, which bound the skew between all of their values.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_SAMPLER_H_
+#define _POWERCAP_SAMPLER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "powercap.h"
+
+#define POWERCAP_SAMPLER_NAME_SIZE 32
+
+/* What to read during a sample */
+#define POWERCAP_SAMPLER_READ_ENERGY    0x1
+#define POWERCAP_SAMPLER_READ_POWER     0x2
+#define POWERCAP_SAMPLER_READ_ENABLED   0x4
+#define POWERCAP_SAMPLER_READ_LIMITS    0x8
+#define POWERCAP_SAMPLER_READ_CPUFREQ   0x10
+#define POWERCAP_SAMPLER_READ_CPUIDLE   0x20
+#define POWERCAP_SAMPLER_READ_THERMAL   0x40
+#define POWERCAP_SAMPLER_READ_ALL       0x7F
+
+/* Zone value validity flags */
+#define POWERCAP_SAMPLER_ZONE_ENERGY    0x1
+/* derived power, requires two energy readings */
+#define POWERCAP_SAMPLER_ZONE_POWER     0x2
+/* from the zone's power_uw file */
+#define POWERCAP_SAMPLER_ZONE_POWER_UW  0x4
+#define POWERCAP_SAMPLER_ZONE_ENABLED   0x8
+
+/* Constraint value validity flags */
+#define POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT 0x1
+#define POWERCAP_SAMPLER_CONSTRAINT_TIME_WINDOW 0x2
+
+/* Other value validity flags */
+#define POWERCAP_SAMPLER_CPUFREQ_FREQ   0x1
+#define POWERCAP_SAMPLER_CPUIDLE_TIME   0x1
+#define POWERCAP_SAMPLER_CPUIDLE_USAGE  0x2
+#define POWERCAP_SAMPLER_THERMAL_TEMP   0x1
+
+#define POWERCAP_SAMPLER_DEFAULT_CPU_ROOT "/sys/devices/system/cpu"
+#define POWERCAP_SAMPLER_DEFAULT_THERMAL_ROOT "/sys/class/thermal"
+
+/**
+ * A constraint and its static values (0 if not available).
+ */
+typedef struct powercap_sampler_constraint {
+  powercap_constraint fds;
+  uint32_t num;
+  char name[POWERCAP_SAMPLER_NAME_SIZE];
+  uint64_t min_power_uw;
+  uint64_t max_power_uw;
+  uint64_t min_time_window_us;
+  uint64_t max_time_window_us;
+} powercap_sampler_constraint;
+
+/**
+ * A zone, its static values (0 or empty if not available), and energy accounting state.
+ */
+typedef struct powercap_sampler_zone {
+  /* NULL for zones added from file descriptors */
+  char* control_type;
+  uint32_t* zones;
+  uint32_t depth;
+  char name[POWERCAP_SAMPLER_NAME_SIZE];
+  powercap_zone fds;
+  uint64_t max_energy_range_uj;
+  uint64_t max_power_range_uw;
+  powercap_sampler_constraint* constraints;
+  uint32_t nconstraints;
+  /* index of this zone's first constraint in snapshots */
+  uint32_t constraint_index;
+  /* last energy counter reading, when it was read, and the corrected total since the first reading */
+  uint64_t energy_uj;
+  int64_t energy_ns;
+  uint64_t total_energy_uj;
+  int have_energy;
+} powercap_sampler_zone;
+
+/**
+ * A CPU's scaling_cur_freq file.
+ */
+typedef struct powercap_sampler_cpufreq {
+  uint32_t cpu;
+  int fd;
+} powercap_sampler_cpufreq;
+
+/**
+ * A CPU idle state's files and name.
+ */
+typedef struct powercap_sampler_cpuidle {
+  uint32_t cpu;
+  uint32_t state;
+  char name[POWERCAP_SAMPLER_NAME_SIZE];
+  int time_fd;
+  int usage_fd;
+} powercap_sampler_cpuidle;
+
+/**
+ * A thermal zone's temp file and type.
+ */
+typedef struct powercap_sampler_thermal {
+  uint32_t zone;
+  char type[POWERCAP_SAMPLER_NAME_SIZE];
+  int fd;
+} powercap_sampler_thermal;
+
+/**
+ * Sampler state.
+ * Fields are managed by the library and should be treated as read-only.
+ * CPUs, idle states, and thermal zones are sorted by their numbers.
+ */
+typedef struct powercap_sampler {
+  powercap_sampler_zone* zones;
+  uint32_t nzones;
+  uint32_t size;
+  uint32_t nconstraints;
+  int64_t last_ns;
+  uint64_t nsamples;
+  powercap_sampler_cpufreq* cpufreqs;
+  uint32_t ncpufreqs;
+  powercap_sampler_cpuidle* cpuidles;
+  uint32_t ncpuidles;
+  powercap_sampler_thermal* thermals;
+  uint32_t nthermals;
+} powercap_sampler;
+
+/**
+ * Dynamic zone values.
+ */
+typedef struct powercap_sampler_zone_values {
+  uint32_t valid;
+  uint32_t enabled;
+  /* raw counter */
+  uint64_t energy_uj;
+  /* monotonic, overflow-corrected total since the zone's first reading */
+  uint64_t total_energy_uj;
+  /* derived from energy since the previous sample */
+  uint64_t power_uw;
+  /* read from the power_uw file */
+  uint64_t power_file_uw;
+} powercap_sampler_zone_values;
+
+/**
+ * Dynamic constraint values.
+ */
+typedef struct powercap_sampler_constraint_values {
+  uint32_t valid;
+  uint64_t power_limit_uw;
+  uint64_t time_window_us;
+} powercap_sampler_constraint_values;
+
+/**
+ * Dynamic CPU frequency values.
+ */
+typedef struct powercap_sampler_cpufreq_values {
+  uint32_t valid;
+  uint64_t freq_khz;
+} powercap_sampler_cpufreq_values;
+
+/**
+ * Dynamic CPU idle state values, which are cumulative since boot.
+ */
+typedef struct powercap_sampler_cpuidle_values {
+  uint32_t valid;
+  uint64_t time_us;
+  uint64_t usage;
+} powercap_sampler_cpuidle_values;
+
+/**
+ * Dynamic thermal zone values.
+ */
+typedef struct powercap_sampler_thermal_values {
+  uint32_t valid;
+  int64_t temp_mc;
+} powercap_sampler_thermal_values;
+
+/**
+ * A snapshot of all zones, constraints, and other telemetry in a sampler.
+ * Constraint values are stored zone by zone; zone i's start at index zones[i].constraint_index of the sampler.
+ * Other values are stored in the same order as the sampler's cpufreqs, cpuidles, and thermals.
+ */
+typedef struct powercap_sampler_snapshot {
+  /* CLOCK_MONOTONIC time of the sample and time since the previous sample (0 for the first) */
+  int64_t time_ns;
+  int64_t elapsed_ns;
+  /* CLOCK_MONOTONIC time when all values had been read */
+  int64_t end_ns;
+  powercap_sampler_zone_values* zones;
+  uint32_t nzones;
+  powercap_sampler_constraint_values* constraints;
+  uint32_t nconstraints;
+  powercap_sampler_cpufreq_values* cpufreqs;
+  uint32_t ncpufreqs;
+  powercap_sampler_cpuidle_values* cpuidles;
+  uint32_t ncpuidles;
+  powercap_sampler_thermal_values* thermals;
+  uint32_t nthermals;
+} powercap_sampler_snapshot;
+
+/**
+ * Initialize an empty sampler.
+ */
+int powercap_sampler_init(powercap_sampler* sampler);
+
+/**
+ * Close all files and release resources.
+ */
+int powercap_sampler_destroy(powercap_sampler* sampler);
+
+/**
+ * Open a zone and all of its constraints read-only (see powercap-sysfs.h for parameters).
+ * Snapshots created before adding zones must be recreated.
+ */
+int powercap_sampler_add_zone(powercap_sampler* sampler, const char* control_type, const uint32_t* zones,
+                              uint32_t depth);
+
+/**
+ * Add a zone and, if recurse is set, all of its subzones.
+ * If depth is 0, all zones of the control type are added.
+ */
+int powercap_sampler_add_zone_tree(powercap_sampler* sampler, const char* control_type, const uint32_t* zones,
+                                   uint32_t depth, int recurse);
+
+/**
+ * Add a zone from already-open file descriptors (<= 0 for unavailable files), e.g., ones received from another
+ * process, which the sampler takes ownership of on success.
+ * Constraints may be NULL if nconstraints is 0; name may be NULL.
+ */
+int powercap_sampler_add_zone_fds(powercap_sampler* sampler, const char* name, const powercap_zone* zone,
+                                  const powercap_constraint* constraints, uint32_t nconstraints);
+
+/**
+ * Open the scaling_cur_freq file of each CPU under root (POWERCAP_SAMPLER_DEFAULT_CPU_ROOT if NULL).
+ * CPUs without the file (e.g., offline ones) are skipped.
+ * Fails with EEXIST if CPUs were already added.
+ * Snapshots created before adding CPUs must be recreated.
+ */
+int powercap_sampler_add_cpufreq(powercap_sampler* sampler, const char* root);
+
+/**
+ * Open the time and usage files of each idle state of each CPU under root (POWERCAP_SAMPLER_DEFAULT_CPU_ROOT if
+ * NULL), and read their names.
+ * Fails with EEXIST if idle states were already added.
+ * Snapshots created before adding idle states must be recreated.
+ */
+int powercap_sampler_add_cpuidle(powercap_sampler* sampler, const char* root);
+
+/**
+ * Open the temp file of each thermal zone under root (POWERCAP_SAMPLER_DEFAULT_THERMAL_ROOT if NULL), and read their
+ * types.
+ * Fails with EEXIST if thermal zones were already added.
+ * Snapshots created before adding thermal zones must be recreated.
+ */
+int powercap_sampler_add_thermal(powercap_sampler* sampler, const char* root);
+
+/**
+ * Allocate a snapshot sized for the sampler's current zones, constraints, and other telemetry.
+ */
+int powercap_sampler_snapshot_init(const powercap_sampler* sampler, powercap_sampler_snapshot* snap);
+
+/**
+ * Release a snapshot.
+ */
+int powercap_sampler_snapshot_destroy(powercap_sampler_snapshot* snap);
+
+/**
+ * Read the values selected by flags (POWERCAP_SAMPLER_READ_*) into a snapshot.
+ * Files that can't be read leave their values marked invalid.
+ * Derived power requires POWERCAP_SAMPLER_READ_ENERGY; POWERCAP_SAMPLER_READ_POWER reads zones' power_uw files.
+ * Zones are read first, so that energy is read as close to the snapshot's time as possible.
+ */
+int powercap_sampler_sample(powercap_sampler* sampler, powercap_sampler_snapshot* snap, uint32_t flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * Apply a timed sequence of power limit and time window settings ("cap profile") to constraints.
+ *
+ * Every step is validated against constraint bounds (cached during initialization) before anything is written.
+ * Steps are then executed against an absolute monotonic clock, so errors don't accumulate, and the achieved
+ * actuation time of every step is reported next to the planned time.
+ *
+ * Schedules can be built in memory or parsed from a compact text format, one step per line:
+ *
+ *   OFFSET_US TARGET POWER_LIMIT_UW [TIME_WINDOW_US]
+ *
+ * where TARGET indexes the constraints the schedule was initialized with, and a value of "-" leaves that setting
+ * unchanged.
+ * Blank lines and text following '#' are ignored.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_SCHEDULE_H_
+#define _POWERCAP_SCHEDULE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include "powercap.h"
+
+/* Value for settings that a step leaves unchanged */
+#define POWERCAP_SCHEDULE_UNCHANGED UINT64_MAX
+
+/**
+ * A single step, relative to the start of the schedule.
+ */
+typedef struct powercap_schedule_step {
+  uint64_t offset_us;
+  uint32_t target;
+  uint64_t power_limit_uw;
+  uint64_t time_window_us;
+} powercap_schedule_step;
+
+/**
+ * Execution report for a step; times are relative to the start of the schedule.
+ */
+typedef struct powercap_schedule_result {
+  int64_t planned_ns;
+  /* when writing started */
+  int64_t actual_ns;
+  /* how long the write(s) took */
+  int64_t write_ns;
+} powercap_schedule_result;
+
+/**
+ * Cached bounds for a target; 0 and UINT64_MAX when not available.
+ */
+typedef struct powercap_schedule_bounds {
+  uint64_t min_power_uw;
+  uint64_t max_power_uw;
+  uint64_t min_time_window_us;
+  uint64_t max_time_window_us;
+} powercap_schedule_bounds;
+
+/**
+ * Schedule state.
+ * Fields are managed by the library and should be treated as read-only, except where noted.
+ */
+typedef struct powercap_schedule {
+  const powercap_constraint* const* targets;
+  powercap_schedule_bounds* bounds;
+  uint32_t ntargets;
+  /* busy-wait this long before each step for lower jitter; 0 (default) to only sleep - may be set by users */
+  uint64_t spin_us;
+} powercap_schedule;
+
+/**
+ * Initialize a schedule for an array of constraints, which must remain valid for the schedule's lifetime.
+ * Bounds are read from each constraint's max/min power and time window files, where available.
+ */
+int powercap_schedule_init(powercap_schedule* sched, const powercap_constraint* const* targets, uint32_t ntargets);
+
+/**
+ * Release resources.
+ */
+int powercap_schedule_destroy(powercap_schedule* sched);
+
+/**
+ * Check that offsets don't decrease or exceed INT64_MAX / 2000 us (about 146 years), that targets exist, and that
+ * values are within cached bounds.
+ * On failure, returns -EINVAL and sets bad_step (if not NULL) to the index of the first invalid step.
+ */
+int powercap_schedule_validate(const powercap_schedule* sched, const powercap_schedule_step* steps, uint32_t nsteps,
+                               uint32_t* bad_step);
+
+/**
+ * Validate, then execute all steps, starting now.
+ * If results is not NULL, it must have room for nsteps entries.
+ * Stops at the first failed write, or with -EINTR if a signal interrupts a sleep.
+ */
+int powercap_schedule_run(const powercap_schedule* sched, const powercap_schedule_step* steps, uint32_t nsteps,
+                          powercap_schedule_result* results);
+
+/**
+ * Parse steps from a stream; the returned array must be released with free().
+ * On a syntax error, returns -EINVAL and sets bad_line (if not NULL) to the 1-based line number.
+ * Lines longer than 254 characters (not counting the newline) and offsets above INT64_MAX / 2000 us are syntax errors.
+ */
+int powercap_schedule_parse(FILE* f, powercap_schedule_step** steps, uint32_t* nsteps, uint32_t* bad_line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * Opt-in instrumentation of library file I/O.
+ *
+ * When enabled, the library counts file opens, reads (pread), writes (pwrite), parse failures, and bytes transferred
+ * for each zone and constraint file type, and records read and write latencies in log2 histograms.
+ * Constraint file statistics are aggregated across constraint numbers, e.g., all "constraint_N_power_limit_uw" files
+ * share a single entry.
+ *
+ * Instrumentation is disabled by default; when disabled, the overhead is a single relaxed atomic load per operation.
+ * Counters are updated atomically and may be queried while other threads are using the library.
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-18
+ */
+#ifndef _POWERCAP_STATS_H_
+#define _POWERCAP_STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include "powercap.h"
+
+/**
+ * Number of latency histogram buckets.
+ * Bucket i counts operations that took [2^i, 2^(i+1)) nanoseconds; bucket 0 also counts operations that took < 1 ns,
+ * and the last bucket also counts all longer operations.
+ */
+#define POWERCAP_STATS_HIST_BUCKETS 32
+
+/**
+ * Statistics for a zone or constraint file type.
+ */
+typedef struct powercap_stats_file {
+  uint64_t opens;
+  uint64_t open_errors;
+  uint64_t reads;
+  uint64_t read_errors;
+  uint64_t writes;
+  uint64_t write_errors;
+  uint64_t parse_errors;
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+  uint64_t read_ns;
+  uint64_t write_ns;
+  uint64_t read_ns_hist[POWERCAP_STATS_HIST_BUCKETS];
+  uint64_t write_ns_hist[POWERCAP_STATS_HIST_BUCKETS];
+} powercap_stats_file;
+
+/**
+ * Enable (non-zero) or disable (zero) instrumentation.
+ * Counters are retained when disabled.
+ */
+void powercap_stats_set_enabled(int enabled);
+
+/**
+ * Returns 1 if instrumentation is enabled, 0 otherwise.
+ */
+int powercap_stats_is_enabled(void);
+
+/**
+ * Reset all counters to 0.
+ * Operations that are concurrently in progress may or may not be counted.
+ */
+void powercap_stats_reset(void);
+
+/**
+ * Get the statistics for a zone file type.
+ */
+int powercap_stats_get_zone_file(powercap_zone_file type, powercap_stats_file* stats);
+
+/**
+ * Get the statistics for a constraint file type.
+ */
+int powercap_stats_get_constraint_file(powercap_constraint_file type, powercap_stats_file* stats);
+
+/**
+ * Write a text dump of all file types that have recorded activity.
+ * Histograms are printed as "bucket:count" pairs for non-empty buckets only.
+ */
+int powercap_stats_fprint(FILE* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -33,6 +33,7 @@ extern "C" {
 
 #include <inttypes.h>
 #include <unistd.h>
+#include "powercap.h"
 
 /**
  * Determine if a a control type exists.
@@ -261,6 +262,55 @@ int powercap_sysfs_constraint_get_min_time_window_us(const char* control_type, c
  */
 ssize_t powercap_sysfs_constraint_get_name(const char* control_type, const uint32_t* zones, uint32_t depth, uint32_t constraint, char* buf, size_t size);
 
+/**
+ * Open a zone's files for repeated reads/writes with the functions in powercap.h, avoiding an open/close per access.
+ * Files that don't exist (or, if read_only, that can't be read) are left unopened with a descriptor of 0.
+ * Only the enabled file is opened for writing, and only if read_only is 0; in particular, energy_uj is always opened
+ * O_RDONLY, so the energy counter can't be reset through it.
+ * Release with powercap_sysfs_zone_close(...).
+ *
+ * @param zone
+ * @param control_type
+ * @param zones
+ * @param depth
+ * @param read_only
+ * @return 0 on success, a negative error code otherwise (-ENOSYS if the zone doesn't exist).
+ */
+int powercap_sysfs_zone_open(powercap_zone* zone, const char* control_type, const uint32_t* zones, uint32_t depth, int read_only);
+
+/**
+ * Close a zone's files.
+ * All files are closed even if one fails to close.
+ *
+ * @param zone
+ * @return 0 on success, the first negative error code otherwise.
+ */
+int powercap_sysfs_zone_close(powercap_zone* zone);
+
+/**
+ * Open a constraint's files for repeated reads/writes with the functions in powercap.h.
+ * Files that don't exist (or, if read_only, that can't be read) are left unopened with a descriptor of 0.
+ * Release with powercap_sysfs_constraint_close(...).
+ *
+ * @param constraint
+ * @param control_type
+ * @param zones
+ * @param depth
+ * @param num the constraint number
+ * @param read_only
+ * @return 0 on success, a negative error code otherwise (-ENOSYS if the constraint doesn't exist).
+ */
+int powercap_sysfs_constraint_open(powercap_constraint* constraint, const char* control_type, const uint32_t* zones, uint32_t depth, uint32_t num, int read_only);
+
+/**
+ * Close a constraint's files.
+ * All files are closed even if one fails to close.
+ *
+ * @param constraint
+ * @return 0 on success, the first negative error code otherwise.
+ */
+int powercap_sysfs_constraint_close(powercap_constraint* constraint);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,84 @@
+/**
+ * Energy consumed over arbitrary time intervals of a recorded sample series.
+ *
+ * A timeline holds the prefix sums of each zone's overflow-corrected energy at each sample time, so the energy
+ * consumed between any two times is a difference of two interpolated sums, found by binary search in O(log n).
+ * Between samples, energy is interpolated linearly (i.e., power is assumed constant between samples).
+ * Times before the first sample or after the last are limited to the recorded range.
+ *
+ * Batch queries reuse each interval's position as a starting point for the next, so sorted or mostly-sorted
+ * intervals (e.g., per-request or per-task windows) are found in amortized constant time.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_TIMELINE_H_
+#define _POWERCAP_TIMELINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "powercap-column.h"
+
+/**
+ * A timeline.
+ * Fields are managed by the library and should be treated as read-only.
+ */
+typedef struct powercap_timeline {
+  uint32_t nzones;
+  uint64_t* max_energy_range_uj;
+  /* raw counters of the last sample */
+  uint64_t* last_uj;
+  int64_t* time_ns;
+  /* energy since the first sample, row-major: sample i's sum for zone z is energy_uj[i * nzones + z] */
+  uint64_t* energy_uj;
+  size_t nsamples;
+  size_t cap;
+} powercap_timeline;
+
+/**
+ * Initialize an empty timeline.
+ * max_energy_range_uj has a value for each zone to correct overflows, and may be NULL or contain 0 if unknown.
+ */
+int powercap_timeline_init(powercap_timeline* tl, uint32_t nzones, const uint64_t* max_energy_range_uj);
+
+/**
+ * Release resources.
+ */
+int powercap_timeline_destroy(powercap_timeline* tl);
+
+/**
+ * Append a sample of raw counters, one for each zone.
+ * Timestamps must not decrease.
+ */
+int powercap_timeline_append(powercap_timeline* tl, int64_t time_ns, const uint64_t* energy_uj);
+
+/**
+ * Append every sample of a columnar file, which must have the same number of zones as the timeline.
+ */
+int powercap_timeline_append_column(powercap_timeline* tl, const powercap_column_reader* r);
+
+/**
+ * Get the energy consumed in a zone between two times, where start_ns <= end_ns.
+ * Fails with ENODATA if the timeline is empty.
+ */
+int powercap_timeline_energy(const powercap_timeline* tl, uint32_t zone, int64_t start_ns, int64_t end_ns,
+                             double* energy_uj);
+
+/**
+ * Get the energy consumed in a zone during each of n intervals.
+ * Stops at the first invalid interval and fails with EINVAL, leaving later results unset.
+ */
+int powercap_timeline_energy_batch(const powercap_timeline* tl, uint32_t zone, const int64_t* start_ns,
+                                   const int64_t* end_ns, size_t n, double* energy_uj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * Batch kernels for converting recorded energy counters to power.
+ *
+ * Kernels use SSE2 or AVX2 on x86-64 when the CPU supports them (AVX2 also requires building with a compiler that
+ * supports -mavx2), and portable scalar code otherwise.
+ * The best available instruction set is selected at runtime, and all of them give identical results.
+ *
+ * Unless otherwise stated, all functions return 0 on success or a negative value on error.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_VECTOR_H_
+#define _POWERCAP_VECTOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Instruction sets, in increasing order of preference.
+ */
+typedef enum powercap_vector_isa {
+  POWERCAP_VECTOR_ISA_SCALAR,
+  POWERCAP_VECTOR_ISA_SSE2,
+  POWERCAP_VECTOR_ISA_AVX2
+} powercap_vector_isa;
+
+/**
+ * Get the instruction set the kernels use.
+ */
+powercap_vector_isa powercap_vector_get_isa(void);
+
+/**
+ * Force the kernels to use an instruction set, e.g., to compare them.
+ * Fails with ENOTSUP if it isn't available.
+ * Not thread-safe: don't call while kernels are running in other threads.
+ */
+int powercap_vector_set_isa(powercap_vector_isa isa);
+
+/**
+ * Compute the energy consumed between each of n consecutive counter readings, allowing for at most one overflow
+ * between readings, as n - 1 values.
+ * If max_energy_range_uj is 0 (unknown), counters that go backward give 0.
+ * delta_uj may be the same array as energy_uj.
+ */
+int powercap_vector_energy_deltas(const uint64_t* energy_uj, size_t n, uint64_t max_energy_range_uj,
+                                  uint64_t* delta_uj);
+
+/**
+ * Compute the power (in uW) over each of the n - 1 intervals between n timestamps, given the energy consumed in each
+ * interval (e.g., from powercap_vector_energy_deltas).
+ * Intervals whose timestamps don't increase give 0.
+ */
+int powercap_vector_power(const uint64_t* delta_uj, const int64_t* time_ns, size_t n, double* power_uw);
+
+/**
+ * Get the minimum, maximum, and mean of n values, any of which may be NULL.
+ * Values must not be NaN.
+ * Fails with ENODATA if n is 0.
+ */
+int powercap_vector_stats(const double* values, size_t n, double* min, double* max, double* mean);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * Rate-limited power limit actuator.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap.h"
+#include "powercap-actuator.h"
+
+#define DEFAULT_STEP_INTERVAL_US 10000
+
+void powercap_actuator_config_default(powercap_actuator_config* config) {
+  if (config != NULL) {
+    memset(config, 0, sizeof(powercap_actuator_config));
+    config->step_interval_us = DEFAULT_STEP_INTERVAL_US;
+  }
+}
+
+static uint64_t elapsed_us(const struct timespec* start, const struct timespec* end) {
+  int64_t us = (int64_t) (end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000;
+  return us > 0 ? (uint64_t) us : 0;
+}
+
+/* 0 disarms the timer */
+static int arm(const powercap_actuator* act, uint64_t us) {
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = (time_t) (us / 1000000);
+  its.it_value.tv_nsec = (long) (us % 1000000) * 1000;
+  return timerfd_settime(act->timer_fd, 0, &its, NULL) ? -errno : 0;
+}
+
+static int advance(powercap_actuator* act) {
+  struct timespec now;
+  uint64_t since;
+  uint64_t diff;
+  uint64_t max_step;
+  uint64_t next;
+  int ret;
+  if (!act->pending) {
+    return arm(act, 0);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  since = elapsed_us(&act->last_write, &now);
+  if (act->writes && since < act->config.step_interval_us) {
+    return arm(act, act->config.step_interval_us - since);
+  }
+  if (!act->config.max_slew_uw_per_s || (act->config.fast_decrease && act->target_uw < act->limit_uw)) {
+    next = act->target_uw;
+  } else {
+    /* a late step doesn't earn a bigger one */
+    if (since > act->config.step_interval_us) {
+      since = act->config.step_interval_us;
+    }
+    max_step = (uint64_t) ((double) act->config.max_slew_uw_per_s * since / 1000000.0);
+    if (!max_step) {
+      max_step = 1;
+    }
+    if (act->target_uw > act->limit_uw) {
+      diff = act->target_uw - act->limit_uw;
+      next = act->limit_uw + (diff < max_step ? diff : max_step);
+    } else {
+      diff = act->limit_uw - act->target_uw;
+      next = act->limit_uw - (diff < max_step ? diff : max_step);
+    }
+  }
+  if ((ret = powercap_constraint_set_power_limit_uw(act->constraint, next))) {
+    /* still pending: retry after a step interval */
+    arm(act, act->config.step_interval_us);
+    errno = -ret;
+    return ret;
+  }
+  act->limit_uw = next;
+  act->last_write = now;
+  act->writes++;
+  act->pending = next != act->target_uw;
+  return arm(act, act->pending ? act->config.step_interval_us : 0);
+}
+
+int powercap_actuator_init(powercap_actuator* act, const powercap_constraint* constraint,
+                           const powercap_actuator_config* config) {
+  int ret;
+  if (act == NULL || constraint == NULL || config == NULL || !config->step_interval_us) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(act, 0, sizeof(powercap_actuator));
+  act->timer_fd = -1;
+  act->constraint = constraint;
+  act->config = *config;
+  if ((ret = powercap_constraint_get_power_limit_uw(constraint, &act->limit_uw))) {
+    return ret;
+  }
+  act->target_uw = act->limit_uw;
+  if ((act->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+    return -errno;
+  }
+  return 0;
+}
+
+int powercap_actuator_destroy(powercap_actuator* act) {
+  int ret = 0;
+  if (act == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (act->timer_fd >= 0 && close(act->timer_fd)) {
+    ret = -errno;
+  }
+  act->timer_fd = -1;
+  act->pending = 0;
+  return ret;
+}
+
+int powercap_actuator_request(powercap_actuator* act, uint64_t limit_uw) {
+  uint64_t diff;
+  if (act == NULL || act->timer_fd < 0) {
+    errno = EINVAL;
+    return -errno;
+  }
+  act->requests++;
+  diff = limit_uw > act->limit_uw ? limit_uw - act->limit_uw : act->limit_uw - limit_uw;
+  if (!diff || diff <= act->config.deadband_uw) {
+    /* close enough to where we are, so stop any ramp in progress */
+    act->target_uw = act->limit_uw;
+    act->pending = 0;
+  } else {
+    act->target_uw = limit_uw;
+    act->pending = 1;
+  }
+  return advance(act);
+}
+
+int powercap_actuator_step(powercap_actuator* act) {
+  uint64_t expirations;
+  if (act == NULL || act->timer_fd < 0) {
+    errno = EINVAL;
+    return -errno;
+  }
+  /* drain the timer; EAGAIN just means it hasn't fired */
+  if (read(act->timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+    return -errno;
+  }
+  return advance(act);
+}
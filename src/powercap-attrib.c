@@ -0,0 +1,122 @@
+/**
+ * Internal helpers shared by the energy attribution modules.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap-attrib.h"
+#include "powercap-common.h"
+#include "powercap-rapl.h"
+
+static const powercap_rapl_zone zones[ATTRIB_NUM_ZONES] = { POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_ZONE_CORE };
+
+int attrib_energy_init(const powercap_rapl_pkg* pkgs, uint32_t npkgs, uint64_t** energy_uj,
+                       uint64_t** max_energy_range_uj) {
+  uint64_t* max;
+  uint32_t i;
+  uint32_t z;
+  int ret;
+  if ((*energy_uj = calloc((size_t) npkgs * ATTRIB_NUM_ZONES + 1, sizeof(uint64_t))) == NULL) {
+    return -errno;
+  }
+  if ((max = calloc((size_t) npkgs * ATTRIB_NUM_ZONES + 1, sizeof(uint64_t))) == NULL) {
+    ret = -errno;
+    free(*energy_uj);
+    *energy_uj = NULL;
+    return ret;
+  }
+  for (i = 0; i < npkgs; i++) {
+    for (z = 0; z < ATTRIB_NUM_ZONES; z++) {
+      if (powercap_rapl_is_zone_file_supported(&pkgs[i], zones[z], POWERCAP_ZONE_FILE_MAX_ENERGY_RANGE_UJ) != 1 ||
+          powercap_rapl_get_max_energy_range_uj(&pkgs[i], zones[z], &max[i * ATTRIB_NUM_ZONES + z])) {
+        max[i * ATTRIB_NUM_ZONES + z] = 0;
+      }
+    }
+  }
+  *max_energy_range_uj = max;
+  return 0;
+}
+
+void attrib_energy_read(const powercap_rapl_pkg* pkgs, uint32_t npkgs, uint64_t* energy_uj,
+                        const uint64_t* max_energy_range_uj, int first, uint64_t* pkg_delta_uj,
+                        uint64_t* core_delta_uj) {
+  uint64_t energy;
+  uint32_t i;
+  uint32_t z;
+  *pkg_delta_uj = 0;
+  *core_delta_uj = 0;
+  for (i = 0; i < npkgs; i++) {
+    for (z = 0; z < ATTRIB_NUM_ZONES; z++) {
+      if (powercap_rapl_is_zone_file_supported(&pkgs[i], zones[z], POWERCAP_ZONE_FILE_ENERGY_UJ) != 1 ||
+          powercap_rapl_get_energy_uj(&pkgs[i], zones[z], &energy)) {
+        continue;
+      }
+      if (!first) {
+        *(z ? core_delta_uj : pkg_delta_uj) +=
+          energy_delta_uj(energy_uj[i * ATTRIB_NUM_ZONES + z], energy, max_energy_range_uj[i * ATTRIB_NUM_ZONES + z]);
+      }
+      energy_uj[i * ATTRIB_NUM_ZONES + z] = energy;
+    }
+  }
+}
+
+static const void* entry_at(const attrib_table_ops* ops, const void* slots, uint32_t i) {
+  return (const unsigned char*) slots + (size_t) i * ops->entry_size;
+}
+
+uint32_t attrib_table_find(const attrib_table_ops* ops, const void* slots, uint32_t nslots, const void* key,
+                           uint64_t hash) {
+  const void* e;
+  uint32_t mask = nslots - 1;
+  uint32_t i;
+  for (i = (uint32_t) hash & mask; !ops->is_empty(e = entry_at(ops, slots, i)); i = (i + 1) & mask) {
+    if (ops->hash(e) == hash && ops->matches(e, key)) {
+      break;
+    }
+  }
+  return i;
+}
+
+/* Returns the empty slot where an entry with the hash belongs */
+static uint32_t find_empty(const attrib_table_ops* ops, const void* slots, uint32_t nslots, uint64_t hash) {
+  uint32_t mask = nslots - 1;
+  uint32_t i;
+  for (i = (uint32_t) hash & mask; !ops->is_empty(entry_at(ops, slots, i)); i = (i + 1) & mask);
+  return i;
+}
+
+void* attrib_table_grow(const attrib_table_ops* ops, const void* slots, uint32_t nslots) {
+  const void* e;
+  unsigned char* grown;
+  uint32_t i;
+  if ((grown = calloc(2 * (size_t) nslots, ops->entry_size)) == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < nslots; i++) {
+    e = entry_at(ops, slots, i);
+    if (!ops->is_empty(e)) {
+      memcpy(grown + (size_t) find_empty(ops, grown, 2 * nslots, ops->hash(e)) * ops->entry_size, e, ops->entry_size);
+    }
+  }
+  return grown;
+}
+
+void attrib_table_remove(const attrib_table_ops* ops, void* slots, uint32_t nslots, uint32_t i) {
+  unsigned char* s = slots;
+  uint32_t mask = nslots - 1;
+  uint32_t j;
+  uint32_t home;
+  /* shift back following entries that would otherwise become unreachable */
+  for (j = (i + 1) & mask; !ops->is_empty(s + (size_t) j * ops->entry_size); j = (j + 1) & mask) {
+    home = (uint32_t) ops->hash(s + (size_t) j * ops->entry_size) & mask;
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      memcpy(s + (size_t) i * ops->entry_size, s + (size_t) j * ops->entry_size, ops->entry_size);
+      i = j;
+    }
+  }
+  memset(s + (size_t) i * ops->entry_size, 0, ops->entry_size);
+}
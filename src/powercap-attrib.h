@@ -0,0 +1,69 @@
+/**
+ * Internal helpers shared by the energy attribution modules (powercap-cgroup.h and powercap-proc.h).
+ *
+ * Both apportion the package and core energy of a set of packages to entries kept in an open-addressing hash table
+ * with linear probing and backward-shift deletion, so there are no tombstones and lookups stay short as entries come
+ * and go.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_ATTRIB_H_
+#define _POWERCAP_ATTRIB_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "powercap-rapl.h"
+
+#pragma GCC visibility push(hidden)
+
+/* Zones whose energy is attributed, per package: package zone, then core zone */
+#define ATTRIB_NUM_ZONES 2
+
+/*
+ * Allocate the per-package, per-zone energy counters and read the max energy ranges (0 if unknown).
+ * Return 0 on success, negative error code on failure (nothing is left allocated).
+ */
+int attrib_energy_init(const powercap_rapl_pkg* pkgs, uint32_t npkgs, uint64_t** energy_uj,
+                       uint64_t** max_energy_range_uj);
+
+/*
+ * Read the energy counters and set the energy consumed since the previous read, summed over packages.
+ * If first is nonzero, only the counters are read and the deltas are 0.
+ * Counters that can't be read are skipped.
+ */
+void attrib_energy_read(const powercap_rapl_pkg* pkgs, uint32_t npkgs, uint64_t* energy_uj,
+                        const uint64_t* max_energy_range_uj, int first, uint64_t* pkg_delta_uj,
+                        uint64_t* core_delta_uj);
+
+/* Describes a hash table's entries; a table's size is always a power of 2 */
+typedef struct attrib_table_ops {
+  size_t entry_size;
+  int (*is_empty)(const void* entry);
+  /* only called for non-empty entries */
+  uint64_t (*hash)(const void* entry);
+  /* only called for non-empty entries with the key's hash */
+  int (*matches)(const void* entry, const void* key);
+} attrib_table_ops;
+
+/* Returns the slot holding key, or the empty slot where it belongs */
+uint32_t attrib_table_find(const attrib_table_ops* ops, const void* slots, uint32_t nslots, const void* key,
+                           uint64_t hash);
+
+/* Returns a table of twice the size holding the same entries, or NULL on failure; the caller frees the old table */
+void* attrib_table_grow(const attrib_table_ops* ops, const void* slots, uint32_t nslots);
+
+/* Empty a slot, whose resources the caller has already released, shifting back entries that follow it as needed */
+void attrib_table_remove(const attrib_table_ops* ops, void* slots, uint32_t nslots, uint32_t i);
+
+#pragma GCC visibility pop
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
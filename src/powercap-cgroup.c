@@ -0,0 +1,303 @@
+/**
+ * Per-cgroup energy attribution.
+ *
+ * Cgroups are kept in the hash table from powercap-attrib.h, keyed by their paths.
+ * The hierarchy is walked relative to directory file descriptors, so paths are never resolved from the root.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "powercap-attrib.h"
+#include "powercap-common.h"
+#include "powercap-cgroup.h"
+#include "powercap-rapl.h"
+
+#define MIN_SLOTS 64
+#define CPU_STAT_SIZE 1024
+
+/* FNV-1a */
+static uint64_t hash_path(const char* path) {
+  uint64_t h = 14695981039346656037ULL;
+  for (; *path; path++) {
+    h ^= (unsigned char) *path;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static int entry_is_empty(const void* entry) {
+  return ((const powercap_cgroup_entry*) entry)->path == NULL;
+}
+
+static uint64_t entry_hash(const void* entry) {
+  return ((const powercap_cgroup_entry*) entry)->hash;
+}
+
+static int entry_matches(const void* entry, const void* key) {
+  return !strcmp(((const powercap_cgroup_entry*) entry)->path, (const char*) key);
+}
+
+static const attrib_table_ops table_ops = { sizeof(powercap_cgroup_entry), entry_is_empty, entry_hash, entry_matches };
+
+static uint32_t find_slot(const powercap_cgroup* cg, const char* path, uint64_t h) {
+  return attrib_table_find(&table_ops, cg->slots, cg->nslots, path, h);
+}
+
+static int grow(powercap_cgroup* cg) {
+  powercap_cgroup_entry* slots;
+  if ((slots = attrib_table_grow(&table_ops, cg->slots, cg->nslots)) == NULL) {
+    return -errno;
+  }
+  free(cg->slots);
+  cg->slots = slots;
+  cg->nslots *= 2;
+  return 0;
+}
+
+static void remove_slot(powercap_cgroup* cg, uint32_t i) {
+  if (cg->slots[i].fd >= 0) {
+    close(cg->slots[i].fd);
+  }
+  free(cg->slots[i].path);
+  attrib_table_remove(&table_ops, cg->slots, cg->nslots, i);
+  cg->nentries--;
+}
+
+/* Returns 0 and sets usage, or -1 if the file can't be read or parsed */
+static int read_usage(int fd, uint64_t* usage) {
+  char buf[CPU_STAT_SIZE];
+  const char* p;
+  char* end;
+  ssize_t n;
+  if (fd < 0 || (n = pread(fd, buf, sizeof(buf) - 1, 0)) <= 0) {
+    return -1;
+  }
+  buf[n] = '\0';
+  for (p = buf; strncmp(p, "usage_usec ", 11); p++) {
+    if ((p = strchr(p, '\n')) == NULL) {
+      return -1;
+    }
+  }
+  errno = 0;
+  *usage = strtoull(p + 11, &end, 10);
+  return (end == p + 11 || errno) ? -1 : 0;
+}
+
+static void visit(powercap_cgroup* cg, int dirfd, const char* path, uint32_t depth) {
+  powercap_cgroup_entry* e;
+  uint64_t h = hash_path(path);
+  uint64_t usage;
+  uint32_t i = find_slot(cg, path, h);
+  int fresh = 0;
+  if (cg->slots[i].path == NULL) {
+    /* keep the load factor at most 1/2 */
+    if (2 * (cg->nentries + 1) > cg->nslots) {
+      if (grow(cg)) {
+        LOG(ERROR, "powercap_cgroup: Failed to grow table: %s\n", strerror(errno));
+        return;
+      }
+      i = find_slot(cg, path, h);
+    }
+    e = &cg->slots[i];
+    if ((e->path = strdup(path)) == NULL) {
+      return;
+    }
+    e->hash = h;
+    e->depth = depth;
+    e->fd = openat(dirfd, "cpu.stat", O_RDONLY | O_CLOEXEC);
+    cg->nentries++;
+    fresh = 1;
+  }
+  e = &cg->slots[i];
+  if (!fresh && read_usage(e->fd, &usage)) {
+    /* removed and recreated with the same name since the last sample (or lacks usage): start over */
+    if (e->fd >= 0) {
+      close(e->fd);
+    }
+    e->fd = openat(dirfd, "cpu.stat", O_RDONLY | O_CLOEXEC);
+    e->pkg_energy_uj = 0;
+    e->core_energy_uj = 0;
+    fresh = 1;
+  }
+  if (fresh) {
+    e->usage_delta_usec = 0;
+    e->usage_usec = read_usage(e->fd, &usage) ? 0 : usage;
+  } else {
+    e->usage_delta_usec = usage >= e->usage_usec ? usage - e->usage_usec : 0;
+    e->usage_usec = usage;
+  }
+  e->alive = 1;
+  e->seen = cg->samples;
+}
+
+static void walk(powercap_cgroup* cg, int dirfd, char* path, size_t len, uint32_t depth) {
+  struct dirent* ent;
+  struct stat st;
+  DIR* dir;
+  size_t name_len;
+  int fd;
+  visit(cg, dirfd, path, depth);
+  if ((fd = openat(dirfd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+    return;
+  }
+  if ((dir = fdopendir(fd)) == NULL) {
+    close(fd);
+    return;
+  }
+  while ((ent = readdir(dir)) != NULL) {
+    if (ent->d_name[0] == '.' && (!ent->d_name[1] || (ent->d_name[1] == '.' && !ent->d_name[2]))) {
+      continue;
+    }
+    if (ent->d_type != DT_DIR && (ent->d_type != DT_UNKNOWN ||
+        fstatat(dirfd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) || !S_ISDIR(st.st_mode))) {
+      continue;
+    }
+    name_len = strlen(ent->d_name);
+    if (len + name_len + 2 > PATH_MAX) {
+      continue;
+    }
+    if ((fd = openat(dirfd, ent->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+      /* removed since listing */
+      continue;
+    }
+    if (len) {
+      path[len] = '/';
+      memcpy(path + len + 1, ent->d_name, name_len + 1);
+      walk(cg, fd, path, len + 1 + name_len, depth + 1);
+    } else {
+      memcpy(path, ent->d_name, name_len + 1);
+      walk(cg, fd, path, name_len, depth + 1);
+    }
+    path[len] = '\0';
+    close(fd);
+  }
+  closedir(dir);
+}
+
+int powercap_cgroup_init(powercap_cgroup* cg, const char* root, const powercap_rapl_pkg* pkgs, uint32_t npkgs) {
+  int ret;
+  if (cg == NULL || (pkgs == NULL && npkgs)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(cg, 0, sizeof(powercap_cgroup));
+  if ((cg->root_fd = open(root ? root : POWERCAP_CGROUP_DEFAULT_ROOT, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+    return -errno;
+  }
+  cg->pkgs = pkgs;
+  cg->npkgs = npkgs;
+  cg->nslots = MIN_SLOTS;
+  if ((cg->slots = calloc(cg->nslots, sizeof(powercap_cgroup_entry))) == NULL) {
+    ret = -errno;
+  } else {
+    ret = attrib_energy_init(pkgs, npkgs, &cg->energy_uj, &cg->max_energy_range_uj);
+  }
+  if (ret) {
+    powercap_cgroup_destroy(cg);
+    errno = -ret;
+  }
+  return ret;
+}
+
+int powercap_cgroup_destroy(powercap_cgroup* cg) {
+  uint32_t i;
+  if (cg == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (i = 0; cg->slots != NULL && i < cg->nslots; i++) {
+    if (cg->slots[i].path != NULL) {
+      if (cg->slots[i].fd >= 0) {
+        close(cg->slots[i].fd);
+      }
+      free(cg->slots[i].path);
+    }
+  }
+  if (cg->root_fd >= 0) {
+    close(cg->root_fd);
+  }
+  free(cg->max_energy_range_uj);
+  free(cg->energy_uj);
+  free(cg->slots);
+  memset(cg, 0, sizeof(powercap_cgroup));
+  cg->root_fd = -1;
+  return 0;
+}
+
+int powercap_cgroup_sample(powercap_cgroup* cg) {
+  powercap_cgroup_entry* e;
+  const powercap_cgroup_entry* root;
+  char path[PATH_MAX];
+  uint64_t total = 0;
+  uint32_t i;
+  if (cg == NULL || cg->slots == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  cg->samples++;
+  attrib_energy_read(cg->pkgs, cg->npkgs, cg->energy_uj, cg->max_energy_range_uj, cg->samples == 1, &cg->pkg_delta_uj,
+                     &cg->core_delta_uj);
+  path[0] = '\0';
+  walk(cg, cg->root_fd, path, 0, 0);
+
+  /* cgroups that are gone are kept for one sample, then removed */
+  for (i = 0; i < cg->nslots; i++) {
+    e = &cg->slots[i];
+    if (e->path != NULL && e->seen != cg->samples && e->alive) {
+      e->alive = 0;
+      e->usage_delta_usec = 0;
+      /* so that it's removed next time */
+      e->seen = cg->samples;
+    }
+  }
+  for (i = 0; i < cg->nslots;) {
+    e = &cg->slots[i];
+    if (e->path != NULL && !e->alive && e->seen != cg->samples) {
+      /* another entry may be shifted into this slot */
+      remove_slot(cg, i);
+    } else {
+      i++;
+    }
+  }
+
+  root = powercap_cgroup_get(cg, "");
+  if (root != NULL && root->fd >= 0) {
+    total = root->usage_delta_usec;
+  } else {
+    for (i = 0; i < cg->nslots; i++) {
+      if (cg->slots[i].path != NULL && cg->slots[i].depth == 1) {
+        total += cg->slots[i].usage_delta_usec;
+      }
+    }
+  }
+  if (!total || (!cg->pkg_delta_uj && !cg->core_delta_uj)) {
+    return 0;
+  }
+  for (i = 0; i < cg->nslots; i++) {
+    e = &cg->slots[i];
+    if (e->path != NULL && e->usage_delta_usec) {
+      e->pkg_energy_uj += (uint64_t) ((double) cg->pkg_delta_uj * e->usage_delta_usec / total + 0.5);
+      e->core_energy_uj += (uint64_t) ((double) cg->core_delta_uj * e->usage_delta_usec / total + 0.5);
+    }
+  }
+  return 0;
+}
+
+const powercap_cgroup_entry* powercap_cgroup_get(const powercap_cgroup* cg, const char* path) {
+  uint32_t i;
+  if (cg == NULL || cg->slots == NULL || path == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+  i = find_slot(cg, path, hash_path(path));
+  return cg->slots[i].path == NULL ? NULL : &cg->slots[i];
+}
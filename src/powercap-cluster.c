@@ -0,0 +1,803 @@
+/**
+ * Cluster power budget coordinator and agent.
+ *
+ * Frames are a 4-byte big-endian payload length followed by the payload, whose first byte is the message type.
+ * Integers are LEB128 varints; deltas are zigzag-encoded so that decreases stay small.
+ *   HELLO:  version, count, count * {id, min_power_uw, max_power_uw}
+ *   REPORT: count, count * {id, delta(power_uw), delta(demand_uw)}
+ *   CAPS:   count, count * {id, delta(cap_uw)}
+ * Delta bases start at 0 when a node is registered.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "powercap-common.h"
+#include "powercap-cluster.h"
+
+#define MSG_HELLO 1
+#define MSG_REPORT 2
+#define MSG_CAPS 3
+
+#define FRAME_HEADER_SIZE 4
+#define READ_CHUNK_SIZE 4096
+
+static int buf_reserve(powercap_cluster_buf* b, size_t extra) {
+  unsigned char* data;
+  size_t size;
+  if (b->len + extra <= b->size) {
+    return 0;
+  }
+  size = b->size ? b->size : 256;
+  while (size < b->len + extra) {
+    size *= 2;
+  }
+  if ((data = realloc(b->data, size)) == NULL) {
+    return -errno;
+  }
+  b->data = data;
+  b->size = size;
+  return 0;
+}
+
+static void buf_free(powercap_cluster_buf* b) {
+  free(b->data);
+  memset(b, 0, sizeof(powercap_cluster_buf));
+}
+
+static void buf_consume(powercap_cluster_buf* b, size_t n) {
+  memmove(b->data, b->data + n, b->len - n);
+  b->len -= n;
+}
+
+/* caller must have reserved VARINT_MAX_SIZE bytes */
+static void buf_put_varint(powercap_cluster_buf* b, uint64_t v) {
+  b->len = (size_t) (put_varint(b->data + b->len, v) - b->data);
+}
+
+static void buf_put_delta(powercap_cluster_buf* b, uint64_t prev, uint64_t cur) {
+  /* two's complement difference */
+  buf_put_varint(b, zigzag(cur - prev));
+}
+
+static int buf_get_varint(const unsigned char** p, const unsigned char* end, uint64_t* v) {
+  const unsigned char* next = get_varint(*p, end, v);
+  if (next == NULL) {
+    return -1;
+  }
+  *p = next;
+  return 0;
+}
+
+static int get_delta(const unsigned char** p, const unsigned char* end, uint64_t* base) {
+  uint64_t z;
+  if (buf_get_varint(p, end, &z)) {
+    return -1;
+  }
+  *base += unzigzag(z);
+  return 0;
+}
+
+static int get_id(const unsigned char** p, const unsigned char* end, uint32_t* id) {
+  uint64_t v;
+  if (buf_get_varint(p, end, &v) || v > UINT32_MAX) {
+    return -1;
+  }
+  *id = (uint32_t) v;
+  return 0;
+}
+
+/* Returns the payload offset, to later be passed to frame_end */
+static size_t frame_begin(powercap_cluster_buf* b, unsigned char type) {
+  size_t off = b->len;
+  b->len += FRAME_HEADER_SIZE;
+  b->data[b->len++] = type;
+  return off;
+}
+
+static void frame_end(powercap_cluster_buf* b, size_t off) {
+  uint32_t len = (uint32_t) (b->len - off - FRAME_HEADER_SIZE);
+  b->data[off] = (unsigned char) (len >> 24);
+  b->data[off + 1] = (unsigned char) (len >> 16);
+  b->data[off + 2] = (unsigned char) (len >> 8);
+  b->data[off + 3] = (unsigned char) len;
+}
+
+/* Returns the frame size (header included) if a complete frame is buffered, 0 if not, or -1 if too large */
+static int64_t frame_peek(const powercap_cluster_buf* b) {
+  uint32_t len;
+  if (b->len < FRAME_HEADER_SIZE) {
+    return 0;
+  }
+  len = ((uint32_t) b->data[0] << 24) | ((uint32_t) b->data[1] << 16) | ((uint32_t) b->data[2] << 8) | b->data[3];
+  if (!len || len > POWERCAP_CLUSTER_MAX_FRAME_SIZE) {
+    return -1;
+  }
+  return b->len < FRAME_HEADER_SIZE + (size_t) len ? 0 : (int64_t) (FRAME_HEADER_SIZE + len);
+}
+
+/* Returns 0 if the peer closed the connection, > 0 if data was read, or -errno (including -EAGAIN) */
+static ssize_t read_into(int fd, powercap_cluster_buf* b) {
+  ssize_t n;
+  if (buf_reserve(b, READ_CHUNK_SIZE)) {
+    return -errno;
+  }
+  do {
+    n = read(fd, b->data + b->len, b->size - b->len);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    return -errno;
+  }
+  b->len += (size_t) n;
+  return n;
+}
+
+/* Write as much as possible without blocking (if fd is non-blocking); returns 0 or -errno, but not -EAGAIN */
+static int flush(int fd, powercap_cluster_buf* b) {
+  ssize_t n;
+  size_t off = 0;
+  while (off < b->len) {
+    n = send(fd, b->data + off, b->len - off, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return -errno;
+    }
+    off += (size_t) n;
+  }
+  buf_consume(b, off);
+  return 0;
+}
+
+static int set_nonblocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    return -errno;
+  }
+  return 0;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*) a;
+  uint64_t y = *(const uint64_t*) b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/* Raise alloc toward limit, sharing remaining equally (max-min fair) in O(n log n); returns what couldn't be given */
+static uint64_t fair_fill(uint64_t* alloc, const uint64_t* limit, uint32_t n, uint64_t remaining, uint64_t* room) {
+  uint64_t level = 0;
+  uint64_t need;
+  uint64_t extra = 0;
+  uint64_t give;
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    room[i] = limit[i] > alloc[i] ? limit[i] - alloc[i] : 0;
+  }
+  qsort(room, n, sizeof(uint64_t), cmp_u64);
+  for (i = 0; i < n && remaining; i++) {
+    need = (room[i] - level) * (n - i);
+    if (need <= remaining) {
+      remaining -= need;
+      level = room[i];
+    } else {
+      level += remaining / (n - i);
+      extra = remaining % (n - i);
+      remaining = 0;
+    }
+  }
+  for (i = 0; i < n; i++) {
+    if (limit[i] > alloc[i]) {
+      give = limit[i] - alloc[i] < level ? limit[i] - alloc[i] : level;
+      /* hand out the indivisible remainder one unit at a time */
+      if (extra && limit[i] - alloc[i] > level) {
+        give++;
+        extra--;
+      }
+      alloc[i] += give;
+    }
+  }
+  return remaining;
+}
+
+/* Coordinator */
+
+static int64_t find_node(const powercap_cluster_coord* coord, uint32_t id) {
+  uint32_t lo = 0;
+  uint32_t hi = coord->nnodes;
+  uint32_t mid;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (coord->nodes[mid].id < id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo < coord->nnodes && coord->nodes[lo].id == id) ? (int64_t) lo : -(int64_t) lo - 1;
+}
+
+static powercap_cluster_node* register_node(powercap_cluster_coord* coord, uint32_t id) {
+  powercap_cluster_node* nodes;
+  int64_t idx = find_node(coord, id);
+  uint32_t pos;
+  if (idx >= 0) {
+    return &coord->nodes[idx];
+  }
+  pos = (uint32_t) (-idx - 1);
+  if (coord->nnodes == coord->nodes_size) {
+    if ((nodes = realloc(coord->nodes, (coord->nodes_size ? 2 * coord->nodes_size : 16) *
+                                       sizeof(powercap_cluster_node))) == NULL) {
+      return NULL;
+    }
+    coord->nodes = nodes;
+    coord->nodes_size = coord->nodes_size ? 2 * coord->nodes_size : 16;
+  }
+  memmove(&coord->nodes[pos + 1], &coord->nodes[pos], (coord->nnodes - pos) * sizeof(powercap_cluster_node));
+  coord->nnodes++;
+  coord->nodes[pos].id = id;
+  return &coord->nodes[pos];
+}
+
+static void drop_conn(powercap_cluster_coord* coord, uint32_t idx) {
+  powercap_cluster_conn* conn = &coord->conns[idx];
+  uint32_t i;
+  uint32_t j;
+  for (i = 0, j = 0; i < coord->nnodes; i++) {
+    if (coord->nodes[i].fd != conn->fd) {
+      coord->nodes[j++] = coord->nodes[i];
+    }
+  }
+  LOG(INFO, "powercap_cluster: Dropping connection %d with %"PRIu32" node(s)\n", conn->fd, coord->nnodes - j);
+  coord->nnodes = j;
+  close(conn->fd);
+  buf_free(&conn->in);
+  buf_free(&conn->out);
+  coord->conns[idx] = coord->conns[--coord->nconns];
+}
+
+static int handle_hello(powercap_cluster_coord* coord, int fd, const unsigned char* p, const unsigned char* end) {
+  powercap_cluster_node* node;
+  uint64_t version;
+  uint64_t count;
+  uint64_t min;
+  uint64_t max;
+  uint32_t id;
+  if (buf_get_varint(&p, end, &version) || version != POWERCAP_CLUSTER_PROTOCOL_VERSION) {
+    LOG(ERROR, "powercap_cluster: Unsupported protocol version\n");
+    return -1;
+  }
+  if (buf_get_varint(&p, end, &count)) {
+    return -1;
+  }
+  for (; count; count--) {
+    if (get_id(&p, end, &id) || buf_get_varint(&p, end, &min) || buf_get_varint(&p, end, &max) || min > max) {
+      return -1;
+    }
+    if ((node = register_node(coord, id)) == NULL) {
+      return -1;
+    }
+    /* (re)registration resets the delta bases */
+    memset(node, 0, sizeof(powercap_cluster_node));
+    node->id = id;
+    node->fd = fd;
+    node->min_power_uw = min;
+    node->max_power_uw = max;
+  }
+  return p == end ? 0 : -1;
+}
+
+static int handle_report(powercap_cluster_coord* coord, int fd, const unsigned char* p, const unsigned char* end) {
+  powercap_cluster_node* node;
+  uint64_t power;
+  uint64_t demand;
+  uint64_t count;
+  int64_t idx;
+  uint32_t id;
+  if (buf_get_varint(&p, end, &count)) {
+    return -1;
+  }
+  for (; count; count--) {
+    if (get_id(&p, end, &id)) {
+      return -1;
+    }
+    idx = find_node(coord, id);
+    node = (idx >= 0 && coord->nodes[idx].fd == fd) ? &coord->nodes[idx] : NULL;
+    power = node ? node->power_uw : 0;
+    demand = node ? node->demand_uw : 0;
+    if (get_delta(&p, end, &power) || get_delta(&p, end, &demand)) {
+      return -1;
+    }
+    /* ignore nodes that aren't (or are no longer) registered on this connection */
+    if (node) {
+      node->power_uw = power;
+      node->demand_uw = demand;
+    }
+  }
+  return p == end ? 0 : -1;
+}
+
+/* Returns 0 to keep the connection or -1 to drop it */
+static int handle_input(powercap_cluster_coord* coord, powercap_cluster_conn* conn) {
+  const unsigned char* payload;
+  int64_t size;
+  ssize_t n;
+  int ret;
+  do {
+    n = read_into(conn->fd, &conn->in);
+  } while (n > 0);
+  if (!n || (n < 0 && n != -EAGAIN && n != -EWOULDBLOCK)) {
+    return -1;
+  }
+  while ((size = frame_peek(&conn->in)) > 0) {
+    payload = conn->in.data + FRAME_HEADER_SIZE;
+    switch (payload[0]) {
+    case MSG_HELLO:
+      ret = handle_hello(coord, conn->fd, payload + 1, conn->in.data + size);
+      break;
+    case MSG_REPORT:
+      ret = handle_report(coord, conn->fd, payload + 1, conn->in.data + size);
+      break;
+    default:
+      ret = -1;
+      break;
+    }
+    if (ret) {
+      LOG(ERROR, "powercap_cluster: Malformed message on connection %d\n", conn->fd);
+      return -1;
+    }
+    buf_consume(&conn->in, (size_t) size);
+  }
+  return size < 0 ? -1 : 0;
+}
+
+int powercap_cluster_coord_init(powercap_cluster_coord* coord, int listen_fd, uint64_t budget_uw) {
+  if (coord == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(coord, 0, sizeof(powercap_cluster_coord));
+  coord->listen_fd = listen_fd;
+  coord->budget_uw = budget_uw;
+  return 0;
+}
+
+int powercap_cluster_coord_destroy(powercap_cluster_coord* coord) {
+  if (coord == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  while (coord->nconns) {
+    drop_conn(coord, coord->nconns - 1);
+  }
+  free(coord->conns);
+  free(coord->nodes);
+  memset(coord, 0, sizeof(powercap_cluster_coord));
+  coord->listen_fd = -1;
+  return 0;
+}
+
+int powercap_cluster_coord_add_conn(powercap_cluster_coord* coord, int fd) {
+  powercap_cluster_conn* conns;
+  int ret;
+  if (coord == NULL || fd < 0) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((ret = set_nonblocking(fd))) {
+    return ret;
+  }
+  if (coord->nconns == coord->conns_size) {
+    if ((conns = realloc(coord->conns, (coord->conns_size ? 2 * coord->conns_size : 16) *
+                                       sizeof(powercap_cluster_conn))) == NULL) {
+      return -errno;
+    }
+    coord->conns = conns;
+    coord->conns_size = coord->conns_size ? 2 * coord->conns_size : 16;
+  }
+  memset(&coord->conns[coord->nconns], 0, sizeof(powercap_cluster_conn));
+  coord->conns[coord->nconns++].fd = fd;
+  return 0;
+}
+
+int powercap_cluster_coord_set_budget(powercap_cluster_coord* coord, uint64_t budget_uw) {
+  if (coord == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  coord->budget_uw = budget_uw;
+  return 0;
+}
+
+int powercap_cluster_coord_poll(powercap_cluster_coord* coord, int timeout_ms) {
+  struct pollfd* pfds;
+  powercap_cluster_conn* conn;
+  uint32_t off;
+  uint32_t n;
+  uint32_t i;
+  int fd;
+  if (coord == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  off = coord->listen_fd >= 0 ? 1 : 0;
+  n = coord->nconns + off;
+  if (!n) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((pfds = malloc(n * sizeof(struct pollfd))) == NULL) {
+    return -errno;
+  }
+  if (off) {
+    pfds[0].fd = coord->listen_fd;
+    pfds[0].events = POLLIN;
+  }
+  for (i = 0; i < coord->nconns; i++) {
+    pfds[i + off].fd = coord->conns[i].fd;
+    pfds[i + off].events = POLLIN | (coord->conns[i].out.len ? POLLOUT : 0);
+  }
+  if (poll(pfds, n, timeout_ms) < 0) {
+    free(pfds);
+    return errno == EINTR ? 0 : -errno;
+  }
+  /* reverse order, since dropping a connection moves the last one into its place */
+  for (i = coord->nconns; i > 0; i--) {
+    conn = &coord->conns[i - 1];
+    if ((pfds[i - 1 + off].revents & (POLLIN | POLLHUP | POLLERR) && handle_input(coord, conn)) ||
+        (conn->out.len && flush(conn->fd, &conn->out))) {
+      drop_conn(coord, i - 1);
+    }
+  }
+  if (off && (pfds[0].revents & POLLIN)) {
+    if ((fd = accept4(coord->listen_fd, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+      LOG(WARN, "powercap_cluster: accept failed: %s\n", strerror(errno));
+    } else if (powercap_cluster_coord_add_conn(coord, fd)) {
+      close(fd);
+    }
+  }
+  free(pfds);
+  return 0;
+}
+
+/* Queue a CAPS frame for each connection with nodes whose caps changed, then try to send them */
+static int queue_caps(powercap_cluster_coord* coord) {
+  powercap_cluster_node* node;
+  powercap_cluster_conn* conn;
+  uint32_t* counts;
+  size_t* offs;
+  int* conn_of_fd;
+  int max_fd = 0;
+  uint32_t i;
+  int ret = 0;
+  for (i = 0; i < coord->nconns; i++) {
+    max_fd = coord->conns[i].fd > max_fd ? coord->conns[i].fd : max_fd;
+  }
+  conn_of_fd = malloc(((size_t) max_fd + 1) * sizeof(int));
+  counts = calloc(coord->nconns ? coord->nconns : 1, sizeof(uint32_t));
+  offs = malloc((coord->nconns ? coord->nconns : 1) * sizeof(size_t));
+  if (conn_of_fd == NULL || counts == NULL || offs == NULL) {
+    ret = -errno;
+  } else {
+    for (i = 0; i < coord->nconns; i++) {
+      conn_of_fd[coord->conns[i].fd] = (int) i;
+    }
+    for (i = 0; i < coord->nnodes; i++) {
+      if (coord->nodes[i].cap_uw != coord->nodes[i].sent_cap_uw) {
+        counts[conn_of_fd[coord->nodes[i].fd]]++;
+      }
+    }
+    /* reserve everything up front so that no frame is left half-written */
+    for (i = 0; i < coord->nconns && !ret; i++) {
+      if (counts[i]) {
+        ret = buf_reserve(&coord->conns[i].out, FRAME_HEADER_SIZE + 1 + (1 + 2 * (size_t) counts[i]) * VARINT_MAX_SIZE);
+      }
+    }
+  }
+  if (!ret) {
+    for (i = 0; i < coord->nconns; i++) {
+      if (counts[i]) {
+        offs[i] = frame_begin(&coord->conns[i].out, MSG_CAPS);
+        buf_put_varint(&coord->conns[i].out, counts[i]);
+      }
+    }
+    for (i = 0; i < coord->nnodes; i++) {
+      node = &coord->nodes[i];
+      if (node->cap_uw != node->sent_cap_uw) {
+        conn = &coord->conns[conn_of_fd[node->fd]];
+        buf_put_varint(&conn->out, node->id);
+        buf_put_delta(&conn->out, node->sent_cap_uw, node->cap_uw);
+        node->sent_cap_uw = node->cap_uw;
+      }
+    }
+    for (i = coord->nconns; i > 0; i--) {
+      conn = &coord->conns[i - 1];
+      if (counts[i - 1]) {
+        frame_end(&conn->out, offs[i - 1]);
+      }
+      if (conn->out.len && flush(conn->fd, &conn->out)) {
+        drop_conn(coord, i - 1);
+      }
+    }
+  }
+  free(offs);
+  free(counts);
+  free(conn_of_fd);
+  return ret;
+}
+
+int powercap_cluster_coord_rebalance(powercap_cluster_coord* coord) {
+  powercap_cluster_node* node;
+  uint64_t* scratch;
+  uint64_t* alloc;
+  uint64_t* limit;
+  uint64_t* room;
+  uint64_t remaining;
+  uint64_t sum_min = 0;
+  uint32_t i;
+  if (coord == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (!coord->nnodes) {
+    return 0;
+  }
+  if ((scratch = malloc(3 * (size_t) coord->nnodes * sizeof(uint64_t))) == NULL) {
+    return -errno;
+  }
+  alloc = scratch;
+  limit = scratch + coord->nnodes;
+  room = scratch + 2 * coord->nnodes;
+  for (i = 0; i < coord->nnodes; i++) {
+    node = &coord->nodes[i];
+    alloc[i] = node->min_power_uw;
+    limit[i] = node->demand_uw > node->max_power_uw ? node->max_power_uw : node->demand_uw;
+    sum_min += node->min_power_uw;
+  }
+  if (coord->budget_uw < sum_min) {
+    LOG(WARN, "powercap_cluster: Budget %"PRIu64" uW is less than the nodes' minimum power %"PRIu64" uW\n",
+        coord->budget_uw, sum_min);
+  } else {
+    /* first satisfy demand, then share any surplus up to the maximums */
+    remaining = fair_fill(alloc, limit, coord->nnodes, coord->budget_uw - sum_min, room);
+    for (i = 0; i < coord->nnodes; i++) {
+      limit[i] = coord->nodes[i].max_power_uw;
+    }
+    fair_fill(alloc, limit, coord->nnodes, remaining, room);
+  }
+  for (i = 0; i < coord->nnodes; i++) {
+    coord->nodes[i].cap_uw = alloc[i];
+  }
+  free(scratch);
+  return queue_caps(coord);
+}
+
+/* Agent */
+
+static int write_all(int fd, powercap_cluster_buf* b) {
+  ssize_t n;
+  size_t off = 0;
+  while (off < b->len) {
+    n = send(fd, b->data + off, b->len - off, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    off += (size_t) n;
+  }
+  b->len = 0;
+  return 0;
+}
+
+static int cmp_agent_node(const void* a, const void* b) {
+  uint32_t x = ((const powercap_cluster_agent_node*) a)->id;
+  uint32_t y = ((const powercap_cluster_agent_node*) b)->id;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static powercap_cluster_agent_node* agent_find_node(const powercap_cluster_agent* agent, uint32_t id) {
+  powercap_cluster_agent_node key;
+  key.id = id;
+  return bsearch(&key, agent->nodes, agent->nnodes, sizeof(powercap_cluster_agent_node), cmp_agent_node);
+}
+
+int powercap_cluster_agent_init(powercap_cluster_agent* agent, int fd, const powercap_cluster_node_info* nodes,
+                                uint32_t nnodes) {
+  powercap_cluster_buf b = { NULL, 0, 0 };
+  size_t off;
+  uint32_t i;
+  int err_save;
+  int ret;
+  if (agent == NULL || fd < 0 || nodes == NULL || !nnodes) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(agent, 0, sizeof(powercap_cluster_agent));
+  agent->fd = fd;
+  if ((agent->nodes = calloc(nnodes, sizeof(powercap_cluster_agent_node))) == NULL) {
+    return -errno;
+  }
+  agent->nnodes = nnodes;
+  for (i = 0; i < nnodes; i++) {
+    agent->nodes[i].id = nodes[i].id;
+  }
+  qsort(agent->nodes, nnodes, sizeof(powercap_cluster_agent_node), cmp_agent_node);
+  for (i = 1; i < nnodes; i++) {
+    if (agent->nodes[i].id == agent->nodes[i - 1].id) {
+      powercap_cluster_agent_destroy(agent);
+      errno = EINVAL;
+      return -errno;
+    }
+  }
+  if (!(ret = buf_reserve(&b, FRAME_HEADER_SIZE + 1 + (2 + 3 * (size_t) nnodes) * VARINT_MAX_SIZE))) {
+    off = frame_begin(&b, MSG_HELLO);
+    buf_put_varint(&b, POWERCAP_CLUSTER_PROTOCOL_VERSION);
+    buf_put_varint(&b, nnodes);
+    for (i = 0; i < nnodes; i++) {
+      buf_put_varint(&b, nodes[i].id);
+      buf_put_varint(&b, nodes[i].min_power_uw);
+      buf_put_varint(&b, nodes[i].max_power_uw);
+    }
+    frame_end(&b, off);
+    ret = write_all(fd, &b);
+  }
+  buf_free(&b);
+  if (ret) {
+    err_save = errno;
+    powercap_cluster_agent_destroy(agent);
+    errno = err_save;
+  }
+  return ret;
+}
+
+int powercap_cluster_agent_destroy(powercap_cluster_agent* agent) {
+  if (agent == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  free(agent->nodes);
+  buf_free(&agent->in);
+  memset(agent, 0, sizeof(powercap_cluster_agent));
+  agent->fd = -1;
+  return 0;
+}
+
+int powercap_cluster_agent_report(powercap_cluster_agent* agent, const powercap_cluster_report* reports,
+                                  uint32_t nreports) {
+  powercap_cluster_buf b = { NULL, 0, 0 };
+  powercap_cluster_agent_node* node;
+  uint32_t count = 0;
+  size_t off;
+  uint32_t i;
+  int ret;
+  if (agent == NULL || agent->nodes == NULL || (reports == NULL && nreports)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (i = 0; i < nreports; i++) {
+    if ((node = agent_find_node(agent, reports[i].id)) == NULL) {
+      errno = EINVAL;
+      return -errno;
+    }
+    if (node->power_uw != reports[i].power_uw || node->demand_uw != reports[i].demand_uw) {
+      count++;
+    }
+  }
+  if (!count) {
+    return 0;
+  }
+  if ((ret = buf_reserve(&b, FRAME_HEADER_SIZE + 1 + (1 + 3 * (size_t) count) * VARINT_MAX_SIZE))) {
+    return ret;
+  }
+  off = frame_begin(&b, MSG_REPORT);
+  buf_put_varint(&b, count);
+  for (i = 0; i < nreports; i++) {
+    node = agent_find_node(agent, reports[i].id);
+    if (node->power_uw != reports[i].power_uw || node->demand_uw != reports[i].demand_uw) {
+      buf_put_varint(&b, node->id);
+      buf_put_delta(&b, node->power_uw, reports[i].power_uw);
+      buf_put_delta(&b, node->demand_uw, reports[i].demand_uw);
+      node->power_uw = reports[i].power_uw;
+      node->demand_uw = reports[i].demand_uw;
+    }
+  }
+  frame_end(&b, off);
+  ret = write_all(agent->fd, &b);
+  buf_free(&b);
+  return ret;
+}
+
+static int handle_caps(powercap_cluster_agent* agent, const unsigned char* p, const unsigned char* end) {
+  powercap_cluster_agent_node* node;
+  uint64_t count;
+  uint64_t cap;
+  uint32_t id;
+  int updated = 0;
+  if (buf_get_varint(&p, end, &count)) {
+    return -1;
+  }
+  for (; count; count--) {
+    if (get_id(&p, end, &id)) {
+      return -1;
+    }
+    node = agent_find_node(agent, id);
+    cap = node ? node->cap_uw : 0;
+    if (get_delta(&p, end, &cap)) {
+      return -1;
+    }
+    if (node) {
+      node->cap_uw = cap;
+      updated++;
+    }
+  }
+  return p == end ? updated : -1;
+}
+
+int powercap_cluster_agent_recv(powercap_cluster_agent* agent, int timeout_ms) {
+  struct pollfd pfd;
+  const unsigned char* payload;
+  int64_t size;
+  ssize_t n;
+  int updated = 0;
+  int ret;
+  if (agent == NULL || agent->nodes == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  pfd.fd = agent->fd;
+  pfd.events = POLLIN;
+  if ((ret = poll(&pfd, 1, timeout_ms)) < 0) {
+    return errno == EINTR ? 0 : -errno;
+  }
+  if (!ret) {
+    return 0;
+  }
+  if ((n = read_into(agent->fd, &agent->in)) < 0 && n != -ECONNRESET) {
+    return (int) n;
+  }
+  if (n <= 0) {
+    errno = EPIPE;
+    return -errno;
+  }
+  while ((size = frame_peek(&agent->in)) > 0) {
+    payload = agent->in.data + FRAME_HEADER_SIZE;
+    if (payload[0] != MSG_CAPS || (ret = handle_caps(agent, payload + 1, agent->in.data + size)) < 0) {
+      errno = EPROTO;
+      return -errno;
+    }
+    updated += ret;
+    buf_consume(&agent->in, (size_t) size);
+  }
+  if (size < 0) {
+    errno = EPROTO;
+    return -errno;
+  }
+  return updated;
+}
+
+int powercap_cluster_agent_get_cap(const powercap_cluster_agent* agent, uint32_t id, uint64_t* cap_uw) {
+  const powercap_cluster_agent_node* node;
+  if (agent == NULL || cap_uw == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((node = agent_find_node(agent, id)) == NULL) {
+    errno = ENOENT;
+    return -errno;
+  }
+  *cap_uw = node->cap_uw;
+  return 0;
+}
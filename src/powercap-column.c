@@ -0,0 +1,524 @@
+/**
+ * Compact columnar files of energy counter samples.
+ *
+ * All integers are little-endian.
+ * The file is a header, the blocks in time order, the index, and a trailer:
+ *   header:  "PCC" 1 | u32 nzones | u32 block_rows | u32 0 | u64 max_energy_range_uj for each zone
+ *   block:   i64 first time | u64 first counter for each zone
+ *            then for each remaining row: varint zigzag(time delta - previous time delta)
+ *            then for each zone: varint base | u8 width | the remaining rows' zigzag(counter delta) - base, packed in
+ *            width bits each (LSB first)
+ *   index:   for each block: i64 start | i64 end | u64 offset | u32 size | u32 nrows | u64 min, u64 max for each zone
+ *   trailer: u64 index offset | u32 nblocks | "PCCI"
+ * Deltas use wrapping arithmetic, so a counter overflow is just a large negative delta.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "powercap-column.h"
+#include "powercap-common.h"
+#include "powercap-sampler.h"
+
+#define VERSION 1
+#define HEADER_SIZE(nzones) (16 + 8 * (size_t) (nzones))
+#define BLOCK_FIXED_SIZE(nzones) (8 + 8 * (size_t) (nzones))
+#define ENTRY_SIZE(nzones) (32 + 16 * (size_t) (nzones))
+#define TRAILER_SIZE 16
+
+static const unsigned char magic[3] = { 'P', 'C', 'C' };
+static const unsigned char index_magic[4] = { 'P', 'C', 'C', 'I' };
+
+static uint32_t bit_width(uint64_t v) {
+  uint32_t n = 0;
+  while (v) {
+    v >>= 1;
+    n++;
+  }
+  return n;
+}
+
+/* Append the low width bits of v at bit position pos; out must be zeroed */
+static void pack(unsigned char* out, uint64_t* pos, uint64_t v, uint32_t width) {
+  uint32_t take;
+  while (width) {
+    take = 8 - (uint32_t) (*pos & 7);
+    if (take > width) {
+      take = width;
+    }
+    out[*pos >> 3] |= (unsigned char) ((v & ((1U << take) - 1)) << (*pos & 7));
+    v >>= take;
+    width -= take;
+    *pos += take;
+  }
+}
+
+static uint64_t unpack(const unsigned char* in, uint64_t* pos, uint32_t width) {
+  uint64_t v = 0;
+  uint32_t got = 0;
+  uint32_t take;
+  while (got < width) {
+    take = 8 - (uint32_t) (*pos & 7);
+    if (take > width - got) {
+      take = width - got;
+    }
+    v |= (uint64_t) ((in[*pos >> 3] >> (*pos & 7)) & ((1U << take) - 1)) << got;
+    got += take;
+    *pos += take;
+  }
+  return v;
+}
+
+static int write_all(int fd, const unsigned char* buf, size_t len) {
+  ssize_t n;
+  size_t off = 0;
+  while (off < len) {
+    if ((n = write(fd, buf + off, len - off)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    off += (size_t) n;
+  }
+  return 0;
+}
+
+static size_t max_block_size(uint32_t nzones, uint32_t rows) {
+  return BLOCK_FIXED_SIZE(nzones) + (size_t) VARINT_MAX_SIZE * rows +
+         (size_t) nzones * (VARINT_MAX_SIZE + 1 + 8 * (size_t) rows);
+}
+
+int powercap_column_writer_init(powercap_column_writer* w, int fd, uint32_t nzones,
+                                const uint64_t* max_energy_range_uj, uint32_t block_rows) {
+  unsigned char* p;
+  uint32_t i;
+  int ret;
+  if (!block_rows) {
+    block_rows = POWERCAP_COLUMN_DEFAULT_BLOCK_ROWS;
+  }
+  if (w == NULL || fd < 0 || !nzones || nzones > POWERCAP_COLUMN_MAX_ZONES ||
+      block_rows > POWERCAP_COLUMN_MAX_BLOCK_ROWS ||
+      (uint64_t) nzones * block_rows > POWERCAP_COLUMN_MAX_BLOCK_VALUES) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(w, 0, sizeof(powercap_column_writer));
+  w->fd = fd;
+  w->nzones = nzones;
+  w->block_rows = block_rows;
+  if (!(w->time_ns = malloc(block_rows * sizeof(int64_t))) ||
+      !(w->energy_uj = malloc((size_t) nzones * block_rows * sizeof(uint64_t))) ||
+      !(w->buf = malloc(max_block_size(nzones, block_rows)))) {
+    ret = -errno;
+    free(w->time_ns);
+    free(w->energy_uj);
+    return ret;
+  }
+  p = w->buf;
+  memcpy(p, magic, sizeof(magic));
+  p = put_le(p + sizeof(magic), VERSION, 1);
+  p = put_le(p, nzones, 4);
+  p = put_le(p, block_rows, 4);
+  p = put_le(p, 0, 4);
+  for (i = 0; i < nzones; i++) {
+    p = put_le(p, max_energy_range_uj == NULL ? 0 : max_energy_range_uj[i], 8);
+  }
+  if ((ret = write_all(fd, w->buf, HEADER_SIZE(nzones)))) {
+    free(w->time_ns);
+    free(w->energy_uj);
+    free(w->buf);
+    errno = -ret;
+    return ret;
+  }
+  w->offset = HEADER_SIZE(nzones);
+  return 0;
+}
+
+static int grow_index(powercap_column_writer* w) {
+  size_t need = w->index_size + ENTRY_SIZE(w->nzones);
+  size_t cap = w->index_cap ? w->index_cap : ENTRY_SIZE(w->nzones) * 16;
+  unsigned char* index;
+  while (cap < need) {
+    cap *= 2;
+  }
+  if (cap != w->index_cap) {
+    if (!(index = realloc(w->index, cap))) {
+      return -errno;
+    }
+    w->index = index;
+    w->index_cap = cap;
+  }
+  return 0;
+}
+
+static int write_block(powercap_column_writer* w) {
+  unsigned char* p = w->buf;
+  unsigned char* entry;
+  const uint64_t* col;
+  uint64_t delta;
+  uint64_t prev_delta = 0;
+  uint64_t dmin;
+  uint64_t dmax;
+  uint64_t lo;
+  uint64_t hi;
+  uint64_t pos;
+  uint32_t n = w->nrows;
+  uint32_t width;
+  uint32_t i;
+  uint32_t z;
+  int ret;
+  if ((ret = grow_index(w))) {
+    return ret;
+  }
+  entry = w->index + w->index_size;
+  entry = put_le(entry, (uint64_t) w->time_ns[0], 8);
+  entry = put_le(entry, (uint64_t) w->time_ns[n - 1], 8);
+  entry = put_le(entry, w->offset, 8);
+  /* the size is filled in once known */
+  entry += 4;
+  entry = put_le(entry, n, 4);
+
+  p = put_le(p, (uint64_t) w->time_ns[0], 8);
+  for (z = 0; z < w->nzones; z++) {
+    p = put_le(p, w->energy_uj[(size_t) z * w->block_rows], 8);
+  }
+  for (i = 1; i < n; i++) {
+    delta = (uint64_t) w->time_ns[i] - (uint64_t) w->time_ns[i - 1];
+    p = put_varint(p, zigzag(delta - prev_delta));
+    prev_delta = delta;
+  }
+  for (z = 0; z < w->nzones; z++) {
+    col = &w->energy_uj[(size_t) z * w->block_rows];
+    /* frame of reference for the zigzagged deltas, and the counters' range for the index */
+    dmin = n > 1 ? UINT64_MAX : 0;
+    dmax = 0;
+    lo = col[0];
+    hi = col[0];
+    for (i = 1; i < n; i++) {
+      delta = zigzag(col[i] - col[i - 1]);
+      dmin = delta < dmin ? delta : dmin;
+      dmax = delta > dmax ? delta : dmax;
+      lo = col[i] < lo ? col[i] : lo;
+      hi = col[i] > hi ? col[i] : hi;
+    }
+    entry = put_le(entry, lo, 8);
+    entry = put_le(entry, hi, 8);
+    width = bit_width(dmax - dmin);
+    p = put_varint(p, dmin);
+    *p++ = (unsigned char) width;
+    pos = 0;
+    memset(p, 0, ((size_t) (n - 1) * width + 7) / 8);
+    for (i = 1; i < n; i++) {
+      pack(p, &pos, zigzag(col[i] - col[i - 1]) - dmin, width);
+    }
+    p += (pos + 7) / 8;
+  }
+  put_le(w->index + w->index_size + 24, (uint64_t) (p - w->buf), 4);
+  if ((ret = write_all(w->fd, w->buf, (size_t) (p - w->buf)))) {
+    return ret;
+  }
+  w->index_size += ENTRY_SIZE(w->nzones);
+  w->nblocks++;
+  w->offset += (uint64_t) (p - w->buf);
+  w->nrows = 0;
+  return 0;
+}
+
+int powercap_column_writer_destroy(powercap_column_writer* w) {
+  unsigned char trailer[TRAILER_SIZE];
+  unsigned char* p;
+  int ret;
+  if (w == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  ret = w->err;
+  if (!ret && w->nrows) {
+    ret = write_block(w);
+  }
+  if (!ret && w->index_size) {
+    ret = write_all(w->fd, w->index, w->index_size);
+  }
+  if (!ret) {
+    p = put_le(trailer, w->offset, 8);
+    p = put_le(p, w->nblocks, 4);
+    memcpy(p, index_magic, sizeof(index_magic));
+    ret = write_all(w->fd, trailer, sizeof(trailer));
+  }
+  free(w->time_ns);
+  free(w->energy_uj);
+  free(w->buf);
+  free(w->index);
+  memset(w, 0, sizeof(powercap_column_writer));
+  w->fd = -1;
+  if (ret) {
+    errno = -ret;
+  }
+  return ret;
+}
+
+int powercap_column_writer_append(powercap_column_writer* w, int64_t time_ns, const uint64_t* energy_uj) {
+  uint32_t z;
+  int ret;
+  if (w == NULL || energy_uj == NULL || (w->total_rows && time_ns < w->last_ns)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (w->err) {
+    errno = -w->err;
+    return w->err;
+  }
+  w->time_ns[w->nrows] = time_ns;
+  for (z = 0; z < w->nzones; z++) {
+    w->energy_uj[(size_t) z * w->block_rows + w->nrows] = energy_uj[z];
+  }
+  w->nrows++;
+  w->total_rows++;
+  w->last_ns = time_ns;
+  if (w->nrows == w->block_rows && (ret = write_block(w))) {
+    /* the file can't be completed */
+    w->err = ret;
+    errno = -ret;
+    return ret;
+  }
+  return 0;
+}
+
+int powercap_column_writer_append_snapshot(powercap_column_writer* w, const powercap_sampler_snapshot* snap) {
+  uint64_t* energy_uj;
+  size_t prev;
+  uint32_t z;
+  int ret;
+  if (w == NULL || snap == NULL || snap->nzones != w->nzones || snap->zones == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (!(energy_uj = malloc(w->nzones * sizeof(uint64_t)))) {
+    return -errno;
+  }
+  for (z = 0; z < w->nzones; z++) {
+    prev = (size_t) z * w->block_rows + (w->nrows ? w->nrows - 1 : 0);
+    if (snap->zones[z].valid & POWERCAP_SAMPLER_ZONE_ENERGY) {
+      energy_uj[z] = snap->zones[z].energy_uj;
+    } else if (w->nrows) {
+      energy_uj[z] = w->energy_uj[prev];
+    } else if (w->nblocks) {
+      /* the last row of the block just written is still buffered */
+      energy_uj[z] = w->energy_uj[prev + w->block_rows - 1];
+    } else {
+      energy_uj[z] = 0;
+    }
+  }
+  ret = powercap_column_writer_append(w, snap->time_ns, energy_uj);
+  free(energy_uj);
+  return ret;
+}
+
+static int check_index(powercap_column_reader* r, uint64_t index_offset) {
+  const unsigned char* e;
+  uint64_t offset = HEADER_SIZE(r->nzones);
+  uint64_t size;
+  uint64_t nrows;
+  int64_t start;
+  int64_t end;
+  int64_t prev_end = INT64_MIN;
+  uint32_t i;
+  for (i = 0; i < r->nblocks; i++) {
+    e = r->index + (size_t) i * ENTRY_SIZE(r->nzones);
+    start = (int64_t) get_le(e, 8);
+    end = (int64_t) get_le(e + 8, 8);
+    size = get_le(e + 24, 4);
+    nrows = get_le(e + 28, 4);
+    /* blocks are contiguous and in time order */
+    if (get_le(e + 16, 8) != offset || size < BLOCK_FIXED_SIZE(r->nzones) || size > index_offset - offset ||
+        !nrows || nrows > r->block_rows || start > end || start < prev_end) {
+      return -1;
+    }
+    offset += size;
+    prev_end = end;
+    r->total_rows += nrows;
+  }
+  return offset == index_offset ? 0 : -1;
+}
+
+int powercap_column_reader_open(powercap_column_reader* r, int fd) {
+  struct stat st;
+  unsigned char* map;
+  const unsigned char* t;
+  uint64_t index_offset;
+  uint32_t i;
+  int ret;
+  if (r == NULL || fd < 0) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(r, 0, sizeof(powercap_column_reader));
+  if (fstat(fd, &st)) {
+    return -errno;
+  }
+  if (st.st_size < (off_t) (HEADER_SIZE(1) + TRAILER_SIZE)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    return -errno;
+  }
+  r->map = map;
+  r->size = (size_t) st.st_size;
+  r->nzones = (uint32_t) get_le(map + 4, 4);
+  r->block_rows = (uint32_t) get_le(map + 8, 4);
+  t = map + r->size - TRAILER_SIZE;
+  index_offset = get_le(t, 8);
+  r->nblocks = (uint32_t) get_le(t + 8, 4);
+  if (memcmp(map, magic, sizeof(magic)) || map[3] != VERSION || get_le(map + 12, 4) || memcmp(t + 12, index_magic,
+      sizeof(index_magic)) || !r->nzones || r->nzones > POWERCAP_COLUMN_MAX_ZONES || !r->block_rows ||
+      r->block_rows > POWERCAP_COLUMN_MAX_BLOCK_ROWS || HEADER_SIZE(r->nzones) > index_offset ||
+      index_offset > r->size - TRAILER_SIZE ||
+      (r->size - TRAILER_SIZE - index_offset) / ENTRY_SIZE(r->nzones) != r->nblocks ||
+      (r->size - TRAILER_SIZE - index_offset) % ENTRY_SIZE(r->nzones)) {
+    ret = -EINVAL;
+  } else {
+    r->index = map + index_offset;
+    ret = check_index(r, index_offset) ? -EINVAL : 0;
+  }
+  if (!ret && !(r->max_energy_range_uj = malloc(r->nzones * sizeof(uint64_t)))) {
+    ret = -errno;
+  }
+  if (ret) {
+    munmap(r->map, r->size);
+    memset(r, 0, sizeof(powercap_column_reader));
+    errno = -ret;
+    return ret;
+  }
+  for (i = 0; i < r->nzones; i++) {
+    r->max_energy_range_uj[i] = get_le(map + 16 + 8 * (size_t) i, 8);
+  }
+  return 0;
+}
+
+int powercap_column_reader_close(powercap_column_reader* r) {
+  if (r == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (r->map != NULL) {
+    munmap(r->map, r->size);
+  }
+  free(r->max_energy_range_uj);
+  memset(r, 0, sizeof(powercap_column_reader));
+  return 0;
+}
+
+int powercap_column_reader_get_block(const powercap_column_reader* r, uint32_t block, powercap_column_block* info,
+                                     uint64_t* min_uj, uint64_t* max_uj) {
+  const unsigned char* e;
+  uint32_t z;
+  if (r == NULL || block >= r->nblocks || info == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  e = r->index + (size_t) block * ENTRY_SIZE(r->nzones);
+  info->start_ns = (int64_t) get_le(e, 8);
+  info->end_ns = (int64_t) get_le(e + 8, 8);
+  info->nrows = (uint32_t) get_le(e + 28, 4);
+  for (z = 0; z < r->nzones; z++) {
+    if (min_uj != NULL) {
+      min_uj[z] = get_le(e + 32 + 16 * (size_t) z, 8);
+    }
+    if (max_uj != NULL) {
+      max_uj[z] = get_le(e + 40 + 16 * (size_t) z, 8);
+    }
+  }
+  return 0;
+}
+
+uint32_t powercap_column_reader_find(const powercap_column_reader* r, int64_t time_ns) {
+  uint32_t lo = 0;
+  uint32_t hi;
+  uint32_t mid;
+  if (r == NULL) {
+    errno = EINVAL;
+    return 0;
+  }
+  hi = r->nblocks;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if ((int64_t) get_le(r->index + (size_t) mid * ENTRY_SIZE(r->nzones) + 8, 8) < time_ns) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static const unsigned char* decode_counters(const unsigned char* p, const unsigned char* end, uint64_t* col,
+                                            uint32_t n) {
+  uint64_t base;
+  uint64_t pos = 0;
+  uint32_t width;
+  uint32_t i;
+  if ((p = get_varint(p, end, &base)) == NULL || p >= end || (width = *p++) > 64 ||
+      (size_t) (end - p) < ((size_t) (n - 1) * width + 7) / 8) {
+    return NULL;
+  }
+  for (i = 1; i < n; i++) {
+    col[i] = col[i - 1] + unzigzag(unpack(p, &pos, width) + base);
+  }
+  return p + (pos + 7) / 8;
+}
+
+int powercap_column_reader_decode(const powercap_column_reader* r, uint32_t block, int64_t* time_ns,
+                                  uint64_t* energy_uj) {
+  const unsigned char* e;
+  const unsigned char* p;
+  const unsigned char* end;
+  uint64_t dod;
+  uint64_t delta = 0;
+  uint64_t t;
+  uint32_t n;
+  uint32_t i;
+  uint32_t z;
+  if (r == NULL || block >= r->nblocks) {
+    errno = EINVAL;
+    return -errno;
+  }
+  e = r->index + (size_t) block * ENTRY_SIZE(r->nzones);
+  p = r->map + get_le(e + 16, 8);
+  end = p + get_le(e + 24, 4);
+  n = (uint32_t) get_le(e + 28, 4);
+  t = get_le(p, 8);
+  if (time_ns != NULL) {
+    time_ns[0] = (int64_t) t;
+  }
+  if (energy_uj != NULL) {
+    for (z = 0; z < r->nzones; z++) {
+      energy_uj[(size_t) z * r->block_rows] = get_le(p + 8 + 8 * (size_t) z, 8);
+    }
+  }
+  p += BLOCK_FIXED_SIZE(r->nzones);
+  for (i = 1; p != NULL && i < n; i++) {
+    if ((p = get_varint(p, end, &dod)) != NULL) {
+      delta += unzigzag(dod);
+      t += delta;
+      if (time_ns != NULL) {
+        time_ns[i] = (int64_t) t;
+      }
+    }
+  }
+  for (z = 0; energy_uj != NULL && p != NULL && z < r->nzones; z++) {
+    p = decode_counters(p, end, &energy_uj[(size_t) z * r->block_rows], n);
+  }
+  if (p == NULL || (energy_uj != NULL && p != end)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  return (int) n;
+}
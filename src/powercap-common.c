@@ -15,6 +15,7 @@
 /* Main powercap header only used for enums */
 #include "powercap.h"
 #include "powercap-common.h"
+#include "powercap-trace.h"
 
 #define MAX_U64_SIZE 24
 
@@ -45,9 +46,12 @@ static const char* CONSTRAINT_FILE_SUFFIX[] = {
   "name"
 };
 
-ssize_t read_string_safe(int fd, char* buf, size_t size) {
+ssize_t read_string_safe(int fd, char* buf, size_t size, int attr) {
   ssize_t ret;
-  if ((ret = pread(fd, buf, size - 1, 0)) > 0) {
+  uint64_t start = stats_start();
+  ret = pread(fd, buf, size - 1, 0);
+  stats_record_read(attr, start, ret);
+  if (ret > 0) {
     /* force a terminating character in the buffer */
     if (buf[ret - 1] == '\n') {
       /* also remove newline character */
@@ -64,7 +68,7 @@ ssize_t read_string_safe(int fd, char* buf, size_t size) {
   return ret;
 }
 
-ssize_t read_string(int fd, char* buf, size_t size) {
+ssize_t read_string(int fd, char* buf, size_t size, int attr) {
   if (!buf) {
     errno = EINVAL;
     return (ssize_t) -errno;
@@ -72,37 +76,110 @@ ssize_t read_string(int fd, char* buf, size_t size) {
     errno = ENOBUFS;
     return (ssize_t) -errno;
   }
-  return read_string_safe(fd, buf, size);
+  return read_string_safe(fd, buf, size, attr);
 }
 
-int read_u64(int fd, uint64_t* val) {
+int read_u64(int fd, uint64_t* val, int attr) {
   char buf[MAX_U64_SIZE];
   char* end;
+  TRACE2(read_u64_entry, fd, attr);
   if (!val) {
     errno = EINVAL;
-  } else if (read_string_safe(fd, buf, sizeof(buf)) > 0) {
+  } else if (read_string_safe(fd, buf, sizeof(buf), attr) > 0) {
     errno = 0;
     *val = strtoull(buf, &end, 0);
     if (buf != end && errno != ERANGE) {
+      TRACE4(read_u64_return, fd, attr, 0, *val);
       return 0;
     }
+    if (!errno) {
+      /* nothing was parsed, don't report success */
+      errno = EINVAL;
+    }
+    stats_record_parse_error(attr);
   }
+  TRACE4(read_u64_return, fd, attr, -errno, (uint64_t) 0);
   return -errno;
 }
 
-int write_u64(int fd, uint64_t val) {
+int write_u64(int fd, uint64_t val, int attr) {
   char buf[MAX_U64_SIZE];
   ssize_t written;
+  uint64_t start;
+  int ret = 0;
+  TRACE3(write_u64_entry, fd, attr, val);
   snprintf(buf, sizeof(buf), "%"PRIu64, val);
-  if ((written = pwrite(fd, buf, sizeof(buf), 0)) < 0) {
-    return -errno;
-  }
-  if (!written) {
+  start = stats_start();
+  written = pwrite(fd, buf, sizeof(buf), 0);
+  stats_record_write(attr, start, written);
+  if (written < 0) {
+    ret = -errno;
+  } else if (!written) {
     /* Is there a better error code? */
     errno = EIO;
-    return -errno;
+    ret = -errno;
   }
-  return 0;
+  TRACE3(write_u64_return, fd, attr, ret);
+  return ret;
+}
+
+uint64_t energy_delta_uj(uint64_t prev, uint64_t cur, uint64_t max_range) {
+  if (cur >= prev) {
+    return cur - prev;
+  }
+  /* the counter wraps around to 0 at max_range */
+  return (max_range && prev <= max_range) ? max_range - prev + cur : 0;
+}
+
+unsigned char* put_le(unsigned char* p, uint64_t v, size_t n) {
+  size_t i;
+  for (i = 0; i < n; i++) {
+    p[i] = (unsigned char) (v >> (8 * i));
+  }
+  return p + n;
+}
+
+uint64_t get_le(const unsigned char* p, size_t n) {
+  uint64_t v = 0;
+  size_t i;
+  for (i = 0; i < n; i++) {
+    v |= (uint64_t) p[i] << (8 * i);
+  }
+  return v;
+}
+
+uint64_t zigzag(uint64_t v) {
+  return (v << 1) ^ (0 - (v >> 63));
+}
+
+uint64_t unzigzag(uint64_t v) {
+  return (v >> 1) ^ (0 - (v & 1));
+}
+
+unsigned char* put_varint(unsigned char* p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = (unsigned char) (v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (unsigned char) v;
+  return p;
+}
+
+const unsigned char* get_varint(const unsigned char* p, const unsigned char* end, uint64_t* v) {
+  uint32_t shift = 0;
+  *v = 0;
+  while (p < end && shift < 7 * VARINT_MAX_SIZE) {
+    /* the last byte may only hold bit 63 */
+    if (shift == 63 && (*p & 0x7E)) {
+      return NULL;
+    }
+    *v |= (uint64_t) (*p & 0x7F) << shift;
+    if (!(*p++ & 0x80)) {
+      return p;
+    }
+    shift += 7;
+  }
+  return NULL;
 }
 
 int zone_file_get_name(powercap_zone_file type, char* buf, size_t size) {
@@ -114,6 +191,15 @@ int zone_file_get_name(powercap_zone_file type, char* buf, size_t size) {
   return snprintf(buf, size, "%s", ZONE_FILE[type]);
 }
 
+int constraint_file_get_suffix(powercap_constraint_file type, char* buf, size_t size) {
+  /* check type in case users pass bad int value instead of enum; int cast silences clang compiler */
+  if (!buf || !size || (int) type < 0 || (int) type > POWERCAP_CONSTRAINT_FILE_NAME) {
+    errno = EINVAL;
+    return -errno;
+  }
+  return snprintf(buf, size, "%s", CONSTRAINT_FILE_SUFFIX[type]);
+}
+
 int constraint_file_get_name(powercap_constraint_file type, uint32_t constraint, char* buf, size_t size) {
   /* check type in case users pass bad int value instead of enum; int cast silences clang compiler */
   if (!buf || !size || (int) type < 0 || (int) type > POWERCAP_CONSTRAINT_FILE_NAME) {
@@ -207,17 +293,31 @@ size_t get_constraint_file_path(const char* control_type, const uint32_t* zones,
 
 int open_zone_file(const char* control_type, const uint32_t* zones, uint32_t depth, powercap_zone_file type, int flags) {
   char path[PATH_MAX];
+  int fd;
+  TRACE4(open_zone_file_entry, control_type, zones, depth, type);
+  path[0] = '\0';
   if (!get_zone_file_path(control_type, zones, depth, type, path, sizeof(path))) {
-    return -errno;
+    fd = -errno;
+  } else {
+    fd = open(path, flags);
   }
-  return open(path, flags);
+  stats_record_open(ATTR_ZONE(type), fd);
+  TRACE2(open_zone_file_return, path, fd);
+  return fd;
 }
 
 int open_constraint_file(const char* control_type, const uint32_t* zones, uint32_t depth, uint32_t constraint,
                          powercap_constraint_file type, int flags) {
   char path[PATH_MAX];
+  int fd;
+  TRACE5(open_constraint_file_entry, control_type, zones, depth, constraint, type);
+  path[0] = '\0';
   if (!get_constraint_file_path(control_type, zones, depth, constraint, type, path, sizeof(path))) {
-    return -errno;
+    fd = -errno;
+  } else {
+    fd = open(path, flags);
   }
-  return open(path, flags);
+  stats_record_open(ATTR_CONSTRAINT(type), fd);
+  TRACE2(open_constraint_file_return, path, fd);
+  return fd;
 }
@@ -50,21 +50,32 @@ typedef enum powercap_loglevel {
   #define PATH_MAX 4096
 #endif
 
+/*
+ * Zone and constraint file types share a single attribute index space for instrumentation.
+ * Constraint file types are not distinguished by constraint number.
+ */
+#define ATTR_ZONE(type) ((int) (type))
+#define ATTR_CONSTRAINT(type) ((int) POWERCAP_ZONE_FILE_NAME + 1 + (int) (type))
+#define ATTR_COUNT (ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_NAME) + 1)
+
 /* buf must not be NULL and size >= 1 */
-ssize_t read_string_safe(int fd, char* buf, size_t size);
+ssize_t read_string_safe(int fd, char* buf, size_t size, int attr);
 
 /* Return number of bytes read (including terminating NULL char) on success, negative error code on failure */
-ssize_t read_string(int fd, char* buf, size_t size);
+ssize_t read_string(int fd, char* buf, size_t size, int attr);
 
 /* Return 0 on success, negative error code on failure */
-int read_u64(int fd, uint64_t* val);
+int read_u64(int fd, uint64_t* val, int attr);
 
 /* Return 0 on success, negative error code on failure */
-int write_u64(int fd, uint64_t val);
+int write_u64(int fd, uint64_t val, int attr);
 
 /* Return is like snprintf, or negative error code if parameters are bad */
 int zone_file_get_name(powercap_zone_file type, char* buf, size_t size);
 
+/* Return is like snprintf, or negative error code if parameters are bad */
+int constraint_file_get_suffix(powercap_constraint_file type, char* buf, size_t size);
+
 /* Return is like snprintf, or negative error code if parameters are bad */
 int constraint_file_get_name(powercap_constraint_file type, uint32_t constraint, char* buf, size_t size);
 
@@ -89,6 +100,47 @@ int open_zone_file(const char* control_type, const uint32_t* zones, uint32_t dep
 int open_constraint_file(const char* control_type, const uint32_t* zones, uint32_t depth, uint32_t constraint,
                          powercap_constraint_file type, int flags);
 
+/*
+ * Energy consumed between two energy_uj counter readings, allowing for at most one counter overflow.
+ * If max_range is 0 (unknown) and the counter appears to have gone backwards, returns 0.
+ */
+uint64_t energy_delta_uj(uint64_t prev, uint64_t cur, uint64_t max_range);
+
+/* Serialized formats use little-endian fixed-width integers and LEB128 varints */
+#define VARINT_MAX_SIZE 10
+
+/* Write the low n bytes of v; returns p + n */
+unsigned char* put_le(unsigned char* p, uint64_t v, size_t n);
+
+uint64_t get_le(const unsigned char* p, size_t n);
+
+/* Maps two's complement values to small unsigned ones, so that small decreases stay small */
+uint64_t zigzag(uint64_t v);
+
+uint64_t unzigzag(uint64_t v);
+
+/* p must have VARINT_MAX_SIZE bytes available; returns the end of the varint */
+unsigned char* put_varint(unsigned char* p, uint64_t v);
+
+/* Returns the end of the varint, or NULL if it is truncated, too long, or overflows 64 bits */
+const unsigned char* get_varint(const unsigned char* p, const unsigned char* end, uint64_t* v);
+
+/*
+ * Instrumentation hooks, implemented in powercap-stats.c.
+ * stats_start() returns 0 when instrumentation is disabled, in which case the stats_record_* functions that take a
+ * start time do nothing.
+ */
+uint64_t stats_start(void);
+
+void stats_record_open(int attr, int fd);
+
+/* ret is the return value of the pread/pwrite call */
+void stats_record_read(int attr, uint64_t start, ssize_t ret);
+
+void stats_record_write(int attr, uint64_t start, ssize_t ret);
+
+void stats_record_parse_error(int attr);
+
 #pragma GCC visibility pop
 
 #ifdef __cplusplus
@@ -0,0 +1,562 @@
+/**
+ * Capture and restore the writable configuration of all zones of a control type.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap.h"
+#include "powercap-common.h"
+#include "powercap-config.h"
+#include "powercap-sysfs.h"
+
+/* Deeper trees than this aren't searched */
+#define MAX_TREE_DEPTH 64
+#define MAX_LINE_SIZE 256
+#define HEADER "# powercap-config "
+
+#define CONSTRAINT_ALL (POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT | POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW)
+
+/* Open files and pending writes for a zone and its constraints during a restore */
+typedef struct restore_zone {
+  powercap_zone fds;
+  int write_enabled;
+} restore_zone;
+
+typedef struct restore_constraint {
+  powercap_constraint fds;
+  uint32_t write;
+} restore_constraint;
+
+static int config_init(powercap_config* cfg, const char* control_type) {
+  memset(cfg, 0, sizeof(powercap_config));
+  if (control_type != NULL && (cfg->control_type = strdup(control_type)) == NULL) {
+    return -errno;
+  }
+  return 0;
+}
+
+int powercap_config_destroy(powercap_config* cfg) {
+  uint32_t i;
+  if (cfg == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (i = 0; i < cfg->nzones; i++) {
+    free(cfg->zones[i].zones);
+    free(cfg->zones[i].constraints);
+  }
+  free(cfg->zones);
+  free(cfg->control_type);
+  memset(cfg, 0, sizeof(powercap_config));
+  return 0;
+}
+
+static powercap_config_zone* find_zone(const powercap_config* cfg, const uint32_t* zones, uint32_t depth) {
+  uint32_t i;
+  for (i = 0; i < cfg->nzones; i++) {
+    if (cfg->zones[i].depth == depth && (!depth || !memcmp(cfg->zones[i].zones, zones, depth * sizeof(uint32_t)))) {
+      return &cfg->zones[i];
+    }
+  }
+  return NULL;
+}
+
+static powercap_config_zone* add_zone(powercap_config* cfg, const uint32_t* zones, uint32_t depth) {
+  powercap_config_zone* tmp;
+  powercap_config_zone* z;
+  /* grow by one; configurations are small and built once */
+  if ((tmp = realloc(cfg->zones, (cfg->nzones + 1) * sizeof(powercap_config_zone))) == NULL) {
+    return NULL;
+  }
+  cfg->zones = tmp;
+  z = &cfg->zones[cfg->nzones];
+  memset(z, 0, sizeof(powercap_config_zone));
+  if (depth) {
+    if ((z->zones = malloc(depth * sizeof(uint32_t))) == NULL) {
+      return NULL;
+    }
+    memcpy(z->zones, zones, depth * sizeof(uint32_t));
+  }
+  z->depth = depth;
+  cfg->nzones++;
+  return z;
+}
+
+static powercap_config_constraint* get_constraint(powercap_config_zone* z, uint32_t num) {
+  powercap_config_constraint* tmp;
+  if (num >= z->nconstraints) {
+    if ((tmp = realloc(z->constraints, (num + 1) * sizeof(powercap_config_constraint))) == NULL) {
+      return NULL;
+    }
+    memset(&tmp[z->nconstraints], 0, (num + 1 - z->nconstraints) * sizeof(powercap_config_constraint));
+    z->constraints = tmp;
+    z->nconstraints = num + 1;
+  }
+  return &z->constraints[num];
+}
+
+static int capture_zone(powercap_config* cfg, const uint32_t* zones, uint32_t depth) {
+  powercap_config_zone* z;
+  powercap_config_constraint* c;
+  uint32_t enabled;
+  uint32_t n;
+  if ((z = add_zone(cfg, zones, depth)) == NULL) {
+    return -errno;
+  }
+  if (!powercap_sysfs_zone_get_enabled(cfg->control_type, zones, depth, &enabled)) {
+    z->valid |= POWERCAP_CONFIG_ZONE_ENABLED;
+    z->enabled = (int) enabled;
+  }
+  for (n = 0; !powercap_sysfs_constraint_exists(cfg->control_type, zones, depth, n); n++) {
+    if ((c = get_constraint(z, n)) == NULL) {
+      return -errno;
+    }
+    if (!powercap_sysfs_constraint_get_power_limit_uw(cfg->control_type, zones, depth, n, &c->power_limit_uw)) {
+      c->valid |= POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT;
+    }
+    if (!powercap_sysfs_constraint_get_time_window_us(cfg->control_type, zones, depth, n, &c->time_window_us)) {
+      c->valid |= POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW;
+    }
+  }
+  return 0;
+}
+
+/* Capture all zones at this depth and below */
+static int capture_siblings(powercap_config* cfg, uint32_t* zones, uint32_t depth) {
+  int ret = 0;
+  for (zones[depth - 1] = 0; !ret && !powercap_sysfs_zone_exists(cfg->control_type, zones, depth);
+       zones[depth - 1]++) {
+    if (!(ret = capture_zone(cfg, zones, depth)) && depth < MAX_TREE_DEPTH) {
+      ret = capture_siblings(cfg, zones, depth + 1);
+    }
+  }
+  return ret;
+}
+
+int powercap_config_capture(powercap_config* cfg, const char* control_type) {
+  uint32_t zones[MAX_TREE_DEPTH];
+  int ret;
+  if (cfg == NULL || control_type == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((ret = config_init(cfg, control_type))) {
+    return ret;
+  }
+  if (powercap_sysfs_control_type_exists(control_type)) {
+    ret = -ENOENT;
+  } else {
+    ret = capture_siblings(cfg, zones, 1);
+  }
+  if (ret) {
+    powercap_config_destroy(cfg);
+    errno = -ret;
+  }
+  return ret;
+}
+
+/* Add the values of tz that are different from, or missing in, fz (which may be NULL) */
+static int diff_zone(powercap_config* diff, const powercap_config_zone* fz, const powercap_config_zone* tz) {
+  const powercap_config_constraint* tc;
+  const powercap_config_constraint* fc;
+  powercap_config_zone* dz = NULL;
+  powercap_config_constraint* dc;
+  uint32_t valid;
+  uint32_t j;
+  if ((tz->valid & POWERCAP_CONFIG_ZONE_ENABLED) &&
+      (fz == NULL || !(fz->valid & POWERCAP_CONFIG_ZONE_ENABLED) || fz->enabled != tz->enabled)) {
+    if ((dz = add_zone(diff, tz->zones, tz->depth)) == NULL) {
+      return -errno;
+    }
+    dz->valid = POWERCAP_CONFIG_ZONE_ENABLED;
+    dz->enabled = tz->enabled;
+  }
+  for (j = 0; j < tz->nconstraints; j++) {
+    tc = &tz->constraints[j];
+    fc = (fz != NULL && j < fz->nconstraints) ? &fz->constraints[j] : NULL;
+    valid = tc->valid;
+    if (fc != NULL) {
+      if ((fc->valid & POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT) && fc->power_limit_uw == tc->power_limit_uw) {
+        valid &= ~(uint32_t) POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT;
+      }
+      if ((fc->valid & POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW) && fc->time_window_us == tc->time_window_us) {
+        valid &= ~(uint32_t) POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW;
+      }
+    }
+    if (!valid) {
+      continue;
+    }
+    if ((dz == NULL && (dz = add_zone(diff, tz->zones, tz->depth)) == NULL) ||
+        (dc = get_constraint(dz, j)) == NULL) {
+      return -errno;
+    }
+    dc->valid = valid;
+    dc->power_limit_uw = tc->power_limit_uw;
+    dc->time_window_us = tc->time_window_us;
+  }
+  return 0;
+}
+
+int powercap_config_diff(const powercap_config* from, const powercap_config* to, powercap_config* diff) {
+  uint32_t i;
+  int ret;
+  if (from == NULL || to == NULL || diff == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((ret = config_init(diff, to->control_type))) {
+    return ret;
+  }
+  for (i = 0; !ret && i < to->nzones; i++) {
+    ret = diff_zone(diff, find_zone(from, to->zones[i].zones, to->zones[i].depth), &to->zones[i]);
+  }
+  if (ret) {
+    powercap_config_destroy(diff);
+    errno = -ret;
+  }
+  return ret;
+}
+
+/* Open and read everything needed to restore a zone, recording (but not performing) the writes */
+static int restore_prepare(const char* control_type, const powercap_config_zone* z, restore_zone* rz,
+                           restore_constraint* rcs, uint32_t* nwrites) {
+  const powercap_config_constraint* c;
+  restore_constraint* rc;
+  uint64_t val;
+  uint32_t j;
+  int enabled;
+  int ret;
+  if (powercap_sysfs_zone_exists(control_type, z->zones, z->depth)) {
+    errno = ENOENT;
+    return -errno;
+  }
+  if (z->valid & POWERCAP_CONFIG_ZONE_ENABLED) {
+    if ((ret = powercap_sysfs_zone_open(&rz->fds, control_type, z->zones, z->depth, 0))) {
+      return ret;
+    }
+    if (rz->fds.enabled <= 0) {
+      errno = ENOENT;
+      return -errno;
+    }
+    if ((ret = powercap_zone_get_enabled(&rz->fds, &enabled))) {
+      return ret;
+    }
+    if ((rz->write_enabled = (enabled != z->enabled))) {
+      (*nwrites)++;
+    }
+  }
+  for (j = 0; j < z->nconstraints; j++) {
+    c = &z->constraints[j];
+    rc = &rcs[j];
+    if (!(c->valid & CONSTRAINT_ALL)) {
+      continue;
+    }
+    if ((ret = powercap_sysfs_constraint_open(&rc->fds, control_type, z->zones, z->depth, j, 0))) {
+      return ret;
+    }
+    if (c->valid & POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT) {
+      if ((ret = powercap_constraint_get_power_limit_uw(&rc->fds, &val))) {
+        return ret;
+      }
+      if (val != c->power_limit_uw) {
+        rc->write |= POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT;
+        (*nwrites)++;
+      }
+    }
+    if (c->valid & POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW) {
+      if ((ret = powercap_constraint_get_time_window_us(&rc->fds, &val))) {
+        return ret;
+      }
+      if (val != c->time_window_us) {
+        rc->write |= POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW;
+        (*nwrites)++;
+      }
+    }
+  }
+  return 0;
+}
+
+static int restore_apply(const powercap_config_zone* z, const restore_zone* rz, const restore_constraint* rcs,
+                         uint32_t* nwritten) {
+  const powercap_config_constraint* c;
+  uint32_t j;
+  int ret;
+  for (j = 0; j < z->nconstraints; j++) {
+    c = &z->constraints[j];
+    if (rcs[j].write & POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW) {
+      if ((ret = powercap_constraint_set_time_window_us(&rcs[j].fds, c->time_window_us))) {
+        return ret;
+      }
+      (*nwritten)++;
+    }
+    if (rcs[j].write & POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT) {
+      if ((ret = powercap_constraint_set_power_limit_uw(&rcs[j].fds, c->power_limit_uw))) {
+        return ret;
+      }
+      (*nwritten)++;
+    }
+  }
+  /* enable/disable after limits are in place */
+  if (rz->write_enabled) {
+    if ((ret = powercap_zone_set_enabled(&rz->fds, z->enabled))) {
+      return ret;
+    }
+    (*nwritten)++;
+  }
+  return 0;
+}
+
+int powercap_config_restore(const powercap_config* cfg, uint32_t* nwritten) {
+  restore_zone* rzs;
+  restore_constraint* rcs;
+  uint32_t nconstraints = 0;
+  uint32_t nwrites = 0;
+  uint32_t written = 0;
+  uint32_t off;
+  uint32_t i;
+  int err_save;
+  int ret = 0;
+  if (cfg == NULL || cfg->control_type == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (i = 0; i < cfg->nzones; i++) {
+    nconstraints += cfg->zones[i].nconstraints;
+  }
+  rzs = calloc(cfg->nzones ? cfg->nzones : 1, sizeof(restore_zone));
+  rcs = calloc(nconstraints ? nconstraints : 1, sizeof(restore_constraint));
+  if (rzs == NULL || rcs == NULL) {
+    ret = -errno;
+  }
+  for (i = 0, off = 0; !ret && i < cfg->nzones; off += cfg->zones[i].nconstraints, i++) {
+    if ((ret = restore_prepare(cfg->control_type, &cfg->zones[i], &rzs[i], &rcs[off], &nwrites))) {
+      LOG(ERROR, "powercap_config_restore: Failed to open or read zone %"PRIu32" of %s\n", i, cfg->control_type);
+    }
+  }
+  for (i = 0, off = 0; !ret && nwrites && i < cfg->nzones; off += cfg->zones[i].nconstraints, i++) {
+    ret = restore_apply(&cfg->zones[i], &rzs[i], &rcs[off], &written);
+  }
+  err_save = errno;
+  if (rzs != NULL && rcs != NULL) {
+    for (i = 0; i < cfg->nzones; i++) {
+      powercap_sysfs_zone_close(&rzs[i].fds);
+    }
+    for (i = 0; i < nconstraints; i++) {
+      powercap_sysfs_constraint_close(&rcs[i].fds);
+    }
+  }
+  free(rzs);
+  free(rcs);
+  if (nwritten != NULL) {
+    *nwritten = written;
+  }
+  errno = err_save;
+  return ret;
+}
+
+static void write_zones(const powercap_config_zone* z, FILE* f) {
+  uint32_t i;
+  for (i = 0; i < z->depth; i++) {
+    fprintf(f, i ? ":%"PRIu32 : "%"PRIu32, z->zones[i]);
+  }
+}
+
+int powercap_config_write(const powercap_config* cfg, FILE* f) {
+  const powercap_config_zone* z;
+  const powercap_config_constraint* c;
+  uint32_t i;
+  uint32_t j;
+  if (cfg == NULL || cfg->control_type == NULL || f == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  fprintf(f, HEADER"%s\n", cfg->control_type);
+  for (i = 0; i < cfg->nzones; i++) {
+    z = &cfg->zones[i];
+    if (z->valid & POWERCAP_CONFIG_ZONE_ENABLED) {
+      write_zones(z, f);
+      fprintf(f, " z-enabled=%d\n", z->enabled);
+    }
+    for (j = 0; j < z->nconstraints; j++) {
+      c = &z->constraints[j];
+      if (!(c->valid & CONSTRAINT_ALL)) {
+        continue;
+      }
+      write_zones(z, f);
+      fprintf(f, " constraint=%"PRIu32, j);
+      if (c->valid & POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT) {
+        fprintf(f, " c-power-limit=%"PRIu64, c->power_limit_uw);
+      }
+      if (c->valid & POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW) {
+        fprintf(f, " c-time-window=%"PRIu64, c->time_window_us);
+      }
+      fputc('\n', f);
+    }
+  }
+  if (fflush(f) || ferror(f)) {
+    errno = EIO;
+    return -errno;
+  }
+  return 0;
+}
+
+static int parse_u64(const char* tok, uint64_t* val) {
+  char* end;
+  errno = 0;
+  *val = strtoull(tok, &end, 0);
+  return (*tok == '-' || end == tok || *end != '\0' || errno) ? -1 : 0;
+}
+
+static int parse_zones(char* tok, uint32_t* zones, uint32_t* depth) {
+  char* save;
+  char* z;
+  uint64_t val;
+  *depth = 0;
+  for (z = strtok_r(tok, ":", &save); z != NULL; z = strtok_r(NULL, ":", &save)) {
+    if (*depth == MAX_TREE_DEPTH || parse_u64(z, &val) || val > UINT32_MAX) {
+      return -1;
+    }
+    zones[(*depth)++] = (uint32_t) val;
+  }
+  return *depth ? 0 : -1;
+}
+
+/* Returns 0 on success, 1 for blank lines, or a negative error code (-EINVAL on syntax error) */
+static int parse_line(powercap_config* cfg, char* line) {
+  uint32_t zones[MAX_TREE_DEPTH];
+  uint64_t enabled = 0;
+  uint64_t power_limit = 0;
+  uint64_t time_window = 0;
+  uint64_t constraint = 0;
+  uint32_t zvalid = 0;
+  uint32_t cvalid = 0;
+  int have_constraint = 0;
+  powercap_config_zone* z;
+  powercap_config_constraint* c;
+  char* save;
+  char* tok;
+  char* val;
+  uint32_t depth;
+  if ((tok = strtok_r(line, " \t\r\n", &save)) == NULL) {
+    return 1;
+  }
+  if (parse_zones(tok, zones, &depth)) {
+    return -EINVAL;
+  }
+  while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+    if ((val = strchr(tok, '=')) == NULL) {
+      return -EINVAL;
+    }
+    *val++ = '\0';
+    if (!strcmp(tok, "z-enabled") && !parse_u64(val, &enabled) && enabled <= 1) {
+      zvalid |= POWERCAP_CONFIG_ZONE_ENABLED;
+    } else if (!strcmp(tok, "constraint") && !parse_u64(val, &constraint) && constraint < UINT32_MAX) {
+      have_constraint = 1;
+    } else if (!strcmp(tok, "c-power-limit") && !parse_u64(val, &power_limit)) {
+      cvalid |= POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT;
+    } else if (!strcmp(tok, "c-time-window") && !parse_u64(val, &time_window)) {
+      cvalid |= POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW;
+    } else {
+      return -EINVAL;
+    }
+  }
+  if (!(zvalid || cvalid) || (cvalid && !have_constraint) || (have_constraint && !cvalid)) {
+    return -EINVAL;
+  }
+  if ((z = find_zone(cfg, zones, depth)) == NULL && (z = add_zone(cfg, zones, depth)) == NULL) {
+    return -errno;
+  }
+  if (zvalid) {
+    z->valid |= zvalid;
+    z->enabled = (int) enabled;
+  }
+  if (cvalid) {
+    if ((c = get_constraint(z, (uint32_t) constraint)) == NULL) {
+      return -errno;
+    }
+    c->valid |= cvalid;
+    if (cvalid & POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT) {
+      c->power_limit_uw = power_limit;
+    }
+    if (cvalid & POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW) {
+      c->time_window_us = time_window;
+    }
+  }
+  return 0;
+}
+
+/* Returns 1 if the line is the header (and sets the control type), 0 if not, or a negative error code */
+static int parse_header(powercap_config* cfg, const char* line) {
+  char name[MAX_LINE_SIZE];
+  if (strncmp(line, HEADER, sizeof(HEADER) - 1) || sscanf(line + sizeof(HEADER) - 1, "%255s", name) != 1) {
+    return 0;
+  }
+  /* the name becomes a sysfs path component */
+  if (cfg->control_type != NULL || strchr(name, '/') != NULL || !strcmp(name, ".") || !strcmp(name, "..")) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((cfg->control_type = strdup(name)) == NULL) {
+    return -errno;
+  }
+  return 1;
+}
+
+int powercap_config_read(powercap_config* cfg, FILE* f, uint32_t* bad_line) {
+  char line[MAX_LINE_SIZE];
+  char* comment;
+  uint32_t lineno = 0;
+  size_t len;
+  int ret = 0;
+  if (cfg == NULL || f == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  config_init(cfg, NULL);
+  while (!ret && fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    /* a line that doesn't fit is an error, rather than being split into several */
+    len = strlen(line);
+    if (len && line[len - 1] != '\n' && getc(f) != EOF) {
+      ret = -EINVAL;
+      break;
+    }
+    if ((ret = parse_header(cfg, line)) > 0) {
+      ret = 0;
+      continue;
+    }
+    if (ret) {
+      break;
+    }
+    if ((comment = strchr(line, '#')) != NULL) {
+      *comment = '\0';
+    }
+    if ((ret = parse_line(cfg, line)) > 0) {
+      ret = 0;
+    }
+  }
+  if (!ret && ferror(f)) {
+    ret = -EIO;
+  } else if (!ret && cfg->control_type == NULL) {
+    /* the header is required */
+    lineno = 1;
+    ret = -EINVAL;
+  }
+  if (ret) {
+    if (ret == -EINVAL) {
+      LOG(ERROR, "powercap_config_read: Syntax error on line %"PRIu32"\n", lineno);
+      if (bad_line) {
+        *bad_line = lineno;
+      }
+    }
+    powercap_config_destroy(cfg);
+    errno = -ret;
+  }
+  return ret;
+}
@@ -0,0 +1,975 @@
+/**
+ * Privilege-separated RAPL daemon and client.
+ *
+ * Each message is a single packet: a header, then header.count items.
+ *   READ request:  count * powercap_daemon_zone_id (count 0 reads all zones)
+ *   READ response: count * powercap_daemon_reading
+ *   CAPS request:  count * powercap_daemon_cap
+ *   CAPS response: no items
+ *   OPEN request:  1 * uint32_t package
+ *   OPEN response: count * msg_file_id, with the files passed in the same order
+ * Responses carry the request type and a status of 0 or -errno.
+ * A connection with accepted cap requests isn't read from again until they're answered, so responses stay in order.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-common.h"
+#include "powercap-daemon.h"
+#include "powercap-rapl.h"
+
+#define MSG_READ 1
+#define MSG_CAPS 2
+#define MSG_OPEN 3
+
+typedef struct msg_header {
+  uint8_t version;
+  uint8_t type;
+  uint16_t count;
+  int32_t status;
+} msg_header;
+
+#define MAX_MSG_SIZE (sizeof(msg_header) + POWERCAP_DAEMON_MAX_ITEMS * sizeof(powercap_daemon_reading))
+
+#define NUM_CONSTRAINTS 2
+
+/* Identifies a file of a package, independent of how powercap_rapl_pkg is laid out */
+typedef struct msg_file_id {
+  /* a powercap_rapl_zone */
+  uint16_t zone;
+  /* a powercap_rapl_constraint, or FILE_ZONE */
+  uint8_t constraint;
+  /* a powercap_zone_file or powercap_constraint_file */
+  uint8_t file;
+} msg_file_id;
+
+#define FILE_ZONE 0xFF
+#define NUM_ZONE_FILES (POWERCAP_ZONE_FILE_NAME + 1)
+#define NUM_CONSTRAINT_FILES (POWERCAP_CONSTRAINT_FILE_NAME + 1)
+#define PKG_FILES (POWERCAP_DAEMON_PKG_ZONES * (NUM_ZONE_FILES + NUM_CONSTRAINTS * NUM_CONSTRAINT_FILES))
+
+static int64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint32_t nzones(const powercap_daemon* d) {
+  return d->npkgs * POWERCAP_DAEMON_PKG_ZONES;
+}
+
+static int is_zone_supported(const powercap_daemon* d, uint32_t zone_idx) {
+  return d->slots[zone_idx * NUM_CONSTRAINTS + POWERCAP_RAPL_CONSTRAINT_LONG].supported;
+}
+
+/* Returns the zone index, or -1 if the zone doesn't exist */
+static int64_t zone_index(const powercap_daemon* d, uint32_t pkg, uint32_t zone) {
+  int64_t idx;
+  if (pkg >= d->npkgs || zone >= POWERCAP_DAEMON_PKG_ZONES) {
+    return -1;
+  }
+  idx = (int64_t) pkg * POWERCAP_DAEMON_PKG_ZONES + zone;
+  return is_zone_supported(d, (uint32_t) idx) ? idx : -1;
+}
+
+static powercap_rapl_zone_files* get_zone_files(powercap_rapl_pkg* pkg, uint32_t zone) {
+  switch (zone) {
+  case POWERCAP_RAPL_ZONE_PACKAGE:
+    return &pkg->pkg;
+  case POWERCAP_RAPL_ZONE_CORE:
+    return &pkg->core;
+  case POWERCAP_RAPL_ZONE_UNCORE:
+    return &pkg->uncore;
+  case POWERCAP_RAPL_ZONE_DRAM:
+    return &pkg->dram;
+  case POWERCAP_RAPL_ZONE_PSYS:
+    return &pkg->psys;
+  default:
+    return NULL;
+  }
+}
+
+static int* get_zone_fd(powercap_zone* z, uint32_t file) {
+  switch (file) {
+  case POWERCAP_ZONE_FILE_MAX_ENERGY_RANGE_UJ:
+    return &z->max_energy_range_uj;
+  case POWERCAP_ZONE_FILE_ENERGY_UJ:
+    return &z->energy_uj;
+  case POWERCAP_ZONE_FILE_MAX_POWER_RANGE_UW:
+    return &z->max_power_range_uw;
+  case POWERCAP_ZONE_FILE_POWER_UW:
+    return &z->power_uw;
+  case POWERCAP_ZONE_FILE_ENABLED:
+    return &z->enabled;
+  case POWERCAP_ZONE_FILE_NAME:
+    return &z->name;
+  default:
+    return NULL;
+  }
+}
+
+static int* get_constraint_fd(powercap_constraint* c, uint32_t file) {
+  switch (file) {
+  case POWERCAP_CONSTRAINT_FILE_POWER_LIMIT_UW:
+    return &c->power_limit_uw;
+  case POWERCAP_CONSTRAINT_FILE_TIME_WINDOW_US:
+    return &c->time_window_us;
+  case POWERCAP_CONSTRAINT_FILE_MAX_POWER_UW:
+    return &c->max_power_uw;
+  case POWERCAP_CONSTRAINT_FILE_MIN_POWER_UW:
+    return &c->min_power_uw;
+  case POWERCAP_CONSTRAINT_FILE_MAX_TIME_WINDOW_US:
+    return &c->max_time_window_us;
+  case POWERCAP_CONSTRAINT_FILE_MIN_TIME_WINDOW_US:
+    return &c->min_time_window_us;
+  case POWERCAP_CONSTRAINT_FILE_NAME:
+    return &c->name;
+  default:
+    return NULL;
+  }
+}
+
+/* Returns the package's file descriptor for a file, or NULL if the file doesn't exist */
+static int* get_file_fd(powercap_rapl_pkg* pkg, const msg_file_id* id) {
+  powercap_rapl_zone_files* fds;
+  if ((fds = get_zone_files(pkg, id->zone)) == NULL) {
+    return NULL;
+  }
+  switch (id->constraint) {
+  case FILE_ZONE:
+    return get_zone_fd(&fds->zone, id->file);
+  case POWERCAP_RAPL_CONSTRAINT_LONG:
+    return get_constraint_fd(&fds->constraint_long, id->file);
+  case POWERCAP_RAPL_CONSTRAINT_SHORT:
+    return get_constraint_fd(&fds->constraint_short, id->file);
+  default:
+    return NULL;
+  }
+}
+
+/* Fill ids with every file of a package (PKG_FILES of them) */
+static void get_file_ids(msg_file_id* ids) {
+  uint32_t n = 0;
+  uint32_t z;
+  uint32_t c;
+  uint32_t f;
+  for (z = 0; z < POWERCAP_DAEMON_PKG_ZONES; z++) {
+    for (f = 0; f < NUM_ZONE_FILES; f++, n++) {
+      ids[n].zone = (uint16_t) z;
+      ids[n].constraint = FILE_ZONE;
+      ids[n].file = (uint8_t) f;
+    }
+    for (c = 0; c < NUM_CONSTRAINTS; c++) {
+      for (f = 0; f < NUM_CONSTRAINT_FILES; f++, n++) {
+        ids[n].zone = (uint16_t) z;
+        ids[n].constraint = (uint8_t) c;
+        ids[n].file = (uint8_t) f;
+      }
+    }
+  }
+}
+
+/* Read a zone at most once per poll */
+static const powercap_daemon_reading* get_reading(powercap_daemon* d, uint32_t zone_idx) {
+  powercap_daemon_reading* r = &d->cache[zone_idx];
+  const powercap_rapl_pkg* pkg = &d->pkgs[zone_idx / POWERCAP_DAEMON_PKG_ZONES];
+  powercap_rapl_zone zone = (powercap_rapl_zone) (zone_idx % POWERCAP_DAEMON_PKG_ZONES);
+  uint32_t c;
+  if (d->cache_round[zone_idx] == d->round) {
+    return r;
+  }
+  r->pkg = zone_idx / POWERCAP_DAEMON_PKG_ZONES;
+  r->zone = (uint16_t) zone;
+  r->valid = 0;
+  if (powercap_rapl_is_zone_file_supported(pkg, zone, POWERCAP_ZONE_FILE_ENERGY_UJ) == 1 &&
+      !powercap_rapl_get_energy_uj(pkg, zone, &r->energy_uj)) {
+    r->valid |= POWERCAP_DAEMON_ENERGY;
+  }
+  if (powercap_rapl_is_zone_file_supported(pkg, zone, POWERCAP_ZONE_FILE_MAX_ENERGY_RANGE_UJ) == 1 &&
+      !powercap_rapl_get_max_energy_range_uj(pkg, zone, &r->max_energy_range_uj)) {
+    r->valid |= POWERCAP_DAEMON_MAX_ENERGY_RANGE;
+  }
+  for (c = 0; c < NUM_CONSTRAINTS; c++) {
+    if (d->slots[zone_idx * NUM_CONSTRAINTS + c].supported &&
+        !powercap_rapl_get_power_limit_uw(pkg, zone, (powercap_rapl_constraint) c, &r->power_limit_uw[c])) {
+      r->valid |= (uint16_t) (POWERCAP_DAEMON_POWER_LIMIT_LONG << c);
+    }
+  }
+  d->cache_round[zone_idx] = d->round;
+  return r;
+}
+
+static int write_limit(powercap_daemon* d, uint32_t slot, uint64_t limit_uw) {
+  uint32_t zone_idx = slot / NUM_CONSTRAINTS;
+  int ret;
+  if ((ret = powercap_rapl_set_power_limit_uw(&d->pkgs[zone_idx / POWERCAP_DAEMON_PKG_ZONES],
+                                              (powercap_rapl_zone) (zone_idx % POWERCAP_DAEMON_PKG_ZONES),
+                                              (powercap_rapl_constraint) (slot % NUM_CONSTRAINTS), limit_uw))) {
+    LOG(ERROR, "powercap_daemon: Failed to write power limit for package %"PRIu32", zone %"PRIu32
+        ", constraint %"PRIu32": %s\n", zone_idx / POWERCAP_DAEMON_PKG_ZONES, zone_idx % POWERCAP_DAEMON_PKG_ZONES,
+        slot % NUM_CONSTRAINTS, strerror(errno));
+    return ret;
+  }
+  d->slots[slot].limit_uw = limit_uw;
+  return 0;
+}
+
+static void remove_lease(powercap_daemon* d, uint32_t idx) {
+  d->leases[idx] = d->leases[--d->nleases];
+}
+
+static int set_lease(powercap_daemon* d, int fd, uint32_t slot, uint64_t power_limit_uw, uint64_t lease_ms) {
+  powercap_daemon_lease* leases;
+  uint32_t i;
+  for (i = 0; i < d->nleases && (d->leases[i].fd != fd || d->leases[i].slot != slot); i++);
+  if (!lease_ms) {
+    if (i < d->nleases) {
+      remove_lease(d, i);
+    }
+    return 0;
+  }
+  if (i == d->nleases) {
+    if (d->nleases == d->leases_size) {
+      if ((leases = realloc(d->leases, (d->leases_size ? 2 * d->leases_size : 16) *
+                                       sizeof(powercap_daemon_lease))) == NULL) {
+        return -errno;
+      }
+      d->leases = leases;
+      d->leases_size = d->leases_size ? 2 * d->leases_size : 16;
+    }
+    d->leases[d->nleases].fd = fd;
+    d->leases[d->nleases++].slot = slot;
+  }
+  d->leases[i].power_limit_uw = power_limit_uw;
+  d->leases[i].expires_ms = now_ms() + (lease_ms > INT32_MAX ? INT32_MAX : (int64_t) lease_ms);
+  return 0;
+}
+
+/*
+ * Drop expired leases, then write the lowest requested power limit of each constraint, if it changed.
+ * Write failures are recorded in their slots rather than returned.
+ */
+static int apply_limits(powercap_daemon* d) {
+  uint64_t* want;
+  uint32_t nslots = nzones(d) * NUM_CONSTRAINTS;
+  uint32_t i;
+  int64_t now = now_ms();
+  for (i = d->nleases; i > 0; i--) {
+    if (d->leases[i - 1].expires_ms <= now) {
+      remove_lease(d, i - 1);
+    }
+  }
+  if ((want = malloc(nslots * sizeof(uint64_t))) == NULL) {
+    return -errno;
+  }
+  for (i = 0; i < nslots; i++) {
+    want[i] = d->slots[i].baseline_uw;
+  }
+  for (i = 0; i < d->nleases; i++) {
+    if (d->leases[i].power_limit_uw < want[d->leases[i].slot]) {
+      want[d->leases[i].slot] = d->leases[i].power_limit_uw;
+    }
+  }
+  for (i = 0; i < nslots; i++) {
+    d->slots[i].write_err = 0;
+    if (d->slots[i].supported && want[i] != d->slots[i].limit_uw && write_limit(d, i, want[i])) {
+      d->slots[i].write_err = -errno;
+    }
+  }
+  free(want);
+  return 0;
+}
+
+/* The status for a connection's pending cap requests: the first write error of a constraint they touched */
+static int32_t caps_status(const powercap_daemon* d, powercap_daemon_conn* conn) {
+  int32_t status = 0;
+  uint32_t i;
+  for (i = 0; i < nzones(d) * NUM_CONSTRAINTS; i++) {
+    if (conn->pending_slots[i] && !status) {
+      status = d->slots[i].write_err;
+    }
+    conn->pending_slots[i] = 0;
+  }
+  return status;
+}
+
+static int send_msg(int fd, void* buf, size_t len) {
+  ssize_t n;
+  do {
+    n = send(fd, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+  } while (n < 0 && errno == EINTR);
+  return n < 0 ? -errno : 0;
+}
+
+static int send_status(int fd, uint8_t type, int32_t status) {
+  msg_header h;
+  memset(&h, 0, sizeof(msg_header));
+  h.version = POWERCAP_DAEMON_PROTOCOL_VERSION;
+  h.type = type;
+  h.status = status;
+  return send_msg(fd, &h, sizeof(msg_header));
+}
+
+static int handle_read(powercap_daemon* d, int fd, const powercap_daemon_zone_id* ids, uint32_t count,
+                       unsigned char* out) {
+  msg_header* h = (msg_header*) out;
+  powercap_daemon_reading* readings = (powercap_daemon_reading*) (out + sizeof(msg_header));
+  int64_t idx;
+  uint32_t n = 0;
+  uint32_t i;
+  if (!count) {
+    for (i = 0; i < nzones(d) && n < POWERCAP_DAEMON_MAX_ITEMS; i++) {
+      if (is_zone_supported(d, i)) {
+        readings[n++] = *get_reading(d, i);
+      }
+    }
+  } else {
+    for (i = 0; i < count; i++) {
+      if ((idx = zone_index(d, ids[i].pkg, ids[i].zone)) < 0) {
+        return send_status(fd, MSG_READ, -ENOENT);
+      }
+      readings[n++] = *get_reading(d, (uint32_t) idx);
+    }
+  }
+  memset(h, 0, sizeof(msg_header));
+  h->version = POWERCAP_DAEMON_PROTOCOL_VERSION;
+  h->type = MSG_READ;
+  h->count = (uint16_t) n;
+  return send_msg(fd, out, sizeof(msg_header) + n * sizeof(powercap_daemon_reading));
+}
+
+static int is_limit_valid(const powercap_daemon_slot* slot, uint64_t power_limit_uw) {
+  return power_limit_uw && power_limit_uw >= slot->min_uw && (!slot->max_uw || power_limit_uw <= slot->max_uw);
+}
+
+/* Returns 1 if the client is authorized, 0 if not (which is logged), or -errno */
+static int is_authorized(const powercap_daemon* d, int fd, powercap_daemon_request request, uint32_t pkg,
+                     struct ucred* cred) {
+  socklen_t len = sizeof(struct ucred);
+  int allow;
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, cred, &len)) {
+    return -errno;
+  }
+  if (d->authorize == NULL) {
+    /* without an authorization function, only caps are allowed */
+    allow = request == POWERCAP_DAEMON_REQUEST_CAPS;
+  } else {
+    allow = d->authorize(d->authorize_ctx, request, cred->pid, cred->uid, cred->gid, pkg);
+  }
+  if (!allow) {
+    LOG(INFO, "powercap_daemon: Denied %s for package %"PRIu32" to pid %d, uid %u\n",
+        request == POWERCAP_DAEMON_REQUEST_CAPS ? "caps" : "files", pkg, cred->pid, cred->uid);
+  }
+  return allow ? 1 : 0;
+}
+
+/* Returns 1 if the requests were accepted and the response is pending, 0 if answered, or -errno */
+static int handle_caps(powercap_daemon* d, powercap_daemon_conn* conn, const powercap_daemon_cap* caps,
+                       uint32_t count) {
+  struct ucred cred;
+  int64_t idx;
+  uint32_t slot;
+  uint32_t i;
+  int ret;
+  /* validate everything first, so that requests are applied all together or not at all */
+  for (i = 0; i < count; i++) {
+    if ((idx = zone_index(d, caps[i].pkg, caps[i].zone)) < 0 || caps[i].constraint >= NUM_CONSTRAINTS ||
+        !d->slots[idx * NUM_CONSTRAINTS + caps[i].constraint].supported) {
+      return send_status(conn->fd, MSG_CAPS, -ENOENT);
+    }
+    /* a limit the constraint can't take would otherwise win and block the slot for the whole lease */
+    if (caps[i].lease_ms && !is_limit_valid(&d->slots[idx * NUM_CONSTRAINTS + caps[i].constraint],
+                                            caps[i].power_limit_uw)) {
+      return send_status(conn->fd, MSG_CAPS, -EINVAL);
+    }
+  }
+  /* consecutive requests for the same package are authorized together */
+  for (i = 0; i < count; i++) {
+    if ((!i || caps[i].pkg != caps[i - 1].pkg) &&
+        (ret = is_authorized(d, conn->fd, POWERCAP_DAEMON_REQUEST_CAPS, caps[i].pkg, &cred)) <= 0) {
+      return ret ? ret : send_status(conn->fd, MSG_CAPS, -EPERM);
+    }
+  }
+  for (i = 0; i < count; i++) {
+    slot = (uint32_t) zone_index(d, caps[i].pkg, caps[i].zone) * NUM_CONSTRAINTS + caps[i].constraint;
+    if ((ret = set_lease(d, conn->fd, slot, caps[i].power_limit_uw, caps[i].lease_ms))) {
+      return ret;
+    }
+    conn->pending_slots[slot] = 1;
+  }
+  return 1;
+}
+
+/* Pass read-only copies of a package's files, reopened with the daemon's privileges */
+static int handle_open(powercap_daemon* d, int fd, uint32_t pkg, unsigned char* out) {
+  struct ucred cred;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr* cmsg;
+  union {
+    char buf[CMSG_SPACE(PKG_FILES * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  msg_header* h = (msg_header*) out;
+  msg_file_id* ids = (msg_file_id*) (out + sizeof(msg_header));
+  msg_file_id all[PKG_FILES];
+  const int* file;
+  int fds[PKG_FILES];
+  char path[32];
+  uint32_t n = 0;
+  uint32_t i;
+  ssize_t ret;
+  if ((ret = is_authorized(d, fd, POWERCAP_DAEMON_REQUEST_OPEN, pkg, &cred)) <= 0) {
+    return ret ? (int) ret : send_status(fd, MSG_OPEN, -EPERM);
+  }
+  if (pkg >= d->npkgs) {
+    return send_status(fd, MSG_OPEN, -ENOENT);
+  }
+  get_file_ids(all);
+  for (i = 0; i < PKG_FILES; i++) {
+    file = get_file_fd(&d->pkgs[pkg], &all[i]);
+    if (*file > 0) {
+      snprintf(path, sizeof(path), "/proc/self/fd/%d", *file);
+      if ((fds[n] = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        LOG(WARN, "powercap_daemon: Failed to reopen %s: %s\n", path, strerror(errno));
+      } else {
+        ids[n++] = all[i];
+      }
+    }
+  }
+  memset(h, 0, sizeof(msg_header));
+  h->version = POWERCAP_DAEMON_PROTOCOL_VERSION;
+  h->type = MSG_OPEN;
+  h->count = (uint16_t) n;
+  memset(&msg, 0, sizeof(msg));
+  iov.iov_base = out;
+  iov.iov_len = sizeof(msg_header) + n * sizeof(msg_file_id);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (n) {
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(n * sizeof(int));
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(n * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, n * sizeof(int));
+  }
+  do {
+    ret = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+  } while (ret < 0 && errno == EINTR);
+  ret = ret < 0 ? -errno : 0;
+  for (i = 0; i < n; i++) {
+    close(fds[i]);
+  }
+  LOG(INFO, "powercap_daemon: Passed %"PRIu32" file(s) of package %"PRIu32" to pid %d, uid %u\n", n, pkg,
+      cred.pid, cred.uid);
+  return (int) ret;
+}
+
+/* Serve the connection's received requests; returns 0 to keep the connection or -1 to drop it */
+static int handle_input(powercap_daemon* d, powercap_daemon_conn* conn, unsigned char* in, unsigned char* out) {
+  const msg_header* h = (const msg_header*) in;
+  const unsigned char* items = in + sizeof(msg_header);
+  size_t item_size;
+  ssize_t n;
+  int ret;
+  while (!conn->pending_caps) {
+    do {
+      n = recv(conn->fd, in, MAX_MSG_SIZE, MSG_DONTWAIT | MSG_TRUNC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    if (!n) {
+      /* closed */
+      return -1;
+    }
+    switch (h->type) {
+    case MSG_READ:
+      item_size = sizeof(powercap_daemon_zone_id);
+      break;
+    case MSG_CAPS:
+      item_size = sizeof(powercap_daemon_cap);
+      break;
+    case MSG_OPEN:
+      item_size = sizeof(uint32_t);
+      break;
+    default:
+      item_size = 0;
+      break;
+    }
+    if ((size_t) n < sizeof(msg_header) || (size_t) n > MAX_MSG_SIZE ||
+        h->version != POWERCAP_DAEMON_PROTOCOL_VERSION || !item_size || h->count > POWERCAP_DAEMON_MAX_ITEMS ||
+        (h->type == MSG_OPEN && h->count != 1) || (size_t) n != sizeof(msg_header) + h->count * item_size) {
+      LOG(ERROR, "powercap_daemon: Malformed message on connection %d\n", conn->fd);
+      return -1;
+    }
+    if (h->type == MSG_READ) {
+      ret = handle_read(d, conn->fd, (const powercap_daemon_zone_id*) items, h->count, out);
+    } else if (h->type == MSG_OPEN) {
+      ret = handle_open(d, conn->fd, *(const uint32_t*) items, out);
+    } else if ((ret = handle_caps(d, conn, (const powercap_daemon_cap*) items, h->count)) > 0) {
+      conn->pending_caps++;
+      ret = 0;
+    }
+    if (ret) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void drop_conn(powercap_daemon* d, uint32_t idx) {
+  powercap_daemon_conn* conn = &d->conns[idx];
+  uint32_t i;
+  for (i = d->nleases; i > 0; i--) {
+    if (d->leases[i - 1].fd == conn->fd) {
+      remove_lease(d, i - 1);
+    }
+  }
+  LOG(INFO, "powercap_daemon: Dropping connection %d\n", conn->fd);
+  close(conn->fd);
+  free(conn->pending_slots);
+  d->conns[idx] = d->conns[--d->nconns];
+}
+
+static int next_timeout(const powercap_daemon* d, int timeout_ms) {
+  int64_t now = now_ms();
+  int64_t wait;
+  uint32_t i;
+  for (i = 0; i < d->nleases; i++) {
+    wait = d->leases[i].expires_ms > now ? d->leases[i].expires_ms - now : 0;
+    if (timeout_ms < 0 || wait < timeout_ms) {
+      timeout_ms = (int) wait;
+    }
+  }
+  return timeout_ms;
+}
+
+/* Bounds that can't be read are left as 0 */
+static void read_bounds(const powercap_rapl_pkg* pkg, powercap_rapl_zone zone, powercap_rapl_constraint constraint,
+                        powercap_daemon_slot* slot) {
+  if (powercap_rapl_is_constraint_file_supported(pkg, zone, constraint, POWERCAP_CONSTRAINT_FILE_MIN_POWER_UW) != 1 ||
+      powercap_rapl_get_min_power_uw(pkg, zone, constraint, &slot->min_uw)) {
+    slot->min_uw = 0;
+  }
+  if (powercap_rapl_is_constraint_file_supported(pkg, zone, constraint, POWERCAP_CONSTRAINT_FILE_MAX_POWER_UW) != 1 ||
+      powercap_rapl_get_max_power_uw(pkg, zone, constraint, &slot->max_uw)) {
+    slot->max_uw = 0;
+  }
+}
+
+int powercap_daemon_init(powercap_daemon* d, int listen_fd, powercap_rapl_pkg* pkgs, uint32_t npkgs) {
+  powercap_daemon_slot* slot;
+  powercap_rapl_zone zone;
+  powercap_rapl_constraint constraint;
+  uint32_t i;
+  if (d == NULL || pkgs == NULL || !npkgs) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(d, 0, sizeof(powercap_daemon));
+  d->listen_fd = listen_fd;
+  d->round = 1;
+  if ((d->pkgs = malloc(npkgs * sizeof(powercap_rapl_pkg))) == NULL ||
+      (d->slots = calloc((size_t) npkgs * POWERCAP_DAEMON_PKG_ZONES * NUM_CONSTRAINTS,
+                         sizeof(powercap_daemon_slot))) == NULL ||
+      (d->cache = calloc((size_t) npkgs * POWERCAP_DAEMON_PKG_ZONES, sizeof(powercap_daemon_reading))) == NULL ||
+      (d->cache_round = calloc((size_t) npkgs * POWERCAP_DAEMON_PKG_ZONES, sizeof(uint64_t))) == NULL) {
+    free(d->cache);
+    free(d->slots);
+    free(d->pkgs);
+    memset(d, 0, sizeof(powercap_daemon));
+    d->listen_fd = -1;
+    return -errno;
+  }
+  memcpy(d->pkgs, pkgs, npkgs * sizeof(powercap_rapl_pkg));
+  d->npkgs = npkgs;
+  for (i = 0; i < nzones(d) * NUM_CONSTRAINTS; i++) {
+    slot = &d->slots[i];
+    zone = (powercap_rapl_zone) ((i / NUM_CONSTRAINTS) % POWERCAP_DAEMON_PKG_ZONES);
+    constraint = (powercap_rapl_constraint) (i % NUM_CONSTRAINTS);
+    if (powercap_rapl_is_constraint_supported(&d->pkgs[i / NUM_CONSTRAINTS / POWERCAP_DAEMON_PKG_ZONES], zone,
+                                              constraint) == 1) {
+      if (powercap_rapl_get_power_limit_uw(&d->pkgs[i / NUM_CONSTRAINTS / POWERCAP_DAEMON_PKG_ZONES], zone,
+                                           constraint, &slot->baseline_uw)) {
+        LOG(WARN, "powercap_daemon: Failed to read power limit for package %"PRIu32", zone %d, constraint %d: %s\n",
+            i / NUM_CONSTRAINTS / POWERCAP_DAEMON_PKG_ZONES, zone, constraint, strerror(errno));
+      } else {
+        slot->supported = 1;
+        slot->limit_uw = slot->baseline_uw;
+        read_bounds(&d->pkgs[i / NUM_CONSTRAINTS / POWERCAP_DAEMON_PKG_ZONES], zone, constraint, slot);
+      }
+    }
+  }
+  return 0;
+}
+
+int powercap_daemon_destroy(powercap_daemon* d) {
+  uint32_t i;
+  int ret = 0;
+  if (d == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  while (d->nconns) {
+    drop_conn(d, d->nconns - 1);
+  }
+  for (i = 0; i < nzones(d) * NUM_CONSTRAINTS; i++) {
+    if (d->slots[i].supported && d->slots[i].limit_uw != d->slots[i].baseline_uw &&
+        write_limit(d, i, d->slots[i].baseline_uw)) {
+      ret = -errno;
+    }
+  }
+  for (i = 0; i < d->npkgs; i++) {
+    if (powercap_rapl_destroy(&d->pkgs[i])) {
+      ret = -errno;
+    }
+  }
+  free(d->leases);
+  free(d->conns);
+  free(d->cache_round);
+  free(d->cache);
+  free(d->slots);
+  free(d->pkgs);
+  memset(d, 0, sizeof(powercap_daemon));
+  d->listen_fd = -1;
+  return ret;
+}
+
+int powercap_daemon_set_broker(powercap_daemon* d, powercap_daemon_authorize_fn authorize, void* ctx) {
+  if (d == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  d->authorize = authorize;
+  d->authorize_ctx = ctx;
+  return 0;
+}
+
+int powercap_daemon_add_conn(powercap_daemon* d, int fd) {
+  powercap_daemon_conn* conns;
+  if (d == NULL || fd < 0) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (d->nconns == d->conns_size) {
+    if ((conns = realloc(d->conns, (d->conns_size ? 2 * d->conns_size : 16) *
+                                   sizeof(powercap_daemon_conn))) == NULL) {
+      return -errno;
+    }
+    d->conns = conns;
+    d->conns_size = d->conns_size ? 2 * d->conns_size : 16;
+  }
+  if ((d->conns[d->nconns].pending_slots = calloc(nzones(d) * NUM_CONSTRAINTS, 1)) == NULL) {
+    return -errno;
+  }
+  d->conns[d->nconns].fd = fd;
+  d->conns[d->nconns++].pending_caps = 0;
+  return 0;
+}
+
+int powercap_daemon_poll(powercap_daemon* d, int timeout_ms) {
+  struct pollfd* pfds;
+  unsigned char* in;
+  unsigned char* out;
+  powercap_daemon_conn* conn;
+  uint32_t off;
+  uint32_t n;
+  uint32_t i;
+  int32_t status;
+  int ret = 0;
+  int fd;
+  if (d == NULL || d->pkgs == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  off = d->listen_fd >= 0 ? 1 : 0;
+  n = d->nconns + off;
+  pfds = malloc((n ? n : 1) * sizeof(struct pollfd));
+  in = malloc(MAX_MSG_SIZE);
+  out = malloc(MAX_MSG_SIZE);
+  if (pfds == NULL || in == NULL || out == NULL) {
+    ret = -errno;
+  } else {
+    if (off) {
+      pfds[0].fd = d->listen_fd;
+      pfds[0].events = POLLIN;
+    }
+    for (i = 0; i < d->nconns; i++) {
+      pfds[i + off].fd = d->conns[i].fd;
+      pfds[i + off].events = POLLIN;
+    }
+    if (poll(pfds, n, next_timeout(d, timeout_ms)) < 0) {
+      ret = errno == EINTR ? 0 : -errno;
+      n = 0;
+    }
+  }
+  if (!ret && n) {
+    /* all requests in this poll share one read of each zone */
+    d->round++;
+    /* reverse order, since dropping a connection moves the last one into its place */
+    for (i = d->nconns; i > 0; i--) {
+      if (pfds[i - 1 + off].revents && handle_input(d, &d->conns[i - 1], in, out)) {
+        drop_conn(d, i - 1);
+      }
+    }
+  }
+  if (!ret) {
+    ret = apply_limits(d);
+    for (i = d->nconns; i > 0; i--) {
+      conn = &d->conns[i - 1];
+      status = caps_status(d, conn);
+      for (; conn->pending_caps; conn->pending_caps--) {
+        if (send_status(conn->fd, MSG_CAPS, ret ? ret : status)) {
+          drop_conn(d, i - 1);
+          break;
+        }
+      }
+    }
+    if (off && n && (pfds[0].revents & POLLIN)) {
+      if ((fd = accept4(d->listen_fd, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+        LOG(WARN, "powercap_daemon: accept failed: %s\n", strerror(errno));
+      } else if (powercap_daemon_add_conn(d, fd)) {
+        close(fd);
+      }
+    }
+  }
+  free(out);
+  free(in);
+  free(pfds);
+  return ret;
+}
+
+static int make_addr(const char* path, struct sockaddr_un* addr) {
+  if (path == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (strlen(path) >= sizeof(addr->sun_path)) {
+    errno = ENAMETOOLONG;
+    return -errno;
+  }
+  memset(addr, 0, sizeof(struct sockaddr_un));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, path);
+  return 0;
+}
+
+int powercap_daemon_listen(const char* path) {
+  struct sockaddr_un addr;
+  int err_save;
+  int fd;
+  int ret;
+  if ((ret = make_addr(path, &addr))) {
+    return ret;
+  }
+  if ((fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0) {
+    return -errno;
+  }
+  unlink(path);
+  if (bind(fd, (const struct sockaddr*) &addr, sizeof(addr)) || listen(fd, 64)) {
+    err_save = errno;
+    close(fd);
+    errno = err_save;
+    return -errno;
+  }
+  return fd;
+}
+
+int powercap_daemon_connect(const char* path) {
+  struct sockaddr_un addr;
+  int err_save;
+  int fd;
+  int ret;
+  if ((ret = make_addr(path ? path : POWERCAP_DAEMON_DEFAULT_PATH, &addr))) {
+    return ret;
+  }
+  if ((fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0) {
+    return -errno;
+  }
+  if (connect(fd, (const struct sockaddr*) &addr, sizeof(addr))) {
+    err_save = errno;
+    close(fd);
+    errno = err_save;
+    return -errno;
+  }
+  return fd;
+}
+
+/* Send a request and wait for its response, which is stored in resp (truncated to resp_size) */
+static int transact(int fd, uint8_t type, const void* items, size_t items_size, uint16_t count,
+                    void* resp, size_t resp_size) {
+  const msg_header* rh = (const msg_header*) resp;
+  unsigned char* req;
+  msg_header h;
+  ssize_t n;
+  int ret = 0;
+  if ((req = malloc(sizeof(msg_header) + items_size)) == NULL) {
+    return -errno;
+  }
+  memset(&h, 0, sizeof(msg_header));
+  h.version = POWERCAP_DAEMON_PROTOCOL_VERSION;
+  h.type = type;
+  h.count = count;
+  memcpy(req, &h, sizeof(msg_header));
+  if (items_size) {
+    memcpy(req + sizeof(msg_header), items, items_size);
+  }
+  do {
+    n = send(fd, req, sizeof(msg_header) + items_size, MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  free(req);
+  if (n < 0) {
+    return -errno;
+  }
+  do {
+    n = recv(fd, resp, resp_size, MSG_TRUNC);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    ret = -errno;
+  } else if (!n) {
+    errno = EPIPE;
+    ret = -errno;
+  } else if ((size_t) n < sizeof(msg_header) || rh->version != POWERCAP_DAEMON_PROTOCOL_VERSION ||
+             rh->type != type) {
+    errno = EPROTO;
+    ret = -errno;
+  } else if (rh->status) {
+    errno = -rh->status;
+    ret = -errno;
+  }
+  return ret;
+}
+
+int powercap_daemon_read(int fd, const powercap_daemon_zone_id* ids, uint32_t nids,
+                         powercap_daemon_reading* readings, uint32_t nreadings) {
+  const msg_header* h;
+  unsigned char* resp;
+  size_t resp_size;
+  int ret;
+  if (fd < 0 || (ids == NULL && nids) || nids > POWERCAP_DAEMON_MAX_ITEMS || (readings == NULL && nreadings)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (nreadings > POWERCAP_DAEMON_MAX_ITEMS) {
+    nreadings = POWERCAP_DAEMON_MAX_ITEMS;
+  }
+  resp_size = sizeof(msg_header) + nreadings * sizeof(powercap_daemon_reading);
+  if ((resp = malloc(resp_size)) == NULL) {
+    return -errno;
+  }
+  if (!(ret = transact(fd, MSG_READ, ids, nids * sizeof(powercap_daemon_zone_id), (uint16_t) nids,
+                       resp, resp_size))) {
+    h = (const msg_header*) resp;
+    ret = h->count < nreadings ? h->count : (int) nreadings;
+    memcpy(readings, resp + sizeof(msg_header), (size_t) ret * sizeof(powercap_daemon_reading));
+  }
+  free(resp);
+  return ret;
+}
+
+int powercap_daemon_request_caps(int fd, const powercap_daemon_cap* caps, uint32_t ncaps) {
+  msg_header resp;
+  if (fd < 0 || caps == NULL || !ncaps || ncaps > POWERCAP_DAEMON_MAX_ITEMS) {
+    errno = EINVAL;
+    return -errno;
+  }
+  return transact(fd, MSG_CAPS, caps, ncaps * sizeof(powercap_daemon_cap), (uint16_t) ncaps, &resp, sizeof(resp));
+}
+
+int powercap_daemon_open_pkg(int fd, uint32_t pkg, powercap_rapl_pkg* out) {
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr* cmsg;
+  union {
+    char buf[CMSG_SPACE(PKG_FILES * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  unsigned char resp[sizeof(msg_header) + PKG_FILES * sizeof(msg_file_id)];
+  const msg_header* h = (const msg_header*) resp;
+  const msg_file_id* ids = (const msg_file_id*) (resp + sizeof(msg_header));
+  int fds[PKG_FILES];
+  int* file;
+  uint32_t nfds = 0;
+  uint32_t i;
+  msg_header req[2];
+  ssize_t n;
+  int ret = 0;
+  if (fd < 0 || out == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(out, 0, sizeof(powercap_rapl_pkg));
+  /* the header followed by the package */
+  memset(req, 0, sizeof(req));
+  req[0].version = POWERCAP_DAEMON_PROTOCOL_VERSION;
+  req[0].type = MSG_OPEN;
+  req[0].count = 1;
+  memcpy(&req[1], &pkg, sizeof(uint32_t));
+  do {
+    n = send(fd, req, sizeof(msg_header) + sizeof(uint32_t), MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    return -errno;
+  }
+  memset(&msg, 0, sizeof(msg));
+  iov.iov_base = resp;
+  iov.iov_len = sizeof(resp);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  do {
+    n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    return -errno;
+  }
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      nfds = (uint32_t) ((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+      memcpy(fds, CMSG_DATA(cmsg), nfds * sizeof(int));
+    }
+  }
+  if (!n) {
+    errno = EPIPE;
+    ret = -errno;
+  } else if ((size_t) n < sizeof(msg_header) || h->version != POWERCAP_DAEMON_PROTOCOL_VERSION ||
+             h->type != MSG_OPEN || (msg.msg_flags & MSG_CTRUNC) || h->count != nfds ||
+             (size_t) n != sizeof(msg_header) + nfds * sizeof(msg_file_id)) {
+    errno = EPROTO;
+    ret = -errno;
+  } else if (h->status) {
+    errno = -h->status;
+    ret = -errno;
+  }
+  for (i = 0; i < nfds && !ret; i++) {
+    if ((file = get_file_fd(out, &ids[i])) == NULL || *file) {
+      errno = EPROTO;
+      ret = -errno;
+    } else {
+      *file = fds[i];
+    }
+  }
+  if (ret) {
+    for (i = 0; i < nfds; i++) {
+      close(fds[i]);
+    }
+    memset(out, 0, sizeof(powercap_rapl_pkg));
+    return ret;
+  }
+  return 0;
+}
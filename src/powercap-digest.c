@@ -0,0 +1,318 @@
+/**
+ * Streaming statistics over power samples in constant memory.
+ *
+ * The serialized format is a header followed by the non-empty buckets in increasing order:
+ *   "PCD" 1 | u8 sub_bits | u8 max_bits | u16 0 | u32 nbuckets | u64 count | f64 mean | f64 m2 | u64 min | u64 max
+ *   then for each bucket: u32 index | u64 count
+ * All integers are little-endian, and doubles are stored as the little-endian integers with the same bits.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include "powercap-common.h"
+#include "powercap-digest.h"
+#include "powercap-sampler.h"
+
+#define SUB (1U << POWERCAP_DIGEST_SUB_BITS)
+#define HALF (1U << (POWERCAP_DIGEST_SUB_BITS - 1))
+
+#define VERSION 1
+#define HEADER_SIZE 52
+#define ENTRY_SIZE 12
+
+static const unsigned char magic[3] = { 'P', 'C', 'D' };
+
+static uint32_t log2_u64(uint64_t v) {
+  uint32_t r = 0;
+  if (v >> 32) {
+    v >>= 32;
+    r += 32;
+  }
+  if (v >> 16) {
+    v >>= 16;
+    r += 16;
+  }
+  if (v >> 8) {
+    v >>= 8;
+    r += 8;
+  }
+  if (v >> 4) {
+    v >>= 4;
+    r += 4;
+  }
+  if (v >> 2) {
+    v >>= 2;
+    r += 2;
+  }
+  return r + (uint32_t) (v >> 1);
+}
+
+static uint32_t bucket_index(uint64_t v) {
+  uint32_t g;
+  if (v < SUB) {
+    return (uint32_t) v;
+  }
+  if (v >> POWERCAP_DIGEST_MAX_BITS) {
+    return POWERCAP_DIGEST_BUCKETS - 1;
+  }
+  /* the group of buckets for this power of 2, each 2^g wide */
+  g = log2_u64(v) - (POWERCAP_DIGEST_SUB_BITS - 1);
+  return SUB + (g - 1) * HALF + (uint32_t) (v >> g) - HALF;
+}
+
+/* The midpoint of a bucket */
+static uint64_t bucket_value(uint32_t idx) {
+  uint32_t g;
+  uint64_t lo;
+  if (idx < SUB) {
+    return idx;
+  }
+  g = (idx - SUB) / HALF + 1;
+  lo = (uint64_t) (HALF + (idx - SUB) % HALF) << g;
+  return lo + (((uint64_t) 1 << g) - 1) / 2;
+}
+
+int powercap_digest_init(powercap_digest* d) {
+  if (d == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(d, 0, sizeof(powercap_digest));
+  return 0;
+}
+
+int powercap_digest_add(powercap_digest* d, uint64_t val) {
+  double delta;
+  if (d == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (!d->count || val < d->min) {
+    d->min = val;
+  }
+  if (!d->count || val > d->max) {
+    d->max = val;
+  }
+  d->count++;
+  delta = (double) val - d->mean;
+  d->mean += delta / (double) d->count;
+  d->m2 += delta * ((double) val - d->mean);
+  d->buckets[bucket_index(val)]++;
+  return 0;
+}
+
+int powercap_digest_add_snapshot(powercap_digest* digests, const powercap_sampler_snapshot* snap) {
+  uint32_t i;
+  if (digests == NULL || snap == NULL || (snap->nzones && snap->zones == NULL)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (i = 0; i < snap->nzones; i++) {
+    if (snap->zones[i].valid & POWERCAP_SAMPLER_ZONE_POWER) {
+      powercap_digest_add(&digests[i], snap->zones[i].power_uw);
+    }
+  }
+  return 0;
+}
+
+int powercap_digest_merge(powercap_digest* dst, const powercap_digest* src) {
+  double n;
+  double delta;
+  uint32_t i;
+  if (dst == NULL || src == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (!src->count) {
+    return 0;
+  }
+  if (!dst->count || src->min < dst->min) {
+    dst->min = src->min;
+  }
+  if (!dst->count || src->max > dst->max) {
+    dst->max = src->max;
+  }
+  /* Chan et al.'s parallel combination of Welford's method */
+  n = (double) dst->count + (double) src->count;
+  delta = src->mean - dst->mean;
+  dst->mean += delta * (double) src->count / n;
+  dst->m2 += src->m2 + delta * delta * (double) dst->count * (double) src->count / n;
+  dst->count += src->count;
+  for (i = 0; i < POWERCAP_DIGEST_BUCKETS; i++) {
+    dst->buckets[i] += src->buckets[i];
+  }
+  return 0;
+}
+
+double powercap_digest_variance(const powercap_digest* d) {
+  if (d == NULL || d->count < 2) {
+    return 0;
+  }
+  return d->m2 / (double) (d->count - 1);
+}
+
+int powercap_digest_quantile(const powercap_digest* d, double q, uint64_t* val) {
+  uint64_t rank;
+  uint64_t seen = 0;
+  uint32_t i;
+  if (d == NULL || val == NULL || !(q >= 0 && q <= 1)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (!d->count) {
+    errno = ENODATA;
+    return -errno;
+  }
+  /* the smallest value with at least q of all values at or below it */
+  rank = (uint64_t) (q * (double) d->count);
+  if ((double) rank < q * (double) d->count || !rank) {
+    rank++;
+  }
+  /* the extremes are exact */
+  if (rank == 1) {
+    *val = d->min;
+    return 0;
+  }
+  if (rank == d->count) {
+    *val = d->max;
+    return 0;
+  }
+  for (i = 0; i < POWERCAP_DIGEST_BUCKETS - 1; i++) {
+    if ((seen += d->buckets[i]) >= rank) {
+      break;
+    }
+  }
+  *val = bucket_value(i);
+  if (*val < d->min) {
+    *val = d->min;
+  } else if (*val > d->max || i == POWERCAP_DIGEST_BUCKETS - 1) {
+    /* the last bucket is unbounded */
+    *val = d->max;
+  }
+  return 0;
+}
+
+static uint32_t count_nonempty(const powercap_digest* d) {
+  uint32_t n = 0;
+  uint32_t i;
+  for (i = 0; i < POWERCAP_DIGEST_BUCKETS; i++) {
+    n += d->buckets[i] != 0;
+  }
+  return n;
+}
+
+size_t powercap_digest_serialized_size(const powercap_digest* d) {
+  if (d == NULL) {
+    errno = EINVAL;
+    return 0;
+  }
+  return HEADER_SIZE + (size_t) count_nonempty(d) * ENTRY_SIZE;
+}
+
+static uint64_t double_bits(double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+static double bits_double(uint64_t bits) {
+  double v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+ssize_t powercap_digest_serialize(const powercap_digest* d, void* buf, size_t size) {
+  unsigned char* p = buf;
+  uint32_t n;
+  uint32_t i;
+  if (d == NULL || buf == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  n = count_nonempty(d);
+  if (size < HEADER_SIZE + (size_t) n * ENTRY_SIZE) {
+    errno = ENOBUFS;
+    return -errno;
+  }
+  memcpy(p, magic, sizeof(magic));
+  p += sizeof(magic);
+  p = put_le(p, VERSION, 1);
+  p = put_le(p, POWERCAP_DIGEST_SUB_BITS, 1);
+  p = put_le(p, POWERCAP_DIGEST_MAX_BITS, 1);
+  p = put_le(p, 0, 2);
+  p = put_le(p, n, 4);
+  p = put_le(p, d->count, 8);
+  p = put_le(p, double_bits(d->mean), 8);
+  p = put_le(p, double_bits(d->m2), 8);
+  p = put_le(p, d->min, 8);
+  p = put_le(p, d->max, 8);
+  for (i = 0; i < POWERCAP_DIGEST_BUCKETS; i++) {
+    if (d->buckets[i]) {
+      p = put_le(p, i, 4);
+      p = put_le(p, d->buckets[i], 8);
+    }
+  }
+  return (ssize_t) (HEADER_SIZE + (size_t) n * ENTRY_SIZE);
+}
+
+int powercap_digest_deserialize(powercap_digest* d, const void* buf, size_t len) {
+  const unsigned char* p = buf;
+  uint64_t version;
+  uint64_t sub_bits;
+  uint64_t max_bits;
+  uint64_t pad;
+  uint64_t n;
+  uint64_t idx;
+  uint64_t cnt;
+  uint64_t mean;
+  uint64_t m2;
+  uint64_t total = 0;
+  uint64_t i;
+  int64_t prev = -1;
+  if (d == NULL || buf == NULL || len < HEADER_SIZE || memcmp(p, magic, sizeof(magic))) {
+    errno = EINVAL;
+    return -errno;
+  }
+  p += sizeof(magic);
+  version = get_le(p, 1);
+  sub_bits = get_le(p + 1, 1);
+  max_bits = get_le(p + 2, 1);
+  pad = get_le(p + 3, 2);
+  n = get_le(p + 5, 4);
+  p += 9;
+  if (version != VERSION || sub_bits != POWERCAP_DIGEST_SUB_BITS || max_bits != POWERCAP_DIGEST_MAX_BITS || pad ||
+      n > POWERCAP_DIGEST_BUCKETS || len != HEADER_SIZE + n * ENTRY_SIZE) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(d, 0, sizeof(powercap_digest));
+  d->count = get_le(p, 8);
+  mean = get_le(p + 8, 8);
+  m2 = get_le(p + 16, 8);
+  d->min = get_le(p + 24, 8);
+  d->max = get_le(p + 32, 8);
+  p += 40;
+  d->mean = bits_double(mean);
+  d->m2 = bits_double(m2);
+  for (i = 0; i < n; i++) {
+    idx = get_le(p, 4);
+    cnt = get_le(p + 4, 8);
+    p += ENTRY_SIZE;
+    /* strictly increasing indexes, so there are no duplicates */
+    if ((int64_t) idx <= prev || idx >= POWERCAP_DIGEST_BUCKETS || !cnt) {
+      break;
+    }
+    d->buckets[idx] = cnt;
+    total += cnt;
+    prev = (int64_t) idx;
+  }
+  if (i < n || total != d->count || d->min > d->max) {
+    memset(d, 0, sizeof(powercap_digest));
+    errno = EINVAL;
+    return -errno;
+  }
+  return 0;
+}
@@ -0,0 +1,370 @@
+/**
+ * Per-process energy estimation.
+ *
+ * Processes are kept in the hash table from powercap-attrib.h, keyed by their PIDs.
+ * The procfs root is kept open as a directory stream and rewound for each sample, so listing processes never needs a
+ * new file descriptor.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap-attrib.h"
+#include "powercap-common.h"
+#include "powercap-proc.h"
+#include "powercap-rapl.h"
+
+#define MIN_SLOTS 256
+#define STAT_SIZE 1024
+
+/* Fields of /proc/<pid>/stat (numbered from 1, as in proc(5)) */
+#define FIELD_UTIME 14
+#define FIELD_STIME 15
+#define FIELD_STARTTIME 22
+
+typedef struct pid_stat {
+  char comm[POWERCAP_PROC_COMM_LEN];
+  uint64_t cpu_ticks;
+  uint64_t start_time;
+} pid_stat;
+
+static uint64_t hash_pid(uint32_t pid) {
+  /* Knuth's multiplicative hash spreads consecutive PIDs */
+  return (uint32_t) (pid * 2654435761U);
+}
+
+static int entry_is_empty(const void* entry) {
+  return !((const powercap_proc_entry*) entry)->pid;
+}
+
+static uint64_t entry_hash(const void* entry) {
+  return hash_pid(((const powercap_proc_entry*) entry)->pid);
+}
+
+static int entry_matches(const void* entry, const void* key) {
+  return ((const powercap_proc_entry*) entry)->pid == *(const uint32_t*) key;
+}
+
+static const attrib_table_ops table_ops = { sizeof(powercap_proc_entry), entry_is_empty, entry_hash, entry_matches };
+
+static uint32_t find_slot(const powercap_proc* p, uint32_t pid) {
+  return attrib_table_find(&table_ops, p->slots, p->nslots, &pid, hash_pid(pid));
+}
+
+static int grow(powercap_proc* p) {
+  powercap_proc_entry* slots;
+  if ((slots = attrib_table_grow(&table_ops, p->slots, p->nslots)) == NULL) {
+    return -errno;
+  }
+  free(p->slots);
+  p->slots = slots;
+  p->nslots *= 2;
+  return 0;
+}
+
+static void remove_slot(powercap_proc* p, uint32_t i) {
+  if (p->slots[i].fd >= 0) {
+    close(p->slots[i].fd);
+  }
+  attrib_table_remove(&table_ops, p->slots, p->nslots, i);
+  p->nentries--;
+}
+
+static int open_stat(const powercap_proc* p, uint32_t pid) {
+  char path[32];
+  snprintf(path, sizeof(path), "%"PRIu32"/stat", pid);
+  return openat(p->root_fd, path, O_RDONLY | O_CLOEXEC);
+}
+
+/* The command name may contain spaces and parentheses, so fields are counted from its last ')' */
+static int parse_stat(const char* buf, pid_stat* st) {
+  const char* open = strchr(buf, '(');
+  const char* close = strrchr(buf, ')');
+  const char* s;
+  char* end;
+  size_t len;
+  uint64_t val;
+  int field;
+  if (open == NULL || close == NULL || close < open) {
+    return -1;
+  }
+  len = (size_t) (close - open - 1);
+  if (len >= POWERCAP_PROC_COMM_LEN) {
+    len = POWERCAP_PROC_COMM_LEN - 1;
+  }
+  memcpy(st->comm, open + 1, len);
+  st->comm[len] = '\0';
+  st->cpu_ticks = 0;
+  for (s = close + 1, field = 3; field <= FIELD_STARTTIME; field++) {
+    while (*s == ' ') {
+      s++;
+    }
+    if (!*s) {
+      return -1;
+    }
+    if (field == FIELD_UTIME || field == FIELD_STIME || field == FIELD_STARTTIME) {
+      val = strtoull(s, &end, 10);
+      if (end == s) {
+        return -1;
+      }
+      s = end;
+      if (field == FIELD_STARTTIME) {
+        st->start_time = val;
+      } else {
+        st->cpu_ticks += val;
+      }
+    } else {
+      s += strcspn(s, " ");
+    }
+  }
+  return 0;
+}
+
+/* Reads from fd, or opens the file for the read if fd < 0; returns 0 on success, -1 otherwise */
+static int read_stat(const powercap_proc* p, int fd, uint32_t pid, pid_stat* st) {
+  char buf[STAT_SIZE];
+  ssize_t n;
+  int tmp_fd = -1;
+  if (fd < 0 && (fd = tmp_fd = open_stat(p, pid)) < 0) {
+    return -1;
+  }
+  n = pread(fd, buf, sizeof(buf) - 1, 0);
+  if (tmp_fd >= 0) {
+    close(tmp_fd);
+  }
+  if (n <= 0) {
+    return -1;
+  }
+  buf[n] = '\0';
+  return parse_stat(buf, st);
+}
+
+/* Sum of user, nice, system, irq, softirq, and steal time from the first line of /proc/stat */
+static int read_busy_ticks(int fd, uint64_t* ticks) {
+  char buf[256];
+  const char* s;
+  char* end;
+  uint64_t val;
+  ssize_t n;
+  int field;
+  if (fd < 0 || (n = pread(fd, buf, sizeof(buf) - 1, 0)) <= 0) {
+    return -1;
+  }
+  buf[n] = '\0';
+  if (strncmp(buf, "cpu ", 4)) {
+    return -1;
+  }
+  *ticks = 0;
+  for (s = buf + 4, field = 0; field < 8; field++, s = end) {
+    val = strtoull(s, &end, 10);
+    if (end == s) {
+      return -1;
+    }
+    /* skip idle and iowait */
+    if (field != 3 && field != 4) {
+      *ticks += val;
+    }
+  }
+  return 0;
+}
+
+static void visit(powercap_proc* p, uint32_t pid) {
+  powercap_proc_entry* e;
+  pid_stat st;
+  uint32_t i = find_slot(p, pid);
+  int fd;
+  e = &p->slots[i];
+  if (e->pid == pid && !read_stat(p, e->fd, pid, &st) && st.start_time == e->start_time) {
+    e->cpu_delta_ticks = st.cpu_ticks >= e->cpu_ticks ? st.cpu_ticks - e->cpu_ticks : 0;
+    e->cpu_ticks = st.cpu_ticks;
+  } else {
+    /* new, or the PID was reused since the last sample */
+    fd = open_stat(p, pid);
+    if (read_stat(p, fd, pid, &st)) {
+      /* exited since listing */
+      if (fd >= 0) {
+        close(fd);
+      }
+      return;
+    }
+    if (e->pid == pid) {
+      if (e->fd >= 0) {
+        close(e->fd);
+      }
+    } else {
+      /* keep the load factor at most 1/2 */
+      if (2 * (p->nentries + 1) > p->nslots) {
+        if (grow(p)) {
+          LOG(ERROR, "powercap_proc: Failed to grow table: %s\n", strerror(errno));
+          if (fd >= 0) {
+            close(fd);
+          }
+          return;
+        }
+        i = find_slot(p, pid);
+      }
+      e = &p->slots[i];
+      e->pid = pid;
+      p->nentries++;
+    }
+    e->fd = fd;
+    memcpy(e->comm, st.comm, sizeof(e->comm));
+    e->start_time = st.start_time;
+    e->cpu_ticks = st.cpu_ticks;
+    e->cpu_delta_ticks = 0;
+    e->pkg_energy_uj = 0;
+    e->core_energy_uj = 0;
+  }
+  e->alive = 1;
+  e->seen = p->samples;
+}
+
+static void scan(powercap_proc* p) {
+  struct dirent* ent;
+  unsigned long pid;
+  rewinddir(p->dir);
+  while ((ent = readdir(p->dir)) != NULL) {
+    /* only process directories are numeric */
+    if (!ent->d_name[0] || ent->d_name[strspn(ent->d_name, "0123456789")]) {
+      continue;
+    }
+    pid = strtoul(ent->d_name, NULL, 10);
+    if (pid && pid <= UINT32_MAX) {
+      visit(p, (uint32_t) pid);
+    }
+  }
+}
+
+int powercap_proc_init(powercap_proc* p, const char* root, const powercap_rapl_pkg* pkgs, uint32_t npkgs) {
+  int ret;
+  if (p == NULL || (pkgs == NULL && npkgs)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(p, 0, sizeof(powercap_proc));
+  p->root_fd = -1;
+  p->stat_fd = -1;
+  if ((p->dir = opendir(root ? root : POWERCAP_PROC_DEFAULT_ROOT)) == NULL) {
+    return -errno;
+  }
+  p->root_fd = dirfd(p->dir);
+  /* optional */
+  p->stat_fd = openat(p->root_fd, "stat", O_RDONLY | O_CLOEXEC);
+  p->pkgs = pkgs;
+  p->npkgs = npkgs;
+  p->nslots = MIN_SLOTS;
+  if ((p->slots = calloc(p->nslots, sizeof(powercap_proc_entry))) == NULL) {
+    ret = -errno;
+  } else {
+    ret = attrib_energy_init(pkgs, npkgs, &p->energy_uj, &p->max_energy_range_uj);
+  }
+  if (ret) {
+    powercap_proc_destroy(p);
+    errno = -ret;
+  }
+  return ret;
+}
+
+int powercap_proc_destroy(powercap_proc* p) {
+  uint32_t i;
+  if (p == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (i = 0; p->slots != NULL && i < p->nslots; i++) {
+    if (p->slots[i].pid && p->slots[i].fd >= 0) {
+      close(p->slots[i].fd);
+    }
+  }
+  if (p->stat_fd >= 0) {
+    close(p->stat_fd);
+  }
+  if (p->dir != NULL) {
+    /* also closes root_fd */
+    closedir(p->dir);
+  }
+  free(p->max_energy_range_uj);
+  free(p->energy_uj);
+  free(p->slots);
+  memset(p, 0, sizeof(powercap_proc));
+  p->root_fd = -1;
+  p->stat_fd = -1;
+  return 0;
+}
+
+int powercap_proc_sample(powercap_proc* p) {
+  powercap_proc_entry* e;
+  uint64_t busy;
+  uint64_t total = 0;
+  uint32_t i;
+  if (p == NULL || p->slots == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  p->samples++;
+  attrib_energy_read(p->pkgs, p->npkgs, p->energy_uj, p->max_energy_range_uj, p->samples == 1, &p->pkg_delta_uj,
+                     &p->core_delta_uj);
+  p->busy_delta_ticks = 0;
+  if (!read_busy_ticks(p->stat_fd, &busy)) {
+    if (p->samples > 1 && busy >= p->busy_ticks) {
+      p->busy_delta_ticks = busy - p->busy_ticks;
+    }
+    p->busy_ticks = busy;
+  }
+  scan(p);
+
+  /* processes that exited are kept for one sample, then removed */
+  for (i = 0; i < p->nslots; i++) {
+    e = &p->slots[i];
+    if (e->pid && e->seen != p->samples && e->alive) {
+      e->alive = 0;
+      e->cpu_delta_ticks = 0;
+      /* so that it's removed next time */
+      e->seen = p->samples;
+    }
+  }
+  for (i = 0; i < p->nslots;) {
+    e = &p->slots[i];
+    if (e->pid && !e->alive && e->seen != p->samples) {
+      /* another entry may be shifted into this slot */
+      remove_slot(p, i);
+    } else {
+      i++;
+    }
+  }
+
+  for (i = 0; i < p->nslots; i++) {
+    total += p->slots[i].cpu_delta_ticks;
+  }
+  if (p->busy_delta_ticks > total) {
+    total = p->busy_delta_ticks;
+  }
+  if (!total || (!p->pkg_delta_uj && !p->core_delta_uj)) {
+    return 0;
+  }
+  for (i = 0; i < p->nslots; i++) {
+    e = &p->slots[i];
+    if (e->cpu_delta_ticks) {
+      e->pkg_energy_uj += (uint64_t) ((double) p->pkg_delta_uj * e->cpu_delta_ticks / total + 0.5);
+      e->core_energy_uj += (uint64_t) ((double) p->core_delta_uj * e->cpu_delta_ticks / total + 0.5);
+    }
+  }
+  return 0;
+}
+
+const powercap_proc_entry* powercap_proc_get(const powercap_proc* p, uint32_t pid) {
+  uint32_t i;
+  if (p == NULL || p->slots == NULL || !pid) {
+    errno = EINVAL;
+    return NULL;
+  }
+  i = find_slot(p, pid);
+  return p->slots[i].pid ? &p->slots[i] : NULL;
+}
@@ -0,0 +1,259 @@
+/**
+ * Node-level power budget shifting across RAPL packages.
+ *
+ * @author Connor Imes
+ * @date 2026-10-18
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "powercap-common.h"
+#include "powercap-rapl.h"
+#include "powercap-rapl-common.h"
+#include "powercap-rapl-budget.h"
+
+#define DEFAULT_CAP_THRESHOLD 0.95
+#define DEFAULT_HEADROOM 0.1
+
+void powercap_rapl_budget_config_default(powercap_rapl_budget_config* config) {
+  if (config != NULL) {
+    memset(config, 0, sizeof(powercap_rapl_budget_config));
+    config->cap_threshold = DEFAULT_CAP_THRESHOLD;
+    config->headroom = DEFAULT_HEADROOM;
+  }
+}
+
+static uint64_t sum_min(const powercap_rapl_budget* budget) {
+  uint64_t sum = 0;
+  uint32_t i;
+  for (i = 0; i < budget->npkgs; i++) {
+    sum += budget->pkgs[i].min_power_uw;
+  }
+  return sum;
+}
+
+/*
+ * Raise alloc[i] toward demand[i] (which must be >= alloc[i]), sharing remaining equally among unsatisfied packages.
+ * Returns whatever couldn't be allocated.
+ */
+static uint64_t water_fill(uint64_t* alloc, const uint64_t* demand, uint32_t n, uint64_t remaining) {
+  uint64_t share;
+  uint64_t give;
+  uint32_t nactive;
+  uint32_t i;
+  while (remaining) {
+    nactive = 0;
+    for (i = 0; i < n; i++) {
+      if (alloc[i] < demand[i]) {
+        nactive++;
+      }
+    }
+    if (!nactive) {
+      break;
+    }
+    /* ensure progress when remaining < nactive */
+    share = remaining / nactive ? remaining / nactive : 1;
+    for (i = 0; i < n && remaining; i++) {
+      if (alloc[i] < demand[i]) {
+        give = demand[i] - alloc[i] < share ? demand[i] - alloc[i] : share;
+        alloc[i] += give;
+        remaining -= give;
+      }
+    }
+  }
+  return remaining;
+}
+
+static int set_limit(powercap_rapl_budget* budget, uint32_t i, uint64_t limit_uw) {
+  int ret;
+  if ((ret = powercap_rapl_set_power_limit_uw(budget->pkgs[i].pkg, POWERCAP_RAPL_ZONE_PACKAGE,
+                                              POWERCAP_RAPL_CONSTRAINT_LONG, limit_uw))) {
+    LOG(ERROR, "powercap_rapl_budget: Failed to set power limit for package index %"PRIu32"\n", i);
+    return ret;
+  }
+  budget->pkgs[i].power_limit_uw = limit_uw;
+  return 0;
+}
+
+static int apply_limits(powercap_rapl_budget* budget, const uint64_t* alloc) {
+  uint32_t i;
+  int ret;
+  /* lower limits before raising others so the budget is never exceeded */
+  for (i = 0; i < budget->npkgs; i++) {
+    if (alloc[i] < budget->pkgs[i].power_limit_uw && (ret = set_limit(budget, i, alloc[i]))) {
+      return ret;
+    }
+  }
+  for (i = 0; i < budget->npkgs; i++) {
+    if (alloc[i] > budget->pkgs[i].power_limit_uw && (ret = set_limit(budget, i, alloc[i]))) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+/* demand may be NULL for an equal split */
+static int allocate(powercap_rapl_budget* budget, const uint64_t* demand) {
+  uint64_t* alloc;
+  uint64_t* max;
+  uint64_t remaining;
+  uint32_t i;
+  int ret;
+  if (budget->config.budget_uw < sum_min(budget)) {
+    LOG(ERROR, "powercap_rapl_budget: Budget %"PRIu64" uW is less than the packages' minimum power\n",
+        budget->config.budget_uw);
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((alloc = calloc(2 * budget->npkgs, sizeof(uint64_t))) == NULL) {
+    return -errno;
+  }
+  max = alloc + budget->npkgs;
+  for (i = 0; i < budget->npkgs; i++) {
+    alloc[i] = budget->pkgs[i].min_power_uw;
+    max[i] = budget->pkgs[i].max_power_uw;
+  }
+  remaining = budget->config.budget_uw - sum_min(budget);
+  if (demand) {
+    remaining = water_fill(alloc, demand, budget->npkgs, remaining);
+  }
+  /* share any surplus up to the maximums */
+  water_fill(alloc, max, budget->npkgs, remaining);
+  ret = apply_limits(budget, alloc);
+  free(alloc);
+  return ret;
+}
+
+int powercap_rapl_budget_init(powercap_rapl_budget* budget, const powercap_rapl_pkg* pkgs, uint32_t npkgs,
+                              const powercap_rapl_budget_config* config) {
+  powercap_rapl_budget_pkg* p;
+  uint32_t i;
+  int err_save;
+  int ret = 0;
+  if (budget == NULL || pkgs == NULL || !npkgs || config == NULL || !config->budget_uw ||
+      !(config->cap_threshold > 0) || config->cap_threshold > 1 || config->headroom < 0) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(budget, 0, sizeof(powercap_rapl_budget));
+  if ((budget->pkgs = calloc(npkgs, sizeof(powercap_rapl_budget_pkg))) == NULL) {
+    return -errno;
+  }
+  budget->npkgs = npkgs;
+  budget->config = *config;
+  for (i = 0; i < npkgs; i++) {
+    p = &budget->pkgs[i];
+    p->pkg = &pkgs[i];
+    if ((ret = rapl_get_power_bounds(p->pkg, POWERCAP_RAPL_ZONE_PACKAGE, config->min_power_uw, config->max_power_uw,
+                                     &p->min_power_uw, &p->max_power_uw)) ||
+        (ret = powercap_rapl_get_max_energy_range_uj(p->pkg, POWERCAP_RAPL_ZONE_PACKAGE, &p->max_energy_range_uj)) ||
+        (ret = powercap_rapl_get_energy_uj(p->pkg, POWERCAP_RAPL_ZONE_PACKAGE, &p->energy_uj)) ||
+        (ret = powercap_rapl_get_power_limit_uw(p->pkg, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG,
+                                                &p->power_limit_uw))) {
+      break;
+    }
+  }
+  if (!ret) {
+    clock_gettime(CLOCK_MONOTONIC, &budget->last);
+    ret = allocate(budget, NULL);
+  }
+  if (ret) {
+    err_save = errno;
+    powercap_rapl_budget_destroy(budget);
+    errno = err_save;
+  }
+  return ret;
+}
+
+int powercap_rapl_budget_destroy(powercap_rapl_budget* budget) {
+  if (budget != NULL) {
+    free(budget->pkgs);
+    budget->pkgs = NULL;
+    budget->npkgs = 0;
+  }
+  return 0;
+}
+
+int powercap_rapl_budget_set_budget(powercap_rapl_budget* budget, uint64_t budget_uw) {
+  if (budget == NULL || !budget_uw) {
+    errno = EINVAL;
+    return -errno;
+  }
+  budget->config.budget_uw = budget_uw;
+  return 0;
+}
+
+int powercap_rapl_budget_allocate(powercap_rapl_budget* budget, const uint64_t* power_uw) {
+  powercap_rapl_budget_pkg* p;
+  uint64_t* demand;
+  double d;
+  uint32_t i;
+  int ret;
+  if (budget == NULL || budget->pkgs == NULL || power_uw == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((demand = malloc(budget->npkgs * sizeof(uint64_t))) == NULL) {
+    return -errno;
+  }
+  for (i = 0; i < budget->npkgs; i++) {
+    p = &budget->pkgs[i];
+    p->power_uw = power_uw[i];
+    if (power_uw[i] >= budget->config.cap_threshold * p->power_limit_uw) {
+      /* constrained, would use more power if allowed */
+      demand[i] = p->max_power_uw;
+    } else {
+      d = power_uw[i] * (1 + budget->config.headroom);
+      demand[i] = d < p->min_power_uw ? p->min_power_uw : (d > p->max_power_uw ? p->max_power_uw : (uint64_t) d);
+    }
+    p->demand_uw = demand[i];
+  }
+  ret = allocate(budget, demand);
+  free(demand);
+  return ret;
+}
+
+int powercap_rapl_budget_update(powercap_rapl_budget* budget) {
+  powercap_rapl_budget_pkg* p;
+  struct timespec now;
+  uint64_t* power;
+  uint64_t* energy;
+  uint64_t elapsed_us;
+  uint32_t i;
+  int ret = 0;
+  if (budget == NULL || budget->pkgs == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  elapsed_us = (uint64_t) (((int64_t) (now.tv_sec - budget->last.tv_sec) * 1000000000 +
+                           (now.tv_nsec - budget->last.tv_nsec)) / 1000);
+  if (!elapsed_us) {
+    /* called too quickly, nothing meaningful to measure */
+    errno = EAGAIN;
+    return -errno;
+  }
+  if ((power = malloc(2 * budget->npkgs * sizeof(uint64_t))) == NULL) {
+    return -errno;
+  }
+  energy = &power[budget->npkgs];
+  /* commit the new counters and time together, and only if all of them were read */
+  for (i = 0; i < budget->npkgs && !ret; i++) {
+    p = &budget->pkgs[i];
+    if (!(ret = powercap_rapl_get_energy_uj(p->pkg, POWERCAP_RAPL_ZONE_PACKAGE, &energy[i]))) {
+      power[i] = energy_delta_uj(p->energy_uj, energy[i], p->max_energy_range_uj) * 1000000 / elapsed_us;
+    }
+  }
+  if (!ret) {
+    for (i = 0; i < budget->npkgs; i++) {
+      budget->pkgs[i].energy_uj = energy[i];
+    }
+    budget->last = now;
+    ret = powercap_rapl_budget_allocate(budget, power);
+  }
+  free(power);
+  return ret;
+}
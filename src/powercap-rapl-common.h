@@ -0,0 +1,40 @@
+/**
+ * Internal helpers shared by modules built on powercap-rapl.h.
+ *
+ * @author Connor Imes
+ * @date 2026-10-18
+ */
+#ifndef _POWERCAP_RAPL_COMMON_H_
+#define _POWERCAP_RAPL_COMMON_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "powercap-rapl.h"
+
+#pragma GCC visibility push(hidden)
+
+/*
+ * Get a long-term constraint power bound (min_power_uw or max_power_uw) for a zone: cfg if non-zero, else the file.
+ * Return 0 on success, -ENODATA if cfg is 0 and the file isn't available, or a read error.
+ */
+int rapl_get_power_bound(const powercap_rapl_pkg* pkg, powercap_rapl_zone zone, powercap_constraint_file file,
+                         uint64_t cfg, uint64_t* val);
+
+/*
+ * Get long-term constraint power bounds for a zone.
+ * Configured values (cfg_min, cfg_max) are used when non-zero, otherwise the min_power_uw/max_power_uw files are read.
+ * Return 0 on success, -ENODATA if a bound isn't configured or available, -EINVAL if min > max or max is 0.
+ */
+int rapl_get_power_bounds(const powercap_rapl_pkg* pkg, powercap_rapl_zone zone, uint64_t cfg_min, uint64_t cfg_max,
+                          uint64_t* min, uint64_t* max);
+
+#pragma GCC visibility pop
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
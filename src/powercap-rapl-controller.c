@@ -0,0 +1,124 @@
+/**
+ * Closed-loop performance-targeting power controller.
+ *
+ * The plant model is: perf = b * limit, where b (performance per watt) is estimated with an exponentially weighted
+ * moving average.
+ * The control law is: limit(t+1) = limit(t) + (1 - pole) * (target - perf(t)) / b(t), clamped to the bounds.
+ *
+ * @author Connor Imes
+ * @date 2026-10-18
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "powercap-common.h"
+#include "powercap-rapl.h"
+#include "powercap-rapl-common.h"
+#include "powercap-rapl-controller.h"
+
+#define DEFAULT_POLE 0.5
+#define DEFAULT_ALPHA 0.5
+
+void powercap_rapl_controller_config_default(powercap_rapl_controller_config* config) {
+  if (config != NULL) {
+    memset(config, 0, sizeof(powercap_rapl_controller_config));
+    config->pole = DEFAULT_POLE;
+    config->alpha = DEFAULT_ALPHA;
+  }
+}
+
+static uint64_t clamp_u64(double val, uint64_t min, uint64_t max) {
+  if (val <= (double) min) {
+    return min;
+  }
+  if (val >= (double) max) {
+    return max;
+  }
+  return (uint64_t) val;
+}
+
+int powercap_rapl_controller_init(powercap_rapl_controller* ctl, const powercap_rapl_pkg* pkg,
+                                  const powercap_rapl_controller_config* config) {
+  uint64_t limit;
+  int ret;
+  if (ctl == NULL || pkg == NULL || config == NULL || !(config->target > 0) ||
+      config->pole < 0 || !(config->pole < 1) || !(config->alpha > 0) || config->alpha > 1 || config->dram_ratio < 0) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(ctl, 0, sizeof(powercap_rapl_controller));
+  ctl->pkg = pkg;
+  ctl->config = *config;
+  if ((ret = rapl_get_power_bounds(pkg, POWERCAP_RAPL_ZONE_PACKAGE, config->min_power_uw, config->max_power_uw,
+                                   &ctl->config.min_power_uw, &ctl->config.max_power_uw))) {
+    return ret;
+  }
+  if ((ret = powercap_rapl_get_power_limit_uw(pkg, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, &limit))) {
+    return ret;
+  }
+  ctl->power_limit_uw = limit;
+  if (config->dram_ratio > 0) {
+    if ((ret = rapl_get_power_bounds(pkg, POWERCAP_RAPL_ZONE_DRAM, config->dram_min_power_uw, config->dram_max_power_uw,
+                                     &ctl->config.dram_min_power_uw, &ctl->config.dram_max_power_uw))) {
+      return ret;
+    }
+    if ((ret = powercap_rapl_get_power_limit_uw(pkg, POWERCAP_RAPL_ZONE_DRAM, POWERCAP_RAPL_CONSTRAINT_LONG, &limit))) {
+      return ret;
+    }
+    ctl->dram_power_limit_uw = limit;
+  }
+  return 0;
+}
+
+int powercap_rapl_controller_set_target(powercap_rapl_controller* ctl, double target) {
+  if (ctl == NULL || !(target > 0)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  ctl->config.target = target;
+  return 0;
+}
+
+int powercap_rapl_controller_update(powercap_rapl_controller* ctl, double perf) {
+  const powercap_rapl_controller_config* cfg;
+  double limit_w;
+  double next_uw;
+  uint64_t limit;
+  int ret;
+  if (ctl == NULL || ctl->pkg == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  cfg = &ctl->config;
+  limit_w = ctl->power_limit_uw / 1000000.0;
+  if (perf > 0 && limit_w > 0) {
+    if (ctl->perf_per_w > 0) {
+      ctl->perf_per_w = (1 - cfg->alpha) * ctl->perf_per_w + cfg->alpha * (perf / limit_w);
+    } else {
+      ctl->perf_per_w = perf / limit_w;
+    }
+  }
+  if (ctl->perf_per_w > 0) {
+    next_uw = ctl->power_limit_uw + (1 - cfg->pole) * (cfg->target - (perf > 0 ? perf : 0)) / ctl->perf_per_w * 1000000.0;
+  } else {
+    /* can't model the application yet, so don't risk missing the target */
+    next_uw = (double) cfg->max_power_uw;
+  }
+  limit = clamp_u64(next_uw, cfg->min_power_uw, cfg->max_power_uw);
+  if (limit != ctl->power_limit_uw) {
+    if ((ret = powercap_rapl_set_power_limit_uw(ctl->pkg, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, limit))) {
+      return ret;
+    }
+    ctl->power_limit_uw = limit;
+  }
+  if (cfg->dram_ratio > 0) {
+    limit = clamp_u64(cfg->dram_ratio * ctl->power_limit_uw, cfg->dram_min_power_uw, cfg->dram_max_power_uw);
+    if (limit != ctl->dram_power_limit_uw) {
+      if ((ret = powercap_rapl_set_power_limit_uw(ctl->pkg, POWERCAP_RAPL_ZONE_DRAM, POWERCAP_RAPL_CONSTRAINT_LONG, limit))) {
+        return ret;
+      }
+      ctl->dram_power_limit_uw = limit;
+    }
+  }
+  return 0;
+}
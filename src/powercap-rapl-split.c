@@ -0,0 +1,304 @@
+/**
+ * Online package/DRAM power split optimizer.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "powercap-common.h"
+#include "powercap-rapl.h"
+#include "powercap-rapl-common.h"
+#include "powercap-rapl-split.h"
+
+#define DEFAULT_TOLERANCE 0.01
+#define DEFAULT_PHASE_THRESHOLD 0.15
+#define DEFAULT_CAP_THRESHOLD 0.9
+/* weight of new progress samples in the converged baseline */
+#define BASELINE_ALPHA 0.25
+
+void powercap_rapl_split_config_default(powercap_rapl_split_config* config) {
+  if (config != NULL) {
+    memset(config, 0, sizeof(powercap_rapl_split_config));
+    config->tolerance = DEFAULT_TOLERANCE;
+    config->phase_threshold = DEFAULT_PHASE_THRESHOLD;
+    config->cap_threshold = DEFAULT_CAP_THRESHOLD;
+  }
+}
+
+/* Unlike the controller, bounds that aren't configured or available fall back instead of failing */
+static int get_bound(const powercap_rapl_pkg* pkg, powercap_rapl_zone zone, powercap_constraint_file file,
+                     uint64_t cfg, uint64_t fallback, uint64_t* val) {
+  int ret = rapl_get_power_bound(pkg, zone, file, cfg, val);
+  if (ret == -ENODATA) {
+    *val = fallback;
+    return 0;
+  }
+  return ret;
+}
+
+static uint64_t initial_step(const powercap_rapl_split* split) {
+  return split->config.initial_step_uw ? split->config.initial_step_uw : split->config.budget_uw / 8;
+}
+
+static uint64_t min_step(const powercap_rapl_split* split) {
+  return split->config.min_step_uw ? split->config.min_step_uw : split->config.budget_uw / 64;
+}
+
+static int check_budget(const powercap_rapl_split_config* config, uint64_t budget_uw) {
+  if (!budget_uw || budget_uw < config->pkg_min_power_uw + config->dram_min_power_uw) {
+    LOG(ERROR, "powercap_rapl_split: Budget %"PRIu64" uW is less than the zones' minimum power\n", budget_uw);
+    errno = EINVAL;
+    return -errno;
+  }
+  return 0;
+}
+
+/* Clamp a DRAM limit so that both zones are within their bounds, as far as the budget allows */
+static uint64_t clamp_dram(const powercap_rapl_split* split, uint64_t dram_uw) {
+  const powercap_rapl_split_config* c = &split->config;
+  uint64_t lo = c->budget_uw > c->pkg_max_power_uw ? c->budget_uw - c->pkg_max_power_uw : 0;
+  uint64_t hi = c->budget_uw - c->pkg_min_power_uw;
+  if (lo < c->dram_min_power_uw) {
+    lo = c->dram_min_power_uw;
+  }
+  if (hi > c->dram_max_power_uw) {
+    hi = c->dram_max_power_uw;
+  }
+  if (lo > hi) {
+    /* budget exceeds both maximums */
+    lo = hi;
+  }
+  return dram_uw < lo ? lo : (dram_uw > hi ? hi : dram_uw);
+}
+
+static int set_limit(const powercap_rapl_split* split, powercap_rapl_zone zone, uint64_t val) {
+  int ret = powercap_rapl_set_power_limit_uw(split->pkg, zone, POWERCAP_RAPL_CONSTRAINT_LONG, val);
+  if (ret) {
+    LOG(ERROR, "powercap_rapl_split: Failed to set power limit for zone %d\n", zone);
+  }
+  return ret;
+}
+
+static int apply(powercap_rapl_split* split, uint64_t dram_uw) {
+  uint64_t pkg_uw;
+  int ret;
+  dram_uw = clamp_dram(split, dram_uw);
+  pkg_uw = split->config.budget_uw - dram_uw;
+  if (pkg_uw > split->config.pkg_max_power_uw) {
+    pkg_uw = split->config.pkg_max_power_uw;
+  }
+  /* lower one zone before raising the other so the budget is never exceeded */
+  if (dram_uw < split->dram_limit_uw) {
+    if ((ret = set_limit(split, POWERCAP_RAPL_ZONE_DRAM, dram_uw))) {
+      return ret;
+    }
+    split->dram_limit_uw = dram_uw;
+  }
+  if (pkg_uw != split->pkg_limit_uw) {
+    if ((ret = set_limit(split, POWERCAP_RAPL_ZONE_PACKAGE, pkg_uw))) {
+      return ret;
+    }
+    split->pkg_limit_uw = pkg_uw;
+  }
+  if (dram_uw != split->dram_limit_uw) {
+    if ((ret = set_limit(split, POWERCAP_RAPL_ZONE_DRAM, dram_uw))) {
+      return ret;
+    }
+    split->dram_limit_uw = dram_uw;
+  }
+  return 0;
+}
+
+static void restart(powercap_rapl_split* split) {
+  split->step_uw = initial_step(split);
+  split->dir = 1;
+  split->probing = 0;
+  split->flipped = 0;
+  split->converged = 0;
+}
+
+/* A direction didn't help: try the other one, or halve the step once both have failed */
+static void reject(powercap_rapl_split* split) {
+  split->dir = -split->dir;
+  if (split->flipped) {
+    split->step_uw /= 2;
+  }
+  split->flipped = !split->flipped;
+}
+
+/*
+ * Apply the next probe from the best split, or hold the best split once converged.
+ * A zone that wasn't using its limit at the best split can't benefit from a higher one.
+ */
+static int probe(powercap_rapl_split* split) {
+  uint64_t dram_uw;
+  while (split->step_uw >= min_step(split) && split->step_uw) {
+    if (split->dir > 0) {
+      dram_uw = clamp_dram(split, split->best_dram_uw + split->step_uw);
+    } else {
+      dram_uw = split->best_dram_uw > split->step_uw ? split->best_dram_uw - split->step_uw : 0;
+      dram_uw = clamp_dram(split, dram_uw);
+    }
+    if (dram_uw == split->best_dram_uw || (split->dir > 0 ? split->best_dram_idle : split->best_pkg_idle)) {
+      reject(split);
+      continue;
+    }
+    split->probing = 1;
+    return apply(split, dram_uw);
+  }
+  split->probing = 0;
+  split->converged = 1;
+  return apply(split, split->best_dram_uw);
+}
+
+/* Record progress and zone usage at the best split */
+static void set_best(powercap_rapl_split* split, double perf) {
+  split->best_dram_uw = split->dram_limit_uw;
+  split->best_perf = perf;
+  split->best_pkg_idle = split->pkg_power_uw < split->config.cap_threshold * split->pkg_limit_uw;
+  split->best_dram_idle = split->dram_power_uw < split->config.cap_threshold * split->dram_limit_uw;
+}
+
+int powercap_rapl_split_init(powercap_rapl_split* split, const powercap_rapl_pkg* pkg,
+                             const powercap_rapl_split_config* config) {
+  powercap_rapl_split_config* c;
+  uint64_t dram_uw;
+  int ret;
+  if (split == NULL || pkg == NULL || config == NULL || config->tolerance < 0 || !(config->phase_threshold > 0) ||
+      !(config->cap_threshold > 0) || config->cap_threshold > 1) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (powercap_rapl_is_zone_supported(pkg, POWERCAP_RAPL_ZONE_DRAM) <= 0) {
+    LOG(ERROR, "powercap_rapl_split: Package has no DRAM zone\n");
+    errno = ENOTSUP;
+    return -errno;
+  }
+  memset(split, 0, sizeof(powercap_rapl_split));
+  split->pkg = pkg;
+  split->config = *config;
+  c = &split->config;
+  if ((ret = get_bound(pkg, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_CONSTRAINT_FILE_MIN_POWER_UW, config->pkg_min_power_uw,
+                       0, &c->pkg_min_power_uw)) ||
+      (ret = get_bound(pkg, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_CONSTRAINT_FILE_MAX_POWER_UW, config->pkg_max_power_uw,
+                       config->budget_uw, &c->pkg_max_power_uw)) ||
+      (ret = get_bound(pkg, POWERCAP_RAPL_ZONE_DRAM, POWERCAP_CONSTRAINT_FILE_MIN_POWER_UW, config->dram_min_power_uw,
+                       0, &c->dram_min_power_uw)) ||
+      (ret = get_bound(pkg, POWERCAP_RAPL_ZONE_DRAM, POWERCAP_CONSTRAINT_FILE_MAX_POWER_UW, config->dram_max_power_uw,
+                       config->budget_uw, &c->dram_max_power_uw))) {
+    return ret;
+  }
+  if (!c->pkg_max_power_uw || !c->dram_max_power_uw || c->pkg_min_power_uw > c->pkg_max_power_uw ||
+      c->dram_min_power_uw > c->dram_max_power_uw) {
+    LOG(ERROR, "powercap_rapl_split: Bad zone bounds\n");
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((ret = check_budget(c, c->budget_uw)) ||
+      (ret = powercap_rapl_get_max_energy_range_uj(pkg, POWERCAP_RAPL_ZONE_PACKAGE, &split->pkg_max_energy_range_uj)) ||
+      (ret = powercap_rapl_get_max_energy_range_uj(pkg, POWERCAP_RAPL_ZONE_DRAM, &split->dram_max_energy_range_uj)) ||
+      (ret = powercap_rapl_get_energy_uj(pkg, POWERCAP_RAPL_ZONE_PACKAGE, &split->pkg_energy_uj)) ||
+      (ret = powercap_rapl_get_energy_uj(pkg, POWERCAP_RAPL_ZONE_DRAM, &split->dram_energy_uj)) ||
+      (ret = powercap_rapl_get_power_limit_uw(pkg, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG,
+                                              &split->pkg_limit_uw)) ||
+      (ret = powercap_rapl_get_power_limit_uw(pkg, POWERCAP_RAPL_ZONE_DRAM, POWERCAP_RAPL_CONSTRAINT_LONG,
+                                              &split->dram_limit_uw))) {
+    return ret;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &split->last);
+  restart(split);
+  dram_uw = clamp_dram(split, split->dram_limit_uw);
+  split->best_dram_uw = dram_uw;
+  return apply(split, dram_uw);
+}
+
+int powercap_rapl_split_set_budget(powercap_rapl_split* split, uint64_t budget_uw) {
+  uint64_t old;
+  uint64_t dram_uw;
+  int ret;
+  if (split == NULL || split->pkg == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((ret = check_budget(&split->config, budget_uw))) {
+    return ret;
+  }
+  old = split->config.budget_uw;
+  split->config.budget_uw = budget_uw;
+  dram_uw = (uint64_t) ((double) split->best_dram_uw * budget_uw / old);
+  restart(split);
+  split->best_dram_uw = clamp_dram(split, dram_uw);
+  return apply(split, split->best_dram_uw);
+}
+
+int powercap_rapl_split_update_power(powercap_rapl_split* split, double perf, uint64_t pkg_power_uw,
+                                     uint64_t dram_power_uw) {
+  if (split == NULL || split->pkg == NULL || perf < 0) {
+    errno = EINVAL;
+    return -errno;
+  }
+  split->pkg_power_uw = pkg_power_uw;
+  split->dram_power_uw = dram_power_uw;
+  if (split->converged) {
+    if (split->best_perf > 0 &&
+        (perf > split->best_perf * (1 + split->config.phase_threshold) ||
+         perf < split->best_perf * (1 - split->config.phase_threshold))) {
+      /* new application phase - search again from here */
+      split->phases++;
+      restart(split);
+      set_best(split, perf);
+      return probe(split);
+    }
+    split->best_perf = split->best_perf * (1 - BASELINE_ALPHA) + perf * BASELINE_ALPHA;
+    return 0;
+  }
+  if (!split->probing) {
+    /* measured at the best split */
+    set_best(split, perf);
+  } else if (perf > split->best_perf * (1 + split->config.tolerance)) {
+    /* keep going in this direction with the same step */
+    set_best(split, perf);
+    split->flipped = 0;
+  } else {
+    reject(split);
+  }
+  return probe(split);
+}
+
+int powercap_rapl_split_update(powercap_rapl_split* split, double perf) {
+  struct timespec now;
+  uint64_t pkg_energy;
+  uint64_t dram_energy;
+  uint64_t elapsed_us;
+  uint64_t pkg_power;
+  uint64_t dram_power;
+  int ret;
+  if (split == NULL || split->pkg == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  elapsed_us = (uint64_t) (((int64_t) (now.tv_sec - split->last.tv_sec) * 1000000000 +
+                           (now.tv_nsec - split->last.tv_nsec)) / 1000);
+  if (!elapsed_us) {
+    /* called too quickly, nothing meaningful to measure */
+    errno = EAGAIN;
+    return -errno;
+  }
+  if ((ret = powercap_rapl_get_energy_uj(split->pkg, POWERCAP_RAPL_ZONE_PACKAGE, &pkg_energy)) ||
+      (ret = powercap_rapl_get_energy_uj(split->pkg, POWERCAP_RAPL_ZONE_DRAM, &dram_energy))) {
+    return ret;
+  }
+  pkg_power = energy_delta_uj(split->pkg_energy_uj, pkg_energy, split->pkg_max_energy_range_uj) * 1000000 / elapsed_us;
+  dram_power = energy_delta_uj(split->dram_energy_uj, dram_energy, split->dram_max_energy_range_uj) * 1000000 /
+               elapsed_us;
+  split->pkg_energy_uj = pkg_energy;
+  split->dram_energy_uj = dram_energy;
+  split->last = now;
+  return powercap_rapl_split_update_power(split, perf, pkg_power, dram_power);
+}
@@ -15,7 +15,9 @@
 #include "powercap.h"
 #include "powercap-common.h"
 #include "powercap-rapl.h"
+#include "powercap-rapl-common.h"
 #include "powercap-rapl-sysfs.h"
+#include "powercap-trace.h"
 
 #define CONTROL_TYPE "intel-rapl"
 
@@ -276,8 +278,10 @@ int powercap_rapl_init(uint32_t package, powercap_rapl_pkg* pkg, int read_only)
   uint32_t i;
   uint32_t npp;
   powercap_rapl_zone type;
+  TRACE2(rapl_init_entry, package, read_only);
   if (pkg == NULL) {
     errno = EINVAL;
+    TRACE2(rapl_init_return, package, -errno);
     return -errno;
   }
   // force all fds to 0 so we don't try to operate on invalid descriptors
@@ -317,6 +321,7 @@ int powercap_rapl_init(uint32_t package, powercap_rapl_pkg* pkg, int read_only)
     powercap_rapl_destroy(pkg);
     errno = err_save;
   }
+  TRACE2(rapl_init_return, package, ret);
   return ret;
 }
 
@@ -489,3 +494,36 @@ ssize_t powercap_rapl_get_constraint_name(const powercap_rapl_pkg* pkg, powercap
   const powercap_constraint* fds = get_constraint_files(pkg, zone, constraint);
   return fds == NULL ? -errno : powercap_constraint_get_name(fds, buf, size);
 }
+
+int rapl_get_power_bound(const powercap_rapl_pkg* pkg, powercap_rapl_zone zone, powercap_constraint_file file,
+                         uint64_t cfg, uint64_t* val) {
+  *val = cfg;
+  if (cfg) {
+    return 0;
+  }
+  if (powercap_rapl_is_constraint_file_supported(pkg, zone, POWERCAP_RAPL_CONSTRAINT_LONG, file) <= 0) {
+    errno = ENODATA;
+    return -errno;
+  }
+  return file == POWERCAP_CONSTRAINT_FILE_MIN_POWER_UW ?
+         powercap_rapl_get_min_power_uw(pkg, zone, POWERCAP_RAPL_CONSTRAINT_LONG, val) :
+         powercap_rapl_get_max_power_uw(pkg, zone, POWERCAP_RAPL_CONSTRAINT_LONG, val);
+}
+
+int rapl_get_power_bounds(const powercap_rapl_pkg* pkg, powercap_rapl_zone zone, uint64_t cfg_min, uint64_t cfg_max,
+                          uint64_t* min, uint64_t* max) {
+  if (rapl_get_power_bound(pkg, zone, POWERCAP_CONSTRAINT_FILE_MIN_POWER_UW, cfg_min, min)) {
+    LOG(ERROR, "rapl_get_power_bounds: No min power for zone %d, must be configured\n", zone);
+    return -errno;
+  }
+  if (rapl_get_power_bound(pkg, zone, POWERCAP_CONSTRAINT_FILE_MAX_POWER_UW, cfg_max, max)) {
+    LOG(ERROR, "rapl_get_power_bounds: No max power for zone %d, must be configured\n", zone);
+    return -errno;
+  }
+  if (*min > *max || !*max) {
+    LOG(ERROR, "rapl_get_power_bounds: Bad bounds for zone %d: [%"PRIu64", %"PRIu64"]\n", zone, *min, *max);
+    errno = EINVAL;
+    return -errno;
+  }
+  return 0;
+}
@@ -0,0 +1,633 @@
+/**
+ * Sample zone energy, power, and limits through persistent file descriptors.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap.h"
+#include "powercap-common.h"
+#include "powercap-sampler.h"
+#include "powercap-sysfs.h"
+
+/* Deeper trees than this aren't searched */
+#define MAX_TREE_DEPTH 64
+
+/* Large enough for any cpufreq, cpuidle, or thermal path relative to its root */
+#define REL_PATH_SIZE 128
+
+int powercap_sampler_init(powercap_sampler* sampler) {
+  if (sampler == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(sampler, 0, sizeof(powercap_sampler));
+  return 0;
+}
+
+static void close_zone(powercap_sampler_zone* z) {
+  uint32_t i;
+  for (i = 0; i < z->nconstraints; i++) {
+    powercap_sysfs_constraint_close(&z->constraints[i].fds);
+  }
+  powercap_sysfs_zone_close(&z->fds);
+  free(z->constraints);
+  free(z->zones);
+  free(z->control_type);
+}
+
+static void close_fd(int fd) {
+  if (fd > 0) {
+    close(fd);
+  }
+}
+
+int powercap_sampler_destroy(powercap_sampler* sampler) {
+  uint32_t i;
+  if (sampler == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (i = 0; i < sampler->nzones; i++) {
+    close_zone(&sampler->zones[i]);
+  }
+  for (i = 0; i < sampler->ncpufreqs; i++) {
+    close_fd(sampler->cpufreqs[i].fd);
+  }
+  for (i = 0; i < sampler->ncpuidles; i++) {
+    close_fd(sampler->cpuidles[i].time_fd);
+    close_fd(sampler->cpuidles[i].usage_fd);
+  }
+  for (i = 0; i < sampler->nthermals; i++) {
+    close_fd(sampler->thermals[i].fd);
+  }
+  free(sampler->zones);
+  free(sampler->cpufreqs);
+  free(sampler->cpuidles);
+  free(sampler->thermals);
+  memset(sampler, 0, sizeof(powercap_sampler));
+  return 0;
+}
+
+static void read_static(int fd, int (*fn)(const powercap_constraint*, uint64_t*), const powercap_constraint* c,
+                        uint64_t* val) {
+  if (fd <= 0 || fn(c, val)) {
+    *val = 0;
+  }
+}
+
+static void read_constraint_static(powercap_sampler_constraint* c) {
+  const powercap_constraint* fds = &c->fds;
+  if (fds->name <= 0 || powercap_constraint_get_name(fds, c->name, sizeof(c->name)) <= 0) {
+    c->name[0] = '\0';
+  }
+  read_static(fds->min_power_uw, powercap_constraint_get_min_power_uw, fds, &c->min_power_uw);
+  read_static(fds->max_power_uw, powercap_constraint_get_max_power_uw, fds, &c->max_power_uw);
+  read_static(fds->min_time_window_us, powercap_constraint_get_min_time_window_us, fds, &c->min_time_window_us);
+  read_static(fds->max_time_window_us, powercap_constraint_get_max_time_window_us, fds, &c->max_time_window_us);
+}
+
+static void read_zone_static(powercap_sampler_zone* z, const char* name) {
+  if (name != NULL) {
+    snprintf(z->name, sizeof(z->name), "%s", name);
+  } else if (z->fds.name <= 0 || powercap_zone_get_name(&z->fds, z->name, sizeof(z->name)) <= 0) {
+    z->name[0] = '\0';
+  }
+  if (z->fds.max_energy_range_uj <= 0 || powercap_zone_get_max_energy_range_uj(&z->fds, &z->max_energy_range_uj)) {
+    z->max_energy_range_uj = 0;
+  }
+  if (z->fds.max_power_range_uw <= 0 || powercap_zone_get_max_power_range_uw(&z->fds, &z->max_power_range_uw)) {
+    z->max_power_range_uw = 0;
+  }
+}
+
+/* Reserve the next zone entry; it only counts once the caller increments nzones */
+static powercap_sampler_zone* next_zone(powercap_sampler* sampler) {
+  powercap_sampler_zone* tmp;
+  uint32_t size;
+  if (sampler->nzones == sampler->size) {
+    size = sampler->size ? 2 * sampler->size : 8;
+    if ((tmp = realloc(sampler->zones, size * sizeof(powercap_sampler_zone))) == NULL) {
+      return NULL;
+    }
+    sampler->zones = tmp;
+    sampler->size = size;
+  }
+  tmp = &sampler->zones[sampler->nzones];
+  memset(tmp, 0, sizeof(powercap_sampler_zone));
+  return tmp;
+}
+
+static void commit_zone(powercap_sampler* sampler, powercap_sampler_zone* z, const char* name) {
+  uint32_t i;
+  read_zone_static(z, name);
+  for (i = 0; i < z->nconstraints; i++) {
+    read_constraint_static(&z->constraints[i]);
+  }
+  z->constraint_index = sampler->nconstraints;
+  sampler->nconstraints += z->nconstraints;
+  sampler->nzones++;
+}
+
+int powercap_sampler_add_zone(powercap_sampler* sampler, const char* control_type, const uint32_t* zones,
+                              uint32_t depth) {
+  powercap_sampler_zone* z;
+  uint32_t n;
+  int err_save;
+  int ret;
+  if (sampler == NULL || control_type == NULL || (depth && zones == NULL)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((z = next_zone(sampler)) == NULL) {
+    return -errno;
+  }
+  if ((ret = powercap_sysfs_zone_open(&z->fds, control_type, zones, depth, 1))) {
+    return ret;
+  }
+  for (n = 0; !powercap_sysfs_constraint_exists(control_type, zones, depth, n); n++);
+  if ((z->control_type = strdup(control_type)) == NULL ||
+      (depth && (z->zones = malloc(depth * sizeof(uint32_t))) == NULL) ||
+      (n && (z->constraints = calloc(n, sizeof(powercap_sampler_constraint))) == NULL)) {
+    ret = -errno;
+  }
+  if (depth && z->zones != NULL) {
+    memcpy(z->zones, zones, depth * sizeof(uint32_t));
+  }
+  z->depth = depth;
+  for (; !ret && z->nconstraints < n; z->nconstraints++) {
+    z->constraints[z->nconstraints].num = z->nconstraints;
+    if ((ret = powercap_sysfs_constraint_open(&z->constraints[z->nconstraints].fds, control_type, zones, depth,
+                                              z->nconstraints, 1))) {
+      break;
+    }
+  }
+  if (ret) {
+    err_save = errno;
+    close_zone(z);
+    errno = err_save;
+    return ret;
+  }
+  commit_zone(sampler, z, NULL);
+  return 0;
+}
+
+/* Add all zones at this depth and below */
+static int add_siblings(powercap_sampler* sampler, const char* control_type, uint32_t* zones, uint32_t depth) {
+  int ret = 0;
+  for (zones[depth - 1] = 0; !ret && !powercap_sysfs_zone_exists(control_type, zones, depth); zones[depth - 1]++) {
+    if (!(ret = powercap_sampler_add_zone(sampler, control_type, zones, depth)) && depth < MAX_TREE_DEPTH) {
+      ret = add_siblings(sampler, control_type, zones, depth + 1);
+    }
+  }
+  return ret;
+}
+
+int powercap_sampler_add_zone_tree(powercap_sampler* sampler, const char* control_type, const uint32_t* zones,
+                                   uint32_t depth, int recurse) {
+  uint32_t path[MAX_TREE_DEPTH];
+  int ret;
+  if (sampler == NULL || control_type == NULL || (depth && zones == NULL)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (depth > MAX_TREE_DEPTH) {
+    errno = ENOBUFS;
+    return -errno;
+  }
+  if (depth && (ret = powercap_sampler_add_zone(sampler, control_type, zones, depth))) {
+    return ret;
+  }
+  if ((depth && !recurse) || depth == MAX_TREE_DEPTH) {
+    return 0;
+  }
+  if (depth) {
+    memcpy(path, zones, depth * sizeof(uint32_t));
+  }
+  return add_siblings(sampler, control_type, path, depth + 1);
+}
+
+int powercap_sampler_add_zone_fds(powercap_sampler* sampler, const char* name, const powercap_zone* zone,
+                                  const powercap_constraint* constraints, uint32_t nconstraints) {
+  powercap_sampler_zone* z;
+  uint32_t i;
+  if (sampler == NULL || zone == NULL || (nconstraints && constraints == NULL)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((z = next_zone(sampler)) == NULL) {
+    return -errno;
+  }
+  if (nconstraints && (z->constraints = calloc(nconstraints, sizeof(powercap_sampler_constraint))) == NULL) {
+    return -errno;
+  }
+  z->fds = *zone;
+  z->nconstraints = nconstraints;
+  for (i = 0; i < nconstraints; i++) {
+    z->constraints[i].fds = constraints[i];
+    z->constraints[i].num = i;
+  }
+  commit_zone(sampler, z, name);
+  return 0;
+}
+
+/*
+ * Arrays of other telemetry have capacity for the next power of 2 entries (at least 8).
+ * Returns arr if it has room for another entry, otherwise the reallocated array, or NULL on failure.
+ */
+static void* reserve(void* arr, uint32_t n, size_t size) {
+  if (n && (n < 8 || (n & (n - 1)))) {
+    return arr;
+  }
+  return realloc(arr, (n ? 2 * (size_t) n : 8) * size);
+}
+
+/* Returns N for a name like prefixN, or -1 */
+static int64_t parse_numbered(const char* name, const char* prefix) {
+  size_t len = strlen(prefix);
+  char* end;
+  unsigned long n;
+  /* no leading zeros, so that N maps back to the name */
+  if (strncmp(name, prefix, len) || name[len] < '0' || name[len] > '9' || (name[len] == '0' && name[len + 1])) {
+    return -1;
+  }
+  errno = 0;
+  n = strtoul(name + len, &end, 10);
+  return (*end || errno || n > UINT32_MAX) ? -1 : (int64_t) n;
+}
+
+/* Returns the number of characters read, without a trailing newline, or -1 on failure */
+static ssize_t pread_str(int fd, char* buf, size_t size) {
+  ssize_t n;
+  if (fd <= 0 || (n = pread(fd, buf, size - 1, 0)) <= 0) {
+    return -1;
+  }
+  if (buf[n - 1] == '\n') {
+    n--;
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+static int pread_u64(int fd, uint64_t* val) {
+  char buf[32];
+  char* end;
+  if (pread_str(fd, buf, sizeof(buf)) <= 0) {
+    return -1;
+  }
+  errno = 0;
+  *val = strtoull(buf, &end, 10);
+  return (*end || errno) ? -1 : 0;
+}
+
+static int pread_s64(int fd, int64_t* val) {
+  char buf[32];
+  char* end;
+  if (pread_str(fd, buf, sizeof(buf)) <= 0) {
+    return -1;
+  }
+  errno = 0;
+  *val = strtoll(buf, &end, 10);
+  return (*end || errno) ? -1 : 0;
+}
+
+/* Read a static name, which is empty if it can't be read */
+static void read_name(int dirfd, const char* path, char* name, size_t size) {
+  int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+  if (pread_str(fd, name, size) < 0) {
+    name[0] = '\0';
+  }
+  close_fd(fd);
+}
+
+static int compare_cpufreq(const void* a, const void* b) {
+  const powercap_sampler_cpufreq* x = a;
+  const powercap_sampler_cpufreq* y = b;
+  return x->cpu < y->cpu ? -1 : x->cpu > y->cpu;
+}
+
+static int compare_cpuidle(const void* a, const void* b) {
+  const powercap_sampler_cpuidle* x = a;
+  const powercap_sampler_cpuidle* y = b;
+  if (x->cpu != y->cpu) {
+    return x->cpu < y->cpu ? -1 : 1;
+  }
+  return x->state < y->state ? -1 : x->state > y->state;
+}
+
+static int compare_thermal(const void* a, const void* b) {
+  const powercap_sampler_thermal* x = a;
+  const powercap_sampler_thermal* y = b;
+  return x->zone < y->zone ? -1 : x->zone > y->zone;
+}
+
+int powercap_sampler_add_cpufreq(powercap_sampler* sampler, const char* root) {
+  powercap_sampler_cpufreq* tmp;
+  struct dirent* ent;
+  char path[REL_PATH_SIZE];
+  DIR* dir;
+  int64_t cpu;
+  int fd;
+  int ret = 0;
+  if (sampler == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  /* enumerating again would add the same files twice */
+  if (sampler->ncpufreqs) {
+    errno = EEXIST;
+    return -errno;
+  }
+  if ((dir = opendir(root ? root : POWERCAP_SAMPLER_DEFAULT_CPU_ROOT)) == NULL) {
+    return -errno;
+  }
+  while (!ret && (ent = readdir(dir)) != NULL) {
+    if ((cpu = parse_numbered(ent->d_name, "cpu")) < 0) {
+      continue;
+    }
+    snprintf(path, sizeof(path), "cpu%"PRId64"/cpufreq/scaling_cur_freq", cpu);
+    if ((fd = openat(dirfd(dir), path, O_RDONLY | O_CLOEXEC)) < 0) {
+      continue;
+    }
+    if ((tmp = reserve(sampler->cpufreqs, sampler->ncpufreqs, sizeof(powercap_sampler_cpufreq))) == NULL) {
+      ret = -errno;
+      close(fd);
+      break;
+    }
+    sampler->cpufreqs = tmp;
+    sampler->cpufreqs[sampler->ncpufreqs].cpu = (uint32_t) cpu;
+    sampler->cpufreqs[sampler->ncpufreqs].fd = fd;
+    sampler->ncpufreqs++;
+  }
+  closedir(dir);
+  if (sampler->ncpufreqs) {
+    qsort(sampler->cpufreqs, sampler->ncpufreqs, sizeof(powercap_sampler_cpufreq), compare_cpufreq);
+  }
+  return ret;
+}
+
+/* Add all idle states of a CPU */
+static int add_cpuidle_states(powercap_sampler* sampler, int dirfd, uint32_t cpu) {
+  powercap_sampler_cpuidle* tmp;
+  powercap_sampler_cpuidle* c;
+  char path[REL_PATH_SIZE];
+  uint32_t state;
+  int fd;
+  for (state = 0; ; state++) {
+    snprintf(path, sizeof(path), "cpu%"PRIu32"/cpuidle/state%"PRIu32"/time", cpu, state);
+    if ((fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC)) < 0) {
+      return 0;
+    }
+    if ((tmp = reserve(sampler->cpuidles, sampler->ncpuidles, sizeof(powercap_sampler_cpuidle))) == NULL) {
+      close(fd);
+      return -errno;
+    }
+    sampler->cpuidles = tmp;
+    c = &sampler->cpuidles[sampler->ncpuidles++];
+    c->cpu = cpu;
+    c->state = state;
+    c->time_fd = fd;
+    snprintf(path, sizeof(path), "cpu%"PRIu32"/cpuidle/state%"PRIu32"/usage", cpu, state);
+    if ((c->usage_fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC)) < 0) {
+      c->usage_fd = 0;
+    }
+    snprintf(path, sizeof(path), "cpu%"PRIu32"/cpuidle/state%"PRIu32"/name", cpu, state);
+    read_name(dirfd, path, c->name, sizeof(c->name));
+  }
+}
+
+int powercap_sampler_add_cpuidle(powercap_sampler* sampler, const char* root) {
+  struct dirent* ent;
+  DIR* dir;
+  int64_t cpu;
+  int ret = 0;
+  if (sampler == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  /* enumerating again would add the same files twice */
+  if (sampler->ncpuidles) {
+    errno = EEXIST;
+    return -errno;
+  }
+  if ((dir = opendir(root ? root : POWERCAP_SAMPLER_DEFAULT_CPU_ROOT)) == NULL) {
+    return -errno;
+  }
+  while (!ret && (ent = readdir(dir)) != NULL) {
+    if ((cpu = parse_numbered(ent->d_name, "cpu")) >= 0) {
+      ret = add_cpuidle_states(sampler, dirfd(dir), (uint32_t) cpu);
+    }
+  }
+  closedir(dir);
+  if (sampler->ncpuidles) {
+    qsort(sampler->cpuidles, sampler->ncpuidles, sizeof(powercap_sampler_cpuidle), compare_cpuidle);
+  }
+  return ret;
+}
+
+int powercap_sampler_add_thermal(powercap_sampler* sampler, const char* root) {
+  powercap_sampler_thermal* tmp;
+  powercap_sampler_thermal* t;
+  struct dirent* ent;
+  char path[REL_PATH_SIZE];
+  DIR* dir;
+  int64_t zone;
+  int fd;
+  int ret = 0;
+  if (sampler == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  /* enumerating again would add the same files twice */
+  if (sampler->nthermals) {
+    errno = EEXIST;
+    return -errno;
+  }
+  if ((dir = opendir(root ? root : POWERCAP_SAMPLER_DEFAULT_THERMAL_ROOT)) == NULL) {
+    return -errno;
+  }
+  while (!ret && (ent = readdir(dir)) != NULL) {
+    if ((zone = parse_numbered(ent->d_name, "thermal_zone")) < 0) {
+      continue;
+    }
+    snprintf(path, sizeof(path), "thermal_zone%"PRId64"/temp", zone);
+    if ((fd = openat(dirfd(dir), path, O_RDONLY | O_CLOEXEC)) < 0) {
+      continue;
+    }
+    if ((tmp = reserve(sampler->thermals, sampler->nthermals, sizeof(powercap_sampler_thermal))) == NULL) {
+      ret = -errno;
+      close(fd);
+      break;
+    }
+    sampler->thermals = tmp;
+    t = &sampler->thermals[sampler->nthermals++];
+    t->zone = (uint32_t) zone;
+    t->fd = fd;
+    snprintf(path, sizeof(path), "thermal_zone%"PRId64"/type", zone);
+    read_name(dirfd(dir), path, t->type, sizeof(t->type));
+  }
+  closedir(dir);
+  if (sampler->nthermals) {
+    qsort(sampler->thermals, sampler->nthermals, sizeof(powercap_sampler_thermal), compare_thermal);
+  }
+  return ret;
+}
+
+int powercap_sampler_snapshot_init(const powercap_sampler* sampler, powercap_sampler_snapshot* snap) {
+  if (sampler == NULL || snap == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(snap, 0, sizeof(powercap_sampler_snapshot));
+  /* allocate at least one of each so an empty sampler still has a valid snapshot */
+  if ((snap->zones = calloc(sampler->nzones ? sampler->nzones : 1, sizeof(powercap_sampler_zone_values))) == NULL ||
+      (snap->constraints = calloc(sampler->nconstraints ? sampler->nconstraints : 1,
+                                  sizeof(powercap_sampler_constraint_values))) == NULL ||
+      (snap->cpufreqs = calloc(sampler->ncpufreqs ? sampler->ncpufreqs : 1,
+                               sizeof(powercap_sampler_cpufreq_values))) == NULL ||
+      (snap->cpuidles = calloc(sampler->ncpuidles ? sampler->ncpuidles : 1,
+                               sizeof(powercap_sampler_cpuidle_values))) == NULL ||
+      (snap->thermals = calloc(sampler->nthermals ? sampler->nthermals : 1,
+                               sizeof(powercap_sampler_thermal_values))) == NULL) {
+    powercap_sampler_snapshot_destroy(snap);
+    return -errno;
+  }
+  snap->nzones = sampler->nzones;
+  snap->nconstraints = sampler->nconstraints;
+  snap->ncpufreqs = sampler->ncpufreqs;
+  snap->ncpuidles = sampler->ncpuidles;
+  snap->nthermals = sampler->nthermals;
+  return 0;
+}
+
+int powercap_sampler_snapshot_destroy(powercap_sampler_snapshot* snap) {
+  if (snap == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  free(snap->zones);
+  free(snap->constraints);
+  free(snap->cpufreqs);
+  free(snap->cpuidles);
+  free(snap->thermals);
+  memset(snap, 0, sizeof(powercap_sampler_snapshot));
+  return 0;
+}
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sample_energy(powercap_sampler_zone* z, powercap_sampler_zone_values* v, int64_t ns) {
+  uint64_t energy;
+  uint64_t delta;
+  if (z->fds.energy_uj <= 0 || powercap_zone_get_energy_uj(&z->fds, &energy)) {
+    return;
+  }
+  if (z->have_energy) {
+    delta = energy_delta_uj(z->energy_uj, energy, z->max_energy_range_uj);
+    z->total_energy_uj += delta;
+    if (ns > z->energy_ns) {
+      /* uJ per second is uW */
+      v->power_uw = (uint64_t) (delta * 1000000000.0 / (ns - z->energy_ns));
+      v->valid |= POWERCAP_SAMPLER_ZONE_POWER;
+    }
+  }
+  z->energy_uj = energy;
+  z->energy_ns = ns;
+  z->have_energy = 1;
+  v->energy_uj = energy;
+  v->total_energy_uj = z->total_energy_uj;
+  v->valid |= POWERCAP_SAMPLER_ZONE_ENERGY;
+}
+
+static void sample_zone(powercap_sampler_zone* z, powercap_sampler_zone_values* v,
+                        powercap_sampler_constraint_values* cv, uint32_t flags, int64_t ns) {
+  const powercap_constraint* c;
+  uint32_t i;
+  int enabled;
+  memset(v, 0, sizeof(powercap_sampler_zone_values));
+  if (flags & POWERCAP_SAMPLER_READ_ENERGY) {
+    sample_energy(z, v, ns);
+  }
+  if ((flags & POWERCAP_SAMPLER_READ_POWER) && z->fds.power_uw > 0 &&
+      !powercap_zone_get_power_uw(&z->fds, &v->power_file_uw)) {
+    v->valid |= POWERCAP_SAMPLER_ZONE_POWER_UW;
+  }
+  if ((flags & POWERCAP_SAMPLER_READ_ENABLED) && z->fds.enabled > 0 && !powercap_zone_get_enabled(&z->fds, &enabled)) {
+    v->enabled = (uint32_t) enabled;
+    v->valid |= POWERCAP_SAMPLER_ZONE_ENABLED;
+  }
+  for (i = 0; i < z->nconstraints; i++) {
+    memset(&cv[i], 0, sizeof(powercap_sampler_constraint_values));
+    if (!(flags & POWERCAP_SAMPLER_READ_LIMITS)) {
+      continue;
+    }
+    c = &z->constraints[i].fds;
+    if (c->power_limit_uw > 0 && !powercap_constraint_get_power_limit_uw(c, &cv[i].power_limit_uw)) {
+      cv[i].valid |= POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT;
+    }
+    if (c->time_window_us > 0 && !powercap_constraint_get_time_window_us(c, &cv[i].time_window_us)) {
+      cv[i].valid |= POWERCAP_SAMPLER_CONSTRAINT_TIME_WINDOW;
+    }
+  }
+}
+
+static void sample_other(const powercap_sampler* sampler, powercap_sampler_snapshot* snap, uint32_t flags) {
+  uint32_t i;
+  for (i = 0; i < sampler->ncpufreqs; i++) {
+    snap->cpufreqs[i].valid = (flags & POWERCAP_SAMPLER_READ_CPUFREQ) &&
+                              !pread_u64(sampler->cpufreqs[i].fd, &snap->cpufreqs[i].freq_khz) ?
+                              POWERCAP_SAMPLER_CPUFREQ_FREQ : 0;
+  }
+  for (i = 0; i < sampler->ncpuidles; i++) {
+    snap->cpuidles[i].valid = 0;
+    if (!(flags & POWERCAP_SAMPLER_READ_CPUIDLE)) {
+      continue;
+    }
+    if (!pread_u64(sampler->cpuidles[i].time_fd, &snap->cpuidles[i].time_us)) {
+      snap->cpuidles[i].valid |= POWERCAP_SAMPLER_CPUIDLE_TIME;
+    }
+    if (!pread_u64(sampler->cpuidles[i].usage_fd, &snap->cpuidles[i].usage)) {
+      snap->cpuidles[i].valid |= POWERCAP_SAMPLER_CPUIDLE_USAGE;
+    }
+  }
+  for (i = 0; i < sampler->nthermals; i++) {
+    snap->thermals[i].valid = (flags & POWERCAP_SAMPLER_READ_THERMAL) &&
+                              !pread_s64(sampler->thermals[i].fd, &snap->thermals[i].temp_mc) ?
+                              POWERCAP_SAMPLER_THERMAL_TEMP : 0;
+  }
+}
+
+int powercap_sampler_sample(powercap_sampler* sampler, powercap_sampler_snapshot* snap, uint32_t flags) {
+  uint32_t i;
+  int64_t ns;
+  if (sampler == NULL || snap == NULL || snap->zones == NULL || snap->nzones != sampler->nzones ||
+      snap->nconstraints != sampler->nconstraints || snap->ncpufreqs != sampler->ncpufreqs ||
+      snap->ncpuidles != sampler->ncpuidles || snap->nthermals != sampler->nthermals) {
+    errno = EINVAL;
+    return -errno;
+  }
+  ns = now_ns();
+  snap->time_ns = ns;
+  snap->elapsed_ns = sampler->nsamples ? ns - sampler->last_ns : 0;
+  for (i = 0; i < sampler->nzones; i++) {
+    sample_zone(&sampler->zones[i], &snap->zones[i], &snap->constraints[sampler->zones[i].constraint_index], flags, ns);
+  }
+  sample_other(sampler, snap, flags);
+  snap->end_ns = now_ns();
+  sampler->last_ns = ns;
+  sampler->nsamples++;
+  return 0;
+}
@@ -0,0 +1,271 @@
+/**
+ * Timed power limit/time window schedules.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "powercap-common.h"
+#include "powercap.h"
+#include "powercap-schedule.h"
+
+#define MAX_LINE_SIZE 256
+/* offsets are converted to nanoseconds and added to the monotonic start time, so leave half the range for that */
+#define MAX_OFFSET_US (INT64_MAX / 1000 / 2)
+
+typedef int (*constraint_get_fn)(const powercap_constraint* c, uint64_t* val);
+
+/* File descriptors <= 0 are unsupported files (see powercap-rapl.h) */
+static void read_bound(const powercap_constraint* c, int fd, constraint_get_fn fn, uint64_t* val) {
+  uint64_t v;
+  if (fd > 0 && !fn(c, &v)) {
+    *val = v;
+  }
+}
+
+int powercap_schedule_init(powercap_schedule* sched, const powercap_constraint* const* targets, uint32_t ntargets) {
+  const powercap_constraint* c;
+  powercap_schedule_bounds* b;
+  uint32_t i;
+  if (sched == NULL || targets == NULL || !ntargets) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(sched, 0, sizeof(powercap_schedule));
+  if ((sched->bounds = calloc(ntargets, sizeof(powercap_schedule_bounds))) == NULL) {
+    return -errno;
+  }
+  sched->targets = targets;
+  sched->ntargets = ntargets;
+  for (i = 0; i < ntargets; i++) {
+    c = targets[i];
+    b = &sched->bounds[i];
+    b->max_power_uw = UINT64_MAX;
+    b->max_time_window_us = UINT64_MAX;
+    if (c == NULL) {
+      powercap_schedule_destroy(sched);
+      errno = EINVAL;
+      return -errno;
+    }
+    read_bound(c, c->min_power_uw, powercap_constraint_get_min_power_uw, &b->min_power_uw);
+    read_bound(c, c->max_power_uw, powercap_constraint_get_max_power_uw, &b->max_power_uw);
+    read_bound(c, c->min_time_window_us, powercap_constraint_get_min_time_window_us, &b->min_time_window_us);
+    read_bound(c, c->max_time_window_us, powercap_constraint_get_max_time_window_us, &b->max_time_window_us);
+    /* a bound of 0 is never meaningful as a maximum */
+    if (!b->max_power_uw) {
+      b->max_power_uw = UINT64_MAX;
+    }
+    if (!b->max_time_window_us) {
+      b->max_time_window_us = UINT64_MAX;
+    }
+  }
+  return 0;
+}
+
+int powercap_schedule_destroy(powercap_schedule* sched) {
+  if (sched == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  free(sched->bounds);
+  memset(sched, 0, sizeof(powercap_schedule));
+  return 0;
+}
+
+static int in_range(uint64_t val, uint64_t min, uint64_t max) {
+  return val == POWERCAP_SCHEDULE_UNCHANGED || (val >= min && val <= max);
+}
+
+int powercap_schedule_validate(const powercap_schedule* sched, const powercap_schedule_step* steps, uint32_t nsteps,
+                               uint32_t* bad_step) {
+  const powercap_schedule_bounds* b;
+  uint32_t i;
+  if (sched == NULL || sched->bounds == NULL || (steps == NULL && nsteps)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (i = 0; i < nsteps; i++) {
+    if ((i && steps[i].offset_us < steps[i - 1].offset_us) || steps[i].offset_us > MAX_OFFSET_US ||
+        steps[i].target >= sched->ntargets) {
+      break;
+    }
+    b = &sched->bounds[steps[i].target];
+    if (!in_range(steps[i].power_limit_uw, b->min_power_uw, b->max_power_uw) ||
+        !in_range(steps[i].time_window_us, b->min_time_window_us, b->max_time_window_us)) {
+      break;
+    }
+  }
+  if (i < nsteps) {
+    LOG(ERROR, "powercap_schedule: Step %"PRIu32" is invalid\n", i);
+    if (bad_step) {
+      *bad_step = i;
+    }
+    errno = EINVAL;
+    return -errno;
+  }
+  return 0;
+}
+
+static int64_t ts_to_ns(const struct timespec* ts) {
+  return (int64_t) ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static void ns_to_ts(int64_t ns, struct timespec* ts) {
+  ts->tv_sec = (time_t) (ns / 1000000000);
+  ts->tv_nsec = (long) (ns % 1000000000);
+}
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts_to_ns(&ts);
+}
+
+/* Sleep until (spin_ns before) the deadline, then spin the rest of the way */
+static int wait_until(int64_t deadline_ns, int64_t spin_ns) {
+  struct timespec ts;
+  int ret;
+  if (deadline_ns - spin_ns > now_ns()) {
+    ns_to_ts(deadline_ns - spin_ns, &ts);
+    if ((ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))) {
+      errno = ret;
+      return -errno;
+    }
+  }
+  while (spin_ns && now_ns() < deadline_ns);
+  return 0;
+}
+
+int powercap_schedule_run(const powercap_schedule* sched, const powercap_schedule_step* steps, uint32_t nsteps,
+                          powercap_schedule_result* results) {
+  const powercap_constraint* c;
+  int64_t start;
+  int64_t planned;
+  int64_t actual;
+  uint32_t i;
+  int ret;
+  if ((ret = powercap_schedule_validate(sched, steps, nsteps, NULL))) {
+    return ret;
+  }
+  start = now_ns();
+  for (i = 0; i < nsteps; i++) {
+    planned = (int64_t) steps[i].offset_us * 1000;
+    if ((ret = wait_until(start + planned, (int64_t) sched->spin_us * 1000))) {
+      return ret;
+    }
+    c = sched->targets[steps[i].target];
+    actual = now_ns();
+    if ((steps[i].power_limit_uw != POWERCAP_SCHEDULE_UNCHANGED &&
+         (ret = powercap_constraint_set_power_limit_uw(c, steps[i].power_limit_uw))) ||
+        (steps[i].time_window_us != POWERCAP_SCHEDULE_UNCHANGED &&
+         (ret = powercap_constraint_set_time_window_us(c, steps[i].time_window_us)))) {
+      LOG(ERROR, "powercap_schedule: Failed to apply step %"PRIu32"\n", i);
+      return ret;
+    }
+    if (results) {
+      results[i].planned_ns = planned;
+      results[i].actual_ns = actual - start;
+      results[i].write_ns = now_ns() - actual;
+    }
+  }
+  return 0;
+}
+
+/* Parses a u64, or "-" if allowed */
+static int parse_token(const char* tok, uint64_t* val, int allow_unchanged) {
+  char* end;
+  if (allow_unchanged && !strcmp(tok, "-")) {
+    *val = POWERCAP_SCHEDULE_UNCHANGED;
+    return 0;
+  }
+  errno = 0;
+  *val = strtoull(tok, &end, 0);
+  return (*tok == '-' || *end != '\0' || errno) ? -1 : 0;
+}
+
+/* Returns 0 on success, 1 for blank lines, -1 on error */
+static int parse_line(char* line, powercap_schedule_step* step) {
+  char* tok[5];
+  char* save;
+  uint64_t target;
+  uint32_t n;
+  tok[0] = strtok_r(line, " \t\r\n", &save);
+  for (n = 0; n < 5 && tok[n] != NULL; n++) {
+    if (n < 4) {
+      tok[n + 1] = strtok_r(NULL, " \t\r\n", &save);
+    }
+  }
+  if (!n) {
+    return 1;
+  }
+  step->time_window_us = POWERCAP_SCHEDULE_UNCHANGED;
+  if (n < 3 || n > 4 ||
+      parse_token(tok[0], &step->offset_us, 0) || step->offset_us > MAX_OFFSET_US ||
+      parse_token(tok[1], &target, 0) || target > UINT32_MAX ||
+      parse_token(tok[2], &step->power_limit_uw, 1) ||
+      (n == 4 && parse_token(tok[3], &step->time_window_us, 1))) {
+    return -1;
+  }
+  step->target = (uint32_t) target;
+  return 0;
+}
+
+int powercap_schedule_parse(FILE* f, powercap_schedule_step** steps, uint32_t* nsteps, uint32_t* bad_line) {
+  powercap_schedule_step* s = NULL;
+  powercap_schedule_step* tmp;
+  char line[MAX_LINE_SIZE];
+  char* comment;
+  uint32_t size = 0;
+  uint32_t n = 0;
+  uint32_t lineno = 0;
+  size_t len;
+  int too_long;
+  int ret;
+  if (f == NULL || steps == NULL || nsteps == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    /* a line that doesn't fit is an error, rather than being split into several */
+    len = strlen(line);
+    too_long = len && line[len - 1] != '\n' && getc(f) != EOF;
+    if ((comment = strchr(line, '#')) != NULL) {
+      *comment = '\0';
+    }
+    if (n == size) {
+      size = size ? 2 * size : 32;
+      if ((tmp = realloc(s, size * sizeof(powercap_schedule_step))) == NULL) {
+        free(s);
+        return -errno;
+      }
+      s = tmp;
+    }
+    if (too_long || (ret = parse_line(line, &s[n])) < 0) {
+      LOG(ERROR, "powercap_schedule: Syntax error on line %"PRIu32"\n", lineno);
+      free(s);
+      if (bad_line) {
+        *bad_line = lineno;
+      }
+      errno = EINVAL;
+      return -errno;
+    }
+    if (!ret) {
+      n++;
+    }
+  }
+  if (ferror(f)) {
+    free(s);
+    errno = EIO;
+    return -errno;
+  }
+  *steps = s;
+  *nsteps = n;
+  return 0;
+}
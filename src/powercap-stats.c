@@ -0,0 +1,196 @@
+/**
+ * Instrumentation of library file I/O.
+ *
+ * @author Connor Imes
+ * @date 2026-10-18
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+#include "powercap.h"
+#include "powercap-common.h"
+#include "powercap-stats.h"
+
+#define STATS_LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STATS_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define STATS_ADD(x, v) __atomic_fetch_add(&(x), (v), __ATOMIC_RELAXED)
+
+static int stats_enabled = 0;
+static powercap_stats_file stats[ATTR_COUNT];
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+static uint32_t hist_bucket(uint64_t ns) {
+  uint32_t b;
+  if (!ns) {
+    return 0;
+  }
+  b = 63 - (uint32_t) __builtin_clzll(ns);
+  return b < POWERCAP_STATS_HIST_BUCKETS ? b : POWERCAP_STATS_HIST_BUCKETS - 1;
+}
+
+static int is_valid_attr(int attr) {
+  return attr >= 0 && attr < ATTR_COUNT;
+}
+
+uint64_t stats_start(void) {
+  return STATS_LOAD(stats_enabled) ? now_ns() : 0;
+}
+
+void stats_record_open(int attr, int fd) {
+  if (STATS_LOAD(stats_enabled) && is_valid_attr(attr)) {
+    STATS_ADD(stats[attr].opens, 1);
+    if (fd < 0) {
+      STATS_ADD(stats[attr].open_errors, 1);
+    }
+  }
+}
+
+void stats_record_read(int attr, uint64_t start, ssize_t ret) {
+  uint64_t ns;
+  if (start && is_valid_attr(attr)) {
+    ns = now_ns() - start;
+    STATS_ADD(stats[attr].reads, 1);
+    STATS_ADD(stats[attr].read_ns, ns);
+    STATS_ADD(stats[attr].read_ns_hist[hist_bucket(ns)], 1);
+    if (ret < 0) {
+      STATS_ADD(stats[attr].read_errors, 1);
+    } else {
+      STATS_ADD(stats[attr].bytes_read, (uint64_t) ret);
+    }
+  }
+}
+
+void stats_record_write(int attr, uint64_t start, ssize_t ret) {
+  uint64_t ns;
+  if (start && is_valid_attr(attr)) {
+    ns = now_ns() - start;
+    STATS_ADD(stats[attr].writes, 1);
+    STATS_ADD(stats[attr].write_ns, ns);
+    STATS_ADD(stats[attr].write_ns_hist[hist_bucket(ns)], 1);
+    if (ret < 0) {
+      STATS_ADD(stats[attr].write_errors, 1);
+    } else {
+      STATS_ADD(stats[attr].bytes_written, (uint64_t) ret);
+    }
+  }
+}
+
+void stats_record_parse_error(int attr) {
+  if (STATS_LOAD(stats_enabled) && is_valid_attr(attr)) {
+    STATS_ADD(stats[attr].parse_errors, 1);
+  }
+}
+
+void powercap_stats_set_enabled(int enabled) {
+  STATS_STORE(stats_enabled, enabled ? 1 : 0);
+}
+
+int powercap_stats_is_enabled(void) {
+  return STATS_LOAD(stats_enabled);
+}
+
+static void copy_stats(powercap_stats_file* dest, powercap_stats_file* src) {
+  uint32_t i;
+  dest->opens = STATS_LOAD(src->opens);
+  dest->open_errors = STATS_LOAD(src->open_errors);
+  dest->reads = STATS_LOAD(src->reads);
+  dest->read_errors = STATS_LOAD(src->read_errors);
+  dest->writes = STATS_LOAD(src->writes);
+  dest->write_errors = STATS_LOAD(src->write_errors);
+  dest->parse_errors = STATS_LOAD(src->parse_errors);
+  dest->bytes_read = STATS_LOAD(src->bytes_read);
+  dest->bytes_written = STATS_LOAD(src->bytes_written);
+  dest->read_ns = STATS_LOAD(src->read_ns);
+  dest->write_ns = STATS_LOAD(src->write_ns);
+  for (i = 0; i < POWERCAP_STATS_HIST_BUCKETS; i++) {
+    dest->read_ns_hist[i] = STATS_LOAD(src->read_ns_hist[i]);
+    dest->write_ns_hist[i] = STATS_LOAD(src->write_ns_hist[i]);
+  }
+}
+
+void powercap_stats_reset(void) {
+  uint64_t* p;
+  size_t i;
+  int attr;
+  /* the struct is only counters, so clear each one atomically */
+  for (attr = 0; attr < ATTR_COUNT; attr++) {
+    p = (uint64_t*) &stats[attr];
+    for (i = 0; i < sizeof(powercap_stats_file) / sizeof(uint64_t); i++) {
+      STATS_STORE(p[i], 0);
+    }
+  }
+}
+
+int powercap_stats_get_zone_file(powercap_zone_file type, powercap_stats_file* s) {
+  /* check type in case users pass bad int value instead of enum; int cast silences clang compiler */
+  if (!s || (int) type < 0 || (int) type > POWERCAP_ZONE_FILE_NAME) {
+    errno = EINVAL;
+    return -errno;
+  }
+  copy_stats(s, &stats[ATTR_ZONE(type)]);
+  return 0;
+}
+
+int powercap_stats_get_constraint_file(powercap_constraint_file type, powercap_stats_file* s) {
+  /* check type in case users pass bad int value instead of enum; int cast silences clang compiler */
+  if (!s || (int) type < 0 || (int) type > POWERCAP_CONSTRAINT_FILE_NAME) {
+    errno = EINVAL;
+    return -errno;
+  }
+  copy_stats(s, &stats[ATTR_CONSTRAINT(type)]);
+  return 0;
+}
+
+static void fprint_hist(FILE* stream, const char* label, const uint64_t* hist) {
+  uint32_t i;
+  fprintf(stream, "  %s:", label);
+  for (i = 0; i < POWERCAP_STATS_HIST_BUCKETS; i++) {
+    if (hist[i]) {
+      fprintf(stream, " %"PRIu32":%"PRIu64, i, hist[i]);
+    }
+  }
+  fprintf(stream, "\n");
+}
+
+int powercap_stats_fprint(FILE* stream) {
+  powercap_stats_file s;
+  char name[48];
+  int attr;
+  int n;
+  if (!stream) {
+    errno = EINVAL;
+    return -errno;
+  }
+  for (attr = 0; attr < ATTR_COUNT; attr++) {
+    copy_stats(&s, &stats[attr]);
+    if (!(s.opens || s.reads || s.writes)) {
+      continue;
+    }
+    if (attr < ATTR_CONSTRAINT(0)) {
+      zone_file_get_name((powercap_zone_file) attr, name, sizeof(name));
+    } else {
+      /* constraint number is not tracked, use a placeholder */
+      n = snprintf(name, sizeof(name), "constraint_N_");
+      constraint_file_get_suffix((powercap_constraint_file) (attr - ATTR_CONSTRAINT(0)), name + n, sizeof(name) - (size_t) n);
+    }
+    fprintf(stream, "%s\n", name);
+    fprintf(stream, "  opens: %"PRIu64" (errors: %"PRIu64")\n", s.opens, s.open_errors);
+    fprintf(stream, "  reads: %"PRIu64" (errors: %"PRIu64", parse errors: %"PRIu64", bytes: %"PRIu64", ns: %"PRIu64")\n",
+            s.reads, s.read_errors, s.parse_errors, s.bytes_read, s.read_ns);
+    fprintf(stream, "  writes: %"PRIu64" (errors: %"PRIu64", bytes: %"PRIu64", ns: %"PRIu64")\n",
+            s.writes, s.write_errors, s.bytes_written, s.write_ns);
+    fprint_hist(stream, "read_ns_log2_hist", s.read_ns_hist);
+    fprint_hist(stream, "write_ns_log2_hist", s.write_ns_hist);
+  }
+  if (ferror(stream)) {
+    errno = EIO;
+    return -errno;
+  }
+  return 0;
+}
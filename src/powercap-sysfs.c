@@ -13,10 +13,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-/* Main powercap header only used for enums, not functions! */
+/* Main powercap header only used for enums and file descriptor structs, not functions! */
 #include "powercap.h"
 #include "powercap-common.h"
 #include "powercap-sysfs.h"
+#include "powercap-trace.h"
 
 static int zone_read_u64(const char* control_type, const uint32_t* zones, uint32_t depth, uint64_t* val,
                          powercap_zone_file type) {
@@ -25,7 +26,7 @@ static int zone_read_u64(const char* control_type, const uint32_t* zones, uint32
   if ((fd = open_zone_file(control_type, zones, depth, type, O_RDONLY)) < 0) {
     return -errno;
   }
-  ret = read_u64(fd, val);
+  ret = read_u64(fd, val, ATTR_ZONE(type));
   close(fd);
   return ret;
 }
@@ -37,20 +38,38 @@ static int constraint_read_u64(const char* control_type, const uint32_t* zones,
   if ((fd = open_constraint_file(control_type, zones, depth, constraint, type, O_RDONLY)) < 0) {
     return -errno;
   }
-  ret = read_u64(fd, val);
+  ret = read_u64(fd, val, ATTR_CONSTRAINT(type));
   close(fd);
   return ret;
 }
 
+static int zone_write_u64(const char* control_type, const uint32_t* zones, uint32_t depth, uint64_t val,
+                          powercap_zone_file type) {
+  int ret;
+  int fd;
+  TRACE5(sysfs_zone_set_entry, control_type, zones, depth, ATTR_ZONE(type), val);
+  if ((fd = open_zone_file(control_type, zones, depth, type, O_WRONLY)) < 0) {
+    ret = -errno;
+  } else {
+    ret = write_u64(fd, val, ATTR_ZONE(type));
+    close(fd);
+  }
+  TRACE5(sysfs_zone_set_return, control_type, zones, depth, ATTR_ZONE(type), ret);
+  return ret;
+}
+
 static int constraint_write_u64(const char* control_type, const uint32_t* zones, uint32_t depth, uint32_t constraint,
                                 uint64_t val, powercap_constraint_file type) {
   int ret;
   int fd;
+  TRACE6(sysfs_constraint_set_entry, control_type, zones, depth, constraint, ATTR_CONSTRAINT(type), val);
   if ((fd = open_constraint_file(control_type, zones, depth, constraint, type, O_WRONLY)) < 0) {
-    return -errno;
+    ret = -errno;
+  } else {
+    ret = write_u64(fd, val, ATTR_CONSTRAINT(type));
+    close(fd);
   }
-  ret = write_u64(fd, val);
-  close(fd);
+  TRACE6(sysfs_constraint_set_return, control_type, zones, depth, constraint, ATTR_CONSTRAINT(type), ret);
   return ret;
 }
 
@@ -90,14 +109,7 @@ int powercap_sysfs_zone_get_max_energy_range_uj(const char* control_type, const
 }
 
 int powercap_sysfs_zone_reset_energy_uj(const char* control_type, const uint32_t* zones, uint32_t depth) {
-  int ret;
-  int fd;
-  if ((fd = open_zone_file(control_type, zones, depth, POWERCAP_ZONE_FILE_ENERGY_UJ, O_WRONLY)) < 0) {
-    return -errno;
-  }
-  ret = write_u64(fd, 0);
-  close(fd);
-  return ret;
+  return zone_write_u64(control_type, zones, depth, 0, POWERCAP_ZONE_FILE_ENERGY_UJ);
 }
 
 int powercap_sysfs_zone_get_energy_uj(const char* control_type, const uint32_t* zones, uint32_t depth, uint64_t* val) {
@@ -113,14 +125,7 @@ int powercap_sysfs_zone_get_power_uw(const char* control_type, const uint32_t* z
 }
 
 int powercap_sysfs_zone_set_enabled(const char* control_type, const uint32_t* zones, uint32_t depth, uint32_t val) {
-  int ret;
-  int fd;
-  if ((fd = open_zone_file(control_type, zones, depth, POWERCAP_ZONE_FILE_ENABLED, O_WRONLY)) < 0) {
-    return -errno;
-  }
-  ret = write_u64(fd, (uint64_t) val);
-  close(fd);
-  return ret;
+  return zone_write_u64(control_type, zones, depth, (uint64_t) val, POWERCAP_ZONE_FILE_ENABLED);
 }
 
 int powercap_sysfs_zone_get_enabled(const char* control_type, const uint32_t* zones, uint32_t depth, uint32_t* val) {
@@ -143,7 +148,7 @@ ssize_t powercap_sysfs_zone_get_name(const char* control_type, const uint32_t* z
   if ((fd = open_zone_file(control_type, zones, depth, POWERCAP_ZONE_FILE_NAME, O_RDONLY)) < 0) {
     return -errno;
   }
-  ret = read_string(fd, buf, size);
+  ret = read_string(fd, buf, size, ATTR_ZONE(POWERCAP_ZONE_FILE_NAME));
   close(fd);
   return ret;
 }
@@ -186,7 +191,159 @@ ssize_t powercap_sysfs_constraint_get_name(const char* control_type, const uint3
   if ((fd = open_constraint_file(control_type, zones, depth, constraint, POWERCAP_CONSTRAINT_FILE_NAME, O_RDONLY)) < 0) {
     return -errno;
   }
-  ret = read_string(fd, buf, size);
+  ret = read_string(fd, buf, size, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_NAME));
   close(fd);
   return ret;
 }
+
+/* Missing files, and files that can't be read when read_only, are left unopened (fd 0) as in powercap-rapl.h */
+static int open_or_skip(int fd, int read_only, int* out) {
+  if (fd >= 0) {
+    *out = fd;
+    return 0;
+  }
+  if (errno == ENOENT || (read_only && errno == EACCES)) {
+    *out = 0;
+    return 0;
+  }
+  return -errno;
+}
+
+static int close_fd(int* fd) {
+  int ret = (*fd > 0 && close(*fd)) ? -errno : 0;
+  *fd = 0;
+  return ret;
+}
+
+static int zone_open(const char* control_type, const uint32_t* zones, uint32_t depth, powercap_zone_file type,
+                     int flags, int read_only, int* fd) {
+  return open_or_skip(open_zone_file(control_type, zones, depth, type, flags), read_only, fd);
+}
+
+static int constraint_open(const char* control_type, const uint32_t* zones, uint32_t depth, uint32_t constraint,
+                           powercap_constraint_file type, int flags, int read_only, int* fd) {
+  return open_or_skip(open_constraint_file(control_type, zones, depth, constraint, type, flags), read_only, fd);
+}
+
+int powercap_sysfs_zone_open(powercap_zone* zone, const char* control_type, const uint32_t* zones, uint32_t depth,
+                             int read_only) {
+  int rw = read_only ? O_RDONLY : O_RDWR;
+  int err_save;
+  int ret;
+  if (zone == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(zone, 0, sizeof(powercap_zone));
+  if ((ret = powercap_sysfs_zone_exists(control_type, zones, depth))) {
+    return ret;
+  }
+  if ((ret = zone_open(control_type, zones, depth, POWERCAP_ZONE_FILE_MAX_ENERGY_RANGE_UJ, O_RDONLY, read_only,
+                       &zone->max_energy_range_uj)) ||
+      (ret = zone_open(control_type, zones, depth, POWERCAP_ZONE_FILE_ENERGY_UJ, O_RDONLY, read_only,
+                       &zone->energy_uj)) ||
+      (ret = zone_open(control_type, zones, depth, POWERCAP_ZONE_FILE_MAX_POWER_RANGE_UW, O_RDONLY, read_only,
+                       &zone->max_power_range_uw)) ||
+      (ret = zone_open(control_type, zones, depth, POWERCAP_ZONE_FILE_POWER_UW, O_RDONLY, read_only,
+                       &zone->power_uw)) ||
+      (ret = zone_open(control_type, zones, depth, POWERCAP_ZONE_FILE_ENABLED, rw, read_only, &zone->enabled)) ||
+      (ret = zone_open(control_type, zones, depth, POWERCAP_ZONE_FILE_NAME, O_RDONLY, read_only, &zone->name))) {
+    err_save = errno;
+    powercap_sysfs_zone_close(zone);
+    errno = err_save;
+  }
+  return ret;
+}
+
+int powercap_sysfs_zone_close(powercap_zone* zone) {
+  int ret = 0;
+  int r;
+  if (zone == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((r = close_fd(&zone->max_energy_range_uj)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&zone->energy_uj)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&zone->max_power_range_uw)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&zone->power_uw)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&zone->enabled)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&zone->name)) && !ret) {
+    ret = r;
+  }
+  return ret;
+}
+
+int powercap_sysfs_constraint_open(powercap_constraint* constraint, const char* control_type, const uint32_t* zones,
+                                   uint32_t depth, uint32_t num, int read_only) {
+  int rw = read_only ? O_RDONLY : O_RDWR;
+  int err_save;
+  int ret;
+  if (constraint == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(constraint, 0, sizeof(powercap_constraint));
+  if ((ret = powercap_sysfs_constraint_exists(control_type, zones, depth, num))) {
+    return ret;
+  }
+  if ((ret = constraint_open(control_type, zones, depth, num, POWERCAP_CONSTRAINT_FILE_POWER_LIMIT_UW, rw, read_only,
+                             &constraint->power_limit_uw)) ||
+      (ret = constraint_open(control_type, zones, depth, num, POWERCAP_CONSTRAINT_FILE_TIME_WINDOW_US, rw, read_only,
+                             &constraint->time_window_us)) ||
+      (ret = constraint_open(control_type, zones, depth, num, POWERCAP_CONSTRAINT_FILE_MAX_POWER_UW, O_RDONLY,
+                             read_only, &constraint->max_power_uw)) ||
+      (ret = constraint_open(control_type, zones, depth, num, POWERCAP_CONSTRAINT_FILE_MIN_POWER_UW, O_RDONLY,
+                             read_only, &constraint->min_power_uw)) ||
+      (ret = constraint_open(control_type, zones, depth, num, POWERCAP_CONSTRAINT_FILE_MAX_TIME_WINDOW_US, O_RDONLY,
+                             read_only, &constraint->max_time_window_us)) ||
+      (ret = constraint_open(control_type, zones, depth, num, POWERCAP_CONSTRAINT_FILE_MIN_TIME_WINDOW_US, O_RDONLY,
+                             read_only, &constraint->min_time_window_us)) ||
+      (ret = constraint_open(control_type, zones, depth, num, POWERCAP_CONSTRAINT_FILE_NAME, O_RDONLY, read_only,
+                             &constraint->name))) {
+    err_save = errno;
+    powercap_sysfs_constraint_close(constraint);
+    errno = err_save;
+  }
+  return ret;
+}
+
+int powercap_sysfs_constraint_close(powercap_constraint* constraint) {
+  int ret = 0;
+  int r;
+  if (constraint == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((r = close_fd(&constraint->power_limit_uw)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&constraint->time_window_us)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&constraint->max_power_uw)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&constraint->min_power_uw)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&constraint->max_time_window_us)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&constraint->min_time_window_us)) && !ret) {
+    ret = r;
+  }
+  if ((r = close_fd(&constraint->name)) && !ret) {
+    ret = r;
+  }
+  return ret;
+}
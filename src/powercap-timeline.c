@@ -0,0 +1,235 @@
+/**
+ * Energy consumed over arbitrary time intervals of a recorded sample series.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap-column.h"
+#include "powercap-common.h"
+#include "powercap-timeline.h"
+#include "powercap-vector.h"
+
+int powercap_timeline_init(powercap_timeline* tl, uint32_t nzones, const uint64_t* max_energy_range_uj) {
+  int ret;
+  if (tl == NULL || !nzones) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(tl, 0, sizeof(powercap_timeline));
+  if (!(tl->max_energy_range_uj = calloc(nzones, sizeof(uint64_t))) ||
+      !(tl->last_uj = calloc(nzones, sizeof(uint64_t)))) {
+    ret = -errno;
+    free(tl->max_energy_range_uj);
+    return ret;
+  }
+  if (max_energy_range_uj != NULL) {
+    memcpy(tl->max_energy_range_uj, max_energy_range_uj, nzones * sizeof(uint64_t));
+  }
+  tl->nzones = nzones;
+  return 0;
+}
+
+int powercap_timeline_destroy(powercap_timeline* tl) {
+  if (tl == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  free(tl->max_energy_range_uj);
+  free(tl->last_uj);
+  free(tl->time_ns);
+  free(tl->energy_uj);
+  memset(tl, 0, sizeof(powercap_timeline));
+  return 0;
+}
+
+static int reserve(powercap_timeline* tl, size_t n) {
+  int64_t* time_ns;
+  uint64_t* energy_uj;
+  size_t cap = tl->cap ? tl->cap : 1024;
+  if (n <= tl->cap) {
+    return 0;
+  }
+  while (cap < n) {
+    cap *= 2;
+  }
+  if (!(time_ns = realloc(tl->time_ns, cap * sizeof(int64_t)))) {
+    return -errno;
+  }
+  tl->time_ns = time_ns;
+  if (!(energy_uj = realloc(tl->energy_uj, cap * tl->nzones * sizeof(uint64_t)))) {
+    return -errno;
+  }
+  tl->energy_uj = energy_uj;
+  tl->cap = cap;
+  return 0;
+}
+
+int powercap_timeline_append(powercap_timeline* tl, int64_t time_ns, const uint64_t* energy_uj) {
+  uint64_t* sums;
+  const uint64_t* prev;
+  uint32_t z;
+  int ret;
+  if (tl == NULL || energy_uj == NULL || (tl->nsamples && time_ns < tl->time_ns[tl->nsamples - 1])) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((ret = reserve(tl, tl->nsamples + 1))) {
+    errno = -ret;
+    return ret;
+  }
+  sums = &tl->energy_uj[tl->nsamples * tl->nzones];
+  prev = tl->nsamples ? sums - tl->nzones : NULL;
+  for (z = 0; z < tl->nzones; z++) {
+    sums[z] = prev ? prev[z] + energy_delta_uj(tl->last_uj[z], energy_uj[z], tl->max_energy_range_uj[z]) : 0;
+    tl->last_uj[z] = energy_uj[z];
+  }
+  tl->time_ns[tl->nsamples++] = time_ns;
+  return 0;
+}
+
+/* Append a decoded block, whose counters are overwritten with their deltas */
+static int append_block(powercap_timeline* tl, const int64_t* time_ns, uint64_t* energy_uj, size_t stride, size_t n) {
+  uint64_t* sums = &tl->energy_uj[tl->nsamples * tl->nzones];
+  const uint64_t* prev = tl->nsamples ? sums - tl->nzones : NULL;
+  uint64_t* col;
+  uint64_t last;
+  size_t i;
+  uint32_t z;
+  for (i = 0; i < n; i++) {
+    if (time_ns[i] < (i ? time_ns[i - 1] : (tl->nsamples ? tl->time_ns[tl->nsamples - 1] : INT64_MIN))) {
+      return -EINVAL;
+    }
+  }
+  for (z = 0; z < tl->nzones; z++) {
+    col = &energy_uj[z * stride];
+    last = col[n - 1];
+    sums[z] = prev ? prev[z] + energy_delta_uj(tl->last_uj[z], col[0], tl->max_energy_range_uj[z]) : 0;
+    powercap_vector_energy_deltas(col, n, tl->max_energy_range_uj[z], col);
+    for (i = 1; i < n; i++) {
+      sums[i * tl->nzones + z] = sums[(i - 1) * tl->nzones + z] + col[i - 1];
+    }
+    tl->last_uj[z] = last;
+  }
+  memcpy(&tl->time_ns[tl->nsamples], time_ns, n * sizeof(int64_t));
+  tl->nsamples += n;
+  return 0;
+}
+
+int powercap_timeline_append_column(powercap_timeline* tl, const powercap_column_reader* r) {
+  int64_t* time_ns;
+  uint64_t* energy_uj;
+  uint32_t b;
+  int n;
+  int ret;
+  if (tl == NULL || r == NULL || r->nzones != tl->nzones) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (r->total_rows > SIZE_MAX - tl->nsamples) {
+    errno = ENOMEM;
+    return -errno;
+  }
+  if ((ret = reserve(tl, tl->nsamples + (size_t) r->total_rows))) {
+    errno = -ret;
+    return ret;
+  }
+  time_ns = malloc(r->block_rows * sizeof(int64_t));
+  energy_uj = malloc((size_t) r->nzones * r->block_rows * sizeof(uint64_t));
+  ret = time_ns == NULL || energy_uj == NULL ? -ENOMEM : 0;
+  for (b = 0; !ret && b < r->nblocks; b++) {
+    if ((n = powercap_column_reader_decode(r, b, time_ns, energy_uj)) < 0) {
+      ret = n;
+    } else {
+      ret = append_block(tl, time_ns, energy_uj, r->block_rows, (size_t) n);
+    }
+  }
+  free(time_ns);
+  free(energy_uj);
+  if (ret) {
+    errno = -ret;
+  }
+  return ret;
+}
+
+/*
+ * Find the last sample at or before t (or the first sample if there is none), starting from a hint: galloping
+ * forward if t is at or after the hinted sample, otherwise searching the samples before it.
+ */
+static size_t locate(const powercap_timeline* tl, int64_t t, size_t hint) {
+  const int64_t* ts = tl->time_ns;
+  size_t lo = 0;
+  size_t hi = hint;
+  size_t step = 1;
+  size_t mid;
+  if (ts[hint] <= t) {
+    lo = hint;
+    while (lo + step < tl->nsamples && ts[lo + step] <= t) {
+      lo += step;
+      step *= 2;
+    }
+    hi = lo + step < tl->nsamples ? lo + step : tl->nsamples;
+  }
+  /* ts[hi] > t, or hi is the end */
+  while (hi - lo > 1) {
+    mid = lo + (hi - lo) / 2;
+    if (ts[mid] <= t) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/* The energy between sample i and t, interpolated between samples i and i + 1 */
+static double partial(const powercap_timeline* tl, uint32_t zone, size_t i, int64_t t) {
+  const int64_t* ts = tl->time_ns;
+  const uint64_t* e = &tl->energy_uj[i * tl->nzones + zone];
+  if (t <= ts[i] || i + 1 >= tl->nsamples) {
+    return 0;
+  }
+  return (double) (e[tl->nzones] - e[0]) * (double) ((uint64_t) t - (uint64_t) ts[i]) /
+         (double) ((uint64_t) ts[i + 1] - (uint64_t) ts[i]);
+}
+
+static double interval_energy(const powercap_timeline* tl, uint32_t zone, size_t i, int64_t start_ns, size_t j,
+                              int64_t end_ns) {
+  return (double) (tl->energy_uj[j * tl->nzones + zone] - tl->energy_uj[i * tl->nzones + zone]) +
+         partial(tl, zone, j, end_ns) - partial(tl, zone, i, start_ns);
+}
+
+int powercap_timeline_energy(const powercap_timeline* tl, uint32_t zone, int64_t start_ns, int64_t end_ns,
+                             double* energy_uj) {
+  return powercap_timeline_energy_batch(tl, zone, &start_ns, &end_ns, 1, energy_uj);
+}
+
+int powercap_timeline_energy_batch(const powercap_timeline* tl, uint32_t zone, const int64_t* start_ns,
+                                   const int64_t* end_ns, size_t n, double* energy_uj) {
+  size_t hint = 0;
+  size_t i;
+  size_t j;
+  size_t k;
+  if (tl == NULL || zone >= tl->nzones || (n && (start_ns == NULL || end_ns == NULL || energy_uj == NULL))) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (!tl->nsamples) {
+    errno = ENODATA;
+    return -errno;
+  }
+  for (k = 0; k < n; k++) {
+    if (start_ns[k] > end_ns[k]) {
+      errno = EINVAL;
+      return -errno;
+    }
+    i = locate(tl, start_ns[k], hint);
+    j = locate(tl, end_ns[k], i);
+    energy_uj[k] = interval_energy(tl, zone, i, start_ns[k], j, end_ns[k]);
+    hint = i;
+  }
+  return 0;
+}
@@ -0,0 +1,53 @@
+/**
+ * Static tracepoints (USDT probes) for hot paths.
+ *
+ * Probes are only compiled in when POWERCAP_USDT is defined (CMake option of the same name), which requires
+ * <sys/sdt.h> (e.g., from systemtap-sdt-dev); otherwise the macros expand to nothing and their arguments are not
+ * evaluated.
+ * An unattached probe is a single nop instruction.
+ *
+ * All probes are in the "powercap" provider, and each traced function has "_entry" and "_return" probes:
+ *   read_u64_entry(fd, attr)                       read_u64_return(fd, attr, ret, val)
+ *   write_u64_entry(fd, attr, val)                 write_u64_return(fd, attr, ret)
+ *   open_zone_file_entry(control_type, zones,      open_zone_file_return(path, fd)
+ *                        depth, type)
+ *   open_constraint_file_entry(control_type,       open_constraint_file_return(path, fd)
+ *                              zones, depth,
+ *                              constraint, type)
+ *   rapl_init_entry(package, read_only)            rapl_init_return(package, ret)
+ *   zone_set_entry(fd, attr, val)                  zone_set_return(fd, attr, ret)
+ *   constraint_set_entry(fd, attr, val)            constraint_set_return(fd, attr, ret)
+ *   sysfs_zone_set_entry(control_type, zones,      sysfs_zone_set_return(control_type, zones, depth, attr, ret)
+ *                        depth, attr, val)
+ *   sysfs_constraint_set_entry(control_type,       sysfs_constraint_set_return(control_type, zones, depth,
+ *                              zones, depth,                                   constraint, attr, ret)
+ *                              constraint, attr,
+ *                              val)
+ * "attr" is the attribute index from powercap-common.h (zone file types, then constraint file types).
+ * The fd-based probes don't know the file path; correlate fds with the open probes or /proc/PID/fd.
+ *
+ * For example, with bpftrace:
+ *   bpftrace -e 'usdt:/usr/local/lib/libpowercap.so:powercap:constraint_set_entry { printf("%d %d\n", arg0, arg2); }'
+ *
+ * @author Connor Imes
+ * @date 2026-10-18
+ */
+#ifndef _POWERCAP_TRACE_H_
+#define _POWERCAP_TRACE_H_
+
+#ifdef POWERCAP_USDT
+  #include <sys/sdt.h>
+  #define TRACE2(name, a, b) DTRACE_PROBE2(powercap, name, a, b)
+  #define TRACE3(name, a, b, c) DTRACE_PROBE3(powercap, name, a, b, c)
+  #define TRACE4(name, a, b, c, d) DTRACE_PROBE4(powercap, name, a, b, c, d)
+  #define TRACE5(name, a, b, c, d, e) DTRACE_PROBE5(powercap, name, a, b, c, d, e)
+  #define TRACE6(name, a, b, c, d, e, f) DTRACE_PROBE6(powercap, name, a, b, c, d, e, f)
+#else
+  #define TRACE2(name, a, b) do { } while (0)
+  #define TRACE3(name, a, b, c) do { } while (0)
+  #define TRACE4(name, a, b, c, d) do { } while (0)
+  #define TRACE5(name, a, b, c, d, e) do { } while (0)
+  #define TRACE6(name, a, b, c, d, e, f) do { } while (0)
+#endif
+
+#endif
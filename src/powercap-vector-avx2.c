@@ -0,0 +1,95 @@
+/**
+ * AVX2 kernels for powercap-vector.h.
+ *
+ * This file is compiled with -mavx2; its functions must only be called after checking that the CPU supports AVX2.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "powercap-vector-common.h"
+
+/* Compare unsigned 64-bit lanes a > b */
+static __m256i cmpgt_epu64(__m256i a, __m256i b) {
+  const __m256i sign = _mm256_set1_epi64x((long long) 0x8000000000000000ULL);
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+}
+
+size_t vector_energy_deltas_avx2(const uint64_t* energy_uj, size_t n, uint64_t max_range, uint64_t* delta_uj) {
+  const __m256i max = _mm256_set1_epi64x((long long) max_range);
+  __m256i prev;
+  __m256i cur;
+  __m256i wrapped;
+  __m256i valid;
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    prev = _mm256_loadu_si256((const __m256i*) &energy_uj[i]);
+    cur = _mm256_loadu_si256((const __m256i*) &energy_uj[i + 1]);
+    /* a counter that went backward wrapped, if it was in range: max - prev + cur */
+    wrapped = cmpgt_epu64(prev, cur);
+    valid = _mm256_andnot_si256(cmpgt_epu64(prev, max), wrapped);
+    cur = _mm256_sub_epi64(cur, prev);
+    _mm256_storeu_si256((__m256i*) &delta_uj[i], _mm256_or_si256(_mm256_andnot_si256(wrapped, cur),
+                                                                 _mm256_and_si256(valid, _mm256_add_epi64(cur, max))));
+  }
+  return i;
+}
+
+/* Convert lanes below 2^52 to doubles exactly */
+static __m256d exact_to_pd(__m256i v) {
+  const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+  return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(v, magic)), _mm256_set1_pd(4503599627370496.0));
+}
+
+size_t vector_power_avx2(const uint64_t* delta_uj, const int64_t* time_ns, size_t n, double* power_uw) {
+  __m256i delta;
+  __m256i t0;
+  __m256i t1;
+  __m256i pos;
+  __m256i big;
+  __m256d p;
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    delta = _mm256_loadu_si256((const __m256i*) &delta_uj[i]);
+    t0 = _mm256_loadu_si256((const __m256i*) &time_ns[i]);
+    t1 = _mm256_loadu_si256((const __m256i*) &time_ns[i + 1]);
+    pos = _mm256_cmpgt_epi64(t1, t0);
+    t1 = _mm256_and_si256(_mm256_sub_epi64(t1, t0), pos);
+    big = _mm256_srli_epi64(_mm256_or_si256(delta, t1), VECTOR_EXACT_BITS);
+    if (!_mm256_testz_si256(big, big)) {
+      vector_power_scalar(delta_uj, time_ns, i, i + 4, power_uw);
+      continue;
+    }
+    p = _mm256_div_pd(_mm256_mul_pd(exact_to_pd(delta), _mm256_set1_pd(1e9)), exact_to_pd(t1));
+    _mm256_storeu_pd(&power_uw[i], _mm256_and_pd(p, _mm256_castsi256_pd(pos)));
+  }
+  return i;
+}
+
+size_t vector_stats_avx2(const double* values, size_t n, vector_stats* stats) {
+  __m256d sums = _mm256_loadu_pd(stats->sums);
+  __m256d min = _mm256_set1_pd(stats->min);
+  __m256d max = _mm256_set1_pd(stats->max);
+  __m256d v;
+  double lanes[4];
+  size_t i;
+  size_t k;
+  for (i = 0; i + 4 <= n; i += 4) {
+    v = _mm256_loadu_pd(&values[i]);
+    sums = _mm256_add_pd(sums, v);
+    min = _mm256_min_pd(min, v);
+    max = _mm256_max_pd(max, v);
+  }
+  _mm256_storeu_pd(stats->sums, sums);
+  _mm256_storeu_pd(lanes, min);
+  for (k = 0; k < 4; k++) {
+    stats->min = lanes[k] < stats->min ? lanes[k] : stats->min;
+  }
+  _mm256_storeu_pd(lanes, max);
+  for (k = 0; k < 4; k++) {
+    stats->max = lanes[k] > stats->max ? lanes[k] : stats->max;
+  }
+  return i;
+}
@@ -0,0 +1,58 @@
+/**
+ * Internal kernels shared by the instruction set implementations of powercap-vector.h.
+ *
+ * Each implementation processes whole vectors and leaves the remainder to the scalar kernels, which are written to
+ * give results identical to the vector kernels (sums are accumulated in 4 interleaved partial sums).
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _POWERCAP_VECTOR_COMMON_H_
+#define _POWERCAP_VECTOR_COMMON_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma GCC visibility push(hidden)
+
+/* Values below 2^52 convert exactly between uint64_t and double */
+#define VECTOR_EXACT_BITS 52
+
+/* Running statistics; sums[k] accumulates values at indexes i with i % 4 == k */
+typedef struct vector_stats {
+  double min;
+  double max;
+  double sums[4];
+} vector_stats;
+
+/* Deltas between energy_uj[i] and energy_uj[i + 1] for i in [start, end) */
+void vector_energy_deltas_scalar(const uint64_t* energy_uj, size_t start, size_t end, uint64_t max_range,
+                                 uint64_t* delta_uj);
+
+/* Power over the intervals between time_ns[i] and time_ns[i + 1] for i in [start, end) */
+void vector_power_scalar(const uint64_t* delta_uj, const int64_t* time_ns, size_t start, size_t end,
+                         double* power_uw);
+
+/* Accumulate values[i] for i in [start, end), where start is a multiple of 4; min and max must be initialized */
+void vector_stats_scalar(const double* values, size_t start, size_t end, vector_stats* stats);
+
+#ifdef POWERCAP_VECTOR_AVX2
+/* Return the number of values processed, from the start of the arrays */
+size_t vector_energy_deltas_avx2(const uint64_t* energy_uj, size_t n, uint64_t max_range, uint64_t* delta_uj);
+
+size_t vector_power_avx2(const uint64_t* delta_uj, const int64_t* time_ns, size_t n, double* power_uw);
+
+size_t vector_stats_avx2(const double* values, size_t n, vector_stats* stats);
+#endif
+
+#pragma GCC visibility pop
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,264 @@
+/**
+ * Batch kernels for converting recorded energy counters to power.
+ *
+ * The scalar and SSE2 kernels are here; SSE2 is part of the x86-64 baseline, so it needs no special compiler flags.
+ * The AVX2 kernels are in a separate file that's compiled with -mavx2.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "powercap-common.h"
+#include "powercap-vector.h"
+#include "powercap-vector-common.h"
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#define VECTOR_SSE2
+#endif
+
+/* -1 selects the best available */
+static int forced_isa = -1;
+
+static powercap_vector_isa best_isa(void) {
+#ifdef POWERCAP_VECTOR_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return POWERCAP_VECTOR_ISA_AVX2;
+  }
+#endif
+#ifdef VECTOR_SSE2
+  return POWERCAP_VECTOR_ISA_SSE2;
+#else
+  return POWERCAP_VECTOR_ISA_SCALAR;
+#endif
+}
+
+powercap_vector_isa powercap_vector_get_isa(void) {
+  return forced_isa < 0 ? best_isa() : (powercap_vector_isa) forced_isa;
+}
+
+int powercap_vector_set_isa(powercap_vector_isa isa) {
+  /* int cast silences clang compiler */
+  if ((int) isa < 0 || (int) isa > POWERCAP_VECTOR_ISA_AVX2) {
+    errno = EINVAL;
+    return -errno;
+  }
+  /* each instruction set implies support for the ones before it */
+  if (isa > best_isa()) {
+    errno = ENOTSUP;
+    return -errno;
+  }
+  forced_isa = (int) isa;
+  return 0;
+}
+
+void vector_energy_deltas_scalar(const uint64_t* energy_uj, size_t start, size_t end, uint64_t max_range,
+                                 uint64_t* delta_uj) {
+  size_t i;
+  for (i = start; i < end; i++) {
+    delta_uj[i] = energy_delta_uj(energy_uj[i], energy_uj[i + 1], max_range);
+  }
+}
+
+void vector_power_scalar(const uint64_t* delta_uj, const int64_t* time_ns, size_t start, size_t end,
+                         double* power_uw) {
+  size_t i;
+  for (i = start; i < end; i++) {
+    power_uw[i] = time_ns[i + 1] > time_ns[i] ?
+                  (double) delta_uj[i] * 1e9 / (double) ((uint64_t) time_ns[i + 1] - (uint64_t) time_ns[i]) : 0;
+  }
+}
+
+void vector_stats_scalar(const double* values, size_t start, size_t end, vector_stats* stats) {
+  size_t i;
+  for (i = start; i < end; i++) {
+    stats->min = values[i] < stats->min ? values[i] : stats->min;
+    stats->max = values[i] > stats->max ? values[i] : stats->max;
+    stats->sums[i & 3] += values[i];
+  }
+}
+
+#ifdef VECTOR_SSE2
+/* Compare 64-bit lanes a > b, signed in the high halves if hi_bias is 0, or unsigned if it's 0x80000000 */
+static __m128i cmpgt_epi64_sse2(__m128i a, __m128i b, int hi_bias) {
+  const __m128i bias = _mm_set_epi32(hi_bias, (int) 0x80000000, hi_bias, (int) 0x80000000);
+  __m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+  __m128i eq = _mm_cmpeq_epi32(a, b);
+  /* the high halves decide unless they're equal */
+  return _mm_or_si128(_mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1)),
+                      _mm_and_si128(_mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1)),
+                                    _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0))));
+}
+
+static size_t energy_deltas_sse2(const uint64_t* energy_uj, size_t n, uint64_t max_range, uint64_t* delta_uj) {
+  const __m128i max = _mm_set1_epi64x((long long) max_range);
+  const __m128i ones = _mm_set1_epi32(-1);
+  __m128i prev;
+  __m128i cur;
+  __m128i wrapped;
+  __m128i valid;
+  size_t i;
+  for (i = 0; i + 2 <= n; i += 2) {
+    prev = _mm_loadu_si128((const __m128i*) &energy_uj[i]);
+    cur = _mm_loadu_si128((const __m128i*) &energy_uj[i + 1]);
+    /* a counter that went backward wrapped, if it was in range: max - prev + cur */
+    wrapped = cmpgt_epi64_sse2(prev, cur, (int) 0x80000000);
+    valid = _mm_and_si128(wrapped, _mm_xor_si128(cmpgt_epi64_sse2(prev, max, (int) 0x80000000), ones));
+    cur = _mm_sub_epi64(cur, prev);
+    _mm_storeu_si128((__m128i*) &delta_uj[i], _mm_or_si128(_mm_andnot_si128(wrapped, cur),
+                                                           _mm_and_si128(valid, _mm_add_epi64(cur, max))));
+  }
+  return i;
+}
+
+/* Convert lanes below 2^52 to doubles exactly */
+static __m128d exact_to_pd_sse2(__m128i v) {
+  const __m128i magic = _mm_set1_epi64x(0x4330000000000000LL);
+  return _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(v, magic)), _mm_set1_pd(4503599627370496.0));
+}
+
+static size_t power_sse2(const uint64_t* delta_uj, const int64_t* time_ns, size_t n, double* power_uw) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i delta;
+  __m128i dt;
+  __m128i pos;
+  __m128d p;
+  size_t i;
+  for (i = 0; i + 2 <= n; i += 2) {
+    delta = _mm_loadu_si128((const __m128i*) &delta_uj[i]);
+    dt = _mm_loadu_si128((const __m128i*) &time_ns[i + 1]);
+    pos = cmpgt_epi64_sse2(dt, _mm_loadu_si128((const __m128i*) &time_ns[i]), 0);
+    dt = _mm_and_si128(_mm_sub_epi64(dt, _mm_loadu_si128((const __m128i*) &time_ns[i])), pos);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi64(_mm_or_si128(delta, dt), VECTOR_EXACT_BITS), zero)) !=
+        0xFFFF) {
+      vector_power_scalar(delta_uj, time_ns, i, i + 2, power_uw);
+      continue;
+    }
+    p = _mm_div_pd(_mm_mul_pd(exact_to_pd_sse2(delta), _mm_set1_pd(1e9)), exact_to_pd_sse2(dt));
+    _mm_storeu_pd(&power_uw[i], _mm_and_pd(p, _mm_castsi128_pd(pos)));
+  }
+  return i;
+}
+
+static size_t stats_sse2(const double* values, size_t n, vector_stats* stats) {
+  __m128d sums01 = _mm_loadu_pd(&stats->sums[0]);
+  __m128d sums23 = _mm_loadu_pd(&stats->sums[2]);
+  __m128d min = _mm_set1_pd(stats->min);
+  __m128d max = _mm_set1_pd(stats->max);
+  __m128d v01;
+  __m128d v23;
+  double lanes[2];
+  size_t i;
+  for (i = 0; i + 4 <= n; i += 4) {
+    v01 = _mm_loadu_pd(&values[i]);
+    v23 = _mm_loadu_pd(&values[i + 2]);
+    sums01 = _mm_add_pd(sums01, v01);
+    sums23 = _mm_add_pd(sums23, v23);
+    min = _mm_min_pd(min, _mm_min_pd(v01, v23));
+    max = _mm_max_pd(max, _mm_max_pd(v01, v23));
+  }
+  _mm_storeu_pd(&stats->sums[0], sums01);
+  _mm_storeu_pd(&stats->sums[2], sums23);
+  _mm_storeu_pd(lanes, min);
+  stats->min = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+  _mm_storeu_pd(lanes, max);
+  stats->max = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+  return i;
+}
+#endif
+
+int powercap_vector_energy_deltas(const uint64_t* energy_uj, size_t n, uint64_t max_energy_range_uj,
+                                  uint64_t* delta_uj) {
+  size_t done = 0;
+  if ((n && energy_uj == NULL) || (n > 1 && delta_uj == NULL)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (n < 2) {
+    return 0;
+  }
+  switch (powercap_vector_get_isa()) {
+#ifdef POWERCAP_VECTOR_AVX2
+  case POWERCAP_VECTOR_ISA_AVX2:
+    done = vector_energy_deltas_avx2(energy_uj, n - 1, max_energy_range_uj, delta_uj);
+    break;
+#endif
+#ifdef VECTOR_SSE2
+  case POWERCAP_VECTOR_ISA_SSE2:
+    done = energy_deltas_sse2(energy_uj, n - 1, max_energy_range_uj, delta_uj);
+    break;
+#endif
+  default:
+    break;
+  }
+  vector_energy_deltas_scalar(energy_uj, done, n - 1, max_energy_range_uj, delta_uj);
+  return 0;
+}
+
+int powercap_vector_power(const uint64_t* delta_uj, const int64_t* time_ns, size_t n, double* power_uw) {
+  size_t done = 0;
+  if (n > 1 && (delta_uj == NULL || time_ns == NULL || power_uw == NULL)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (n < 2) {
+    return 0;
+  }
+  switch (powercap_vector_get_isa()) {
+#ifdef POWERCAP_VECTOR_AVX2
+  case POWERCAP_VECTOR_ISA_AVX2:
+    done = vector_power_avx2(delta_uj, time_ns, n - 1, power_uw);
+    break;
+#endif
+#ifdef VECTOR_SSE2
+  case POWERCAP_VECTOR_ISA_SSE2:
+    done = power_sse2(delta_uj, time_ns, n - 1, power_uw);
+    break;
+#endif
+  default:
+    break;
+  }
+  vector_power_scalar(delta_uj, time_ns, done, n - 1, power_uw);
+  return 0;
+}
+
+int powercap_vector_stats(const double* values, size_t n, double* min, double* max, double* mean) {
+  vector_stats stats = { 0, 0, { 0, 0, 0, 0 } };
+  size_t done = 0;
+  if (n && values == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (!n) {
+    errno = ENODATA;
+    return -errno;
+  }
+  stats.min = values[0];
+  stats.max = values[0];
+  switch (powercap_vector_get_isa()) {
+#ifdef POWERCAP_VECTOR_AVX2
+  case POWERCAP_VECTOR_ISA_AVX2:
+    done = vector_stats_avx2(values, n, &stats);
+    break;
+#endif
+#ifdef VECTOR_SSE2
+  case POWERCAP_VECTOR_ISA_SSE2:
+    done = stats_sse2(values, n, &stats);
+    break;
+#endif
+  default:
+    break;
+  }
+  vector_stats_scalar(values, done, n, &stats);
+  if (min != NULL) {
+    *min = stats.min;
+  }
+  if (max != NULL) {
+    *max = stats.max;
+  }
+  if (mean != NULL) {
+    *mean = ((stats.sums[0] + stats.sums[1]) + (stats.sums[2] + stats.sums[3])) / (double) n;
+  }
+  return 0;
+}
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include "powercap.h"
 #include "powercap-common.h"
+#include "powercap-trace.h"
 
 int powercap_zone_file_get_name(powercap_zone_file type, char* buf, size_t size) {
   return zone_file_get_name(type, buf, size);
@@ -24,34 +25,50 @@ int powercap_constraint_file_get_name(powercap_constraint_file type, uint32_t co
     return -errno; \
   }
 
+static int zone_set_u64(int fd, uint64_t val, int attr) {
+  int ret;
+  TRACE3(zone_set_entry, fd, attr, val);
+  ret = write_u64(fd, val, attr);
+  TRACE3(zone_set_return, fd, attr, ret);
+  return ret;
+}
+
+static int constraint_set_u64(int fd, uint64_t val, int attr) {
+  int ret;
+  TRACE3(constraint_set_entry, fd, attr, val);
+  ret = write_u64(fd, val, attr);
+  TRACE3(constraint_set_return, fd, attr, ret);
+  return ret;
+}
+
 int powercap_zone_get_max_energy_range_uj(const powercap_zone* zone, uint64_t* val) {
   VERIFY_ARG(zone);
-  return read_u64(zone->max_energy_range_uj, val);
+  return read_u64(zone->max_energy_range_uj, val, ATTR_ZONE(POWERCAP_ZONE_FILE_MAX_ENERGY_RANGE_UJ));
 }
 
 int powercap_zone_get_energy_uj(const powercap_zone* zone, uint64_t* val) {
   VERIFY_ARG(zone);
-  return read_u64(zone->energy_uj, val);
+  return read_u64(zone->energy_uj, val, ATTR_ZONE(POWERCAP_ZONE_FILE_ENERGY_UJ));
 }
 
 int powercap_zone_reset_energy_uj(const powercap_zone* zone) {
   VERIFY_ARG(zone);
-  return write_u64(zone->energy_uj, 0);
+  return zone_set_u64(zone->energy_uj, 0, ATTR_ZONE(POWERCAP_ZONE_FILE_ENERGY_UJ));
 }
 
 int powercap_zone_get_max_power_range_uw(const powercap_zone* zone, uint64_t* val) {
   VERIFY_ARG(zone);
-  return read_u64(zone->max_power_range_uw, val);
+  return read_u64(zone->max_power_range_uw, val, ATTR_ZONE(POWERCAP_ZONE_FILE_MAX_POWER_RANGE_UW));
 }
 
 int powercap_zone_get_power_uw(const powercap_zone* zone, uint64_t* val) {
   VERIFY_ARG(zone);
-  return read_u64(zone->power_uw, val);
+  return read_u64(zone->power_uw, val, ATTR_ZONE(POWERCAP_ZONE_FILE_POWER_UW));
 }
 
 int powercap_zone_set_enabled(const powercap_zone* zone, int val) {
   VERIFY_ARG(zone);
-  return write_u64(zone->enabled, (uint64_t) val);
+  return zone_set_u64(zone->enabled, (uint64_t) val, ATTR_ZONE(POWERCAP_ZONE_FILE_ENABLED));
 }
 
 int powercap_zone_get_enabled(const powercap_zone* zone, int* val) {
@@ -59,7 +76,7 @@ int powercap_zone_get_enabled(const powercap_zone* zone, int* val) {
   int ret;
   VERIFY_ARG(zone);
   VERIFY_ARG(val);
-  if (!(ret = read_u64(zone->enabled, &enabled))) {
+  if (!(ret = read_u64(zone->enabled, &enabled, ATTR_ZONE(POWERCAP_ZONE_FILE_ENABLED)))) {
     *val = enabled ? 1 : 0;
   }
   return ret;
@@ -67,50 +84,50 @@ int powercap_zone_get_enabled(const powercap_zone* zone, int* val) {
 
 ssize_t powercap_zone_get_name(const powercap_zone* zone, char* buf, size_t size) {
   VERIFY_ARG(zone);
-  return read_string(zone->name, buf, size);
+  return read_string(zone->name, buf, size, ATTR_ZONE(POWERCAP_ZONE_FILE_NAME));
 }
 
 int powercap_constraint_set_power_limit_uw(const powercap_constraint* constraint, uint64_t val) {
   VERIFY_ARG(constraint)
-  return write_u64(constraint->power_limit_uw, val);
+  return constraint_set_u64(constraint->power_limit_uw, val, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_POWER_LIMIT_UW));
 }
 
 int powercap_constraint_get_power_limit_uw(const powercap_constraint* constraint, uint64_t* val) {
   VERIFY_ARG(constraint)
-  return read_u64(constraint->power_limit_uw, val);
+  return read_u64(constraint->power_limit_uw, val, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_POWER_LIMIT_UW));
 }
 
 int powercap_constraint_set_time_window_us(const powercap_constraint* constraint, uint64_t val) {
   VERIFY_ARG(constraint)
-  return write_u64(constraint->time_window_us, val);
+  return constraint_set_u64(constraint->time_window_us, val, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_TIME_WINDOW_US));
 }
 
 int powercap_constraint_get_time_window_us(const powercap_constraint* constraint, uint64_t* val) {
   VERIFY_ARG(constraint)
-  return read_u64(constraint->time_window_us, val);
+  return read_u64(constraint->time_window_us, val, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_TIME_WINDOW_US));
 }
 
 int powercap_constraint_get_max_power_uw(const powercap_constraint* constraint, uint64_t* val) {
   VERIFY_ARG(constraint)
-  return read_u64(constraint->max_power_uw, val);
+  return read_u64(constraint->max_power_uw, val, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_MAX_POWER_UW));
 }
 
 int powercap_constraint_get_min_power_uw(const powercap_constraint* constraint, uint64_t* val) {
   VERIFY_ARG(constraint)
-  return read_u64(constraint->min_power_uw, val);
+  return read_u64(constraint->min_power_uw, val, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_MIN_POWER_UW));
 }
 
 int powercap_constraint_get_max_time_window_us(const powercap_constraint* constraint, uint64_t* val) {
   VERIFY_ARG(constraint)
-  return read_u64(constraint->max_time_window_us, val);
+  return read_u64(constraint->max_time_window_us, val, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_MAX_TIME_WINDOW_US));
 }
 
 int powercap_constraint_get_min_time_window_us(const powercap_constraint* constraint, uint64_t* val) {
   VERIFY_ARG(constraint)
-  return read_u64(constraint->min_time_window_us, val);
+  return read_u64(constraint->min_time_window_us, val, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_MIN_TIME_WINDOW_US));
 }
 
 ssize_t powercap_constraint_get_name(const powercap_constraint* constraint, char* buf, size_t size) {
   VERIFY_ARG(constraint)
-  return read_string(constraint->name, buf, size);
+  return read_string(constraint->name, buf, size, ATTR_CONSTRAINT(POWERCAP_CONSTRAINT_FILE_NAME));
 }
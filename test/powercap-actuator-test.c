@@ -0,0 +1,167 @@
+/**
+ * Actuator tests.
+ * Uses a temporary file in place of a sysfs file.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap.h"
+#include "powercap-actuator.h"
+#include "powercap-test-common.h"
+
+static void make_constraint(powercap_constraint* c) {
+  memset(c, 0, sizeof(*c));
+  c->power_limit_uw = make_file("50000000\n");
+}
+
+/* wait for the timer, then step; returns 0 if the timer didn't fire */
+static int wait_step(powercap_actuator* act, int timeout_ms) {
+  struct pollfd pfd;
+  pfd.fd = act->timer_fd;
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, timeout_ms) <= 0) {
+    return 0;
+  }
+  assert(powercap_actuator_step(act) == 0);
+  return 1;
+}
+
+static void test_coalesce(void) {
+  powercap_constraint c;
+  powercap_actuator act;
+  powercap_actuator_config cfg;
+  make_constraint(&c);
+  powercap_actuator_config_default(&cfg);
+  cfg.step_interval_us = 50000;
+  assert(powercap_actuator_init(&act, &c, &cfg) == 0);
+  assert(act.limit_uw == 50000000);
+  /* first write is immediate */
+  assert(powercap_actuator_request(&act, 40000000) == 0);
+  assert(read_file(c.power_limit_uw) == 40000000);
+  /* a burst of requests within the interval collapses into the last one */
+  assert(powercap_actuator_request(&act, 39000000) == 0);
+  assert(powercap_actuator_request(&act, 38000000) == 0);
+  assert(powercap_actuator_request(&act, 37000000) == 0);
+  assert(read_file(c.power_limit_uw) == 40000000);
+  assert(act.pending);
+  assert(wait_step(&act, 1000));
+  assert(read_file(c.power_limit_uw) == 37000000);
+  assert(!act.pending);
+  assert(act.requests == 4);
+  assert(act.writes == 2);
+  /* no change, no write */
+  assert(powercap_actuator_request(&act, 37000000) == 0);
+  assert(act.writes == 2);
+  /* disarmed */
+  assert(!wait_step(&act, 100));
+  assert(powercap_actuator_destroy(&act) == 0);
+  close_constraint(&c);
+}
+
+static void test_slew(void) {
+  powercap_constraint c;
+  powercap_actuator act;
+  powercap_actuator_config cfg;
+  uint64_t prev;
+  uint64_t cur;
+  make_constraint(&c);
+  powercap_actuator_config_default(&cfg);
+  /* 1 W/s with 10 ms steps is at most 10 mW per step */
+  cfg.max_slew_uw_per_s = 1000000;
+  cfg.step_interval_us = 10000;
+  assert(powercap_actuator_init(&act, &c, &cfg) == 0);
+  assert(powercap_actuator_request(&act, 50030000) == 0);
+  prev = read_file(c.power_limit_uw);
+  assert(prev == 50010000);
+  while (act.pending) {
+    assert(wait_step(&act, 1000));
+    cur = read_file(c.power_limit_uw);
+    assert(cur > prev && cur - prev <= 10000);
+    prev = cur;
+  }
+  assert(prev == 50030000);
+  assert(act.writes >= 3);
+
+  /* reversing direction mid-ramp pursues only the new target */
+  assert(powercap_actuator_request(&act, 50000000) == 0);
+  assert(powercap_actuator_request(&act, 50050000) == 0);
+  while (act.pending) {
+    assert(wait_step(&act, 1000));
+    cur = read_file(c.power_limit_uw);
+    assert(cur >= prev && cur - prev <= 10000);
+    prev = cur;
+  }
+  assert(prev == 50050000);
+  assert(powercap_actuator_destroy(&act) == 0);
+
+  /* decreases can bypass the slew limit */
+  cfg.fast_decrease = 1;
+  assert(powercap_actuator_init(&act, &c, &cfg) == 0);
+  assert(powercap_actuator_request(&act, 20000000) == 0);
+  assert(read_file(c.power_limit_uw) == 20000000);
+  assert(!act.pending);
+  assert(powercap_actuator_destroy(&act) == 0);
+  close_constraint(&c);
+}
+
+static void test_deadband(void) {
+  powercap_constraint c;
+  powercap_actuator act;
+  powercap_actuator_config cfg;
+  make_constraint(&c);
+  powercap_actuator_config_default(&cfg);
+  cfg.deadband_uw = 1000000;
+  cfg.max_slew_uw_per_s = 100000000;
+  cfg.step_interval_us = 20000;
+  assert(powercap_actuator_init(&act, &c, &cfg) == 0);
+  assert(powercap_actuator_request(&act, 50500000) == 0);
+  assert(powercap_actuator_request(&act, 49000000) == 0);
+  assert(act.writes == 0);
+  assert(!act.pending);
+  /* start a 10 W ramp (2 W steps), then ask for something close to where it is: the ramp stops */
+  assert(powercap_actuator_request(&act, 60000000) == 0);
+  assert(read_file(c.power_limit_uw) == 52000000);
+  assert(powercap_actuator_request(&act, 52500000) == 0);
+  assert(!act.pending);
+  assert(act.target_uw == 52000000);
+  assert(!wait_step(&act, 100));
+  assert(read_file(c.power_limit_uw) == 52000000);
+  assert(powercap_actuator_destroy(&act) == 0);
+  close_constraint(&c);
+}
+
+static void test_bad_params(void) {
+  powercap_constraint c;
+  powercap_actuator act;
+  powercap_actuator_config cfg;
+  make_constraint(&c);
+  powercap_actuator_config_default(&cfg);
+  cfg.step_interval_us = 0;
+  assert(powercap_actuator_init(&act, &c, &cfg) == -EINVAL);
+  cfg.step_interval_us = 1;
+  assert(powercap_actuator_init(NULL, &c, &cfg) == -EINVAL);
+  assert(powercap_actuator_init(&act, NULL, &cfg) == -EINVAL);
+  assert(powercap_actuator_init(&act, &c, NULL) == -EINVAL);
+  assert(powercap_actuator_init(&act, &c, &cfg) == 0);
+  assert(powercap_actuator_destroy(&act) == 0);
+  assert(powercap_actuator_request(&act, 1) == -EINVAL);
+  assert(powercap_actuator_step(&act) == -EINVAL);
+  assert(powercap_actuator_request(NULL, 1) == -EINVAL);
+  assert(powercap_actuator_step(NULL) == -EINVAL);
+  assert(powercap_actuator_destroy(NULL) == -EINVAL);
+  close_constraint(&c);
+}
+
+int main(void) {
+  test_coalesce();
+  test_slew();
+  test_deadband();
+  test_bad_params();
+  return 0;
+}
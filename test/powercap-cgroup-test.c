@@ -0,0 +1,210 @@
+/**
+ * Cgroup energy attribution tests.
+ * Uses a temporary directory tree in place of cgroupfs and temporary files in place of sysfs files.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "powercap-cgroup.h"
+#include "powercap-rapl.h"
+#include "powercap-test-common.h"
+
+static char root[] = "/tmp/powercap-cgroup-test-XXXXXX";
+
+static void write_u64(int fd, uint64_t val) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%"PRIu64"\n", val);
+  write_file(fd, buf);
+}
+
+static void mkcg(const char* cgroup) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s", root, cgroup);
+  assert(mkdir(path, 0700) == 0);
+}
+
+static void rmcg(const char* cgroup) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s/cpu.stat", root, cgroup);
+  assert(unlink(path) == 0);
+  snprintf(path, sizeof(path), "%s/%s", root, cgroup);
+  assert(rmdir(path) == 0);
+}
+
+static void set_usage(const char* cgroup, uint64_t usage_usec) {
+  char path[PATH_MAX];
+  FILE* f;
+  snprintf(path, sizeof(path), "%s%s%s/cpu.stat", root, *cgroup ? "/" : "", cgroup);
+  assert((f = fopen(path, "w")) != NULL);
+  fprintf(f, "usage_usec %"PRIu64"\nuser_usec %"PRIu64"\nsystem_usec 0\n", usage_usec, usage_usec);
+  assert(fclose(f) == 0);
+}
+
+static uint64_t pkg_energy(const powercap_cgroup* cg, const char* cgroup) {
+  const powercap_cgroup_entry* e = powercap_cgroup_get(cg, cgroup);
+  assert(e != NULL);
+  return e->pkg_energy_uj;
+}
+
+static void test_cgroup(void) {
+  char path[PATH_MAX];
+  powercap_cgroup cg;
+  powercap_rapl_pkg pkg;
+  const powercap_cgroup_entry* e;
+
+  memset(&pkg, 0, sizeof(pkg));
+  pkg.pkg.zone.energy_uj = make_file("1000\n");
+  pkg.pkg.zone.max_energy_range_uj = make_file("100000\n");
+  pkg.core.zone.energy_uj = make_file("500\n");
+  pkg.core.zone.max_energy_range_uj = make_file("100000\n");
+
+  assert(mkdtemp(root) != NULL);
+  set_usage("", 1000);
+  mkcg("a");
+  set_usage("a", 500);
+  mkcg("a/x");
+  set_usage("a/x", 100);
+  mkcg("b");
+  set_usage("b", 200);
+
+  assert(powercap_cgroup_init(&cg, root, &pkg, 1) == 0);
+  /* baseline */
+  assert(powercap_cgroup_sample(&cg) == 0);
+  assert(cg.nentries == 4);
+  assert(pkg_energy(&cg, "") == 0 && pkg_energy(&cg, "a/x") == 0);
+  e = powercap_cgroup_get(&cg, "a/x");
+  assert(e->depth == 2 && e->alive && e->usage_usec == 100);
+  assert(powercap_cgroup_get(&cg, "c") == NULL);
+
+  /* shares of the root's usage */
+  set_usage("", 2000);
+  set_usage("a", 1100);
+  set_usage("a/x", 300);
+  set_usage("b", 600);
+  write_u64(pkg.pkg.zone.energy_uj, 11000);
+  write_u64(pkg.core.zone.energy_uj, 5500);
+  assert(powercap_cgroup_sample(&cg) == 0);
+  assert(cg.pkg_delta_uj == 10000 && cg.core_delta_uj == 5000);
+  assert(pkg_energy(&cg, "") == 10000);
+  assert(pkg_energy(&cg, "a") == 6000);
+  assert(pkg_energy(&cg, "a/x") == 2000);
+  assert(pkg_energy(&cg, "b") == 4000);
+  assert(powercap_cgroup_get(&cg, "a")->core_energy_uj == 3000);
+
+  /* b is removed and c is created; counters wrap */
+  rmcg("b");
+  mkcg("c");
+  set_usage("c", 5000);
+  set_usage("", 3000);
+  set_usage("a", 2100);
+  write_u64(pkg.pkg.zone.energy_uj, 1000);
+  write_u64(pkg.core.zone.energy_uj, 500);
+  assert(powercap_cgroup_sample(&cg) == 0);
+  assert(cg.pkg_delta_uj == 90000 && cg.core_delta_uj == 95000);
+  e = powercap_cgroup_get(&cg, "b");
+  assert(e != NULL && !e->alive && e->usage_delta_usec == 0 && e->pkg_energy_uj == 4000);
+  e = powercap_cgroup_get(&cg, "c");
+  assert(e != NULL && e->alive && e->usage_delta_usec == 0 && e->pkg_energy_uj == 0);
+  assert(pkg_energy(&cg, "a") == 6000 + 90000);
+  assert(cg.nentries == 5);
+
+  /* b is dropped, c accrues */
+  set_usage("", 4000);
+  set_usage("c", 5500);
+  write_u64(pkg.pkg.zone.energy_uj, 3000);
+  assert(powercap_cgroup_sample(&cg) == 0);
+  assert(powercap_cgroup_get(&cg, "b") == NULL);
+  assert(cg.nentries == 4);
+  assert(pkg_energy(&cg, "c") == 1000);
+  assert(pkg_energy(&cg, "a") == 96000);
+
+  assert(powercap_cgroup_destroy(&cg) == 0);
+  rmcg("c");
+  rmcg("a/x");
+  rmcg("a");
+  snprintf(path, sizeof(path), "%s/cpu.stat", root);
+  assert(unlink(path) == 0);
+  assert(rmdir(root) == 0);
+  close_pkg(&pkg);
+}
+
+/* Many cgroups force the table to grow and entries to shift on removal */
+static void test_many(void) {
+  char name[32];
+  powercap_cgroup cg;
+  powercap_rapl_pkg pkg;
+  uint64_t sum = 0;
+  uint32_t i;
+
+  memset(&pkg, 0, sizeof(pkg));
+  pkg.pkg.zone.energy_uj = make_file("0\n");
+  strcpy(root, "/tmp/powercap-cgroup-test-XXXXXX");
+  assert(mkdtemp(root) != NULL);
+  for (i = 0; i < 300; i++) {
+    snprintf(name, sizeof(name), "cg%"PRIu32, i);
+    mkcg(name);
+    set_usage(name, 0);
+  }
+  assert(powercap_cgroup_init(&cg, root, &pkg, 1) == 0);
+  assert(powercap_cgroup_sample(&cg) == 0);
+  /* no cpu.stat in the root: shares of the children's total */
+  assert(cg.nentries == 301 && cg.nslots >= 602);
+  for (i = 0; i < 300; i++) {
+    snprintf(name, sizeof(name), "cg%"PRIu32, i);
+    set_usage(name, 10);
+  }
+  write_u64(pkg.pkg.zone.energy_uj, 300000);
+  assert(powercap_cgroup_sample(&cg) == 0);
+  for (i = 0; i < 300; i++) {
+    snprintf(name, sizeof(name), "cg%"PRIu32, i);
+    sum += pkg_energy(&cg, name);
+    assert(pkg_energy(&cg, name) == 1000);
+  }
+  assert(sum == 300000);
+  for (i = 0; i < 300; i += 2) {
+    snprintf(name, sizeof(name), "cg%"PRIu32, i);
+    rmcg(name);
+  }
+  assert(powercap_cgroup_sample(&cg) == 0);
+  assert(powercap_cgroup_sample(&cg) == 0);
+  assert(cg.nentries == 151);
+  for (i = 0; i < 300; i++) {
+    snprintf(name, sizeof(name), "cg%"PRIu32, i);
+    assert((powercap_cgroup_get(&cg, name) != NULL) == (i % 2));
+  }
+  assert(powercap_cgroup_destroy(&cg) == 0);
+  for (i = 1; i < 300; i += 2) {
+    snprintf(name, sizeof(name), "cg%"PRIu32, i);
+    rmcg(name);
+  }
+  assert(rmdir(root) == 0);
+  close_pkg(&pkg);
+}
+
+static void test_bad_params(void) {
+  powercap_cgroup cg;
+  powercap_rapl_pkg pkg;
+  memset(&pkg, 0, sizeof(pkg));
+  assert(powercap_cgroup_init(NULL, "/tmp", &pkg, 1) == -EINVAL);
+  assert(powercap_cgroup_init(&cg, "/tmp", NULL, 1) == -EINVAL);
+  assert(powercap_cgroup_init(&cg, "/nonexistent/powercap-cgroup-test", &pkg, 1) == -ENOENT);
+  assert(powercap_cgroup_sample(NULL) == -EINVAL);
+  assert(powercap_cgroup_destroy(NULL) == -EINVAL);
+  assert(powercap_cgroup_get(NULL, "") == NULL);
+}
+
+int main(void) {
+  test_cgroup();
+  test_many();
+  test_bad_params();
+  return 0;
+}
@@ -0,0 +1,241 @@
+/**
+ * Coordinator/agent tests, with all agents on one machine using Unix sockets.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "powercap-cluster.h"
+
+static char dir[] = "/tmp/powercap-cluster-test-XXXXXX";
+static struct sockaddr_un addr;
+
+static int make_listener(void) {
+  int fd;
+  assert(mkdtemp(dir) != NULL);
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/sock", dir);
+  assert((fd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0);
+  assert(bind(fd, (const struct sockaddr*) &addr, sizeof(addr)) == 0);
+  assert(listen(fd, 16) == 0);
+  return fd;
+}
+
+static void remove_listener(int fd) {
+  close(fd);
+  unlink(addr.sun_path);
+  rmdir(dir);
+}
+
+static int connect_agent(void) {
+  int fd;
+  assert((fd = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0);
+  assert(connect(fd, (const struct sockaddr*) &addr, sizeof(addr)) == 0);
+  return fd;
+}
+
+/* let the coordinator accept and process everything that's pending */
+static void pump(powercap_cluster_coord* coord) {
+  int i;
+  for (i = 0; i < 10; i++) {
+    assert(powercap_cluster_coord_poll(coord, 10) == 0);
+  }
+}
+
+static uint64_t get_cap(const powercap_cluster_agent* agent, uint32_t id) {
+  uint64_t cap;
+  assert(powercap_cluster_agent_get_cap(agent, id, &cap) == 0);
+  return cap;
+}
+
+static void test_cluster(void) {
+  const powercap_cluster_node_info info_a[] = { { 1, 50000000, 200000000 } };
+  const powercap_cluster_node_info info_b[] = { { 3, 50000000, 200000000 }, { 2, 50000000, 200000000 } };
+  powercap_cluster_report reports[2];
+  powercap_cluster_coord coord;
+  powercap_cluster_agent a;
+  powercap_cluster_agent b;
+  int lfd = make_listener();
+  int fd_a = connect_agent();
+  int fd_b = connect_agent();
+
+  assert(powercap_cluster_coord_init(&coord, lfd, 300000000) == 0);
+  assert(powercap_cluster_agent_init(&a, fd_a, info_a, 1) == 0);
+  /* b speaks for two nodes */
+  assert(powercap_cluster_agent_init(&b, fd_b, info_b, 2) == 0);
+  pump(&coord);
+  assert(coord.nconns == 2);
+  assert(coord.nnodes == 3);
+  /* sorted */
+  assert(coord.nodes[0].id == 1 && coord.nodes[1].id == 2 && coord.nodes[2].id == 3);
+
+  /* node 1 is capped, node 2 and 3 have slack */
+  reports[0].id = 1;
+  reports[0].power_uw = 200000000;
+  reports[0].demand_uw = 200000000;
+  assert(powercap_cluster_agent_report(&a, reports, 1) == 0);
+  reports[0].id = 2;
+  reports[0].power_uw = 55000000;
+  reports[0].demand_uw = 60000000;
+  reports[1].id = 3;
+  reports[1].power_uw = 30000000;
+  reports[1].demand_uw = 40000000;
+  assert(powercap_cluster_agent_report(&b, reports, 2) == 0);
+  pump(&coord);
+  assert(coord.nodes[0].demand_uw == 200000000);
+  assert(coord.nodes[1].power_uw == 55000000);
+  assert(coord.nodes[2].demand_uw == 40000000);
+
+  /* everyone gets their minimum, node 2 its demand, and node 1 the rest */
+  assert(powercap_cluster_coord_rebalance(&coord) == 0);
+  assert(powercap_cluster_agent_recv(&a, 1000) == 1);
+  assert(powercap_cluster_agent_recv(&b, 1000) == 2);
+  assert(get_cap(&a, 1) == 190000000);
+  assert(get_cap(&b, 2) == 60000000);
+  assert(get_cap(&b, 3) == 50000000);
+
+  /* nothing changed, so nothing is sent */
+  assert(powercap_cluster_agent_report(&b, reports, 2) == 0);
+  assert(powercap_cluster_coord_rebalance(&coord) == 0);
+  assert(powercap_cluster_agent_recv(&a, 10) == 0);
+  assert(powercap_cluster_agent_recv(&b, 10) == 0);
+
+  /* only the changed node is sent */
+  reports[1].demand_uw = 30000000;
+  assert(powercap_cluster_agent_report(&b, reports, 2) == 0);
+  pump(&coord);
+  assert(coord.nodes[2].demand_uw == 30000000);
+  assert(coord.nodes[1].demand_uw == 60000000);
+
+  /* a budget that doesn't cover the minimums caps every node at its minimum */
+  assert(powercap_cluster_coord_set_budget(&coord, 100000000) == 0);
+  assert(powercap_cluster_coord_rebalance(&coord) == 0);
+  assert(powercap_cluster_agent_recv(&a, 1000) == 1);
+  assert(powercap_cluster_agent_recv(&b, 1000) == 1);
+  assert(get_cap(&a, 1) == 50000000);
+  assert(get_cap(&b, 2) == 50000000);
+  assert(get_cap(&b, 3) == 50000000);
+
+  /* node 1 leaves, its share goes to the remaining nodes, split equally once demands are met */
+  assert(powercap_cluster_coord_set_budget(&coord, 300000001) == 0);
+  assert(powercap_cluster_agent_destroy(&a) == 0);
+  close(fd_a);
+  pump(&coord);
+  assert(coord.nconns == 1);
+  assert(coord.nnodes == 2);
+  assert(powercap_cluster_coord_rebalance(&coord) == 0);
+  assert(powercap_cluster_agent_recv(&b, 1000) == 2);
+  assert(get_cap(&b, 2) + get_cap(&b, 3) == 300000001);
+  /* 60 W demand, then 95 W (plus the indivisible remainder) of the surplus */
+  assert(get_cap(&b, 2) == 155000000 || get_cap(&b, 2) == 155000001);
+
+  assert(powercap_cluster_agent_destroy(&b) == 0);
+  assert(powercap_cluster_coord_destroy(&coord) == 0);
+  /* the coordinator closed its end */
+  assert(recv(fd_b, reports, sizeof(reports), 0) == 0);
+  close(fd_b);
+  remove_listener(lfd);
+}
+
+static void test_protocol_error(void) {
+  const powercap_cluster_node_info info[] = { { 7, 1000000, 2000000 } };
+  static const unsigned char bad[] = { 0, 0, 0, 2, 99, 0 };
+  powercap_cluster_coord coord;
+  powercap_cluster_agent agent;
+  int fds[2];
+  int good[2];
+  assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  assert(socketpair(AF_UNIX, SOCK_STREAM, 0, good) == 0);
+  assert(powercap_cluster_coord_init(&coord, -1, 10000000) == 0);
+  assert(powercap_cluster_coord_add_conn(&coord, fds[0]) == 0);
+  assert(powercap_cluster_coord_add_conn(&coord, good[0]) == 0);
+  assert(powercap_cluster_agent_init(&agent, good[1], info, 1) == 0);
+  /* unknown message type */
+  assert(write(fds[1], bad, sizeof(bad)) == sizeof(bad));
+  pump(&coord);
+  assert(coord.nconns == 1);
+  assert(coord.nnodes == 1);
+  assert(powercap_cluster_coord_rebalance(&coord) == 0);
+  assert(powercap_cluster_agent_recv(&agent, 1000) == 1);
+  /* nothing reported, so just the minimum plus an equal share of the surplus */
+  assert(get_cap(&agent, 7) == 2000000);
+  assert(powercap_cluster_agent_get_cap(&agent, 8, &coord.budget_uw) == -ENOENT);
+  close(fds[1]);
+  assert(powercap_cluster_coord_destroy(&coord) == 0);
+  /* agent sees the closed connection */
+  assert(powercap_cluster_agent_recv(&agent, 1000) == -EPIPE);
+  assert(powercap_cluster_agent_destroy(&agent) == 0);
+  close(good[1]);
+}
+
+static void test_varint_overflow(void) {
+  /* HELLO from node 5 with a minimum of 0 and a 10-byte maximum, whose last byte may only hold bit 63 */
+  unsigned char hello[] = { 0, 0, 0, 15, 1, 1, 1, 5, 0,
+                            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 };
+  powercap_cluster_coord coord;
+  int fds[2];
+  int good[2];
+  assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  assert(socketpair(AF_UNIX, SOCK_STREAM, 0, good) == 0);
+  assert(powercap_cluster_coord_init(&coord, -1, 10000000) == 0);
+  assert(powercap_cluster_coord_add_conn(&coord, good[0]) == 0);
+  assert(powercap_cluster_coord_add_conn(&coord, fds[0]) == 0);
+  assert(write(good[1], hello, sizeof(hello)) == sizeof(hello));
+  pump(&coord);
+  assert(coord.nnodes == 1);
+  assert(coord.nodes[0].max_power_uw == UINT64_MAX);
+  /* bit 64 doesn't fit, so the message is rejected rather than truncated */
+  hello[7] = 6;
+  hello[sizeof(hello) - 1] = 0x03;
+  assert(write(fds[1], hello, sizeof(hello)) == sizeof(hello));
+  pump(&coord);
+  assert(coord.nconns == 1);
+  assert(coord.nnodes == 1);
+  close(fds[1]);
+  close(good[1]);
+  assert(powercap_cluster_coord_destroy(&coord) == 0);
+}
+
+static void test_bad_params(void) {
+  const powercap_cluster_node_info dup[] = { { 1, 0, 1 }, { 1, 0, 1 } };
+  powercap_cluster_report report = { 2, 0, 0 };
+  powercap_cluster_coord coord;
+  powercap_cluster_agent agent;
+  int fds[2];
+  assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  assert(powercap_cluster_coord_init(NULL, -1, 0) == -EINVAL);
+  assert(powercap_cluster_coord_init(&coord, -1, 0) == 0);
+  /* nothing to poll */
+  assert(powercap_cluster_coord_poll(&coord, 0) == -EINVAL);
+  assert(powercap_cluster_coord_add_conn(&coord, -1) == -EINVAL);
+  assert(powercap_cluster_coord_rebalance(&coord) == 0);
+  assert(powercap_cluster_coord_destroy(&coord) == 0);
+  assert(powercap_cluster_agent_init(NULL, fds[1], dup, 1) == -EINVAL);
+  assert(powercap_cluster_agent_init(&agent, -1, dup, 1) == -EINVAL);
+  assert(powercap_cluster_agent_init(&agent, fds[1], NULL, 1) == -EINVAL);
+  assert(powercap_cluster_agent_init(&agent, fds[1], dup, 0) == -EINVAL);
+  assert(powercap_cluster_agent_init(&agent, fds[1], dup, 2) == -EINVAL);
+  assert(powercap_cluster_agent_init(&agent, fds[1], dup, 1) == 0);
+  /* unregistered node */
+  assert(powercap_cluster_agent_report(&agent, &report, 1) == -EINVAL);
+  close(fds[0]);
+  assert(powercap_cluster_agent_recv(&agent, 1000) == -EPIPE);
+  assert(powercap_cluster_agent_destroy(&agent) == 0);
+  close(fds[1]);
+}
+
+int main(void) {
+  test_cluster();
+  test_protocol_error();
+  test_varint_overflow();
+  test_bad_params();
+  return 0;
+}
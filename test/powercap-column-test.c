@@ -0,0 +1,255 @@
+/**
+ * Columnar file tests.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap-column.h"
+#include "powercap-sampler.h"
+#include "powercap-test-common.h"
+
+#define NZONES 3
+#define ROWS 10000
+#define BLOCK_ROWS 1000
+
+static const uint64_t ranges[NZONES] = { 262143328850, 262143328850, 65712999613 };
+
+/* 1 ms sampling with jitter; zone 0 at ~50 W wraps, zone 1 is idle, zone 2 is noisy */
+static void make_rows(int64_t* t, uint64_t* e) {
+  uint32_t i;
+  t[0] = 1000000000;
+  e[0] = ranges[0] - 5000000;
+  e[ROWS] = 123456;
+  e[2 * ROWS] = 0;
+  for (i = 1; i < ROWS; i++) {
+    t[i] = t[i - 1] + 1000000 + (i % 7 == 0 ? 3000 : 0);
+    e[i] = (e[i - 1] + 50000 + i % 13) % (ranges[0] + 1);
+    e[ROWS + i] = e[ROWS + i - 1];
+    e[2 * ROWS + i] = e[2 * ROWS + i - 1] + (i * 2654435761U) % 40000;
+  }
+}
+
+static void test_roundtrip(void) {
+  powercap_column_writer w;
+  powercap_column_reader r;
+  powercap_column_block info;
+  int64_t* t = malloc(ROWS * sizeof(int64_t));
+  uint64_t* e = malloc(NZONES * ROWS * sizeof(uint64_t));
+  int64_t dt[BLOCK_ROWS];
+  uint64_t de[NZONES * BLOCK_ROWS];
+  uint64_t row[NZONES];
+  uint64_t lo[NZONES];
+  uint64_t hi[NZONES];
+  uint32_t b;
+  uint32_t i;
+  uint32_t z;
+  int fd = make_file(NULL);
+  assert(t != NULL && e != NULL);
+  make_rows(t, e);
+
+  /* the last block is partial */
+  assert(powercap_column_writer_init(&w, fd, NZONES, ranges, BLOCK_ROWS) == 0);
+  for (i = 0; i < ROWS - 500; i++) {
+    for (z = 0; z < NZONES; z++) {
+      row[z] = e[z * ROWS + i];
+    }
+    assert(powercap_column_writer_append(&w, t[i], row) == 0);
+  }
+  assert(powercap_column_writer_append(&w, t[i - 1] - 1, row) == -EINVAL);
+  assert(w.nblocks == 9);
+  assert(powercap_column_writer_destroy(&w) == 0);
+  /* much smaller than 32 bytes per row */
+  assert(lseek(fd, 0, SEEK_END) < (ROWS - 500) * 8);
+
+  assert(powercap_column_reader_open(&r, fd) == 0);
+  close(fd);
+  assert(r.nzones == NZONES && r.block_rows == BLOCK_ROWS && r.nblocks == 10 && r.total_rows == ROWS - 500);
+  assert(memcmp(r.max_energy_range_uj, ranges, sizeof(ranges)) == 0);
+  for (b = 0; b < r.nblocks; b++) {
+    assert(powercap_column_reader_get_block(&r, b, &info, lo, hi) == 0);
+    assert(info.start_ns == t[b * BLOCK_ROWS]);
+    assert(info.nrows == (b < 9 ? BLOCK_ROWS : 500));
+    assert(info.end_ns == t[b * BLOCK_ROWS + info.nrows - 1]);
+    assert(powercap_column_reader_decode(&r, b, dt, de) == (int) info.nrows);
+    for (i = 0; i < info.nrows; i++) {
+      assert(dt[i] == t[b * BLOCK_ROWS + i]);
+      for (z = 0; z < NZONES; z++) {
+        assert(de[z * BLOCK_ROWS + i] == e[z * ROWS + b * BLOCK_ROWS + i]);
+        assert(de[z * BLOCK_ROWS + i] >= lo[z] && de[z * BLOCK_ROWS + i] <= hi[z]);
+      }
+    }
+  }
+  /* the first block holds the wrap */
+  assert(powercap_column_reader_get_block(&r, 0, &info, lo, hi) == 0);
+  assert(lo[0] < 50000000 && hi[0] > ranges[0] - 5000000);
+  assert(lo[1] == 123456 && hi[1] == 123456);
+  /* timestamps alone */
+  assert(powercap_column_reader_decode(&r, 3, dt, NULL) == BLOCK_ROWS && dt[BLOCK_ROWS - 1] == t[4 * BLOCK_ROWS - 1]);
+
+  assert(powercap_column_reader_find(&r, 0) == 0);
+  assert(powercap_column_reader_find(&r, t[0]) == 0);
+  assert(powercap_column_reader_find(&r, t[BLOCK_ROWS - 1]) == 0);
+  assert(powercap_column_reader_find(&r, t[BLOCK_ROWS - 1] + 1) == 1);
+  assert(powercap_column_reader_find(&r, t[5 * BLOCK_ROWS + 17]) == 5);
+  assert(powercap_column_reader_find(&r, t[ROWS - 501]) == 9);
+  assert(powercap_column_reader_find(&r, t[ROWS - 501] + 1) == 10);
+  assert(powercap_column_reader_decode(&r, 10, dt, de) == -EINVAL);
+  assert(powercap_column_reader_close(&r) == 0);
+  free(t);
+  free(e);
+}
+
+static void test_snapshot(void) {
+  powercap_column_writer w;
+  powercap_column_reader r;
+  powercap_sampler_zone_values zones[2];
+  powercap_sampler_snapshot snap;
+  int64_t t[4];
+  uint64_t e[2 * 4];
+  uint32_t b;
+  uint32_t i;
+  int fd = make_file(NULL);
+  memset(zones, 0, sizeof(zones));
+  memset(&snap, 0, sizeof(snap));
+  snap.zones = zones;
+  snap.nzones = 2;
+  assert(powercap_column_writer_init(&w, fd, 2, NULL, 3) == 0);
+  /* zone 1 is missing every third sample, which starts each block */
+  for (i = 0; i < 10; i++) {
+    snap.time_ns = 1000 * (int64_t) i;
+    zones[0].valid = POWERCAP_SAMPLER_ZONE_ENERGY;
+    zones[0].energy_uj = 100 * i;
+    zones[1].valid = i % 3 ? POWERCAP_SAMPLER_ZONE_ENERGY : 0;
+    zones[1].energy_uj = 7 * i;
+    assert(powercap_column_writer_append_snapshot(&w, &snap) == 0);
+  }
+  snap.nzones = 1;
+  assert(powercap_column_writer_append_snapshot(&w, &snap) == -EINVAL);
+  assert(powercap_column_writer_destroy(&w) == 0);
+  assert(powercap_column_reader_open(&r, fd) == 0);
+  assert(r.nblocks == 4 && r.total_rows == 10 && r.max_energy_range_uj[1] == 0);
+  for (b = 0; b < 4; b++) {
+    assert(powercap_column_reader_decode(&r, b, t, e) == (b < 3 ? 3 : 1));
+    for (i = 0; i < (b < 3 ? 3U : 1U); i++) {
+      assert(t[i] == 1000 * (int64_t) (3 * b + i));
+      assert(e[i] == 100 * (3 * b + i));
+      /* the first sample has no previous counter */
+      assert(e[3 + i] == (b || i ? 7 * (3 * b + i - !i) : 0));
+    }
+  }
+  powercap_column_reader_close(&r);
+  close(fd);
+}
+
+static void test_corrupt(void) {
+  powercap_column_writer w;
+  powercap_column_reader r;
+  int64_t t[64];
+  uint64_t e[64];
+  uint64_t v;
+  unsigned char c;
+  off_t size;
+  int fd = make_file(NULL);
+  assert(powercap_column_writer_init(&w, fd, 1, NULL, 64) == 0);
+  for (v = 0; v < 100; v++) {
+    assert(powercap_column_writer_append(&w, (int64_t) v * 10, &v) == 0);
+  }
+  assert(powercap_column_writer_destroy(&w) == 0);
+  size = lseek(fd, 0, SEEK_END);
+  assert(powercap_column_reader_open(&r, fd) == 0);
+  assert(powercap_column_reader_decode(&r, 1, t, e) == 36 && e[35] == 99 && t[35] == 990);
+  powercap_column_reader_close(&r);
+
+  /* a block's width byte, just after the timestamps and the counter's base */
+  assert(pread(fd, &c, 1, 24 + 16 + 63 + 1) == 1 && c == 0);
+  c = 65;
+  assert(pwrite(fd, &c, 1, 24 + 16 + 63 + 1) == 1);
+  assert(powercap_column_reader_open(&r, fd) == 0);
+  assert(powercap_column_reader_decode(&r, 0, t, e) == -EINVAL);
+  assert(powercap_column_reader_decode(&r, 0, t, NULL) == 64);
+  powercap_column_reader_close(&r);
+
+  /* a bad trailer */
+  assert(pwrite(fd, "X", 1, size - 1) == 1);
+  assert(powercap_column_reader_open(&r, fd) == -EINVAL);
+  assert(r.map == NULL);
+  /* truncated */
+  assert(pwrite(fd, "I", 1, size - 1) == 1);
+  assert(ftruncate(fd, size - 1) == 0);
+  assert(powercap_column_reader_open(&r, fd) == -EINVAL);
+  close(fd);
+}
+
+static void test_overlong_varint(void) {
+  powercap_column_writer w;
+  powercap_column_reader r;
+  int64_t t[64];
+  uint64_t v;
+  uint64_t e;
+  int fd = make_file(NULL);
+  assert(powercap_column_writer_init(&w, fd, 1, NULL, 64) == 0);
+  for (v = 0; v < 64; v++) {
+    /* varying deltas, so that the counters are bit-packed after the timestamps */
+    e = v * v;
+    assert(powercap_column_writer_append(&w, (int64_t) v * 10, &e) == 0);
+  }
+  assert(powercap_column_writer_destroy(&w) == 0);
+  /* replace the last timestamp varint with a 10-byte one that ends in the packed counters */
+  assert(pwrite(fd, "\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01", 10, 24 + 16 + 62) == 10);
+  assert(powercap_column_reader_open(&r, fd) == 0);
+  assert(powercap_column_reader_decode(&r, 0, t, NULL) == 64);
+  powercap_column_reader_close(&r);
+  /* data beyond 64 bits */
+  assert(pwrite(fd, "\x02", 1, 24 + 16 + 62 + 9) == 1);
+  assert(powercap_column_reader_open(&r, fd) == 0);
+  assert(powercap_column_reader_decode(&r, 0, t, NULL) == -EINVAL);
+  powercap_column_reader_close(&r);
+  close(fd);
+}
+
+static void test_bad_params(void) {
+  powercap_column_writer w;
+  powercap_column_reader r;
+  powercap_column_block info;
+  uint64_t v = 0;
+  int fd = make_file(NULL);
+  assert(powercap_column_writer_init(NULL, fd, 1, NULL, 0) == -EINVAL);
+  assert(powercap_column_writer_init(&w, -1, 1, NULL, 0) == -EINVAL);
+  assert(powercap_column_writer_init(&w, fd, 0, NULL, 0) == -EINVAL);
+  assert(powercap_column_writer_init(&w, fd, POWERCAP_COLUMN_MAX_ZONES + 1, NULL, 1) == -EINVAL);
+  assert(powercap_column_writer_init(&w, fd, 1, NULL, POWERCAP_COLUMN_MAX_BLOCK_ROWS + 1) == -EINVAL);
+  assert(powercap_column_writer_init(&w, fd, POWERCAP_COLUMN_MAX_ZONES, NULL, POWERCAP_COLUMN_MAX_BLOCK_ROWS) ==
+         -EINVAL);
+  assert(powercap_column_writer_append(NULL, 0, &v) == -EINVAL);
+  assert(powercap_column_writer_append_snapshot(NULL, NULL) == -EINVAL);
+  assert(powercap_column_writer_destroy(NULL) == -EINVAL);
+  /* empty file */
+  assert(powercap_column_reader_open(&r, fd) == -EINVAL);
+  assert(powercap_column_reader_open(NULL, fd) == -EINVAL);
+  assert(powercap_column_reader_close(NULL) == -EINVAL);
+  assert(powercap_column_reader_get_block(NULL, 0, &info, NULL, NULL) == -EINVAL);
+  assert(powercap_column_reader_decode(NULL, 0, NULL, NULL) == -EINVAL);
+  /* no rows */
+  assert(powercap_column_writer_init(&w, fd, 1, NULL, 0) == 0 && w.block_rows == POWERCAP_COLUMN_DEFAULT_BLOCK_ROWS);
+  assert(powercap_column_writer_destroy(&w) == 0);
+  assert(powercap_column_reader_open(&r, fd) == 0 && r.nblocks == 0);
+  assert(powercap_column_reader_find(&r, 0) == 0);
+  assert(powercap_column_reader_get_block(&r, 0, &info, NULL, NULL) == -EINVAL);
+  powercap_column_reader_close(&r);
+  close(fd);
+}
+
+int main(void) {
+  test_roundtrip();
+  test_snapshot();
+  test_corrupt();
+  test_overlong_varint();
+  test_bad_params();
+  return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * Configuration tests.
+ * Uses in-memory streams in place of saved configuration files; capture and restore require sysfs.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap-config.h"
+
+static const char saved[] =
+  "# powercap-config intel-rapl\n"
+  "0 z-enabled=1\n"
+  "0 constraint=0 c-power-limit=50000000 c-time-window=999424\n"
+  "0 constraint=1 c-power-limit=60000000 c-time-window=2440\n"
+  "0:0 z-enabled=0\n"
+  "0:0 constraint=0 c-power-limit=0 c-time-window=976\n";
+
+static int read_string(powercap_config* cfg, const char* s, uint32_t* bad_line) {
+  char* buf = strdup(s);
+  FILE* f;
+  int ret;
+  assert(buf != NULL);
+  assert((f = fmemopen(buf, strlen(buf), "r")) != NULL);
+  ret = powercap_config_read(cfg, f, bad_line);
+  fclose(f);
+  free(buf);
+  return ret;
+}
+
+static void test_read_write(void) {
+  powercap_config cfg;
+  powercap_config cfg2;
+  char* buf = NULL;
+  size_t size = 0;
+  FILE* f;
+  assert(read_string(&cfg, saved, NULL) == 0);
+  assert(!strcmp(cfg.control_type, "intel-rapl"));
+  assert(cfg.nzones == 2);
+  assert(cfg.zones[0].depth == 1 && cfg.zones[0].zones[0] == 0);
+  assert(cfg.zones[0].valid == POWERCAP_CONFIG_ZONE_ENABLED && cfg.zones[0].enabled == 1);
+  assert(cfg.zones[0].nconstraints == 2);
+  assert(cfg.zones[0].constraints[1].power_limit_uw == 60000000);
+  assert(cfg.zones[0].constraints[1].time_window_us == 2440);
+  assert(cfg.zones[1].depth == 2 && cfg.zones[1].zones[1] == 0);
+  assert(cfg.zones[1].enabled == 0);
+  assert(cfg.zones[1].constraints[0].valid ==
+         (POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT | POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW));
+  /* round trip is exact */
+  f = open_memstream(&buf, &size);
+  assert(f != NULL);
+  assert(powercap_config_write(&cfg, f) == 0);
+  fclose(f);
+  assert(!strcmp(buf, saved));
+  assert(read_string(&cfg2, buf, NULL) == 0);
+  assert(cfg2.nzones == cfg.nzones);
+  free(buf);
+  assert(powercap_config_destroy(&cfg2) == 0);
+  assert(powercap_config_destroy(&cfg) == 0);
+}
+
+static void test_read_partial(void) {
+  powercap_config cfg;
+  /* comments, blank lines, constraint gaps, and partial constraints */
+  assert(read_string(&cfg, "# powercap-config foo\n\n1:2 constraint=2 c-time-window=5 # comment\n", NULL) == 0);
+  assert(cfg.nzones == 1);
+  assert(cfg.zones[0].valid == 0);
+  assert(cfg.zones[0].nconstraints == 3);
+  assert(cfg.zones[0].constraints[0].valid == 0);
+  assert(cfg.zones[0].constraints[2].valid == POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW);
+  assert(cfg.zones[0].constraints[2].time_window_us == 5);
+  powercap_config_destroy(&cfg);
+}
+
+static void test_read_errors(void) {
+  powercap_config cfg;
+  char text[512];
+  uint32_t bad = 0;
+  assert(read_string(&cfg, "0 z-enabled=1\n", &bad) == -EINVAL);
+  assert(bad == 1);
+  assert(cfg.zones == NULL && cfg.control_type == NULL);
+  assert(read_string(&cfg, "# powercap-config foo\n0 z-enabled=2\n", &bad) == -EINVAL);
+  assert(bad == 2);
+  assert(read_string(&cfg, "# powercap-config foo\n\n0 c-power-limit=5\n", &bad) == -EINVAL);
+  assert(bad == 3);
+  assert(read_string(&cfg, "# powercap-config foo\n0 constraint=0\n", &bad) == -EINVAL);
+  assert(read_string(&cfg, "# powercap-config foo\n0:x z-enabled=1\n", &bad) == -EINVAL);
+  assert(read_string(&cfg, "# powercap-config foo\n0 z-enabled=1 extra\n", &bad) == -EINVAL);
+  assert(read_string(&cfg, "# powercap-config foo\n# powercap-config bar\n", &bad) == -EINVAL);
+  assert(bad == 2);
+  /* control types that would escape the powercap directory */
+  assert(read_string(&cfg, "# powercap-config ../../foo\n", &bad) == -EINVAL);
+  assert(bad == 1);
+  assert(read_string(&cfg, "# powercap-config ..\n", &bad) == -EINVAL);
+  assert(read_string(&cfg, "# powercap-config .\n", &bad) == -EINVAL);
+  /* a long line isn't split into several */
+  memset(text, ' ', sizeof(text));
+  memcpy(text, "# powercap-config foo\n0 z-enabled=1", 35);
+  memcpy(&text[300], "0 z-enabled=1\n", 15);
+  text[315] = '\0';
+  assert(read_string(&cfg, text, &bad) == -EINVAL);
+  assert(bad == 2);
+}
+
+static void test_diff(void) {
+  powercap_config from;
+  powercap_config to;
+  powercap_config diff;
+  assert(read_string(&to, saved, NULL) == 0);
+  /* identical */
+  assert(read_string(&from, saved, NULL) == 0);
+  assert(powercap_config_diff(&from, &to, &diff) == 0);
+  assert(!strcmp(diff.control_type, "intel-rapl"));
+  assert(diff.nzones == 0);
+  powercap_config_destroy(&diff);
+  powercap_config_destroy(&from);
+  /* one changed limit, one changed enabled, a missing zone, and a value unknown in "from" */
+  assert(read_string(&from, "# powercap-config intel-rapl\n"
+                            "0 z-enabled=0\n"
+                            "0 constraint=0 c-power-limit=50000000 c-time-window=999424\n"
+                            "0 constraint=1 c-power-limit=30000000\n", NULL) == 0);
+  assert(powercap_config_diff(&from, &to, &diff) == 0);
+  assert(diff.nzones == 2);
+  assert(diff.zones[0].valid == POWERCAP_CONFIG_ZONE_ENABLED && diff.zones[0].enabled == 1);
+  assert(diff.zones[0].nconstraints == 2);
+  assert(diff.zones[0].constraints[0].valid == 0);
+  assert(diff.zones[0].constraints[1].valid ==
+         (POWERCAP_CONFIG_CONSTRAINT_POWER_LIMIT | POWERCAP_CONFIG_CONSTRAINT_TIME_WINDOW));
+  assert(diff.zones[0].constraints[1].power_limit_uw == 60000000);
+  assert(diff.zones[1].depth == 2);
+  assert(diff.zones[1].valid == POWERCAP_CONFIG_ZONE_ENABLED);
+  assert(diff.zones[1].constraints[0].power_limit_uw == 0);
+  powercap_config_destroy(&diff);
+  powercap_config_destroy(&from);
+  powercap_config_destroy(&to);
+}
+
+static void test_bad_params(void) {
+  powercap_config cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  assert(powercap_config_capture(NULL, "intel-rapl") == -EINVAL);
+  assert(powercap_config_capture(&cfg, NULL) == -EINVAL);
+  assert(powercap_config_diff(NULL, &cfg, &cfg) == -EINVAL);
+  assert(powercap_config_restore(NULL, NULL) == -EINVAL);
+  /* no control type */
+  assert(powercap_config_restore(&cfg, NULL) == -EINVAL);
+  assert(powercap_config_write(&cfg, stdout) == -EINVAL);
+  assert(powercap_config_read(&cfg, NULL, NULL) == -EINVAL);
+  assert(powercap_config_destroy(NULL) == -EINVAL);
+}
+
+int main(void) {
+  test_read_write();
+  test_read_partial();
+  test_read_errors();
+  test_diff();
+  test_bad_params();
+  return 0;
+}
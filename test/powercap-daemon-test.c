@@ -0,0 +1,402 @@
+/**
+ * Daemon tests.
+ * Uses temporary files in place of sysfs files; a child process acts as the clients while the parent runs the daemon.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-daemon.h"
+#include "powercap-rapl.h"
+#include "powercap-test-common.h"
+
+static void sleep_ms(long ms) {
+  struct timespec ts;
+  ts.tv_sec = 0;
+  ts.tv_nsec = ms * 1000000;
+  nanosleep(&ts, NULL);
+}
+
+static int is_readable(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  return poll(&pfd, 1, 0) > 0;
+}
+
+static void cap(int fd, uint32_t zone, uint32_t constraint, uint64_t power_limit_uw, uint64_t lease_ms) {
+  powercap_daemon_cap c;
+  memset(&c, 0, sizeof(c));
+  c.zone = (uint16_t) zone;
+  c.constraint = (uint16_t) constraint;
+  c.power_limit_uw = power_limit_uw;
+  c.lease_ms = lease_ms;
+  assert(powercap_daemon_request_caps(fd, &c, 1) == 0);
+}
+
+/* The *_limit parameters are copies of the daemon's power limit files */
+static void run_clients(int a, int b, int pkg_limit, int pkg_short, int dram_limit) {
+  powercap_daemon_reading r[8];
+  powercap_daemon_zone_id ids[2] = { { 0, POWERCAP_RAPL_ZONE_DRAM }, { 0, POWERCAP_RAPL_ZONE_CORE } };
+  powercap_daemon_cap caps[2];
+
+  /* read all supported zones */
+  assert(powercap_daemon_read(a, NULL, 0, r, 8) == 2);
+  assert(r[0].zone == POWERCAP_RAPL_ZONE_PACKAGE && r[1].zone == POWERCAP_RAPL_ZONE_DRAM);
+  assert(r[0].valid == (POWERCAP_DAEMON_ENERGY | POWERCAP_DAEMON_MAX_ENERGY_RANGE | POWERCAP_DAEMON_POWER_LIMIT_LONG |
+                        POWERCAP_DAEMON_POWER_LIMIT_SHORT));
+  assert(r[0].energy_uj == 1000 && r[0].max_energy_range_uj == 10000);
+  assert(r[0].power_limit_uw[0] == 50000000 && r[0].power_limit_uw[1] == 60000000);
+  assert(r[1].valid == (POWERCAP_DAEMON_ENERGY | POWERCAP_DAEMON_POWER_LIMIT_LONG));
+  /* truncated */
+  assert(powercap_daemon_read(b, NULL, 0, r, 1) == 1);
+  /* specific zones */
+  assert(powercap_daemon_read(b, ids, 1, r, 8) == 1);
+  assert(r[0].zone == POWERCAP_RAPL_ZONE_DRAM && r[0].energy_uj == 2000);
+  assert(powercap_daemon_read(b, ids, 2, r, 8) == -ENOENT);
+
+  /* min wins */
+  cap(a, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, 40000000, 10000);
+  assert(read_file(pkg_limit) == 40000000);
+  cap(b, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, 30000000, 10000);
+  assert(read_file(pkg_limit) == 30000000);
+  /* renewing with a higher value replaces b's own request */
+  cap(b, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, 45000000, 10000);
+  assert(read_file(pkg_limit) == 40000000);
+  /* releasing restores the lowest remaining request, then the baseline */
+  cap(a, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, 0, 0);
+  assert(read_file(pkg_limit) == 45000000);
+  cap(b, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, 0, 0);
+  assert(read_file(pkg_limit) == 50000000);
+  /* clients can't raise a limit above its baseline */
+  cap(a, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, 90000000, 10000);
+  assert(read_file(pkg_limit) == 50000000);
+
+  /* all or nothing */
+  memset(caps, 0, sizeof(caps));
+  caps[0].zone = POWERCAP_RAPL_ZONE_DRAM;
+  caps[0].power_limit_uw = 10000000;
+  caps[0].lease_ms = 10000;
+  caps[1] = caps[0];
+  caps[1].constraint = POWERCAP_RAPL_CONSTRAINT_SHORT;
+  assert(powercap_daemon_request_caps(a, caps, 2) == -ENOENT);
+  assert(read_file(dram_limit) == 20000000);
+  assert(powercap_daemon_request_caps(a, caps, 1) == 0);
+  assert(read_file(dram_limit) == 10000000);
+
+  /* leases expire */
+  cap(b, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_SHORT, 35000000, 50);
+  assert(read_file(pkg_short) == 35000000);
+  sleep_ms(200);
+  assert(read_file(pkg_short) == 60000000);
+  /* disconnecting drops a's requests */
+  close(a);
+  sleep_ms(200);
+  assert(read_file(dram_limit) == 20000000);
+  /* leave a request for the daemon to restore on destroy */
+  cap(b, POWERCAP_RAPL_ZONE_DRAM, POWERCAP_RAPL_CONSTRAINT_LONG, 15000000, 10000);
+  assert(read_file(dram_limit) == 15000000);
+}
+
+static void test_daemon(void) {
+  powercap_daemon d;
+  powercap_rapl_pkg pkg;
+  int pkg_limit;
+  int pkg_short;
+  int dram_limit;
+  int a[2];
+  int b[2];
+  int done[2];
+  int status;
+  char c;
+  pid_t pid;
+  memset(&pkg, 0, sizeof(pkg));
+  pkg.pkg.zone.energy_uj = make_file("1000\n");
+  pkg.pkg.zone.max_energy_range_uj = make_file("10000\n");
+  pkg.pkg.constraint_long.power_limit_uw = make_file("50000000\n");
+  pkg.pkg.constraint_short.power_limit_uw = make_file("60000000\n");
+  pkg.dram.zone.energy_uj = make_file("2000\n");
+  pkg.dram.constraint_long.power_limit_uw = make_file("20000000\n");
+  assert((pkg_limit = dup(pkg.pkg.constraint_long.power_limit_uw)) >= 0);
+  assert((pkg_short = dup(pkg.pkg.constraint_short.power_limit_uw)) >= 0);
+  assert((dram_limit = dup(pkg.dram.constraint_long.power_limit_uw)) >= 0);
+
+  assert(powercap_daemon_init(&d, -1, &pkg, 1) == 0);
+  assert(d.slots[0].supported && d.slots[0].baseline_uw == 50000000);
+  assert(d.slots[1].supported && d.slots[1].baseline_uw == 60000000);
+  /* core */
+  assert(!d.slots[2].supported);
+  /* dram short */
+  assert(!d.slots[2 * POWERCAP_RAPL_ZONE_DRAM + 1].supported);
+  assert(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, a) == 0);
+  assert(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, b) == 0);
+  assert(powercap_daemon_add_conn(&d, a[0]) == 0);
+  assert(powercap_daemon_add_conn(&d, b[0]) == 0);
+
+  assert(pipe(done) == 0);
+
+  pid = fork();
+  assert(pid >= 0);
+  if (!pid) {
+    close(a[0]);
+    close(b[0]);
+    close(done[0]);
+    run_clients(a[1], b[1], pkg_limit, pkg_short, dram_limit);
+    /* keep b connected until the parent is done */
+    assert(write(done[1], "x", 1) == 1);
+    while (read(b[1], &c, 1) > 0);
+    _exit(0);
+  }
+  close(a[1]);
+  close(b[1]);
+  close(done[1]);
+  while (!is_readable(done[0])) {
+    assert(powercap_daemon_poll(&d, 10) == 0);
+  }
+  /* fails if the child exited early */
+  assert(read(done[0], &c, 1) == 1);
+  assert(d.nconns == 1);
+  assert(d.nleases == 1);
+  /* destroying restores baselines */
+  assert(powercap_daemon_destroy(&d) == 0);
+  assert(read_file(dram_limit) == 20000000);
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  close(done[0]);
+  close(pkg_limit);
+  close(pkg_short);
+  close(dram_limit);
+}
+
+/* ctx counts calls per request type */
+static int authorize(void* ctx, powercap_daemon_request request, pid_t pid, uid_t uid, gid_t gid, uint32_t pkg) {
+  int* calls = (int*) ctx;
+  (void) gid;
+  calls[request]++;
+  /* allow the first request for files, and caps for package 0 only */
+  if (request == POWERCAP_DAEMON_REQUEST_CAPS) {
+    return pkg == 0;
+  }
+  return calls[request] == 1 && pid > 0 && uid == getuid() && pkg == 0;
+}
+
+static void open_client(int fd) {
+  powercap_rapl_pkg pkg;
+  uint64_t val;
+  assert(powercap_daemon_open_pkg(fd, 0, &pkg) == 0);
+  assert(pkg.pkg.zone.energy_uj > 0 && pkg.dram.constraint_long.power_limit_uw > 0);
+  assert(pkg.core.zone.energy_uj == 0 && pkg.dram.constraint_short.power_limit_uw == 0);
+  assert(powercap_rapl_get_energy_uj(&pkg, POWERCAP_RAPL_ZONE_PACKAGE, &val) == 0);
+  assert(val == 1000);
+  assert(powercap_rapl_get_power_limit_uw(&pkg, POWERCAP_RAPL_ZONE_DRAM, POWERCAP_RAPL_CONSTRAINT_LONG, &val) == 0);
+  assert(val == 20000000);
+  /* read-only */
+  assert(powercap_rapl_set_power_limit_uw(&pkg, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, 1) < 0);
+  assert(powercap_rapl_destroy(&pkg) == 0);
+  /* denied */
+  assert(powercap_daemon_open_pkg(fd, 0, &pkg) == -EPERM);
+  assert(pkg.pkg.zone.energy_uj == 0);
+}
+
+static void caps_client(int fd) {
+  powercap_daemon_cap caps[2];
+  memset(caps, 0, sizeof(caps));
+  caps[0].power_limit_uw = 40000000;
+  caps[0].lease_ms = 10000;
+  caps[1] = caps[0];
+  caps[1].pkg = 1;
+  /* all or nothing */
+  assert(powercap_daemon_request_caps(fd, caps, 2) == -EPERM);
+  assert(powercap_daemon_request_caps(fd, &caps[1], 1) == -EPERM);
+  assert(powercap_daemon_request_caps(fd, caps, 1) == 0);
+}
+
+static void test_broker(void) {
+  powercap_daemon d;
+  powercap_rapl_pkg pkgs[2];
+  powercap_rapl_pkg out;
+  int calls[2] = { 0, 0 };
+  int sv[2];
+  int status;
+  pid_t pid;
+  uint32_t i;
+  memset(pkgs, 0, sizeof(pkgs));
+  for (i = 0; i < 2; i++) {
+    pkgs[i].pkg.zone.energy_uj = make_file("1000\n");
+    pkgs[i].pkg.constraint_long.power_limit_uw = make_file("50000000\n");
+    pkgs[i].dram.zone.energy_uj = make_file("2000\n");
+    pkgs[i].dram.constraint_long.power_limit_uw = make_file("20000000\n");
+  }
+  assert(powercap_daemon_init(&d, -1, pkgs, 2) == 0);
+  assert(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == 0);
+  assert(powercap_daemon_add_conn(&d, sv[0]) == 0);
+
+  /* not a broker by default */
+  pid = fork();
+  assert(pid >= 0);
+  if (!pid) {
+    _exit(powercap_daemon_open_pkg(sv[1], 0, &out) == -EPERM ? 0 : 1);
+  }
+  while (waitpid(pid, &status, WNOHANG) == 0) {
+    assert(powercap_daemon_poll(&d, 10) == 0);
+  }
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  assert(powercap_daemon_set_broker(&d, authorize, calls) == 0);
+  pid = fork();
+  assert(pid >= 0);
+  if (!pid) {
+    open_client(sv[1]);
+    caps_client(sv[1]);
+    _exit(0);
+  }
+  while (waitpid(pid, &status, WNOHANG) == 0) {
+    assert(powercap_daemon_poll(&d, 10) == 0);
+  }
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  assert(calls[POWERCAP_DAEMON_REQUEST_OPEN] == 2);
+  assert(calls[POWERCAP_DAEMON_REQUEST_CAPS] == 4);
+  /* only the authorized request was applied */
+  assert(d.nleases == 1 && d.leases[0].slot == 0);
+  close(sv[1]);
+  assert(powercap_daemon_destroy(&d) == 0);
+}
+
+static void write_error_client(int fd) {
+  powercap_daemon_cap caps[2];
+  memset(caps, 0, sizeof(caps));
+  caps[0].power_limit_uw = 40000000;
+  caps[0].lease_ms = 10000;
+  caps[1] = caps[0];
+  caps[1].constraint = POWERCAP_RAPL_CONSTRAINT_SHORT;
+  /* the long constraint's write fails, but the connection is still served */
+  assert(powercap_daemon_request_caps(fd, caps, 2) == -EBADF);
+  assert(powercap_daemon_request_caps(fd, &caps[1], 1) == 0);
+}
+
+static void test_write_error(void) {
+  powercap_daemon d;
+  powercap_rapl_pkg pkg;
+  char path[32];
+  int limit;
+  int sv[2];
+  int status;
+  pid_t pid;
+  memset(&pkg, 0, sizeof(pkg));
+  limit = make_file("50000000\n");
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", limit);
+  /* a read-only power limit file */
+  assert((pkg.pkg.constraint_long.power_limit_uw = open(path, O_RDONLY)) >= 0);
+  close(limit);
+  pkg.pkg.zone.energy_uj = make_file("1000\n");
+  pkg.pkg.constraint_short.power_limit_uw = make_file("60000000\n");
+  assert(powercap_daemon_init(&d, -1, &pkg, 1) == 0);
+  assert(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) == 0);
+  assert(powercap_daemon_add_conn(&d, sv[0]) == 0);
+  pid = fork();
+  assert(pid >= 0);
+  if (!pid) {
+    write_error_client(sv[1]);
+    _exit(0);
+  }
+  while (waitpid(pid, &status, WNOHANG) == 0) {
+    assert(powercap_daemon_poll(&d, 10) == 0);
+  }
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  assert(d.nconns == 1);
+  assert(d.slots[0].limit_uw == 50000000 && d.slots[1].limit_uw == 40000000);
+  close(sv[1]);
+  assert(powercap_daemon_destroy(&d) == 0);
+}
+
+static void invalid_cap_client(int a, int b, int limit) {
+  powercap_daemon_cap c;
+  memset(&c, 0, sizeof(c));
+  c.power_limit_uw = 5000000;
+  c.lease_ms = 10000;
+  /* below the constraint's min */
+  assert(powercap_daemon_request_caps(a, &c, 1) == -EINVAL);
+  c.power_limit_uw = 0;
+  assert(powercap_daemon_request_caps(a, &c, 1) == -EINVAL);
+  /* above its max */
+  c.power_limit_uw = 200000000;
+  assert(powercap_daemon_request_caps(a, &c, 1) == -EINVAL);
+  /* the rejected requests don't keep another client's valid cap from being applied */
+  cap(b, POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG, 30000000, 10000);
+  assert(read_file(limit) == 30000000);
+}
+
+static void test_invalid_cap(void) {
+  powercap_daemon d;
+  powercap_rapl_pkg pkg;
+  int limit;
+  int a[2];
+  int b[2];
+  int status;
+  pid_t pid;
+  memset(&pkg, 0, sizeof(pkg));
+  pkg.pkg.zone.energy_uj = make_file("1000\n");
+  pkg.pkg.constraint_long.power_limit_uw = make_file("50000000\n");
+  pkg.pkg.constraint_long.min_power_uw = make_file("10000000\n");
+  pkg.pkg.constraint_long.max_power_uw = make_file("100000000\n");
+  assert((limit = dup(pkg.pkg.constraint_long.power_limit_uw)) >= 0);
+  assert(powercap_daemon_init(&d, -1, &pkg, 1) == 0);
+  assert(d.slots[0].min_uw == 10000000 && d.slots[0].max_uw == 100000000);
+  assert(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, a) == 0);
+  assert(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, b) == 0);
+  assert(powercap_daemon_add_conn(&d, a[0]) == 0);
+  assert(powercap_daemon_add_conn(&d, b[0]) == 0);
+  pid = fork();
+  assert(pid >= 0);
+  if (!pid) {
+    invalid_cap_client(a[1], b[1], limit);
+    _exit(0);
+  }
+  while (waitpid(pid, &status, WNOHANG) == 0) {
+    assert(powercap_daemon_poll(&d, 10) == 0);
+  }
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  assert(d.nleases == 1);
+  close(a[1]);
+  close(b[1]);
+  assert(powercap_daemon_destroy(&d) == 0);
+  close(limit);
+}
+
+static void test_bad_params(void) {
+  powercap_daemon d;
+  powercap_rapl_pkg pkg;
+  powercap_daemon_cap c;
+  memset(&pkg, 0, sizeof(pkg));
+  memset(&c, 0, sizeof(c));
+  assert(powercap_daemon_init(NULL, -1, &pkg, 1) == -EINVAL);
+  assert(powercap_daemon_init(&d, -1, NULL, 1) == -EINVAL);
+  assert(powercap_daemon_init(&d, -1, &pkg, 0) == -EINVAL);
+  assert(powercap_daemon_destroy(NULL) == -EINVAL);
+  assert(powercap_daemon_add_conn(NULL, 0) == -EINVAL);
+  assert(powercap_daemon_poll(NULL, 0) == -EINVAL);
+  assert(powercap_daemon_read(-1, NULL, 0, NULL, 0) == -EINVAL);
+  assert(powercap_daemon_read(0, NULL, 1, NULL, 0) == -EINVAL);
+  assert(powercap_daemon_request_caps(0, &c, 0) == -EINVAL);
+  assert(powercap_daemon_listen(NULL) == -EINVAL);
+  assert(powercap_daemon_set_broker(NULL, NULL, NULL) == -EINVAL);
+  assert(powercap_daemon_open_pkg(0, 0, NULL) == -EINVAL);
+}
+
+int main(void) {
+  test_daemon();
+  test_broker();
+  test_write_error();
+  test_invalid_cap();
+  test_bad_params();
+  return 0;
+}
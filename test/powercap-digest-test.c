@@ -0,0 +1,158 @@
+/**
+ * Digest tests.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap-digest.h"
+#include "powercap-sampler.h"
+
+/* Within the digest's relative error */
+static void assert_near(uint64_t val, uint64_t expected) {
+  uint64_t err = val > expected ? val - expected : expected - val;
+  assert(err * (1 << (POWERCAP_DIGEST_SUB_BITS - 1)) <= expected);
+}
+
+static void test_stats(void) {
+  powercap_digest d;
+  uint64_t q;
+  uint64_t i;
+  assert(powercap_digest_init(&d) == 0);
+  assert(powercap_digest_quantile(&d, 0.5, &q) == -ENODATA);
+  assert(powercap_digest_variance(&d) <= 0);
+
+  /* 1 to 100 W, in uW */
+  for (i = 1; i <= 100000; i++) {
+    assert(powercap_digest_add(&d, i * 1000) == 0);
+  }
+  assert(d.count == 100000 && d.min == 1000 && d.max == 100000000);
+  assert(d.mean > 50000499 && d.mean < 50000501);
+  /* (n^2 - 1) / 12 * 1000^2 ≈ 8.3334e14 */
+  assert(powercap_digest_variance(&d) > 8.3333e14 && powercap_digest_variance(&d) < 8.3335e14);
+  assert(powercap_digest_quantile(&d, 0, &q) == 0 && q == 1000);
+  assert(powercap_digest_quantile(&d, 1, &q) == 0 && q == 100000000);
+  assert(powercap_digest_quantile(&d, 0.5, &q) == 0);
+  assert_near(q, 50000000);
+  assert(powercap_digest_quantile(&d, 0.99, &q) == 0);
+  assert_near(q, 99000000);
+  assert(powercap_digest_quantile(&d, 0.001, &q) == 0);
+  assert_near(q, 100000);
+  assert(powercap_digest_quantile(&d, 1.5, &q) == -EINVAL);
+
+  /* small values are exact */
+  assert(powercap_digest_init(&d) == 0);
+  for (i = 0; i < 100; i++) {
+    assert(powercap_digest_add(&d, i) == 0);
+  }
+  assert(powercap_digest_quantile(&d, 0.5, &q) == 0 && q == 49);
+  assert(powercap_digest_quantile(&d, 0.505, &q) == 0 && q == 50);
+
+  /* huge values share the last bucket, but the maximum is exact */
+  assert(powercap_digest_add(&d, UINT64_MAX) == 0);
+  assert(powercap_digest_add(&d, (uint64_t) 1 << 60) == 0);
+  assert(d.buckets[POWERCAP_DIGEST_BUCKETS - 1] == 2);
+  assert(powercap_digest_quantile(&d, 1, &q) == 0 && q == UINT64_MAX);
+}
+
+static void test_merge_serialize(void) {
+  powercap_digest all;
+  powercap_digest a;
+  powercap_digest b;
+  powercap_digest c;
+  unsigned char* buf;
+  size_t size;
+  uint64_t qa;
+  uint64_t qb;
+  uint64_t v;
+  uint32_t i;
+  powercap_digest_init(&all);
+  powercap_digest_init(&a);
+  powercap_digest_init(&b);
+  for (i = 0; i < 50000; i++) {
+    v = (uint64_t) (i * 7919U % 65536U) * 1500;
+    powercap_digest_add(&all, v);
+    powercap_digest_add(i % 3 ? &a : &b, v);
+  }
+  assert(powercap_digest_merge(&a, &b) == 0);
+  assert(a.count == all.count && a.min == all.min && a.max == all.max);
+  assert(memcmp(a.buckets, all.buckets, sizeof(all.buckets)) == 0);
+  assert(a.mean / all.mean > 0.999999 && a.mean / all.mean < 1.000001);
+  assert(powercap_digest_variance(&a) / powercap_digest_variance(&all) > 0.999999);
+  assert(powercap_digest_variance(&a) / powercap_digest_variance(&all) < 1.000001);
+  /* merging an empty digest changes nothing */
+  powercap_digest_init(&c);
+  assert(powercap_digest_merge(&a, &c) == 0 && a.count == all.count);
+  assert(powercap_digest_merge(&c, &a) == 0 && c.count == all.count && c.min == all.min);
+
+  size = powercap_digest_serialized_size(&a);
+  assert(size > 52 && size < sizeof(powercap_digest));
+  assert((buf = malloc(size)) != NULL);
+  assert(powercap_digest_serialize(&a, buf, size - 1) == -ENOBUFS);
+  assert(powercap_digest_serialize(&a, buf, size) == (ssize_t) size);
+  assert(powercap_digest_deserialize(&c, buf, size) == 0);
+  assert(c.count == a.count && c.min == a.min && c.max == a.max);
+  assert(!memcmp(&c.mean, &a.mean, sizeof(a.mean)) && !memcmp(&c.m2, &a.m2, sizeof(a.m2)));
+  assert(memcmp(c.buckets, a.buckets, sizeof(a.buckets)) == 0);
+  assert(powercap_digest_quantile(&a, 0.99, &qa) == 0 && powercap_digest_quantile(&c, 0.99, &qb) == 0 && qa == qb);
+  /* corrupt */
+  assert(powercap_digest_deserialize(&c, buf, size - 1) == -EINVAL);
+  buf[0] = 'X';
+  assert(powercap_digest_deserialize(&c, buf, size) == -EINVAL);
+  buf[0] = 'P';
+  /* the first bucket's count no longer matches the total */
+  buf[56]++;
+  assert(powercap_digest_deserialize(&c, buf, size) == -EINVAL);
+  assert(c.count == 0);
+  free(buf);
+}
+
+static void test_snapshot(void) {
+  powercap_sampler_zone_values zones[3];
+  powercap_sampler_snapshot snap;
+  powercap_digest d[3];
+  memset(zones, 0, sizeof(zones));
+  memset(&snap, 0, sizeof(snap));
+  snap.zones = zones;
+  snap.nzones = 3;
+  zones[0].valid = POWERCAP_SAMPLER_ZONE_ENERGY | POWERCAP_SAMPLER_ZONE_POWER;
+  zones[0].power_uw = 25000000;
+  /* no derived power */
+  zones[1].valid = POWERCAP_SAMPLER_ZONE_ENERGY;
+  zones[1].power_uw = 1;
+  zones[2].valid = POWERCAP_SAMPLER_ZONE_POWER;
+  zones[2].power_uw = 3000000;
+  powercap_digest_init(&d[0]);
+  powercap_digest_init(&d[1]);
+  powercap_digest_init(&d[2]);
+  assert(powercap_digest_add_snapshot(d, &snap) == 0);
+  assert(powercap_digest_add_snapshot(d, &snap) == 0);
+  assert(d[0].count == 2 && d[0].max == 25000000);
+  assert(d[1].count == 0);
+  assert(d[2].count == 2 && d[2].min == 3000000 && d[2].max == 3000000);
+}
+
+static void test_bad_params(void) {
+  powercap_digest d;
+  uint64_t q;
+  unsigned char buf[64];
+  assert(powercap_digest_init(NULL) == -EINVAL);
+  assert(powercap_digest_add(NULL, 0) == -EINVAL);
+  assert(powercap_digest_add_snapshot(NULL, NULL) == -EINVAL);
+  assert(powercap_digest_merge(NULL, &d) == -EINVAL);
+  assert(powercap_digest_quantile(NULL, 0.5, &q) == -EINVAL);
+  assert(powercap_digest_serialized_size(NULL) == 0);
+  assert(powercap_digest_serialize(NULL, buf, sizeof(buf)) == -EINVAL);
+  assert(powercap_digest_deserialize(&d, buf, 0) == -EINVAL);
+}
+
+int main(void) {
+  test_stats();
+  test_merge_serialize();
+  test_snapshot();
+  test_bad_params();
+  return 0;
+}
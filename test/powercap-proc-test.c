@@ -0,0 +1,212 @@
+/**
+ * Process energy estimation tests.
+ * Uses a temporary directory tree in place of procfs and temporary files in place of sysfs files.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "powercap-proc.h"
+#include "powercap-rapl.h"
+#include "powercap-test-common.h"
+
+static char root[] = "/tmp/powercap-proc-test-XXXXXX";
+
+static void write_u64(int fd, uint64_t val) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%"PRIu64"\n", val);
+  write_file(fd, buf);
+}
+
+/* Rewrites in place, so that held file descriptors see the change */
+static void write_path(const char* path, const char* contents) {
+  FILE* f;
+  assert((f = fopen(path, "w")) != NULL);
+  fputs(contents, f);
+  assert(fclose(f) == 0);
+}
+
+static void set_busy(uint64_t busy) {
+  char path[PATH_MAX];
+  char buf[256];
+  snprintf(path, sizeof(path), "%s/stat", root);
+  /* user nice system idle iowait irq softirq steal */
+  snprintf(buf, sizeof(buf), "cpu  %"PRIu64" 0 0 123456 789 0 0 0 0 0\ncpu0 %"PRIu64" 0 0 0 0 0 0 0 0 0\n", busy, busy);
+  write_path(path, buf);
+}
+
+static void set_proc(uint32_t pid, const char* comm, uint64_t utime, uint64_t stime, uint64_t start_time) {
+  char path[PATH_MAX];
+  char buf[512];
+  snprintf(path, sizeof(path), "%s/%"PRIu32, root, pid);
+  mkdir(path, 0700);
+  snprintf(path, sizeof(path), "%s/%"PRIu32"/stat", root, pid);
+  snprintf(buf, sizeof(buf), "%"PRIu32" (%s) S 1 1 1 0 -1 4194560 100 0 0 0 %"PRIu64" %"PRIu64" 0 0 20 0 1 0 "
+           "%"PRIu64" 1000 100 18446744073709551615\n", pid, comm, utime, stime, start_time);
+  write_path(path, buf);
+}
+
+static void kill_proc(uint32_t pid) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%"PRIu32"/stat", root, pid);
+  assert(unlink(path) == 0);
+  snprintf(path, sizeof(path), "%s/%"PRIu32, root, pid);
+  assert(rmdir(path) == 0);
+}
+
+static uint64_t pkg_energy(const powercap_proc* p, uint32_t pid) {
+  const powercap_proc_entry* e = powercap_proc_get(p, pid);
+  assert(e != NULL);
+  return e->pkg_energy_uj;
+}
+
+static void test_proc(void) {
+  char path[PATH_MAX];
+  powercap_proc p;
+  powercap_rapl_pkg pkg;
+  const powercap_proc_entry* e;
+
+  memset(&pkg, 0, sizeof(pkg));
+  pkg.pkg.zone.energy_uj = make_file("1000\n");
+  pkg.pkg.zone.max_energy_range_uj = make_file("100000\n");
+  pkg.core.zone.energy_uj = make_file("500\n");
+
+  assert(mkdtemp(root) != NULL);
+  set_busy(1000);
+  set_proc(1, "init", 10, 10, 1);
+  /* a command name with spaces and parentheses */
+  set_proc(100, "a) (b c", 50, 50, 200);
+  set_proc(200, "worker", 0, 0, 300);
+  /* not a process */
+  snprintf(path, sizeof(path), "%s/self", root);
+  assert(mkdir(path, 0700) == 0);
+
+  assert(powercap_proc_init(&p, root, &pkg, 1) == 0);
+  /* baseline */
+  assert(powercap_proc_sample(&p) == 0);
+  assert(p.nentries == 3 && p.busy_ticks == 1000);
+  e = powercap_proc_get(&p, 100);
+  assert(e != NULL && e->alive && !strcmp(e->comm, "a) (b c") && e->cpu_ticks == 100 && e->start_time == 200);
+  assert(e->pkg_energy_uj == 0);
+  assert(powercap_proc_get(&p, 300) == NULL);
+
+  /* shares of the busy time, some of which isn't attributed to any process */
+  set_busy(2000);
+  set_proc(100, "a) (b c", 250, 150, 200);
+  set_proc(200, "worker", 100, 0, 300);
+  write_u64(pkg.pkg.zone.energy_uj, 11000);
+  write_u64(pkg.core.zone.energy_uj, 1500);
+  assert(powercap_proc_sample(&p) == 0);
+  assert(p.busy_delta_ticks == 1000 && p.pkg_delta_uj == 10000 && p.core_delta_uj == 1000);
+  assert(powercap_proc_get(&p, 100)->cpu_delta_ticks == 300);
+  assert(pkg_energy(&p, 100) == 3000);
+  assert(pkg_energy(&p, 200) == 1000);
+  assert(pkg_energy(&p, 1) == 0);
+  assert(powercap_proc_get(&p, 100)->core_energy_uj == 300);
+
+  /* 200 exits, 300 starts, 100's PID is reused, and busy time lags behind process time; the counter wraps */
+  kill_proc(200);
+  set_proc(300, "new", 5, 5, 5000);
+  set_proc(100, "reused", 0, 0, 6000);
+  set_busy(2010);
+  set_proc(1, "init", 60, 60, 1);
+  write_u64(pkg.pkg.zone.energy_uj, 1000);
+  assert(powercap_proc_sample(&p) == 0);
+  assert(p.pkg_delta_uj == 90000);
+  assert(pkg_energy(&p, 1) == 90000);
+  e = powercap_proc_get(&p, 200);
+  assert(e != NULL && !e->alive && e->pkg_energy_uj == 1000);
+  e = powercap_proc_get(&p, 100);
+  assert(e != NULL && e->alive && !strcmp(e->comm, "reused") && e->pkg_energy_uj == 0 && e->cpu_delta_ticks == 0);
+  e = powercap_proc_get(&p, 300);
+  assert(e != NULL && e->alive && e->cpu_delta_ticks == 0);
+  assert(p.nentries == 4);
+
+  /* 200 is dropped */
+  assert(powercap_proc_sample(&p) == 0);
+  assert(powercap_proc_get(&p, 200) == NULL);
+  assert(p.nentries == 3);
+
+  assert(powercap_proc_destroy(&p) == 0);
+  kill_proc(1);
+  kill_proc(100);
+  kill_proc(300);
+  snprintf(path, sizeof(path), "%s/self", root);
+  assert(rmdir(path) == 0);
+  snprintf(path, sizeof(path), "%s/stat", root);
+  assert(unlink(path) == 0);
+  assert(rmdir(root) == 0);
+  close_pkg(&pkg);
+}
+
+/* Many processes force the table to grow and entries to shift on removal */
+static void test_many(void) {
+  powercap_proc p;
+  powercap_rapl_pkg pkg;
+  uint64_t sum = 0;
+  uint32_t i;
+
+  memset(&pkg, 0, sizeof(pkg));
+  pkg.pkg.zone.energy_uj = make_file("0\n");
+  strcpy(root, "/tmp/powercap-proc-test-XXXXXX");
+  assert(mkdtemp(root) != NULL);
+  /* no /proc/stat: shares of the processes' total */
+  for (i = 1; i <= 1000; i++) {
+    set_proc(i, "p", 0, 0, i);
+  }
+  assert(powercap_proc_init(&p, root, &pkg, 1) == 0);
+  assert(p.stat_fd < 0);
+  assert(powercap_proc_sample(&p) == 0);
+  assert(p.nentries == 1000 && p.nslots >= 2000);
+  for (i = 1; i <= 1000; i++) {
+    set_proc(i, "p", 1, 1, i);
+  }
+  write_u64(pkg.pkg.zone.energy_uj, 1000000);
+  assert(powercap_proc_sample(&p) == 0);
+  for (i = 1; i <= 1000; i++) {
+    sum += pkg_energy(&p, i);
+    assert(pkg_energy(&p, i) == 1000);
+  }
+  assert(sum == 1000000);
+  for (i = 1; i <= 1000; i += 2) {
+    kill_proc(i);
+  }
+  assert(powercap_proc_sample(&p) == 0);
+  assert(powercap_proc_sample(&p) == 0);
+  assert(p.nentries == 500);
+  for (i = 1; i <= 1000; i++) {
+    assert((powercap_proc_get(&p, i) != NULL) == !(i % 2));
+  }
+  assert(powercap_proc_destroy(&p) == 0);
+  for (i = 2; i <= 1000; i += 2) {
+    kill_proc(i);
+  }
+  assert(rmdir(root) == 0);
+  close_pkg(&pkg);
+}
+
+static void test_bad_params(void) {
+  powercap_proc p;
+  powercap_rapl_pkg pkg;
+  memset(&pkg, 0, sizeof(pkg));
+  assert(powercap_proc_init(NULL, "/tmp", &pkg, 1) == -EINVAL);
+  assert(powercap_proc_init(&p, "/tmp", NULL, 1) == -EINVAL);
+  assert(powercap_proc_init(&p, "/nonexistent/powercap-proc-test", &pkg, 1) == -ENOENT);
+  assert(powercap_proc_sample(NULL) == -EINVAL);
+  assert(powercap_proc_destroy(NULL) == -EINVAL);
+  assert(powercap_proc_get(NULL, 1) == NULL);
+}
+
+int main(void) {
+  test_proc();
+  test_many();
+  test_bad_params();
+  return 0;
+}
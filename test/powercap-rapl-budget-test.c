@@ -0,0 +1,172 @@
+/**
+ * Budget shifting tests.
+ * Uses temporary files in place of sysfs files.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap-rapl.h"
+#include "powercap-rapl-budget.h"
+#include "powercap-test-common.h"
+
+#define NPKGS 3
+
+static void make_pkg(powercap_rapl_pkg* pkg) {
+  memset(pkg, 0, sizeof(*pkg));
+  pkg->pkg.zone.energy_uj = make_file("1000\n");
+  pkg->pkg.zone.max_energy_range_uj = make_file("262143328850\n");
+  pkg->pkg.constraint_long.power_limit_uw = make_file("100000000\n");
+  pkg->pkg.constraint_long.max_power_uw = make_file("150000000\n");
+}
+
+static uint64_t sum_limits(const powercap_rapl_budget* budget) {
+  uint64_t sum = 0;
+  uint32_t i;
+  for (i = 0; i < budget->npkgs; i++) {
+    assert(read_file(budget->pkgs[i].pkg->pkg.constraint_long.power_limit_uw) == budget->pkgs[i].power_limit_uw);
+    sum += budget->pkgs[i].power_limit_uw;
+  }
+  return sum;
+}
+
+static void test_shift(void) {
+  powercap_rapl_pkg pkgs[NPKGS];
+  powercap_rapl_budget budget;
+  powercap_rapl_budget_config cfg;
+  uint64_t power[NPKGS];
+  uint32_t i;
+  for (i = 0; i < NPKGS; i++) {
+    make_pkg(&pkgs[i]);
+  }
+  powercap_rapl_budget_config_default(&cfg);
+  cfg.budget_uw = 240000000;
+  cfg.min_power_uw = 20000000;
+  assert(powercap_rapl_budget_init(&budget, pkgs, NPKGS, &cfg) == 0);
+  /* equal split */
+  for (i = 0; i < NPKGS; i++) {
+    assert(budget.pkgs[i].min_power_uw == 20000000);
+    assert(budget.pkgs[i].max_power_uw == 150000000);
+    assert(budget.pkgs[i].power_limit_uw == 80000000);
+  }
+  assert(sum_limits(&budget) == 240000000);
+
+  /* pkg 0 is capped, the others have slack */
+  power[0] = 79000000;
+  power[1] = 30000000;
+  power[2] = 40000000;
+  assert(powercap_rapl_budget_allocate(&budget, power) == 0);
+  /* demands are 150 W, 33 W, and 44 W; pkg 0 gets its max and the 13 W surplus is shared by the others */
+  assert(budget.pkgs[0].power_limit_uw == 150000000);
+  assert(budget.pkgs[1].power_limit_uw == 39500000);
+  assert(budget.pkgs[2].power_limit_uw == 50500000);
+  assert(sum_limits(&budget) == 240000000);
+
+  /* all packages are capped: max-min fairness gives an equal split again */
+  for (i = 0; i < NPKGS; i++) {
+    power[i] = budget.pkgs[i].power_limit_uw;
+  }
+  assert(powercap_rapl_budget_allocate(&budget, power) == 0);
+  for (i = 0; i < NPKGS; i++) {
+    assert(budget.pkgs[i].power_limit_uw == 80000000);
+  }
+
+  /* idle packages never go below their minimums */
+  memset(power, 0, sizeof(power));
+  assert(powercap_rapl_budget_set_budget(&budget, 60000000) == 0);
+  assert(powercap_rapl_budget_allocate(&budget, power) == 0);
+  for (i = 0; i < NPKGS; i++) {
+    assert(budget.pkgs[i].power_limit_uw == 20000000);
+  }
+  assert(sum_limits(&budget) == 60000000);
+
+  /* budget too small for the minimums */
+  assert(powercap_rapl_budget_set_budget(&budget, 50000000) == 0);
+  errno = 0;
+  assert(powercap_rapl_budget_allocate(&budget, power) == -EINVAL);
+  assert(errno == EINVAL);
+  assert(sum_limits(&budget) == 60000000);
+
+  assert(powercap_rapl_budget_destroy(&budget) == 0);
+  for (i = 0; i < NPKGS; i++) {
+    close_pkg(&pkgs[i]);
+  }
+}
+
+static void test_update(void) {
+  powercap_rapl_pkg pkgs[NPKGS];
+  powercap_rapl_budget budget;
+  powercap_rapl_budget_config cfg;
+  uint32_t i;
+  int ret;
+  for (i = 0; i < NPKGS; i++) {
+    make_pkg(&pkgs[i]);
+  }
+  powercap_rapl_budget_config_default(&cfg);
+  cfg.budget_uw = 240000000;
+  cfg.min_power_uw = 20000000;
+  assert(powercap_rapl_budget_init(&budget, pkgs, NPKGS, &cfg) == 0);
+  usleep(10000);
+  /* energy counter on pkg 1 wrapped around */
+  assert(pwrite(pkgs[1].pkg.zone.energy_uj, "500\n", 4, 0) == 4);
+  while ((ret = powercap_rapl_budget_update(&budget)) == -EAGAIN);
+  assert(ret == 0);
+  assert(budget.pkgs[0].power_uw == 0);
+  assert(budget.pkgs[1].power_uw > 0);
+  assert(budget.pkgs[1].energy_uj == 500);
+  assert(sum_limits(&budget) <= 240000000);
+  assert(powercap_rapl_budget_destroy(&budget) == 0);
+  for (i = 0; i < NPKGS; i++) {
+    close_pkg(&pkgs[i]);
+  }
+}
+
+static void test_bad_params(void) {
+  powercap_rapl_pkg pkg;
+  powercap_rapl_budget budget;
+  powercap_rapl_budget_config cfg;
+  make_pkg(&pkg);
+  powercap_rapl_budget_config_default(&cfg);
+  /* no budget */
+  errno = 0;
+  assert(powercap_rapl_budget_init(&budget, &pkg, 1, &cfg) == -EINVAL);
+  assert(errno == EINVAL);
+  cfg.budget_uw = 100000000;
+  /* min_power_uw isn't available */
+  errno = 0;
+  assert(powercap_rapl_budget_init(&budget, &pkg, 1, &cfg) == -ENODATA);
+  assert(errno == ENODATA);
+  cfg.min_power_uw = 120000000;
+  /* budget < min */
+  errno = 0;
+  assert(powercap_rapl_budget_init(&budget, &pkg, 1, &cfg) == -EINVAL);
+  assert(errno == EINVAL);
+  assert(budget.pkgs == NULL);
+  cfg.min_power_uw = 1;
+  cfg.cap_threshold = 0;
+  assert(powercap_rapl_budget_init(&budget, &pkg, 1, &cfg) == -EINVAL);
+  cfg.cap_threshold = 1;
+  assert(powercap_rapl_budget_init(NULL, &pkg, 1, &cfg) == -EINVAL);
+  assert(powercap_rapl_budget_init(&budget, NULL, 1, &cfg) == -EINVAL);
+  assert(powercap_rapl_budget_init(&budget, &pkg, 0, &cfg) == -EINVAL);
+  assert(powercap_rapl_budget_init(&budget, &pkg, 1, NULL) == -EINVAL);
+  assert(powercap_rapl_budget_init(&budget, &pkg, 1, &cfg) == 0);
+  assert(powercap_rapl_budget_set_budget(&budget, 0) == -EINVAL);
+  assert(powercap_rapl_budget_set_budget(NULL, 1) == -EINVAL);
+  assert(powercap_rapl_budget_allocate(&budget, NULL) == -EINVAL);
+  assert(powercap_rapl_budget_update(NULL) == -EINVAL);
+  assert(powercap_rapl_budget_destroy(&budget) == 0);
+  assert(powercap_rapl_budget_update(&budget) == -EINVAL);
+  close_pkg(&pkg);
+}
+
+int main(void) {
+  test_shift();
+  test_update();
+  test_bad_params();
+  return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * Controller tests against a simulated application.
+ * Uses temporary files in place of sysfs files.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap-rapl.h"
+#include "powercap-rapl-controller.h"
+#include "powercap-test-common.h"
+
+static void make_pkg(powercap_rapl_pkg* pkg) {
+  memset(pkg, 0, sizeof(*pkg));
+  pkg->pkg.constraint_long.power_limit_uw = make_file("100000000\n");
+  pkg->pkg.constraint_long.max_power_uw = make_file("150000000\n");
+  pkg->dram.constraint_long.power_limit_uw = make_file("30000000\n");
+  pkg->dram.constraint_long.max_power_uw = make_file("40000000\n");
+}
+
+/* Simulated application: 2 units of performance per watt, saturating at 200 */
+static double app_perf(uint64_t limit_uw) {
+  double perf = 2 * (limit_uw / 1000000.0);
+  return perf > 200 ? 200 : perf;
+}
+
+static void test_converge(void) {
+  powercap_rapl_pkg pkg;
+  powercap_rapl_controller ctl;
+  powercap_rapl_controller_config cfg;
+  uint32_t i;
+  make_pkg(&pkg);
+  powercap_rapl_controller_config_default(&cfg);
+  cfg.target = 120;
+  cfg.min_power_uw = 20000000;
+  cfg.dram_ratio = 0.25;
+  cfg.dram_min_power_uw = 5000000;
+  assert(powercap_rapl_controller_init(&ctl, &pkg, &cfg) == 0);
+  assert(ctl.power_limit_uw == 100000000);
+  assert(ctl.config.max_power_uw == 150000000);
+  assert(ctl.config.dram_max_power_uw == 40000000);
+  for (i = 0; i < 20; i++) {
+    assert(powercap_rapl_controller_update(&ctl, app_perf(read_file(pkg.pkg.constraint_long.power_limit_uw))) == 0);
+  }
+  /* 120 units at 2 units/W is 60 W */
+  assert(ctl.power_limit_uw > 59900000 && ctl.power_limit_uw < 60100000);
+  assert(read_file(pkg.pkg.constraint_long.power_limit_uw) == ctl.power_limit_uw);
+  assert(read_file(pkg.dram.constraint_long.power_limit_uw) == ctl.dram_power_limit_uw);
+  assert(ctl.dram_power_limit_uw == ctl.power_limit_uw / 4);
+
+  /* unreachable target saturates at the max bound */
+  assert(powercap_rapl_controller_set_target(&ctl, 1000) == 0);
+  for (i = 0; i < 20; i++) {
+    assert(powercap_rapl_controller_update(&ctl, app_perf(ctl.power_limit_uw)) == 0);
+  }
+  assert(ctl.power_limit_uw == 150000000);
+  assert(ctl.dram_power_limit_uw == 37500000);
+
+  /* tiny target saturates at the min bound */
+  assert(powercap_rapl_controller_set_target(&ctl, 1) == 0);
+  for (i = 0; i < 20; i++) {
+    assert(powercap_rapl_controller_update(&ctl, app_perf(ctl.power_limit_uw)) == 0);
+  }
+  assert(ctl.power_limit_uw == 20000000);
+  assert(ctl.dram_power_limit_uw == 5000000);
+  close_pkg(&pkg);
+}
+
+static void test_no_progress(void) {
+  powercap_rapl_pkg pkg;
+  powercap_rapl_controller ctl;
+  powercap_rapl_controller_config cfg;
+  make_pkg(&pkg);
+  powercap_rapl_controller_config_default(&cfg);
+  cfg.target = 50;
+  cfg.min_power_uw = 20000000;
+  assert(powercap_rapl_controller_init(&ctl, &pkg, &cfg) == 0);
+  assert(powercap_rapl_controller_update(&ctl, 0) == 0);
+  assert(ctl.power_limit_uw == 150000000);
+  /* DRAM is left alone */
+  assert(read_file(pkg.dram.constraint_long.power_limit_uw) == 30000000);
+  close_pkg(&pkg);
+}
+
+static void test_bad_params(void) {
+  powercap_rapl_pkg pkg;
+  powercap_rapl_controller ctl;
+  powercap_rapl_controller_config cfg;
+  make_pkg(&pkg);
+  powercap_rapl_controller_config_default(&cfg);
+  errno = 0;
+  /* no target */
+  assert(powercap_rapl_controller_init(&ctl, &pkg, &cfg) == -EINVAL);
+  assert(errno == EINVAL);
+  cfg.target = 1;
+  /* min_power_uw isn't available */
+  errno = 0;
+  assert(powercap_rapl_controller_init(&ctl, &pkg, &cfg) == -ENODATA);
+  assert(errno == ENODATA);
+  cfg.min_power_uw = 200000000;
+  /* min > max */
+  errno = 0;
+  assert(powercap_rapl_controller_init(&ctl, &pkg, &cfg) == -EINVAL);
+  assert(errno == EINVAL);
+  cfg.min_power_uw = 1;
+  cfg.pole = 1;
+  errno = 0;
+  assert(powercap_rapl_controller_init(&ctl, &pkg, &cfg) == -EINVAL);
+  assert(errno == EINVAL);
+  cfg.pole = 0;
+  assert(powercap_rapl_controller_init(NULL, &pkg, &cfg) == -EINVAL);
+  assert(powercap_rapl_controller_init(&ctl, NULL, &cfg) == -EINVAL);
+  assert(powercap_rapl_controller_init(&ctl, &pkg, NULL) == -EINVAL);
+  assert(powercap_rapl_controller_init(&ctl, &pkg, &cfg) == 0);
+  assert(powercap_rapl_controller_set_target(&ctl, 0) == -EINVAL);
+  assert(powercap_rapl_controller_set_target(NULL, 1) == -EINVAL);
+  assert(powercap_rapl_controller_update(NULL, 1) == -EINVAL);
+  close_pkg(&pkg);
+}
+
+int main(void) {
+  test_converge();
+  test_no_progress();
+  test_bad_params();
+  return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * Package/DRAM split optimizer tests.
+ * Uses temporary files in place of sysfs files and a simulated application.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap-rapl.h"
+#include "powercap-rapl-split.h"
+#include "powercap-test-common.h"
+
+#define BUDGET_UW 120000000
+#define MAX_PERIODS 100
+
+static void make_zone(powercap_rapl_zone_files* zone, const char* limit) {
+  zone->zone.energy_uj = make_file("1000\n");
+  zone->zone.max_energy_range_uj = make_file("262143328850\n");
+  zone->constraint_long.power_limit_uw = make_file(limit);
+}
+
+/* Progress of an application limited by compute (pkg_w * pkg_rate) or memory (dram_w * dram_rate) */
+static double app_perf(const powercap_rapl_split* split, double pkg_rate, double dram_rate) {
+  double pkg = split->pkg_limit_uw / 1000000.0 * pkg_rate;
+  double dram = split->dram_limit_uw / 1000000.0 * dram_rate;
+  return pkg < dram ? pkg : dram;
+}
+
+/* Run until converged, returning the number of periods */
+static uint32_t run(powercap_rapl_split* split, double pkg_rate, double dram_rate) {
+  uint32_t i;
+  for (i = 0; i < MAX_PERIODS && !split->converged; i++) {
+    assert(powercap_rapl_split_update_power(split, app_perf(split, pkg_rate, dram_rate), split->pkg_limit_uw,
+                                            split->dram_limit_uw) == 0);
+    assert(split->pkg_limit_uw + split->dram_limit_uw == BUDGET_UW);
+    assert(read_file(split->pkg->pkg.constraint_long.power_limit_uw) == split->pkg_limit_uw);
+    assert(read_file(split->pkg->dram.constraint_long.power_limit_uw) == split->dram_limit_uw);
+  }
+  assert(split->converged);
+  return i;
+}
+
+static uint64_t distance(uint64_t a, uint64_t b) {
+  return a > b ? a - b : b - a;
+}
+
+static void test_converge(void) {
+  powercap_rapl_pkg pkg;
+  powercap_rapl_split split;
+  powercap_rapl_split_config cfg;
+  uint32_t i;
+  memset(&pkg, 0, sizeof(pkg));
+  make_zone(&pkg.pkg, "100000000\n");
+  make_zone(&pkg.dram, "40000000\n");
+  powercap_rapl_split_config_default(&cfg);
+  cfg.budget_uw = BUDGET_UW;
+  cfg.dram_min_power_uw = 5000000;
+  cfg.dram_max_power_uw = 60000000;
+  assert(powercap_rapl_split_init(&split, &pkg, &cfg) == 0);
+  /* starts from the current DRAM limit, package gets the rest */
+  assert(split.dram_limit_uw == 40000000);
+  assert(split.pkg_limit_uw == 80000000);
+  assert(read_file(pkg.pkg.constraint_long.power_limit_uw) == 80000000);
+
+  /* balanced at 2 * (120 - d) == 10 * d, i.e., d = 20 W */
+  run(&split, 2, 10);
+  assert(distance(split.dram_limit_uw, 20000000) <= split.config.budget_uw / 64);
+  assert(split.phases == 0);
+
+  /* steady progress holds the split */
+  for (i = 0; i < 10; i++) {
+    assert(powercap_rapl_split_update_power(&split, app_perf(&split, 2, 10), split.pkg_limit_uw,
+                                            split.dram_limit_uw) == 0);
+    assert(split.converged);
+  }
+
+  /* memory-heavier phase: balanced at 2 * (120 - d) == 5 * d, i.e., d = 34.3 W */
+  assert(powercap_rapl_split_update_power(&split, app_perf(&split, 2, 5), split.pkg_limit_uw,
+                                          split.dram_limit_uw) == 0);
+  assert(!split.converged);
+  assert(split.phases == 1);
+  run(&split, 2, 5);
+  assert(distance(split.dram_limit_uw, 34285714) <= split.config.budget_uw / 64);
+
+  close_zone(&pkg.pkg);
+  close_zone(&pkg.dram);
+}
+
+static void test_prune(void) {
+  powercap_rapl_pkg pkg;
+  powercap_rapl_split split;
+  powercap_rapl_split_config cfg;
+  uint32_t i;
+  memset(&pkg, 0, sizeof(pkg));
+  make_zone(&pkg.pkg, "100000000\n");
+  make_zone(&pkg.dram, "20000000\n");
+  powercap_rapl_split_config_default(&cfg);
+  cfg.budget_uw = BUDGET_UW;
+  assert(powercap_rapl_split_init(&split, &pkg, &cfg) == 0);
+  /* DRAM never uses more than 10 W, so it's never offered more than its current limit */
+  for (i = 0; i < MAX_PERIODS && !split.converged; i++) {
+    assert(powercap_rapl_split_update_power(&split, 100, split.pkg_limit_uw,
+                                            split.dram_limit_uw < 10000000 ? split.dram_limit_uw : 10000000) == 0);
+    assert(split.dram_limit_uw <= 20000000);
+  }
+  assert(split.converged);
+  assert(split.dram_limit_uw == 20000000);
+
+  /* a new budget keeps the split ratio */
+  assert(powercap_rapl_split_set_budget(&split, BUDGET_UW / 2) == 0);
+  assert(!split.converged);
+  assert(split.dram_limit_uw == 10000000);
+  assert(split.pkg_limit_uw == 50000000);
+
+  close_zone(&pkg.pkg);
+  close_zone(&pkg.dram);
+}
+
+static void test_bad_params(void) {
+  powercap_rapl_pkg pkg;
+  powercap_rapl_split split;
+  powercap_rapl_split_config cfg;
+  memset(&pkg, 0, sizeof(pkg));
+  make_zone(&pkg.pkg, "100000000\n");
+  powercap_rapl_split_config_default(&cfg);
+  cfg.budget_uw = BUDGET_UW;
+  /* no DRAM zone */
+  errno = 0;
+  assert(powercap_rapl_split_init(&split, &pkg, &cfg) == -ENOTSUP);
+  assert(errno == ENOTSUP);
+  make_zone(&pkg.dram, "20000000\n");
+  assert(powercap_rapl_split_init(NULL, &pkg, &cfg) == -EINVAL);
+  assert(powercap_rapl_split_init(&split, NULL, &cfg) == -EINVAL);
+  assert(powercap_rapl_split_init(&split, &pkg, NULL) == -EINVAL);
+  cfg.cap_threshold = 0;
+  assert(powercap_rapl_split_init(&split, &pkg, &cfg) == -EINVAL);
+  cfg.cap_threshold = 0.9;
+  /* budget can't cover the minimums */
+  cfg.pkg_min_power_uw = 100000000;
+  cfg.dram_min_power_uw = 30000000;
+  assert(powercap_rapl_split_init(&split, &pkg, &cfg) == -EINVAL);
+  cfg.pkg_min_power_uw = 0;
+  cfg.dram_min_power_uw = 0;
+  assert(powercap_rapl_split_init(&split, &pkg, &cfg) == 0);
+  assert(powercap_rapl_split_set_budget(&split, 0) == -EINVAL);
+  assert(powercap_rapl_split_update_power(&split, -1, 0, 0) == -EINVAL);
+  close_zone(&pkg.pkg);
+  close_zone(&pkg.dram);
+}
+
+int main(void) {
+  test_converge();
+  test_prune();
+  test_bad_params();
+  return 0;
+}
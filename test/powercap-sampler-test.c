@@ -0,0 +1,222 @@
+/**
+ * Sampler tests.
+ * Uses temporary files in place of sysfs files.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap.h"
+#include "powercap-sampler.h"
+#include "powercap-test-common.h"
+
+static void sleep_ms(long ms) {
+  struct timespec ts;
+  ts.tv_sec = 0;
+  ts.tv_nsec = ms * 1000000;
+  nanosleep(&ts, NULL);
+}
+
+static void test_sample(void) {
+  powercap_sampler sampler;
+  powercap_sampler_snapshot snap;
+  powercap_zone zone;
+  powercap_constraint constraints[2];
+  memset(&zone, 0, sizeof(zone));
+  memset(constraints, 0, sizeof(constraints));
+  zone.energy_uj = make_file("1000\n");
+  zone.max_energy_range_uj = make_file("10000\n");
+  zone.enabled = make_file("1\n");
+  zone.name = make_file("package-0\n");
+  constraints[0].power_limit_uw = make_file("50000000\n");
+  constraints[0].time_window_us = make_file("976\n");
+  constraints[0].max_power_uw = make_file("95000000\n");
+  constraints[0].name = make_file("long_term\n");
+  constraints[1].power_limit_uw = make_file("60000000\n");
+
+  assert(powercap_sampler_init(&sampler) == 0);
+  assert(powercap_sampler_add_zone_fds(&sampler, NULL, &zone, constraints, 2) == 0);
+  assert(sampler.nzones == 1);
+  assert(sampler.nconstraints == 2);
+  /* static values */
+  assert(strcmp(sampler.zones[0].name, "package-0") == 0);
+  assert(sampler.zones[0].max_energy_range_uj == 10000);
+  assert(sampler.zones[0].max_power_range_uw == 0);
+  assert(strcmp(sampler.zones[0].constraints[0].name, "long_term") == 0);
+  assert(sampler.zones[0].constraints[0].max_power_uw == 95000000);
+  assert(sampler.zones[0].constraints[0].min_power_uw == 0);
+  assert(sampler.zones[0].constraints[1].name[0] == '\0');
+
+  assert(powercap_sampler_snapshot_init(&sampler, &snap) == 0);
+  assert(powercap_sampler_sample(&sampler, &snap, POWERCAP_SAMPLER_READ_ALL) == 0);
+  assert(snap.elapsed_ns == 0);
+  /* no power yet, and there's no power_uw file */
+  assert(snap.zones[0].valid == (POWERCAP_SAMPLER_ZONE_ENERGY | POWERCAP_SAMPLER_ZONE_ENABLED));
+  assert(snap.zones[0].energy_uj == 1000);
+  assert(snap.zones[0].total_energy_uj == 0);
+  assert(snap.zones[0].enabled == 1);
+  assert(snap.constraints[0].valid ==
+         (POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT | POWERCAP_SAMPLER_CONSTRAINT_TIME_WINDOW));
+  assert(snap.constraints[0].power_limit_uw == 50000000);
+  assert(snap.constraints[0].time_window_us == 976);
+  assert(snap.constraints[1].valid == POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT);
+  assert(snap.constraints[1].power_limit_uw == 60000000);
+
+  sleep_ms(10);
+  write_file(zone.energy_uj, "9000\n");
+  write_file(constraints[1].power_limit_uw, "40000000\n");
+  assert(powercap_sampler_sample(&sampler, &snap, POWERCAP_SAMPLER_READ_ALL) == 0);
+  assert(snap.elapsed_ns >= 10000000);
+  assert(snap.zones[0].valid & POWERCAP_SAMPLER_ZONE_POWER);
+  assert(snap.zones[0].total_energy_uj == 8000);
+  /* 8 mJ in at least 10 ms */
+  assert(snap.zones[0].power_uw > 0 && snap.zones[0].power_uw <= 800000);
+  assert(snap.constraints[1].power_limit_uw == 40000000);
+
+  /* counter overflow */
+  write_file(zone.energy_uj, "500\n");
+  assert(powercap_sampler_sample(&sampler, &snap, POWERCAP_SAMPLER_READ_ENERGY) == 0);
+  assert(snap.zones[0].energy_uj == 500);
+  assert(snap.zones[0].total_energy_uj == 9500);
+  /* limits weren't requested */
+  assert(!(snap.zones[0].valid & POWERCAP_SAMPLER_ZONE_ENABLED));
+  assert(snap.constraints[0].valid == 0);
+
+  assert(powercap_sampler_snapshot_destroy(&snap) == 0);
+  /* closes the files */
+  assert(powercap_sampler_destroy(&sampler) == 0);
+  assert(sampler.nzones == 0);
+}
+
+/* Create a file (and its parent directories) under root */
+static void make_path(const char* root, const char* rel, const char* contents) {
+  char path[PATH_MAX];
+  FILE* f;
+  char* p;
+  snprintf(path, sizeof(path), "%s/%s", root, rel);
+  for (p = strchr(path + strlen(root) + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+    *p = '\0';
+    mkdir(path, 0700);
+    *p = '/';
+  }
+  assert((f = fopen(path, "w")) != NULL);
+  fputs(contents, f);
+  assert(fclose(f) == 0);
+}
+
+static void remove_tree(const char* root) {
+  char cmd[PATH_MAX + 16];
+  snprintf(cmd, sizeof(cmd), "rm -rf '%s'", root);
+  assert(system(cmd) == 0);
+}
+
+static void test_telemetry(void) {
+  char cpu_root[] = "/tmp/powercap-sampler-test-XXXXXX";
+  char thermal_root[] = "/tmp/powercap-sampler-test-XXXXXX";
+  powercap_sampler sampler;
+  powercap_sampler_snapshot snap;
+  powercap_zone zone;
+
+  assert(mkdtemp(cpu_root) != NULL);
+  assert(mkdtemp(thermal_root) != NULL);
+  /* cpu10 sorts before cpu2 in a listing */
+  make_path(cpu_root, "cpu10/cpufreq/scaling_cur_freq", "3000000\n");
+  make_path(cpu_root, "cpu2/cpufreq/scaling_cur_freq", "1200000\n");
+  make_path(cpu_root, "cpu2/cpuidle/state0/name", "POLL\n");
+  make_path(cpu_root, "cpu2/cpuidle/state0/time", "100\n");
+  make_path(cpu_root, "cpu2/cpuidle/state0/usage", "5\n");
+  make_path(cpu_root, "cpu2/cpuidle/state1/name", "C1\n");
+  make_path(cpu_root, "cpu2/cpuidle/state1/time", "20000\n");
+  /* offline: no cpufreq, but not an error */
+  make_path(cpu_root, "cpu3/online", "0\n");
+  /* not CPUs */
+  make_path(cpu_root, "cpufreq/policy0/scaling_cur_freq", "1\n");
+  make_path(cpu_root, "cpuidle/current_driver", "intel_idle\n");
+  make_path(thermal_root, "thermal_zone1/type", "x86_pkg_temp\n");
+  make_path(thermal_root, "thermal_zone1/temp", "45000\n");
+  make_path(thermal_root, "thermal_zone0/type", "acpitz\n");
+  make_path(thermal_root, "thermal_zone0/temp", "-2500\n");
+  make_path(thermal_root, "cooling_device0/type", "Processor\n");
+
+  memset(&zone, 0, sizeof(zone));
+  zone.energy_uj = make_file("1000\n");
+  assert(powercap_sampler_init(&sampler) == 0);
+  assert(powercap_sampler_add_zone_fds(&sampler, "package-0", &zone, NULL, 0) == 0);
+  assert(powercap_sampler_add_cpufreq(&sampler, cpu_root) == 0);
+  assert(powercap_sampler_add_cpuidle(&sampler, cpu_root) == 0);
+  assert(powercap_sampler_add_thermal(&sampler, thermal_root) == 0);
+  assert(sampler.ncpufreqs == 2 && sampler.cpufreqs[0].cpu == 2 && sampler.cpufreqs[1].cpu == 10);
+  assert(sampler.ncpuidles == 2);
+  assert(sampler.cpuidles[1].cpu == 2 && sampler.cpuidles[1].state == 1 && !strcmp(sampler.cpuidles[1].name, "C1"));
+  assert(sampler.nthermals == 2 && sampler.thermals[0].zone == 0 && !strcmp(sampler.thermals[0].type, "acpitz"));
+  /* not added twice */
+  assert(powercap_sampler_add_cpufreq(&sampler, cpu_root) == -EEXIST);
+  assert(powercap_sampler_add_cpuidle(&sampler, cpu_root) == -EEXIST);
+  assert(powercap_sampler_add_thermal(&sampler, thermal_root) == -EEXIST);
+  assert(sampler.ncpufreqs == 2 && sampler.ncpuidles == 2 && sampler.nthermals == 2);
+  /* the files are held open */
+  remove_tree(cpu_root);
+  remove_tree(thermal_root);
+
+  assert(powercap_sampler_snapshot_init(&sampler, &snap) == 0);
+  assert(powercap_sampler_sample(&sampler, &snap, POWERCAP_SAMPLER_READ_ALL) == 0);
+  assert(snap.end_ns >= snap.time_ns);
+  assert(snap.zones[0].valid == POWERCAP_SAMPLER_ZONE_ENERGY);
+  assert(snap.cpufreqs[0].valid == POWERCAP_SAMPLER_CPUFREQ_FREQ && snap.cpufreqs[0].freq_khz == 1200000);
+  assert(snap.cpufreqs[1].freq_khz == 3000000);
+  assert(snap.cpuidles[0].valid == (POWERCAP_SAMPLER_CPUIDLE_TIME | POWERCAP_SAMPLER_CPUIDLE_USAGE));
+  assert(snap.cpuidles[0].time_us == 100 && snap.cpuidles[0].usage == 5);
+  assert(snap.cpuidles[1].valid == POWERCAP_SAMPLER_CPUIDLE_TIME && snap.cpuidles[1].time_us == 20000);
+  assert(snap.thermals[0].valid == POWERCAP_SAMPLER_THERMAL_TEMP && snap.thermals[0].temp_mc == -2500);
+  assert(snap.thermals[1].temp_mc == 45000);
+
+  /* only what's requested */
+  assert(powercap_sampler_sample(&sampler, &snap, POWERCAP_SAMPLER_READ_ENERGY | POWERCAP_SAMPLER_READ_THERMAL) == 0);
+  assert(snap.cpufreqs[0].valid == 0 && snap.cpuidles[0].valid == 0);
+  assert(snap.thermals[1].valid == POWERCAP_SAMPLER_THERMAL_TEMP);
+
+  assert(powercap_sampler_snapshot_destroy(&snap) == 0);
+  assert(powercap_sampler_destroy(&sampler) == 0);
+  assert(sampler.ncpufreqs == 0 && sampler.cpufreqs == NULL);
+}
+
+static void test_bad_params(void) {
+  powercap_sampler sampler;
+  powercap_sampler_snapshot snap;
+  powercap_zone zone;
+  memset(&zone, 0, sizeof(zone));
+  assert(powercap_sampler_init(NULL) == -EINVAL);
+  assert(powercap_sampler_init(&sampler) == 0);
+  assert(powercap_sampler_add_zone(&sampler, NULL, NULL, 0) == -EINVAL);
+  assert(powercap_sampler_add_zone_fds(&sampler, NULL, NULL, NULL, 0) == -EINVAL);
+  assert(powercap_sampler_add_zone_fds(&sampler, NULL, &zone, NULL, 1) == -EINVAL);
+  /* control type doesn't exist */
+  assert(powercap_sampler_add_zone_tree(&sampler, "foo", NULL, 0, 1) == 0);
+  assert(powercap_sampler_add_zone(&sampler, "foo", NULL, 0) == -ENOSYS);
+  assert(sampler.nzones == 0);
+  assert(powercap_sampler_snapshot_init(&sampler, &snap) == 0);
+  assert(powercap_sampler_sample(&sampler, &snap, POWERCAP_SAMPLER_READ_ALL) == 0);
+  /* snapshot no longer matches the sampler */
+  assert(powercap_sampler_add_zone_fds(&sampler, "fake", &zone, NULL, 0) == 0);
+  assert(strcmp(sampler.zones[0].name, "fake") == 0);
+  assert(powercap_sampler_sample(&sampler, &snap, POWERCAP_SAMPLER_READ_ALL) == -EINVAL);
+  assert(powercap_sampler_snapshot_destroy(&snap) == 0);
+  assert(powercap_sampler_add_cpufreq(NULL, NULL) == -EINVAL);
+  assert(powercap_sampler_add_cpuidle(&sampler, "/nonexistent/powercap-sampler-test") == -ENOENT);
+  assert(powercap_sampler_add_thermal(&sampler, "/nonexistent/powercap-sampler-test") == -ENOENT);
+  assert(powercap_sampler_destroy(&sampler) == 0);
+}
+
+int main(void) {
+  test_sample();
+  test_telemetry();
+  test_bad_params();
+  return 0;
+}
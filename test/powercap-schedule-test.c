@@ -0,0 +1,179 @@
+/**
+ * Schedule tests.
+ * Uses temporary files in place of sysfs files.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap.h"
+#include "powercap-schedule.h"
+#include "powercap-test-common.h"
+
+static void make_constraint(powercap_constraint* c) {
+  memset(c, 0, sizeof(*c));
+  c->power_limit_uw = make_file("50000000\n");
+  c->time_window_us = make_file("1000000\n");
+  c->max_power_uw = make_file("100000000\n");
+}
+
+static void test_parse(void) {
+  static char text[] =
+    "# offset target limit window\n"
+    "0 0 40000000\n"
+    "\n"
+    "  1000 1 - 2000   # comment\n"
+    "0x10 0 30000000 -\n";
+  powercap_schedule_step* steps;
+  uint32_t nsteps;
+  uint32_t bad = 0;
+  FILE* f = fmemopen(text, sizeof(text) - 1, "r");
+  assert(f != NULL);
+  assert(powercap_schedule_parse(f, &steps, &nsteps, &bad) == 0);
+  fclose(f);
+  assert(nsteps == 3);
+  assert(steps[0].offset_us == 0 && steps[0].target == 0 && steps[0].power_limit_uw == 40000000);
+  assert(steps[0].time_window_us == POWERCAP_SCHEDULE_UNCHANGED);
+  assert(steps[1].offset_us == 1000 && steps[1].target == 1);
+  assert(steps[1].power_limit_uw == POWERCAP_SCHEDULE_UNCHANGED && steps[1].time_window_us == 2000);
+  assert(steps[2].offset_us == 16 && steps[2].time_window_us == POWERCAP_SCHEDULE_UNCHANGED);
+  free(steps);
+}
+
+static void test_parse_errors(void) {
+  static const char* bad_texts[] = {
+    "0 0\n",
+    "0 0 1 2 3\n",
+    "-1 0 1\n",
+    "0 - 1\n",
+    "0 0 1x\n",
+    "0 4294967296 1\n",
+    /* would overflow when converted to nanoseconds */
+    "18446744073709552 0 1\n",
+    "4611686018427388 0 1\n",
+  };
+  powercap_schedule_step* steps;
+  uint32_t nsteps;
+  uint32_t bad;
+  uint32_t i;
+  FILE* f;
+  char text[512];
+  for (i = 0; i < sizeof(bad_texts) / sizeof(bad_texts[0]); i++) {
+    snprintf(text, sizeof(text), "0 0 1\n%s", bad_texts[i]);
+    assert((f = fmemopen(text, strlen(text), "r")) != NULL);
+    bad = 0;
+    assert(powercap_schedule_parse(f, &steps, &nsteps, &bad) == -EINVAL);
+    assert(bad == 2);
+    fclose(f);
+  }
+  /* too long, rather than split into two steps */
+  snprintf(text, sizeof(text), "0 0 1\n1 0 1%*s2 0 1\n", 300, "");
+  assert((f = fmemopen(text, strlen(text), "r")) != NULL);
+  bad = 0;
+  assert(powercap_schedule_parse(f, &steps, &nsteps, &bad) == -EINVAL);
+  assert(bad == 2);
+  fclose(f);
+}
+
+static void test_validate_run(void) {
+  powercap_constraint c[2];
+  const powercap_constraint* targets[2] = { &c[0], &c[1] };
+  powercap_schedule_step steps[3];
+  powercap_schedule_result results[3];
+  powercap_schedule sched;
+  uint32_t bad;
+  uint32_t i;
+  make_constraint(&c[0]);
+  make_constraint(&c[1]);
+  assert(powercap_schedule_init(&sched, targets, 2) == 0);
+  assert(sched.bounds[0].max_power_uw == 100000000);
+  assert(sched.bounds[0].min_power_uw == 0);
+  assert(sched.bounds[0].max_time_window_us == UINT64_MAX);
+
+  steps[0].offset_us = 0;
+  steps[0].target = 0;
+  steps[0].power_limit_uw = 40000000;
+  steps[0].time_window_us = POWERCAP_SCHEDULE_UNCHANGED;
+  steps[1].offset_us = 20000;
+  steps[1].target = 1;
+  steps[1].power_limit_uw = 30000000;
+  steps[1].time_window_us = 2000;
+  steps[2].offset_us = 40000;
+  steps[2].target = 0;
+  steps[2].power_limit_uw = POWERCAP_SCHEDULE_UNCHANGED;
+  steps[2].time_window_us = 3000;
+  assert(powercap_schedule_validate(&sched, steps, 3, &bad) == 0);
+
+  /* above max_power_uw */
+  steps[1].power_limit_uw = 100000001;
+  assert(powercap_schedule_validate(&sched, steps, 3, &bad) == -EINVAL);
+  assert(bad == 1);
+  /* nothing was written */
+  assert(powercap_schedule_run(&sched, steps, 3, results) == -EINVAL);
+  assert(read_file(c[0].power_limit_uw) == 50000000);
+  steps[1].power_limit_uw = 30000000;
+  /* out of order */
+  steps[2].offset_us = 10000;
+  assert(powercap_schedule_validate(&sched, steps, 3, &bad) == -EINVAL);
+  assert(bad == 2);
+  steps[2].offset_us = 40000;
+  /* no such target */
+  steps[0].target = 2;
+  assert(powercap_schedule_validate(&sched, steps, 3, &bad) == -EINVAL);
+  assert(bad == 0);
+  steps[0].target = 0;
+  /* too far in the future to schedule */
+  steps[2].offset_us = UINT64_MAX / 1000 + 1;
+  assert(powercap_schedule_validate(&sched, steps, 3, &bad) == -EINVAL);
+  assert(bad == 2);
+  steps[2].offset_us = 40000;
+
+  sched.spin_us = 100;
+  assert(powercap_schedule_run(&sched, steps, 3, results) == 0);
+  assert(read_file(c[0].power_limit_uw) == 40000000);
+  assert(read_file(c[0].time_window_us) == 3000);
+  assert(read_file(c[1].power_limit_uw) == 30000000);
+  assert(read_file(c[1].time_window_us) == 2000);
+  for (i = 0; i < 3; i++) {
+    assert(results[i].planned_ns == (int64_t) steps[i].offset_us * 1000);
+    assert(results[i].actual_ns >= results[i].planned_ns);
+    assert(results[i].write_ns >= 0);
+  }
+  assert(powercap_schedule_destroy(&sched) == 0);
+  close_constraint(&c[0]);
+  close_constraint(&c[1]);
+}
+
+static void test_bad_params(void) {
+  powercap_constraint c;
+  const powercap_constraint* targets[2] = { &c, NULL };
+  powercap_schedule sched;
+  powercap_schedule_step* steps;
+  uint32_t nsteps;
+  make_constraint(&c);
+  assert(powercap_schedule_init(NULL, targets, 1) == -EINVAL);
+  assert(powercap_schedule_init(&sched, NULL, 1) == -EINVAL);
+  assert(powercap_schedule_init(&sched, targets, 0) == -EINVAL);
+  assert(powercap_schedule_init(&sched, targets, 2) == -EINVAL);
+  assert(sched.bounds == NULL);
+  assert(powercap_schedule_validate(&sched, NULL, 0, NULL) == -EINVAL);
+  assert(powercap_schedule_init(&sched, targets, 1) == 0);
+  assert(powercap_schedule_validate(&sched, NULL, 1, NULL) == -EINVAL);
+  assert(powercap_schedule_run(&sched, NULL, 0, NULL) == 0);
+  assert(powercap_schedule_parse(NULL, &steps, &nsteps, NULL) == -EINVAL);
+  assert(powercap_schedule_destroy(&sched) == 0);
+  assert(powercap_schedule_destroy(NULL) == -EINVAL);
+  close_constraint(&c);
+}
+
+int main(void) {
+  test_parse();
+  test_parse_errors();
+  test_validate_run();
+  test_bad_params();
+  return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * Instrumentation tests.
+ * Uses temporary files in place of sysfs files.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap.h"
+#include "powercap-stats.h"
+#include "powercap-test-common.h"
+
+static uint64_t hist_sum(const uint64_t* hist) {
+  uint64_t sum = 0;
+  uint32_t i;
+  for (i = 0; i < POWERCAP_STATS_HIST_BUCKETS; i++) {
+    sum += hist[i];
+  }
+  return sum;
+}
+
+static void test_disabled(void) {
+  powercap_zone zone;
+  powercap_stats_file s;
+  uint64_t val;
+  memset(&zone, 0, sizeof(zone));
+  zone.energy_uj = make_file("1000\n");
+  powercap_stats_reset();
+  powercap_stats_set_enabled(0);
+  assert(!powercap_stats_is_enabled());
+  assert(powercap_zone_get_energy_uj(&zone, &val) == 0);
+  assert(val == 1000);
+  assert(powercap_stats_get_zone_file(POWERCAP_ZONE_FILE_ENERGY_UJ, &s) == 0);
+  assert(s.reads == 0);
+  assert(s.bytes_read == 0);
+  close(zone.energy_uj);
+}
+
+static void test_zone_reads(void) {
+  powercap_zone zone;
+  powercap_stats_file s;
+  uint64_t val;
+  memset(&zone, 0, sizeof(zone));
+  zone.energy_uj = make_file("1000\n");
+  zone.max_energy_range_uj = make_file("not a number\n");
+  powercap_stats_reset();
+  powercap_stats_set_enabled(1);
+  assert(powercap_stats_is_enabled());
+  assert(powercap_zone_get_energy_uj(&zone, &val) == 0);
+  assert(powercap_zone_get_energy_uj(&zone, &val) == 0);
+  assert(powercap_zone_get_max_energy_range_uj(&zone, &val) < 0);
+  powercap_stats_set_enabled(0);
+
+  assert(powercap_stats_get_zone_file(POWERCAP_ZONE_FILE_ENERGY_UJ, &s) == 0);
+  assert(s.reads == 2);
+  assert(s.read_errors == 0);
+  assert(s.parse_errors == 0);
+  assert(s.bytes_read == 2 * strlen("1000\n"));
+  assert(hist_sum(s.read_ns_hist) == 2);
+  assert(s.writes == 0);
+
+  assert(powercap_stats_get_zone_file(POWERCAP_ZONE_FILE_MAX_ENERGY_RANGE_UJ, &s) == 0);
+  assert(s.reads == 1);
+  assert(s.parse_errors == 1);
+
+  /* a closed descriptor is a read error */
+  close(zone.energy_uj);
+  powercap_stats_set_enabled(1);
+  assert(powercap_zone_get_energy_uj(&zone, &val) < 0);
+  powercap_stats_set_enabled(0);
+  assert(powercap_stats_get_zone_file(POWERCAP_ZONE_FILE_ENERGY_UJ, &s) == 0);
+  assert(s.reads == 3);
+  assert(s.read_errors == 1);
+  close(zone.max_energy_range_uj);
+}
+
+static void test_constraint_writes(void) {
+  powercap_constraint constraint;
+  powercap_stats_file s;
+  memset(&constraint, 0, sizeof(constraint));
+  constraint.power_limit_uw = make_file("0\n");
+  powercap_stats_reset();
+  powercap_stats_set_enabled(1);
+  assert(powercap_constraint_set_power_limit_uw(&constraint, 50000000) == 0);
+  powercap_stats_set_enabled(0);
+  assert(powercap_stats_get_constraint_file(POWERCAP_CONSTRAINT_FILE_POWER_LIMIT_UW, &s) == 0);
+  assert(s.writes == 1);
+  assert(s.write_errors == 0);
+  assert(s.bytes_written > 0);
+  assert(hist_sum(s.write_ns_hist) == 1);
+  assert(s.reads == 0);
+  /* reset clears everything */
+  powercap_stats_reset();
+  assert(powercap_stats_get_constraint_file(POWERCAP_CONSTRAINT_FILE_POWER_LIMIT_UW, &s) == 0);
+  assert(s.writes == 0);
+  assert(s.bytes_written == 0);
+  close(constraint.power_limit_uw);
+}
+
+static void test_fprint(void) {
+  powercap_zone zone;
+  uint64_t val;
+  char buf[4096];
+  size_t n;
+  FILE* f = tmpfile();
+  assert(f != NULL);
+  memset(&zone, 0, sizeof(zone));
+  zone.energy_uj = make_file("1000\n");
+  powercap_stats_reset();
+  powercap_stats_set_enabled(1);
+  assert(powercap_zone_get_energy_uj(&zone, &val) == 0);
+  powercap_stats_set_enabled(0);
+  assert(powercap_stats_fprint(f) == 0);
+  rewind(f);
+  n = fread(buf, 1, sizeof(buf) - 1, f);
+  buf[n] = '\0';
+  assert(strstr(buf, "energy_uj\n") != NULL);
+  assert(strstr(buf, "reads: 1") != NULL);
+  /* inactive files are omitted */
+  assert(strstr(buf, "power_limit_uw") == NULL);
+  fclose(f);
+  close(zone.energy_uj);
+}
+
+static void test_bad_params(void) {
+  powercap_stats_file s;
+  errno = 0;
+  assert(powercap_stats_get_zone_file(POWERCAP_ZONE_FILE_ENERGY_UJ, NULL) == -EINVAL);
+  assert(errno == EINVAL);
+  errno = 0;
+  assert(powercap_stats_get_zone_file((powercap_zone_file) -1, &s) == -EINVAL);
+  assert(errno == EINVAL);
+  errno = 0;
+  assert(powercap_stats_get_constraint_file((powercap_constraint_file) (POWERCAP_CONSTRAINT_FILE_NAME + 1), &s) == -EINVAL);
+  assert(errno == EINVAL);
+  errno = 0;
+  assert(powercap_stats_fprint(NULL) == -EINVAL);
+  assert(errno == EINVAL);
+}
+
+int main(void) {
+  test_disabled();
+  test_zone_reads();
+  test_constraint_writes();
+  test_fprint();
+  test_bad_params();
+  return 0;
+}
@@ -248,11 +248,47 @@ static void test_get_set_constraint_all_bad(void) {
 #endif
 }
 
+static void test_open_close_bad(void) {
+  powercap_zone zone;
+  powercap_constraint constraint;
+  uint32_t zones[2];
+  zones[0] = 0;
+  zones[1] = 0;
+  /* bad parameters */
+  errno = 0;
+  assert(powercap_sysfs_zone_open(NULL, "foo", zones, 2, 1) == -EINVAL);
+  assert(errno == EINVAL);
+  errno = 0;
+  assert(powercap_sysfs_zone_open(&zone, NULL, zones, 2, 1) == -EINVAL);
+  assert(errno == EINVAL);
+  errno = 0;
+  assert(powercap_sysfs_constraint_open(NULL, "foo", zones, 2, 0, 1) == -EINVAL);
+  assert(errno == EINVAL);
+  errno = 0;
+  assert(powercap_sysfs_zone_close(NULL) == -EINVAL);
+  assert(errno == EINVAL);
+  errno = 0;
+  assert(powercap_sysfs_constraint_close(NULL) == -EINVAL);
+  assert(errno == EINVAL);
+  /* good parameters, bad control type; nothing is left open */
+  errno = 0;
+  assert(powercap_sysfs_zone_open(&zone, "foo", zones, 2, 1) == -ENOSYS);
+  assert(errno == ENOSYS);
+  assert(zone.energy_uj == 0);
+  assert(powercap_sysfs_zone_close(&zone) == 0);
+  errno = 0;
+  assert(powercap_sysfs_constraint_open(&constraint, "foo", zones, 2, 0, 1) == -ENOSYS);
+  assert(errno == ENOSYS);
+  assert(constraint.power_limit_uw == 0);
+  assert(powercap_sysfs_constraint_close(&constraint) == 0);
+}
+
 int main(void) {
   test_bad_control_type_exists();
   test_bad_zone_exists();
   test_bad_constraint_exists();
   test_get_set_zone_all_bad();
   test_get_set_constraint_all_bad();
+  test_open_close_bad();
   return 0;
 }
@@ -0,0 +1,70 @@
+/**
+ * Test fixtures shared by the tests that use temporary files in place of sysfs files.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap-rapl.h"
+#include "powercap-test-common.h"
+
+int make_file(const char* contents) {
+  char path[] = "/tmp/powercap-test-XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  unlink(path);
+  if (contents != NULL) {
+    assert(pwrite(fd, contents, strlen(contents), 0) == (ssize_t) strlen(contents));
+  }
+  return fd;
+}
+
+void write_file(int fd, const char* contents) {
+  assert(ftruncate(fd, 0) == 0);
+  assert(pwrite(fd, contents, strlen(contents), 0) == (ssize_t) strlen(contents));
+}
+
+uint64_t read_file(int fd) {
+  char buf[32] = { 0 };
+  assert(pread(fd, buf, sizeof(buf) - 1, 0) > 0);
+  return strtoull(buf, NULL, 0);
+}
+
+void close_file(int* fd) {
+  if (*fd > 0) {
+    close(*fd);
+  }
+  *fd = 0;
+}
+
+void close_constraint(powercap_constraint* c) {
+  close_file(&c->power_limit_uw);
+  close_file(&c->time_window_us);
+  close_file(&c->max_power_uw);
+  close_file(&c->min_power_uw);
+  close_file(&c->max_time_window_us);
+  close_file(&c->min_time_window_us);
+  close_file(&c->name);
+}
+
+void close_zone(powercap_rapl_zone_files* zone) {
+  close_file(&zone->zone.max_energy_range_uj);
+  close_file(&zone->zone.energy_uj);
+  close_file(&zone->zone.max_power_range_uw);
+  close_file(&zone->zone.power_uw);
+  close_file(&zone->zone.enabled);
+  close_file(&zone->zone.name);
+  close_constraint(&zone->constraint_long);
+  close_constraint(&zone->constraint_short);
+}
+
+void close_pkg(powercap_rapl_pkg* pkg) {
+  close_zone(&pkg->pkg);
+  close_zone(&pkg->core);
+  close_zone(&pkg->uncore);
+  close_zone(&pkg->dram);
+  close_zone(&pkg->psys);
+}
@@ -0,0 +1,29 @@
+/**
+ * Test fixtures shared by the tests that use temporary files in place of sysfs files.
+ * The files are unlinked as soon as they're created, so they're removed when their descriptors are closed.
+ */
+#ifndef _POWERCAP_TEST_COMMON_H_
+#define _POWERCAP_TEST_COMMON_H_
+
+#include <stdint.h>
+#include "powercap-rapl.h"
+
+/* Create a temporary file with the given contents (empty if NULL) and return its descriptor */
+int make_file(const char* contents);
+
+/* Replace a file's contents */
+void write_file(int fd, const char* contents);
+
+uint64_t read_file(int fd);
+
+/* Descriptors of 0 are unopened */
+void close_file(int* fd);
+
+void close_constraint(powercap_constraint* c);
+
+void close_zone(powercap_rapl_zone_files* zone);
+
+/* Close every file of a package made of temporary files */
+void close_pkg(powercap_rapl_pkg* pkg);
+
+#endif
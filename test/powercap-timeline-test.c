@@ -0,0 +1,174 @@
+/**
+ * Timeline tests.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap-column.h"
+#include "powercap-timeline.h"
+#include "powercap-test-common.h"
+
+#define SAMPLES 5000
+#define QUERIES 100000
+
+static void assert_close(double val, double expected) {
+  double tol = expected > 1 ? expected * 1e-12 : 1e-12;
+  assert(val - expected <= tol && expected - val <= tol);
+}
+
+/* The overlap of an interval with the recorded range */
+static int64_t overlap_ns(int64_t start, int64_t end) {
+  const int64_t first = 1000000;
+  const int64_t last = first + (int64_t) (SAMPLES - 1) * 1000000;
+  start = start < first ? first : start;
+  end = end > last ? last : end;
+  return end > start ? end - start : 0;
+}
+
+/* 1 ms samples: zone 0 at 10 W wrapping at 1 J, zone 1 at 1 W for 1 ms then idle, zone 2 reset with no known range */
+static void build(powercap_timeline* tl) {
+  const uint64_t ranges[3] = { 1000000, 0, 0 };
+  uint64_t e[3];
+  int64_t i;
+  assert(powercap_timeline_init(tl, 3, ranges) == 0);
+  for (i = 0; i < SAMPLES; i++) {
+    e[0] = (uint64_t) (i * 10000) % 1000000;
+    e[1] = i ? 1000 : 0;
+    e[2] = i < 2 ? 5000 + (uint64_t) i * 3000 : 100;
+    assert(powercap_timeline_append(tl, 1000000 + i * 1000000, e) == 0);
+  }
+}
+
+static void test_energy(void) {
+  powercap_timeline tl;
+  double e;
+  build(&tl);
+  assert(tl.nsamples == SAMPLES);
+  /* whole samples */
+  assert(powercap_timeline_energy(&tl, 0, 1000000, 3000000, &e) == 0);
+  assert_close(e, 20000);
+  /* interpolated at both ends, across wraps */
+  assert(powercap_timeline_energy(&tl, 0, 1500000, 250250000, &e) == 0);
+  assert_close(e, 2487500);
+  assert(powercap_timeline_energy(&tl, 0, 1200000, 1700000, &e) == 0);
+  assert_close(e, 5000);
+  assert(powercap_timeline_energy(&tl, 0, 7000000, 7000000, &e) == 0);
+  assert_close(e, 0);
+  /* limited to the recorded range */
+  assert(powercap_timeline_energy(&tl, 0, 0, 1000000 + (int64_t) SAMPLES * 1000000, &e) == 0);
+  assert_close(e, (SAMPLES - 1) * 10000.0);
+  assert(powercap_timeline_energy(&tl, 0, INT64_MIN, 500000, &e) == 0);
+  assert_close(e, 0);
+  assert(powercap_timeline_energy(&tl, 1, 1250000, INT64_MAX, &e) == 0);
+  assert_close(e, 750);
+  assert(powercap_timeline_energy(&tl, 1, 2000000, INT64_MAX, &e) == 0);
+  assert_close(e, 0);
+  /* the reset isn't counted as a wrap */
+  assert(powercap_timeline_energy(&tl, 2, 0, INT64_MAX, &e) == 0);
+  assert_close(e, 3000);
+  assert(powercap_timeline_energy(&tl, 0, 2000000, 1000000, &e) == -EINVAL);
+  assert(powercap_timeline_energy(&tl, 3, 0, 1, &e) == -EINVAL);
+  powercap_timeline_destroy(&tl);
+}
+
+static void test_batch(void) {
+  powercap_timeline tl;
+  int64_t* start = malloc(QUERIES * sizeof(int64_t));
+  int64_t* end = malloc(QUERIES * sizeof(int64_t));
+  double* e = malloc(QUERIES * sizeof(double));
+  double single;
+  int64_t overlap;
+  uint32_t seed = 1;
+  size_t k;
+  assert(start != NULL && end != NULL && e != NULL);
+  build(&tl);
+  /* random intervals, with the second half sorted */
+  for (k = 0; k < QUERIES; k++) {
+    seed = seed * 1103515245 + 12345;
+    start[k] = k < QUERIES / 2 ? (int64_t) (seed % (SAMPLES * 1000U)) * 1000 : (int64_t) k * 50000;
+    end[k] = start[k] + (int64_t) (seed >> 16) * 10;
+  }
+  assert(powercap_timeline_energy_batch(&tl, 0, start, end, QUERIES, e) == 0);
+  for (k = 0; k < QUERIES; k += 97) {
+    assert(powercap_timeline_energy(&tl, 0, start[k], end[k], &single) == 0);
+    assert(memcmp(&single, &e[k], sizeof(single)) == 0);
+  }
+  /* constant power, so energy is proportional to the overlap with the recorded range */
+  for (k = 0; k < QUERIES; k++) {
+    overlap = overlap_ns(start[k], end[k]);
+    assert_close(e[k] * 100, (double) overlap);
+  }
+  end[QUERIES - 1] = start[QUERIES - 1] - 1;
+  assert(powercap_timeline_energy_batch(&tl, 0, start, end, QUERIES, e) == -EINVAL);
+  assert(powercap_timeline_energy_batch(&tl, 0, NULL, NULL, 0, NULL) == 0);
+  powercap_timeline_destroy(&tl);
+  free(start);
+  free(end);
+  free(e);
+}
+
+static void test_column(void) {
+  powercap_column_writer w;
+  powercap_column_reader r;
+  powercap_timeline tl;
+  powercap_timeline expected;
+  const uint64_t ranges[2] = { 50000, 0 };
+  uint64_t e[2];
+  int64_t i;
+  int fd = make_file(NULL);
+  assert(powercap_column_writer_init(&w, fd, 2, ranges, 64) == 0);
+  assert(powercap_timeline_init(&expected, 2, ranges) == 0);
+  for (i = 0; i < 1000; i++) {
+    e[0] = (uint64_t) (i * i) % 50001;
+    e[1] = (uint64_t) i * 7;
+    assert(powercap_column_writer_append(&w, i * 1000 + (i % 3) * 10, e) == 0);
+    assert(powercap_timeline_append(&expected, i * 1000 + (i % 3) * 10, e) == 0);
+  }
+  assert(powercap_column_writer_destroy(&w) == 0);
+  assert(powercap_column_reader_open(&r, fd) == 0);
+  close(fd);
+  assert(powercap_timeline_init(&tl, 2, r.max_energy_range_uj) == 0);
+  assert(powercap_timeline_append_column(&tl, &r) == 0);
+  assert(tl.nsamples == 1000);
+  assert(memcmp(tl.time_ns, expected.time_ns, 1000 * sizeof(int64_t)) == 0);
+  assert(memcmp(tl.energy_uj, expected.energy_uj, 2 * 1000 * sizeof(uint64_t)) == 0);
+  powercap_timeline_destroy(&tl);
+  assert(powercap_timeline_init(&tl, 1, NULL) == 0);
+  assert(powercap_timeline_append_column(&tl, &r) == -EINVAL);
+  powercap_timeline_destroy(&tl);
+  powercap_timeline_destroy(&expected);
+  powercap_column_reader_close(&r);
+}
+
+static void test_bad_params(void) {
+  powercap_timeline tl;
+  uint64_t v = 0;
+  double e;
+  assert(powercap_timeline_init(NULL, 1, NULL) == -EINVAL);
+  assert(powercap_timeline_init(&tl, 0, NULL) == -EINVAL);
+  assert(powercap_timeline_destroy(NULL) == -EINVAL);
+  assert(powercap_timeline_init(&tl, 1, NULL) == 0);
+  assert(powercap_timeline_energy(&tl, 0, 0, 1, &e) == -ENODATA);
+  assert(powercap_timeline_append(NULL, 0, &v) == -EINVAL);
+  assert(powercap_timeline_append(&tl, 0, NULL) == -EINVAL);
+  assert(powercap_timeline_append(&tl, 10, &v) == 0);
+  assert(powercap_timeline_append(&tl, 10, &v) == 0);
+  assert(powercap_timeline_append(&tl, 9, &v) == -EINVAL);
+  assert(powercap_timeline_append_column(&tl, NULL) == -EINVAL);
+  assert(powercap_timeline_energy(&tl, 0, 0, 1, NULL) == -EINVAL);
+  assert(powercap_timeline_energy(NULL, 0, 0, 1, &e) == -EINVAL);
+  powercap_timeline_destroy(&tl);
+}
+
+int main(void) {
+  test_energy();
+  test_batch();
+  test_column();
+  test_bad_params();
+  return 0;
+}
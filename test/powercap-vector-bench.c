@@ -0,0 +1,89 @@
+/**
+ * Benchmark the vector kernels with each available instruction set.
+ *
+ * Usage: powercap-vector-bench [SAMPLES] [ITERATIONS]
+ */
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "powercap-vector.h"
+
+#define DEFAULT_SAMPLES (1 << 22)
+#define DEFAULT_ITERATIONS 20
+#define MAX_RANGE 262143328850ULL
+
+static const char* const isa_names[] = { "scalar", "sse2", "avx2" };
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static void report(const char* kernel, powercap_vector_isa isa, size_t n, int iterations, uint64_t elapsed_ns) {
+  printf("%-8s %-7s %10.1f Msamples/s\n", kernel, isa_names[isa],
+         (double) n * iterations / ((double) elapsed_ns / 1e9) / 1e6);
+}
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? strtoull(argv[1], NULL, 0) : DEFAULT_SAMPLES;
+  int iterations = argc > 2 ? atoi(argv[2]) : DEFAULT_ITERATIONS;
+  powercap_vector_isa best = powercap_vector_get_isa();
+  uint64_t* energy;
+  uint64_t* deltas;
+  int64_t* times;
+  double* power;
+  double min;
+  double max;
+  double mean;
+  uint64_t start;
+  uint32_t seed = 1;
+  size_t i;
+  int isa;
+  int it;
+  if (n < 2 || iterations < 1) {
+    fprintf(stderr, "Usage: powercap-vector-bench [SAMPLES] [ITERATIONS]\n");
+    return EXIT_FAILURE;
+  }
+  energy = malloc(n * sizeof(uint64_t));
+  deltas = malloc(n * sizeof(uint64_t));
+  times = malloc(n * sizeof(int64_t));
+  power = malloc(n * sizeof(double));
+  if (energy == NULL || deltas == NULL || times == NULL || power == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  /* ~50 W sampled every ~1 ms, wrapping periodically */
+  for (i = 0; i < n; i++) {
+    seed = seed * 1103515245 + 12345;
+    energy[i] = i ? (energy[i - 1] + 45000 + (seed >> 16) % 10000) % (MAX_RANGE + 1) : 0;
+    times[i] = i ? times[i - 1] + 1000000 + (int64_t) (seed % 20000) - 10000 : 0;
+  }
+  printf("%zu samples, %d iterations\n", n, iterations);
+  for (isa = POWERCAP_VECTOR_ISA_SCALAR; isa <= (int) best; isa++) {
+    powercap_vector_set_isa((powercap_vector_isa) isa);
+    start = now_ns();
+    for (it = 0; it < iterations; it++) {
+      powercap_vector_energy_deltas(energy, n, MAX_RANGE, deltas);
+    }
+    report("deltas", (powercap_vector_isa) isa, n, iterations, now_ns() - start);
+    start = now_ns();
+    for (it = 0; it < iterations; it++) {
+      powercap_vector_power(deltas, times, n, power);
+    }
+    report("power", (powercap_vector_isa) isa, n, iterations, now_ns() - start);
+    start = now_ns();
+    for (it = 0; it < iterations; it++) {
+      powercap_vector_stats(power, n - 1, &min, &max, &mean);
+    }
+    report("stats", (powercap_vector_isa) isa, n, iterations, now_ns() - start);
+  }
+  printf("min %.0f uW, max %.0f uW, mean %.0f uW\n", min, max, mean);
+  free(energy);
+  free(deltas);
+  free(times);
+  free(power);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/**
+ * Vector kernel tests.
+ * Every available instruction set must give the same results as the scalar kernels.
+ */
+/* force assertions */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap-vector.h"
+
+#define N 1003
+#define MAX_RANGE 262143328850ULL
+
+static uint64_t energy[N];
+static int64_t times[N];
+
+static void make_samples(void) {
+  uint32_t seed = 7;
+  size_t i;
+  for (i = 0; i < N; i++) {
+    seed = seed * 1103515245 + 12345;
+    energy[i] = i ? (energy[i - 1] + (seed >> 8) % 100000) % (MAX_RANGE + 1) : MAX_RANGE - 1000000;
+    times[i] = i ? times[i - 1] + 1000000 + (int64_t) (seed % 5000) : 123456789;
+  }
+  /* an out-of-range counter, a reset with no known range, repeated and decreasing timestamps, a huge delta */
+  energy[100] = MAX_RANGE + 50;
+  energy[501] = 3;
+  times[300] = times[299];
+  times[401] = times[400] - 5;
+  times[702] = times[701] + ((int64_t) 1 << 53);
+  for (i = 703; i < N; i++) {
+    times[i] = times[i - 1] + 1000000;
+  }
+}
+
+static int same(double a, double b) {
+  return !memcmp(&a, &b, sizeof(a));
+}
+
+static uint64_t expected_delta(uint64_t prev, uint64_t cur, uint64_t max_range) {
+  if (cur >= prev) {
+    return cur - prev;
+  }
+  return max_range && prev <= max_range ? max_range - prev + cur : 0;
+}
+
+static void test_isa(powercap_vector_isa isa, const uint64_t* ref_deltas, const double* ref_power, double ref_mean) {
+  uint64_t deltas[N];
+  uint64_t in_place[N];
+  double power[N];
+  double min;
+  double max;
+  double mean;
+  size_t n;
+  size_t i;
+  assert(powercap_vector_set_isa(isa) == 0);
+  assert(powercap_vector_get_isa() == isa);
+  /* every alignment and remainder */
+  for (n = 0; n < 40; n++) {
+    memset(deltas, 0xFF, sizeof(deltas));
+    assert(powercap_vector_energy_deltas(&energy[95 + n % 7], n, MAX_RANGE, deltas) == 0);
+    for (i = 0; i + 1 < n; i++) {
+      assert(deltas[i] == expected_delta(energy[95 + n % 7 + i], energy[95 + n % 7 + i + 1], MAX_RANGE));
+    }
+    assert(n > 1 || deltas[0] == UINT64_MAX);
+  }
+  assert(powercap_vector_energy_deltas(energy, N, MAX_RANGE, deltas) == 0);
+  assert(memcmp(deltas, ref_deltas, (N - 1) * sizeof(uint64_t)) == 0);
+  memcpy(in_place, energy, sizeof(energy));
+  assert(powercap_vector_energy_deltas(in_place, N, MAX_RANGE, in_place) == 0);
+  assert(memcmp(in_place, ref_deltas, (N - 1) * sizeof(uint64_t)) == 0);
+  assert(powercap_vector_energy_deltas(energy, N, 0, deltas) == 0);
+  for (i = 0; i < N - 1; i++) {
+    assert(deltas[i] == expected_delta(energy[i], energy[i + 1], 0));
+  }
+
+  assert(powercap_vector_power(ref_deltas, times, N, power) == 0);
+  assert(memcmp(power, ref_power, (N - 1) * sizeof(double)) == 0);
+  assert(powercap_vector_stats(power, N - 1, &min, &max, &mean) == 0);
+  assert(same(min, 0) && max > mean && mean > 0);
+  assert(same(mean, ref_mean));
+}
+
+static void test_kernels(void) {
+  uint64_t deltas[N];
+  double power[N];
+  double mean;
+  powercap_vector_isa best = powercap_vector_get_isa();
+  int isa;
+  make_samples();
+  assert(powercap_vector_set_isa(POWERCAP_VECTOR_ISA_SCALAR) == 0);
+  assert(powercap_vector_energy_deltas(energy, N, MAX_RANGE, deltas) == 0);
+  assert(deltas[100] == 0);
+  assert(deltas[500] == MAX_RANGE - energy[500] + 3);
+  assert(powercap_vector_power(deltas, times, N, power) == 0);
+  assert(same(power[0], (double) deltas[0] * 1e9 / (double) (times[1] - times[0])));
+  assert(same(power[299], 0) && same(power[400], 0));
+  assert(power[701] > 0 && power[701] < 1);
+  assert(powercap_vector_stats(power, N - 1, NULL, NULL, &mean) == 0);
+  for (isa = POWERCAP_VECTOR_ISA_SCALAR; isa <= (int) best; isa++) {
+    test_isa((powercap_vector_isa) isa, deltas, power, mean);
+  }
+  if (best < POWERCAP_VECTOR_ISA_AVX2) {
+    assert(powercap_vector_set_isa(POWERCAP_VECTOR_ISA_AVX2) == -ENOTSUP);
+  }
+  assert(powercap_vector_set_isa(best) == 0);
+}
+
+static void test_stats(void) {
+  const double values[7] = { 3, -1, 4, 1, 5, 9, 2 };
+  double min;
+  double max;
+  double mean;
+  assert(powercap_vector_stats(values, 7, &min, &max, &mean) == 0);
+  assert(same(min, -1) && same(max, 9) && mean > 3.28 && mean < 3.29);
+  assert(powercap_vector_stats(values, 1, &min, &max, &mean) == 0);
+  assert(same(min, 3) && same(max, 3) && same(mean, 3));
+  assert(powercap_vector_stats(values, 0, &min, &max, &mean) == -ENODATA);
+}
+
+static void test_bad_params(void) {
+  uint64_t v[2] = { 0, 1 };
+  double p;
+  assert(powercap_vector_set_isa((powercap_vector_isa) 10) == -EINVAL);
+  assert(powercap_vector_energy_deltas(NULL, 2, 0, v) == -EINVAL);
+  assert(powercap_vector_energy_deltas(v, 2, 0, NULL) == -EINVAL);
+  assert(powercap_vector_energy_deltas(v, 1, 0, NULL) == 0);
+  assert(powercap_vector_power(v, NULL, 2, &p) == -EINVAL);
+  assert(powercap_vector_power(NULL, NULL, 0, NULL) == 0);
+  assert(powercap_vector_stats(NULL, 1, NULL, NULL, NULL) == -EINVAL);
+}
+
+int main(void) {
+  test_kernels();
+  test_stats();
+  test_bad_params();
+  return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * Distribute a cluster-wide power budget to rapl-cluster-agent instances.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-cluster.h"
+#include "util-common.h"
+#include "util-socket.h"
+
+static const char short_options[] = "ha:b:i:v";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"address",             required_argument,  NULL, 'a'},
+  {"budget",              required_argument,  NULL, 'b'},
+  {"interval",            required_argument,  NULL, 'i'},
+  {"verbose",             no_argument,        NULL, 'v'},
+  {0, 0, 0, 0}
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig) {
+  (void) sig;
+  running = 0;
+}
+
+static void print_usage(void) {
+  printf("Usage: powercap-cluster-coordinator [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -a, --address=ADDRESS        The address to listen on (required)\n");
+  printf("  -b, --budget=UW              The cluster-wide power budget (required)\n");
+  printf("  -i, --interval=MS            The rebalance interval (1000 by default)\n");
+  printf("  -v, --verbose                Print node caps after each rebalance\n");
+  printf("\nAddresses are either unix:PATH or HOST:PORT (HOST may be empty to listen on all interfaces).\n");
+  printf("\nPower units: microwatts (uW)\n");
+  printf("Time units: milliseconds (ms)\n");
+}
+
+static int64_t ms_until(const struct timespec* deadline) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t) (deadline->tv_sec - now.tv_sec) * 1000 + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+}
+
+static void print_caps(const powercap_cluster_coord* coord) {
+  uint32_t i;
+  for (i = 0; i < coord->nnodes; i++) {
+    printf("node %"PRIu32": power=%"PRIu64" demand=%"PRIu64" cap=%"PRIu64"\n", coord->nodes[i].id,
+           coord->nodes[i].power_uw, coord->nodes[i].demand_uw, coord->nodes[i].cap_uw);
+  }
+  fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  powercap_cluster_coord coord;
+  struct sigaction sa;
+  struct timespec deadline;
+  const char* address = NULL;
+  u64_param budget = {0, 0};
+  u32_param interval = {1000, 0};
+  int64_t timeout;
+  int verbose = 0;
+  int lfd;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'a':
+      address = optarg;
+      break;
+    case 'b':
+      ret = set_u64_param(&budget, optarg, &cont);
+      break;
+    case 'i':
+      ret = set_u32_param(&interval, optarg, &cont);
+      break;
+    case 'v':
+      verbose = 1;
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (address == NULL || !budget.set) {
+    fprintf(stderr, "Must specify -a/--address and -b/--budget\n");
+    ret = -EINVAL;
+  } else if (!interval.val) {
+    fprintf(stderr, "Interval must be > 0\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+
+  if ((lfd = socket_listen(address)) < 0) {
+    perror("Failed to listen");
+    return lfd;
+  }
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handle_signal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  powercap_cluster_coord_init(&coord, lfd, budget.val);
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  while (running) {
+    deadline.tv_sec += interval.val / 1000;
+    deadline.tv_nsec += (long) (interval.val % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+    while (running && (timeout = ms_until(&deadline)) > 0) {
+      if ((ret = powercap_cluster_coord_poll(&coord, (int) timeout))) {
+        perror("Failed to poll");
+        running = 0;
+      }
+    }
+    if (running) {
+      if ((ret = powercap_cluster_coord_rebalance(&coord))) {
+        perror("Failed to rebalance");
+        running = 0;
+      } else if (verbose) {
+        print_caps(&coord);
+      }
+    }
+  }
+
+  powercap_cluster_coord_destroy(&coord);
+  close(lfd);
+  socket_unlink(address);
+  return ret;
+}
@@ -0,0 +1,224 @@
+/**
+ * Save and restore all writable powercap settings of a control type.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap-config.h"
+#include "util-common.h"
+
+static const char short_options[] = "hp:s:r:nv";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"control-type",        required_argument,  NULL, 'p'},
+  {"save",                required_argument,  NULL, 's'},
+  {"restore",             required_argument,  NULL, 'r'},
+  {"dry-run",             no_argument,        NULL, 'n'},
+  {"verbose",             no_argument,        NULL, 'v'},
+  {0, 0, 0, 0}
+};
+
+static void print_usage(void) {
+  printf("Usage: powercap-config -p NAME -s FILE\n");
+  printf("   or: powercap-config [-p NAME] -r FILE [-n] [-v]\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -p, --control-type=NAME      The powercap control type name (required with -s/--save)\n");
+  printf("                               Must not be empty or contain a '.' or '/'\n");
+  printf("  -s, --save=FILE              Save all zones' enabled states, power limits, and time windows\n");
+  printf("                               to FILE, or - for stdout\n");
+  printf("  -r, --restore=FILE           Restore settings from FILE, or - for stdin, writing only the values\n");
+  printf("                               that differ from the current ones\n");
+  printf("  -n, --dry-run                With -r/--restore, print the values that would be written instead\n");
+  printf("  -v, --verbose                With -r/--restore, print the number of values written\n");
+  printf("\nSaved files can also be applied with powercap-set -b.\n");
+}
+
+static void print_common_help(void) {
+  printf("Considerations for common errors:\n");
+  printf("- Ensure that the control type exists (may require loading a kernel module, e.g., intel_rapl)\n");
+  printf("- Ensure that you run with administrative (super-user) privileges\n");
+}
+
+static int save(const char* control_type, const char* file) {
+  powercap_config cfg;
+  FILE* f;
+  int ret;
+  if ((ret = powercap_config_capture(&cfg, control_type))) {
+    perror(ret == -ENOENT ? "Control type does not exist" : "Failed to read configuration");
+    return ret;
+  }
+  if (!strcmp(file, "-")) {
+    f = stdout;
+  } else if ((f = fopen(file, "w")) == NULL) {
+    ret = -errno;
+    perror("Failed to open file");
+    powercap_config_destroy(&cfg);
+    return ret;
+  }
+  if ((ret = powercap_config_write(&cfg, f))) {
+    perror("Failed to write configuration");
+  }
+  if (f != stdout && fclose(f) && !ret) {
+    ret = -errno;
+    perror("Failed to write configuration");
+  }
+  powercap_config_destroy(&cfg);
+  return ret;
+}
+
+static int print_diff(const powercap_config* saved) {
+  powercap_config current;
+  powercap_config diff;
+  int ret;
+  if ((ret = powercap_config_capture(&current, saved->control_type))) {
+    perror(ret == -ENOENT ? "Control type does not exist" : "Failed to read configuration");
+    return ret;
+  }
+  if ((ret = powercap_config_diff(&current, saved, &diff))) {
+    perror("Failed to compare configurations");
+  } else {
+    ret = powercap_config_write(&diff, stdout);
+    powercap_config_destroy(&diff);
+  }
+  powercap_config_destroy(&current);
+  return ret;
+}
+
+static int restore(const char* control_type, const char* file, int dry_run, int verbose) {
+  powercap_config saved;
+  uint32_t bad_line = 0;
+  uint32_t nwritten = 0;
+  FILE* f;
+  int ret;
+  if (!strcmp(file, "-")) {
+    f = stdin;
+  } else if ((f = fopen(file, "r")) == NULL) {
+    ret = -errno;
+    perror("Failed to open file");
+    return ret;
+  }
+  ret = powercap_config_read(&saved, f, &bad_line);
+  if (f != stdin) {
+    fclose(f);
+  }
+  if (ret) {
+    if (ret == -EINVAL) {
+      fprintf(stderr, "Invalid configuration on line %"PRIu32"\n", bad_line);
+    } else {
+      perror("Failed to read configuration");
+    }
+    return ret;
+  }
+  if (control_type && strcmp(control_type, saved.control_type)) {
+    fprintf(stderr, "Configuration is for control type: %s\n", saved.control_type);
+    ret = -EINVAL;
+  } else if (!is_valid_control_type(saved.control_type)) {
+    fprintf(stderr, "Configuration control type must not contain any '.' or '/' characters\n");
+    ret = -EINVAL;
+  } else if (dry_run) {
+    ret = print_diff(&saved);
+  } else if ((ret = powercap_config_restore(&saved, &nwritten))) {
+    perror("Failed to restore configuration");
+    if (nwritten) {
+      fprintf(stderr, "Configuration was partially restored (%"PRIu32" value(s) written)\n", nwritten);
+    }
+  } else if (verbose) {
+    printf("Wrote %"PRIu32" value(s)\n", nwritten);
+  }
+  powercap_config_destroy(&saved);
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  const char* control_type = NULL;
+  const char* save_file = NULL;
+  const char* restore_file = NULL;
+  int dry_run = 0;
+  int verbose = 0;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'p':
+      if (control_type) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      control_type = optarg;
+      break;
+    case 's':
+      if (save_file) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      save_file = optarg;
+      break;
+    case 'r':
+      if (restore_file) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      restore_file = optarg;
+      break;
+    case 'n':
+      dry_run = 1;
+      break;
+    case 'v':
+      verbose = 1;
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (!save_file == !restore_file) {
+    fprintf(stderr, "Must specify one of -s/--save or -r/--restore\n");
+    ret = -EINVAL;
+  } else if (control_type && !is_valid_control_type(control_type)) {
+    fprintf(stderr, "-p/--control-type must not be empty or contain any '.' or '/' characters\n");
+    ret = -EINVAL;
+  } else if (save_file && !control_type) {
+    fprintf(stderr, "Must specify -p/--control-type with -s/--save\n");
+    ret = -EINVAL;
+  } else if (save_file && (dry_run || verbose)) {
+    fprintf(stderr, "-n/--dry-run and -v/--verbose require -r/--restore\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+
+  if (save_file) {
+    ret = save(control_type, save_file);
+  } else {
+    ret = restore(control_type, restore_file, dry_run, verbose);
+  }
+  if (ret) {
+    print_common_help();
+  }
+  return ret;
+}
@@ -0,0 +1,401 @@
+/**
+ * Run a command and report the energy each zone consumed.
+ *
+ * Zones are opened once, then sampled before and after each run, and periodically while the command runs so that
+ * energy counter overflows are accounted for.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-sampler.h"
+#include "powercap-sysfs.h"
+#include "util-common.h"
+#include "util-watch.h"
+
+#define DEFAULT_CONTROL_TYPE "intel-rapl"
+#define DEFAULT_INTERVAL_US 1000000
+
+/* Running mean and variance (Welford's method) */
+typedef struct running_stat {
+  double mean;
+  double m2;
+} running_stat;
+
+typedef struct exec_stats {
+  running_stat* energy_j;
+  running_stat* power_w;
+  running_stat wall_s;
+  uint64_t nruns;
+} exec_stats;
+
+static const char short_options[] = "+hp:r:i:j";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"control-type",        required_argument,  NULL, 'p'},
+  {"repeat",              required_argument,  NULL, 'r'},
+  {"interval",            required_argument,  NULL, 'i'},
+  {"json",                no_argument,        NULL, 'j'},
+  {0, 0, 0, 0}
+};
+
+static void print_usage(void) {
+  printf("Usage: powercap-exec [OPTION]... [--] COMMAND [ARG]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -p, --control-type=NAME      The powercap control type whose zones are measured\n");
+  printf("                               (%s by default)\n", DEFAULT_CONTROL_TYPE);
+  printf("  -r, --repeat=N               Run the command N times and report means and standard\n");
+  printf("                               deviations (1 by default)\n");
+  printf("  -i, --interval=SECONDS       Sample energy counters this often while the command runs,\n");
+  printf("                               to account for counter overflow (1 by default)\n");
+  printf("  -j, --json                   Print the report as JSON\n");
+  printf("\nThe report is printed to stderr. The exit status is the command's (from the last run).\n");
+}
+
+static void print_common_help(void) {
+  printf("Considerations for common errors:\n");
+  printf("- Ensure that the control type exists (may require loading a kernel module, e.g., intel_rapl)\n");
+  printf("- Reading energy counters may require administrative (root) privileges\n");
+}
+
+static void stat_add(running_stat* s, uint64_t n, double x) {
+  double delta = x - s->mean;
+  s->mean += delta / n;
+  s->m2 += delta * (x - s->mean);
+}
+
+static double stat_stddev(const running_stat* s, uint64_t n) {
+  return n > 1 ? sqrt(s->m2 / (n - 1)) : 0;
+}
+
+static int64_t ts_to_ns(const struct timespec* ts) {
+  return (int64_t) ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+/*
+ * Wait for the child to exit, sampling every interval.
+ * SIGCHLD is blocked by the caller, so an exit between checks can't be missed.
+ */
+static int wait_child(powercap_sampler* sampler, powercap_sampler_snapshot* snap, pid_t pid, uint64_t interval_us,
+                      int* status) {
+  struct timespec now;
+  struct timespec timeout;
+  sigset_t set;
+  int64_t next_ns;
+  int64_t remaining;
+  pid_t ret;
+  sigemptyset(&set);
+  sigaddset(&set, SIGCHLD);
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  next_ns = ts_to_ns(&now) + (int64_t) interval_us * 1000;
+  for (;;) {
+    if ((ret = waitpid(pid, status, WNOHANG)) == pid) {
+      return 0;
+    } else if (ret < 0 && errno != EINTR) {
+      return -errno;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((remaining = next_ns - ts_to_ns(&now)) <= 0) {
+      if ((ret = powercap_sampler_sample(sampler, snap, POWERCAP_SAMPLER_READ_ENERGY))) {
+        return ret;
+      }
+      next_ns += (int64_t) interval_us * 1000;
+      continue;
+    }
+    timeout.tv_sec = (time_t) (remaining / 1000000000);
+    timeout.tv_nsec = (long) (remaining % 1000000000);
+    /* returns early on SIGCHLD (or any other signal), then check the child again */
+    sigtimedwait(&set, NULL, &timeout);
+  }
+}
+
+static int run_once(powercap_sampler* sampler, powercap_sampler_snapshot* snap, char** cmd, uint64_t interval_us,
+                    const sigset_t* orig_mask, exec_stats* stats, int* status) {
+  uint64_t* start_uj;
+  int64_t start_ns;
+  double wall_s;
+  double energy_j;
+  pid_t pid;
+  uint32_t i;
+  int ret;
+  if ((start_uj = malloc((sampler->nzones ? sampler->nzones : 1) * sizeof(uint64_t))) == NULL) {
+    return -errno;
+  }
+  if ((ret = powercap_sampler_sample(sampler, snap, POWERCAP_SAMPLER_READ_ENERGY))) {
+    free(start_uj);
+    return ret;
+  }
+  for (i = 0; i < sampler->nzones; i++) {
+    start_uj[i] = snap->zones[i].total_energy_uj;
+  }
+  start_ns = snap->time_ns;
+  if ((pid = fork()) < 0) {
+    ret = -errno;
+    free(start_uj);
+    return ret;
+  }
+  if (pid == 0) {
+    /* child: restore the original signal mask and dispositions */
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    sigprocmask(SIG_SETMASK, orig_mask, NULL);
+    execvp(cmd[0], cmd);
+    perror(cmd[0]);
+    _exit(127);
+  }
+  if ((ret = wait_child(sampler, snap, pid, interval_us, status))) {
+    /* don't leave the child running unmeasured, or a zombie */
+    kill(pid, SIGKILL);
+    while (waitpid(pid, status, 0) < 0 && errno == EINTR);
+  } else {
+    ret = powercap_sampler_sample(sampler, snap, POWERCAP_SAMPLER_READ_ENERGY);
+  }
+  if (!ret) {
+    stats->nruns++;
+    wall_s = (snap->time_ns - start_ns) / 1e9;
+    stat_add(&stats->wall_s, stats->nruns, wall_s);
+    for (i = 0; i < sampler->nzones; i++) {
+      energy_j = (snap->zones[i].total_energy_uj - start_uj[i]) / 1e6;
+      stat_add(&stats->energy_j[i], stats->nruns, energy_j);
+      stat_add(&stats->power_w[i], stats->nruns, wall_s > 0 ? energy_j / wall_s : 0);
+    }
+  }
+  free(start_uj);
+  return ret;
+}
+
+static void zone_label(const powercap_sampler_zone* z, char* buf, size_t len) {
+  size_t off;
+  uint32_t i;
+  off = (size_t) snprintf(buf, len, "%s", z->control_type ? z->control_type : "");
+  for (i = 0; i < z->depth && off < len; i++) {
+    off += (size_t) snprintf(buf + off, len - off, ":%"PRIu32, z->zones[i]);
+  }
+}
+
+static void print_cmd(char** cmd) {
+  int i;
+  for (i = 0; cmd[i] != NULL; i++) {
+    fprintf(stderr, i ? " %s" : "%s", cmd[i]);
+  }
+}
+
+static void print_text(const powercap_sampler* sampler, const exec_stats* stats, char** cmd) {
+  char label[64];
+  uint32_t i;
+  fprintf(stderr, "\n Energy stats for '");
+  print_cmd(cmd);
+  fprintf(stderr, "'");
+  if (stats->nruns > 1) {
+    fprintf(stderr, " (%"PRIu64" runs)", stats->nruns);
+  }
+  fprintf(stderr, ":\n\n");
+  for (i = 0; i < sampler->nzones; i++) {
+    zone_label(&sampler->zones[i], label, sizeof(label));
+    fprintf(stderr, "  %-18s %-12s %14.6f J", label, sampler->zones[i].name, stats->energy_j[i].mean);
+    if (stats->nruns > 1) {
+      fprintf(stderr, " +- %-10.6f", stat_stddev(&stats->energy_j[i], stats->nruns));
+    }
+    fprintf(stderr, " %12.3f W", stats->power_w[i].mean);
+    if (stats->nruns > 1) {
+      fprintf(stderr, " +- %.3f", stat_stddev(&stats->power_w[i], stats->nruns));
+    }
+    fprintf(stderr, "\n");
+  }
+  fprintf(stderr, "\n  %.6f seconds time elapsed", stats->wall_s.mean);
+  if (stats->nruns > 1) {
+    fprintf(stderr, " +- %.6f", stat_stddev(&stats->wall_s, stats->nruns));
+  }
+  fprintf(stderr, "\n\n");
+}
+
+static void print_json_string(const char* s) {
+  fputc('"', stderr);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      fprintf(stderr, "\\%c", *s);
+    } else if ((unsigned char) *s < 0x20) {
+      fprintf(stderr, "\\u%04x", (unsigned int) (unsigned char) *s);
+    } else {
+      fputc(*s, stderr);
+    }
+  }
+  fputc('"', stderr);
+}
+
+static void print_json(const powercap_sampler* sampler, const exec_stats* stats, char** cmd) {
+  char label[64];
+  uint32_t i;
+  int j;
+  fprintf(stderr, "{\"command\":[");
+  for (j = 0; cmd[j] != NULL; j++) {
+    if (j) {
+      fputc(',', stderr);
+    }
+    print_json_string(cmd[j]);
+  }
+  fprintf(stderr, "],\"runs\":%"PRIu64",\"elapsed_s\":%.9f,\"elapsed_s_stddev\":%.9f,\"zones\":[", stats->nruns,
+          stats->wall_s.mean, stat_stddev(&stats->wall_s, stats->nruns));
+  for (i = 0; i < sampler->nzones; i++) {
+    zone_label(&sampler->zones[i], label, sizeof(label));
+    fprintf(stderr, "%s{\"zone\":", i ? "," : "");
+    print_json_string(label);
+    fprintf(stderr, ",\"name\":");
+    print_json_string(sampler->zones[i].name);
+    fprintf(stderr, ",\"energy_j\":%.6f,\"energy_j_stddev\":%.6f,\"power_w\":%.6f,\"power_w_stddev\":%.6f}",
+            stats->energy_j[i].mean, stat_stddev(&stats->energy_j[i], stats->nruns), stats->power_w[i].mean,
+            stat_stddev(&stats->power_w[i], stats->nruns));
+  }
+  fprintf(stderr, "]}\n");
+}
+
+int main(int argc, char** argv) {
+  const char* control_type = DEFAULT_CONTROL_TYPE;
+  u64_param repeat = {1, 0};
+  uint64_t interval_us = DEFAULT_INTERVAL_US;
+  powercap_sampler sampler;
+  powercap_sampler_snapshot snap;
+  exec_stats stats;
+  sigset_t block;
+  sigset_t orig_mask;
+  struct sigaction ign;
+  struct sigaction old_int;
+  struct sigaction old_quit;
+  char** cmd;
+  uint64_t n;
+  int json = 0;
+  int status = 0;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  /* Parse command-line arguments, stopping at the command ("+" in short_options) */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'p':
+      control_type = optarg;
+      break;
+    case 'r':
+      ret = set_u64_param(&repeat, optarg, &cont);
+      break;
+    case 'i':
+      ret = watch_parse_interval(optarg, &interval_us, &cont);
+      break;
+    case 'j':
+      json = 1;
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (optind >= argc) {
+    fprintf(stderr, "Must specify a command\n");
+    ret = -EINVAL;
+  } else if (!is_valid_control_type(control_type)) {
+    fprintf(stderr, "-p/--control-type must not be empty or contain any '.' or '/' characters\n");
+    ret = -EINVAL;
+  } else if (!repeat.val) {
+    fprintf(stderr, "-r/--repeat must be > 0\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+  cmd = &argv[optind];
+
+  /* Open zones */
+  powercap_sampler_init(&sampler);
+  if (powercap_sysfs_control_type_exists(control_type)) {
+    fprintf(stderr, "Control type does not exist\n");
+    ret = -EINVAL;
+  } else if ((ret = powercap_sampler_add_zone_tree(&sampler, control_type, NULL, 0, 1))) {
+    errno = -ret;
+    perror("Failed to open zone files");
+  } else if (!sampler.nzones) {
+    fprintf(stderr, "No zones found\n");
+    ret = -ENODEV;
+  }
+  if (ret) {
+    print_common_help();
+    powercap_sampler_destroy(&sampler);
+    return ret;
+  }
+
+  memset(&stats, 0, sizeof(exec_stats));
+  if ((ret = powercap_sampler_snapshot_init(&sampler, &snap))) {
+    perror("powercap_sampler_snapshot_init");
+    powercap_sampler_destroy(&sampler);
+    return ret;
+  }
+  if ((stats.energy_j = calloc(sampler.nzones, sizeof(running_stat))) == NULL ||
+      (stats.power_w = calloc(sampler.nzones, sizeof(running_stat))) == NULL) {
+    ret = -errno;
+    perror("calloc");
+  } else {
+    /* like system(3): let the command handle interrupts, and wait for it */
+    memset(&ign, 0, sizeof(ign));
+    ign.sa_handler = SIG_IGN;
+    sigemptyset(&ign.sa_mask);
+    sigaction(SIGINT, &ign, &old_int);
+    sigaction(SIGQUIT, &ign, &old_quit);
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, &orig_mask);
+    for (n = 0; n < repeat.val; n++) {
+      if ((ret = run_once(&sampler, &snap, cmd, interval_us, &orig_mask, &stats, &status))) {
+        errno = -ret;
+        perror("Failed to run command");
+        break;
+      }
+    }
+    sigprocmask(SIG_SETMASK, &orig_mask, NULL);
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGQUIT, &old_quit, NULL);
+    if (stats.nruns) {
+      if (json) {
+        print_json(&sampler, &stats, cmd);
+      } else {
+        print_text(&sampler, &stats, cmd);
+      }
+    }
+  }
+
+  free(stats.energy_j);
+  free(stats.power_w);
+  powercap_sampler_snapshot_destroy(&snap);
+  powercap_sampler_destroy(&sampler);
+  if (ret) {
+    return ret;
+  }
+  if (WIFEXITED(status)) {
+    return WEXITSTATUS(status);
+  }
+  return WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 0;
+}
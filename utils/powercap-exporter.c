@@ -0,0 +1,550 @@
+/**
+ * Serve zone energy, power, and limits as OpenMetrics over HTTP.
+ *
+ * A sampler thread reads sysfs every interval and renders a complete HTTP response, which is then published by
+ * swapping a reference-counted pointer.
+ * Scrapes are served from the latest response by a single event loop, so they never touch sysfs or block each other.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-sampler.h"
+#include "util-common.h"
+#include "util-format.h"
+#include "util-socket.h"
+#include "util-watch.h"
+
+#define DEFAULT_ADDRESS "127.0.0.1:9105"
+#define DEFAULT_INTERVAL_US 1000000
+#define MAX_CLIENTS 64
+#define REQUEST_SIZE 4096
+#define IDLE_TIMEOUT_MS 30000
+#define CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+/* An immutable, pre-rendered HTTP response; freed when the last reference is released */
+typedef struct page {
+  uint32_t refs;
+  size_t header_len;
+  size_t len;
+  char data[];
+} page;
+
+typedef struct exporter {
+  powercap_sampler sampler;
+  powercap_sampler_snapshot snap;
+  output_buffer body;
+  uint64_t interval_us;
+  double created_s;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int stop;
+  /* protected by lock */
+  page* current;
+} exporter;
+
+typedef struct client {
+  int fd;
+  char req[REQUEST_SIZE];
+  size_t req_len;
+  /* the response being sent, from page or from static_resp */
+  page* page;
+  char static_resp[256];
+  const char* out;
+  size_t out_len;
+  size_t out_off;
+  int close_after;
+  int64_t last_ms;
+} client;
+
+static const char short_options[] = "ha:p:i:";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"address",             required_argument,  NULL, 'a'},
+  {"control-type",        required_argument,  NULL, 'p'},
+  {"interval",            required_argument,  NULL, 'i'},
+  {0, 0, 0, 0}
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig) {
+  (void) sig;
+  running = 0;
+}
+
+static void print_usage(void) {
+  printf("Usage: powercap-exporter [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -a, --address=ADDRESS        The address to listen on (%s by default)\n", DEFAULT_ADDRESS);
+  printf("  -p, --control-type=NAME      The powercap control type name (all by default)\n");
+  printf("                               Must not be empty or contain a '.' or '/'\n");
+  printf("  -i, --interval=SECONDS       How often to sample zones (1 by default)\n");
+  printf("\nAddresses are either unix:PATH or HOST:PORT (HOST may be empty to listen on all interfaces).\n");
+  printf("Metrics are served at /metrics in OpenMetrics text format, from the latest sample.\n");
+}
+
+static int64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static double timespec_s(const struct timespec* ts) {
+  return ts->tv_sec + ts->tv_nsec / 1e9;
+}
+
+static page* page_get(exporter* e) {
+  page* p;
+  pthread_mutex_lock(&e->lock);
+  if ((p = e->current) != NULL) {
+    p->refs++;
+  }
+  pthread_mutex_unlock(&e->lock);
+  return p;
+}
+
+static void page_put(exporter* e, page* p) {
+  if (p == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&e->lock);
+  if (!--p->refs) {
+    free(p);
+  }
+  pthread_mutex_unlock(&e->lock);
+}
+
+static void page_publish(exporter* e, page* p) {
+  page* old;
+  p->refs = 1;
+  pthread_mutex_lock(&e->lock);
+  old = e->current;
+  e->current = p;
+  if (old != NULL && !--old->refs) {
+    free(old);
+  }
+  pthread_mutex_unlock(&e->lock);
+}
+
+/* Sample and render a new response; on failure, the previous response continues to be served */
+static int refresh(exporter* e) {
+  struct timespec start;
+  struct timespec end;
+  struct timespec wall;
+  char header[256];
+  page* p;
+  int header_len;
+  int ret;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if ((ret = powercap_sampler_sample(&e->sampler, &e->snap, POWERCAP_SAMPLER_READ_ALL))) {
+    return ret;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  clock_gettime(CLOCK_REALTIME, &wall);
+  e->body.len = 0;
+  if ((ret = output_format_openmetrics(&e->body, &e->sampler, &e->snap, e->created_s)) ||
+      (ret = output_openmetrics_family(&e->body, "powercap_exporter_sample_timestamp_seconds", "gauge", "seconds",
+                                       "When the served values were sampled")) ||
+      (ret = output_buffer_printf(&e->body, "powercap_exporter_sample_timestamp_seconds %.3f\n",
+                                  timespec_s(&wall))) ||
+      (ret = output_openmetrics_family(&e->body, "powercap_exporter_sample_duration_seconds", "gauge", "seconds",
+                                       "How long reading all zones took")) ||
+      (ret = output_buffer_printf(&e->body, "powercap_exporter_sample_duration_seconds %.6f\n",
+                                  timespec_s(&end) - timespec_s(&start))) ||
+      (ret = output_buffer_append(&e->body, "# EOF\n", 6))) {
+    return ret;
+  }
+  header_len = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: "CONTENT_TYPE"\r\n"
+                        "Content-Length: %zu\r\n\r\n", e->body.len);
+  if ((p = malloc(sizeof(page) + (size_t) header_len + e->body.len)) == NULL) {
+    return -errno;
+  }
+  p->header_len = (size_t) header_len;
+  p->len = p->header_len + e->body.len;
+  memcpy(p->data, header, p->header_len);
+  memcpy(p->data + p->header_len, e->body.data, e->body.len);
+  page_publish(e, p);
+  return 0;
+}
+
+static void add_us(struct timespec* ts, uint64_t us) {
+  ts->tv_sec += (time_t) (us / 1000000);
+  ts->tv_nsec += (long) (us % 1000000) * 1000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+}
+
+static void* sampler_main(void* arg) {
+  exporter* e = (exporter*) arg;
+  struct timespec deadline;
+  struct timespec now;
+  int ret;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  add_us(&deadline, e->interval_us);
+  pthread_mutex_lock(&e->lock);
+  while (!e->stop) {
+    if (pthread_cond_timedwait(&e->cond, &e->lock, &deadline) != ETIMEDOUT) {
+      continue;
+    }
+    pthread_mutex_unlock(&e->lock);
+    if ((ret = refresh(e))) {
+      errno = -ret;
+      perror("Failed to sample zones");
+    }
+    add_us(&deadline, e->interval_us);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (timespec_s(&deadline) < timespec_s(&now)) {
+      /* skip missed intervals rather than sampling back-to-back */
+      deadline = now;
+      add_us(&deadline, e->interval_us);
+    }
+    pthread_mutex_lock(&e->lock);
+  }
+  pthread_mutex_unlock(&e->lock);
+  return NULL;
+}
+
+static int exporter_start(exporter* e) {
+  pthread_condattr_t attr;
+  sigset_t set;
+  sigset_t old;
+  int ret;
+  pthread_mutex_init(&e->lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&e->cond, &attr);
+  pthread_condattr_destroy(&attr);
+  /* signals are handled by the event loop */
+  sigemptyset(&set);
+  sigaddset(&set, SIGINT);
+  sigaddset(&set, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &set, &old);
+  ret = pthread_create(&e->thread, NULL, sampler_main, e);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (ret) {
+    pthread_cond_destroy(&e->cond);
+    pthread_mutex_destroy(&e->lock);
+    return -ret;
+  }
+  return 0;
+}
+
+static void exporter_stop(exporter* e) {
+  pthread_mutex_lock(&e->lock);
+  e->stop = 1;
+  pthread_cond_signal(&e->cond);
+  pthread_mutex_unlock(&e->lock);
+  pthread_join(e->thread, NULL);
+  free(e->current);
+  e->current = NULL;
+  pthread_cond_destroy(&e->cond);
+  pthread_mutex_destroy(&e->lock);
+}
+
+static void client_close(exporter* e, client* c) {
+  page_put(e, c->page);
+  close(c->fd);
+  memset(c, 0, sizeof(client));
+  c->fd = -1;
+}
+
+static void respond_static(client* c, const char* status, const char* body, int head) {
+  int n = snprintf(c->static_resp, sizeof(c->static_resp), "HTTP/1.1 %s\r\nContent-Type: text/plain\r\n"
+                   "Content-Length: %zu\r\n\r\n%s", status, strlen(body), head ? "" : body);
+  c->out = c->static_resp;
+  c->out_len = n < 0 ? 0 : (size_t) n;
+  c->out_off = 0;
+}
+
+/* Parse one complete request at the start of the buffer; returns the request length, or 0 if it's incomplete */
+static size_t handle_request(exporter* e, client* c) {
+  char* end;
+  char* line_end;
+  char* target;
+  char* version;
+  size_t len;
+  int head;
+  if ((end = memmem(c->req, c->req_len, "\r\n\r\n", 4)) == NULL) {
+    return 0;
+  }
+  *end = '\0';
+  len = (size_t) (end - c->req) + 4;
+  if ((line_end = strstr(c->req, "\r\n")) != NULL) {
+    *line_end = '\0';
+  }
+  head = !strncmp(c->req, "HEAD ", 5);
+  target = strchr(c->req, ' ');
+  version = target ? strchr(target + 1, ' ') : NULL;
+  if (target == NULL || version == NULL || strncmp(version + 1, "HTTP/1.", 7)) {
+    respond_static(c, "400 Bad Request", "Bad request\n", 0);
+    c->close_after = 1;
+    return len;
+  }
+  *version++ = '\0';
+  target++;
+  target[strcspn(target, "?")] = '\0';
+  /* HTTP/1.0 closes by default; HTTP/1.1 keeps the connection open unless asked not to */
+  c->close_after = !strcmp(version, "HTTP/1.0") ||
+                   (line_end != NULL && strcasestr(line_end + 1, "\nConnection: close") != NULL);
+  if (!head && strncmp(c->req, "GET ", 4)) {
+    respond_static(c, "405 Method Not Allowed", "Method not allowed\n", 0);
+  } else if (!strcmp(target, "/metrics")) {
+    if ((c->page = page_get(e)) == NULL) {
+      respond_static(c, "503 Service Unavailable", "No sample yet\n", head);
+    } else {
+      c->out = c->page->data;
+      c->out_len = head ? c->page->header_len : c->page->len;
+      c->out_off = 0;
+    }
+  } else if (!strcmp(target, "/")) {
+    respond_static(c, "200 OK", "powercap-exporter: metrics are at /metrics\n", head);
+  } else {
+    respond_static(c, "404 Not Found", "Not found\n", head);
+  }
+  return len;
+}
+
+/* Returns 0 to keep the client, or a negative value to close it */
+static int client_read(exporter* e, client* c) {
+  size_t len;
+  ssize_t n;
+  if (c->req_len == sizeof(c->req)) {
+    return -ENOBUFS;
+  }
+  if ((n = read(c->fd, c->req + c->req_len, sizeof(c->req) - c->req_len)) <= 0) {
+    return (n < 0 && (errno == EAGAIN || errno == EINTR)) ? 0 : -1;
+  }
+  c->req_len += (size_t) n;
+  if (!c->out && (len = handle_request(e, c)) > 0) {
+    /* keep any pipelined requests */
+    memmove(c->req, c->req + len, c->req_len - len);
+    c->req_len -= len;
+  } else if (!c->out && c->req_len == sizeof(c->req)) {
+    respond_static(c, "431 Request Header Fields Too Large", "Request too large\n", 0);
+    c->close_after = 1;
+  }
+  return 0;
+}
+
+static int client_write(exporter* e, client* c) {
+  size_t len;
+  ssize_t n;
+  while (c->out) {
+    if ((n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL)) < 0) {
+      return (errno == EAGAIN || errno == EINTR) ? 0 : -errno;
+    }
+    if ((c->out_off += (size_t) n) < c->out_len) {
+      continue;
+    }
+    page_put(e, c->page);
+    c->page = NULL;
+    c->out = NULL;
+    if (c->close_after) {
+      return -1;
+    }
+    /* serve the next pipelined request, if any */
+    if ((len = handle_request(e, c)) > 0) {
+      memmove(c->req, c->req + len, c->req_len - len);
+      c->req_len -= len;
+    }
+  }
+  return 0;
+}
+
+static void accept_clients(int lfd, client* clients) {
+  uint32_t i;
+  int fd;
+  while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    for (i = 0; i < MAX_CLIENTS && clients[i].fd >= 0; i++);
+    if (i == MAX_CLIENTS) {
+      close(fd);
+      continue;
+    }
+    clients[i].fd = fd;
+    clients[i].last_ms = now_ms();
+  }
+}
+
+static int serve(exporter* e, int lfd) {
+  struct pollfd fds[MAX_CLIENTS + 1];
+  client* clients;
+  uint32_t idx[MAX_CLIENTS + 1];
+  uint32_t nfds;
+  uint32_t i;
+  int64_t now;
+  int ret = 0;
+  if ((clients = calloc(MAX_CLIENTS, sizeof(client))) == NULL) {
+    return -errno;
+  }
+  for (i = 0; i < MAX_CLIENTS; i++) {
+    clients[i].fd = -1;
+  }
+  while (running) {
+    fds[0].fd = lfd;
+    fds[0].events = POLLIN;
+    for (i = 0, nfds = 1; i < MAX_CLIENTS; i++) {
+      if (clients[i].fd >= 0) {
+        fds[nfds].fd = clients[i].fd;
+        fds[nfds].events = clients[i].out ? POLLOUT : POLLIN;
+        idx[nfds++] = i;
+      }
+    }
+    if (poll(fds, nfds, 1000) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ret = -errno;
+      perror("poll");
+      break;
+    }
+    now = now_ms();
+    for (i = 1; i < nfds; i++) {
+      client* c = &clients[idx[i]];
+      if (fds[i].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        /* the peer is gone; nothing more can be read from or written to it */
+        client_close(e, c);
+      } else if (fds[i].revents) {
+        c->last_ms = now;
+        if (((fds[i].revents & POLLIN) && client_read(e, c)) || client_write(e, c)) {
+          client_close(e, c);
+        }
+      } else if (now - c->last_ms > IDLE_TIMEOUT_MS) {
+        client_close(e, c);
+      }
+    }
+    if (fds[0].revents & POLLIN) {
+      accept_clients(lfd, clients);
+    }
+  }
+  for (i = 0; i < MAX_CLIENTS; i++) {
+    if (clients[i].fd >= 0) {
+      client_close(e, &clients[i]);
+    }
+  }
+  free(clients);
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  exporter e;
+  const char* address = DEFAULT_ADDRESS;
+  const char* control_type = NULL;
+  struct sigaction sa;
+  struct timespec wall;
+  int lfd;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  memset(&e, 0, sizeof(exporter));
+  e.interval_us = DEFAULT_INTERVAL_US;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'a':
+      address = optarg;
+      break;
+    case 'p':
+      if (control_type) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      control_type = optarg;
+      break;
+    case 'i':
+      ret = watch_parse_interval(optarg, &e.interval_us, &cont);
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (control_type && !is_valid_control_type(control_type)) {
+    fprintf(stderr, "-p/--control-type must not be empty or contain any '.' or '/' characters\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+
+  powercap_sampler_init(&e.sampler);
+  if ((ret = control_type ? powercap_sampler_add_zone_tree(&e.sampler, control_type, NULL, 0, 1)
+                          : add_all_control_types(&e.sampler))) {
+    perror("Failed to open zones");
+  } else if (!e.sampler.nzones) {
+    fprintf(stderr, "No zones found\n");
+    ret = -ENODEV;
+  } else if ((ret = powercap_sampler_snapshot_init(&e.sampler, &e.snap))) {
+    perror("powercap_sampler_snapshot_init");
+  }
+  if (ret) {
+    powercap_sampler_destroy(&e.sampler);
+    return ret;
+  }
+  output_buffer_init(&e.body);
+  clock_gettime(CLOCK_REALTIME, &wall);
+  e.created_s = timespec_s(&wall);
+
+  /* The first response is ready before any scrape */
+  if ((ret = refresh(&e))) {
+    errno = -ret;
+    perror("Failed to sample zones");
+  } else if ((lfd = socket_listen(address)) < 0) {
+    ret = lfd;
+    perror("Failed to listen");
+  } else {
+    fcntl(lfd, F_SETFL, fcntl(lfd, F_GETFL) | O_NONBLOCK);
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    if ((ret = exporter_start(&e))) {
+      errno = -ret;
+      perror("Failed to start sampler thread");
+    } else {
+      ret = serve(&e, lfd);
+      exporter_stop(&e);
+    }
+    close(lfd);
+    socket_unlink(address);
+  }
+  if (ret) {
+    free(e.current);
+  }
+  output_buffer_destroy(&e.body);
+  powercap_sampler_snapshot_destroy(&e.snap);
+  powercap_sampler_destroy(&e.sampler);
+  return ret;
+}
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include "powercap-sysfs.h"
 #include "util-common.h"
+#include "util-watch.h"
 
 static void print_parent_headers(const uint32_t* zones, uint32_t depth_start, uint32_t depth) {
   uint32_t i;
@@ -126,13 +127,16 @@ static void print_num_zones(const char* control_type, uint32_t* zones, uint32_t
   printf("%"PRIu32"\n", zones[depth]);
 }
 
-static const char short_options[] = "hvp:z:c:njJwWexlsUuTty";
+static const char short_options[] = "hvp:z:c:i:f:mnjJwWexlsUuTty";
 static const struct option long_options[] = {
   {"help",                no_argument,        NULL, 'h'},
   {"verbose",             no_argument,        NULL, 'v'},
   {"control-type",        required_argument,  NULL, 'p'},
   {"zone",                required_argument,  NULL, 'z'},
   {"constraint",          required_argument,  NULL, 'c'},
+  {"watch",               required_argument,  NULL, 'i'},
+  {"format",              required_argument,  NULL, 'f'},
+  {"telemetry",           no_argument,        NULL, 'm'},
   {"nzones",              no_argument,        NULL, 'n'},
   {"z-energy",            no_argument,        NULL, 'j'},
   {"z-max-energy-range",  no_argument,        NULL, 'J'},
@@ -164,6 +168,15 @@ static void print_usage(void) {
   printf("                               Ending with a colon prevents output for subzones\n");
   printf("                               E.g., for zone 0, but not subzones: \"-z 0:\"\n");
   printf("  -c, --constraint=CONSTRAINT  The constraint number\n");
+  printf("  -i, --watch=SECONDS          Keep files open and print zone power and any changed\n");
+  printf("                               energy/power/enabled/limit values every interval\n");
+  printf("                               Cannot be used with -c/--constraint or the options below\n");
+  printf("  -f, --format=FORMAT          Output format: text (default), json, csv, or binary\n");
+  printf("                               Non-text formats print all zones and constraints once,\n");
+  printf("                               or every interval with -i/--watch\n");
+  printf("                               Cannot be used with -c/--constraint or the options below\n");
+  printf("  -m, --telemetry              Also watch CPU frequencies, idle states, and thermal zones\n");
+  printf("                               Requires -i/--watch or -f/--format=json\n");
   printf("All remaining options below are mutually exclusive:\n");
   printf("  -n, --nzones                 Print the number of zones (control type's root by\n");
   printf("                               default; within the -z/--zone level, if set)\n");
@@ -200,6 +213,11 @@ int main(int argc, char** argv) {
   uint32_t zones[MAX_ZONE_DEPTH] = { 0 };
   u32_param constraint = {0, 0};
   uint32_t depth = 0;
+  uint64_t interval_us = 0;
+  output_format format = OUTPUT_FORMAT_TEXT;
+  int format_set = 0;
+  int telemetry = 0;
+  watch w;
   int recurse = 1;
   int verbose = 0;
   int unique_set = 0;
@@ -237,6 +255,26 @@ int main(int argc, char** argv) {
     case 'c':
       ret = set_u32_param(&constraint, optarg, &cont);
       break;
+    case 'i':
+      if (interval_us) {
+        cont = 0;
+        ret = -EINVAL;
+        break;
+      }
+      ret = watch_parse_interval(optarg, &interval_us, &cont);
+      break;
+    case 'f':
+      if (format_set) {
+        cont = 0;
+        ret = -EINVAL;
+        break;
+      }
+      format_set = 1;
+      ret = parse_output_format(optarg, &format, &cont);
+      break;
+    case 'm':
+      telemetry = 1;
+      break;
     case 'n':
     case 'j':
     case 'J':
@@ -277,6 +315,13 @@ int main(int argc, char** argv) {
   } else if (!depth && constraint.set) {
     fprintf(stderr, "Must specify -z/--zone with -c/--constraint\n");
     ret = -EINVAL;
+  } else if ((interval_us || format != OUTPUT_FORMAT_TEXT) && (constraint.set || unique_set)) {
+    fprintf(stderr, "-i/--watch and -f/--format cannot be used with -c/--constraint or zone/constraint-specific outputs\n");
+    ret = -EINVAL;
+  } else if (telemetry && (format == OUTPUT_FORMAT_TEXT ? !interval_us : format != OUTPUT_FORMAT_JSON)) {
+    /* CSV and binary have fixed schemas with no place for other telemetry */
+    fprintf(stderr, "-m/--telemetry requires -i/--watch with text output, or -f/--format=json\n");
+    ret = -EINVAL;
   } else if (unique_set) {
     if (unique_set == 'n') {
       if (constraint.set) {
@@ -339,7 +384,18 @@ int main(int argc, char** argv) {
   }
 
   /* Perform requested action */
-  if (unique_set) {
+  if (interval_us || format != OUTPUT_FORMAT_TEXT) {
+    /* Open files once, then print a snapshot, or power and changed values every interval until interrupted */
+    if ((ret = watch_init(&w, format)) || (ret = watch_add_zone_tree(&w, control_type, zones, depth, recurse)) ||
+        (telemetry && (ret = watch_add_telemetry(&w)))) {
+      errno = -ret;
+      perror("Failed to open zone files");
+    } else if ((ret = interval_us ? watch_run(&w, interval_us) : watch_once(&w))) {
+      errno = -ret;
+      perror("Failed to read zones");
+    }
+    watch_destroy(&w);
+  } else if (unique_set) {
     switch (unique_set) {
     case 'n':
       /* Print number of zones at the specified tree location */
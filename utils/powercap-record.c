@@ -0,0 +1,371 @@
+/**
+ * Record zone energy and power to a binary file at a high rate.
+ *
+ * Zones are opened once, then sampled against absolute deadlines.
+ * Records accumulate in a large buffer that a dedicated writer thread writes out, so file I/O doesn't delay sampling.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-sampler.h"
+#include "powercap-sysfs.h"
+#include "util-common.h"
+#include "util-format.h"
+#include "util-watch.h"
+
+#define DEFAULT_INTERVAL_US 1000
+#define DEFAULT_BUFFER_SIZE (4 * 1024 * 1024)
+
+/* Double-buffered output: the sampling thread fills active while the writer thread writes pending */
+typedef struct writer {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  output_buffer active;
+  output_buffer pending;
+  int full;
+  int done;
+  int err;
+  int fd;
+} writer;
+
+static volatile sig_atomic_t stop;
+
+static const char short_options[] = "hp:z:o:i:d:s:l";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"control-type",        required_argument,  NULL, 'p'},
+  {"zone",                required_argument,  NULL, 'z'},
+  {"output",              required_argument,  NULL, 'o'},
+  {"interval",            required_argument,  NULL, 'i'},
+  {"duration",            required_argument,  NULL, 'd'},
+  {"buffer-size",         required_argument,  NULL, 's'},
+  {"limits",              no_argument,        NULL, 'l'},
+  {0, 0, 0, 0}
+};
+
+static void print_usage(void) {
+  printf("Usage: powercap-record -o FILE [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -o, --output=FILE            [REQUIRED] The output file, or - for stdout\n");
+  printf("  -p, --control-type=NAME      Only record zones of this control type (all by default)\n");
+  printf("  -z, --zone=ZONE(S)           Only record this zone and its subzones (requires -p/--control-type)\n");
+  printf("                               Separate zones/subzones with a colon, e.g., \"-z 0:2\"\n");
+  printf("                               Ending with a colon excludes subzones, e.g., \"-z 0:\"\n");
+  printf("  -i, --interval=SECONDS       The sampling interval (0.001 by default)\n");
+  printf("  -d, --duration=SECONDS       Stop after this long (run until interrupted by default)\n");
+  printf("  -s, --buffer-size=BYTES      Write records in chunks of this size (%d by default)\n", DEFAULT_BUFFER_SIZE);
+  printf("  -l, --limits                 Also record power limits and time windows every sample\n");
+  printf("\nThe output uses the binary format of powercap-info -f binary; summarize it with powercap-report.\n");
+}
+
+static void print_common_help(void) {
+  printf("Considerations for common errors:\n");
+  printf("- Ensure that the control type exists (may require loading a kernel module, e.g., intel_rapl)\n");
+  printf("- Reading energy counters may require administrative (root) privileges\n");
+}
+
+static void handle_signal(int sig) {
+  (void) sig;
+  stop = 1;
+}
+
+static void* writer_main(void* arg) {
+  writer* wr = (writer*) arg;
+  int ret;
+  pthread_mutex_lock(&wr->lock);
+  for (;;) {
+    while (!wr->full && !wr->done) {
+      pthread_cond_wait(&wr->cond, &wr->lock);
+    }
+    if (!wr->full) {
+      break;
+    }
+    pthread_mutex_unlock(&wr->lock);
+    ret = wr->err ? 0 : output_buffer_flush(&wr->pending, wr->fd);
+    pthread_mutex_lock(&wr->lock);
+    if (ret) {
+      wr->err = ret;
+    }
+    /* after an error, keep discarding records so the sampling thread isn't blocked */
+    wr->pending.len = 0;
+    wr->full = 0;
+    pthread_cond_broadcast(&wr->cond);
+  }
+  pthread_mutex_unlock(&wr->lock);
+  return NULL;
+}
+
+static int writer_start(writer* wr, int fd, size_t size) {
+  int ret;
+  memset(wr, 0, sizeof(writer));
+  wr->fd = fd;
+  output_buffer_init(&wr->active);
+  output_buffer_init(&wr->pending);
+  /* allocate up front so buffers don't grow while sampling */
+  if ((ret = output_buffer_reserve(&wr->active, size)) || (ret = output_buffer_reserve(&wr->pending, size))) {
+    return ret;
+  }
+  pthread_mutex_init(&wr->lock, NULL);
+  pthread_cond_init(&wr->cond, NULL);
+  if ((ret = pthread_create(&wr->thread, NULL, writer_main, wr))) {
+    pthread_cond_destroy(&wr->cond);
+    pthread_mutex_destroy(&wr->lock);
+    errno = ret;
+    return -errno;
+  }
+  return 0;
+}
+
+/* Hand off the active buffer, waiting for the writer to finish the previous one */
+static int writer_submit(writer* wr) {
+  output_buffer tmp;
+  int ret;
+  pthread_mutex_lock(&wr->lock);
+  while (wr->full) {
+    pthread_cond_wait(&wr->cond, &wr->lock);
+  }
+  tmp = wr->pending;
+  wr->pending = wr->active;
+  wr->active = tmp;
+  wr->full = 1;
+  ret = wr->err;
+  pthread_cond_broadcast(&wr->cond);
+  pthread_mutex_unlock(&wr->lock);
+  return ret;
+}
+
+/* Write out remaining records and stop the writer thread */
+static int writer_finish(writer* wr) {
+  int ret = 0;
+  if (wr->active.len) {
+    ret = writer_submit(wr);
+  }
+  pthread_mutex_lock(&wr->lock);
+  wr->done = 1;
+  pthread_cond_broadcast(&wr->cond);
+  pthread_mutex_unlock(&wr->lock);
+  pthread_join(wr->thread, NULL);
+  pthread_cond_destroy(&wr->cond);
+  pthread_mutex_destroy(&wr->lock);
+  return ret ? ret : wr->err;
+}
+
+static void writer_destroy(writer* wr) {
+  output_buffer_destroy(&wr->active);
+  output_buffer_destroy(&wr->pending);
+}
+
+static int record(powercap_sampler* sampler, writer* wr, uint32_t flags, uint64_t interval_us, uint64_t duration_us,
+                  size_t chunk) {
+  powercap_sampler_snapshot snap;
+  struct timespec next;
+  int64_t start_ns;
+  int64_t next_ns;
+  int64_t interval_ns = (int64_t) interval_us * 1000;
+  uint64_t missed = 0;
+  int ret;
+  if ((ret = powercap_sampler_snapshot_init(sampler, &snap))) {
+    return ret;
+  }
+  if ((ret = output_format_header(&wr->active, OUTPUT_FORMAT_BINARY, sampler)) ||
+      (ret = powercap_sampler_sample(sampler, &snap, flags)) ||
+      (ret = output_format_snapshot(&wr->active, OUTPUT_FORMAT_BINARY, sampler, &snap, 0))) {
+    powercap_sampler_snapshot_destroy(&snap);
+    return ret;
+  }
+  start_ns = snap.time_ns;
+  next_ns = start_ns;
+  while (!stop && (!duration_us || snap.time_ns - start_ns < (int64_t) duration_us * 1000)) {
+    /* absolute deadlines, so sampling overhead doesn't cause drift */
+    next_ns += interval_ns;
+    next.tv_sec = (time_t) (next_ns / 1000000000);
+    next.tv_nsec = (long) (next_ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR && !stop);
+    if (stop) {
+      break;
+    }
+    if ((ret = powercap_sampler_sample(sampler, &snap, flags)) ||
+        (ret = output_format_snapshot(&wr->active, OUTPUT_FORMAT_BINARY, sampler, &snap, snap.time_ns - start_ns)) ||
+        (wr->active.len > chunk && (ret = writer_submit(wr)))) {
+      break;
+    }
+    if (snap.time_ns - next_ns >= interval_ns) {
+      /* fell behind by at least an interval, don't try to catch up */
+      missed += (uint64_t) ((snap.time_ns - next_ns) / interval_ns);
+      next_ns = snap.time_ns;
+    }
+  }
+  if (!ret) {
+    fprintf(stderr, "Recorded %"PRIu64" samples of %"PRIu32" zone(s) in %.3f s (%"PRIu64" missed intervals)\n",
+            sampler->nsamples, sampler->nzones, (snap.time_ns - start_ns) / 1000000000.0, missed);
+  }
+  powercap_sampler_snapshot_destroy(&snap);
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  const char* control_type = NULL;
+  const char* output = NULL;
+  uint32_t zones[MAX_ZONE_DEPTH] = { 0 };
+  uint32_t depth = 0;
+  uint64_t interval_us = DEFAULT_INTERVAL_US;
+  uint64_t duration_us = 0;
+  u64_param buffer_size = {DEFAULT_BUFFER_SIZE, 0};
+  uint32_t flags = POWERCAP_SAMPLER_READ_ENERGY;
+  powercap_sampler sampler;
+  struct sigaction sa;
+  writer wr;
+  size_t record_size;
+  int recurse = 1;
+  int fd;
+  int c;
+  int cont = 1;
+  int ret = 0;
+  int ret2;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'p':
+      if (control_type) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      control_type = optarg;
+      break;
+    case 'z':
+      recurse = get_recurse(optarg);
+      ret = parse_zones(optarg, zones, MAX_ZONE_DEPTH, &depth, &cont);
+      break;
+    case 'o':
+      if (output) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      output = optarg;
+      break;
+    case 'i':
+      ret = watch_parse_interval(optarg, &interval_us, &cont);
+      break;
+    case 'd':
+      ret = watch_parse_interval(optarg, &duration_us, &cont);
+      break;
+    case 's':
+      ret = set_u64_param(&buffer_size, optarg, &cont);
+      break;
+    case 'l':
+      flags |= POWERCAP_SAMPLER_READ_LIMITS;
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (!output) {
+    fprintf(stderr, "Must specify -o/--output\n");
+    ret = -EINVAL;
+  } else if (control_type && !is_valid_control_type(control_type)) {
+    fprintf(stderr, "-p/--control-type must not be empty or contain any '.' or '/' characters\n");
+    ret = -EINVAL;
+  } else if (depth && !control_type) {
+    fprintf(stderr, "Must specify -p/--control-type with -z/--zone\n");
+    ret = -EINVAL;
+  } else if (buffer_size.val < 4096 || buffer_size.val > SIZE_MAX / 2) {
+    fprintf(stderr, "-s/--buffer-size must be at least 4096\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+
+  /* Open zones */
+  powercap_sampler_init(&sampler);
+  if (control_type && powercap_sysfs_control_type_exists(control_type)) {
+    fprintf(stderr, "Control type does not exist\n");
+    ret = -EINVAL;
+  } else if (depth && powercap_sysfs_zone_exists(control_type, zones, depth)) {
+    fprintf(stderr, "Zone does not exist\n");
+    ret = -EINVAL;
+  } else if ((ret = control_type ? powercap_sampler_add_zone_tree(&sampler, control_type, zones, depth, recurse)
+                                 : add_all_control_types(&sampler))) {
+    errno = -ret;
+    perror("Failed to open zone files");
+  } else if (!sampler.nzones) {
+    fprintf(stderr, "No zones found\n");
+    ret = -ENODEV;
+  }
+  if (ret) {
+    print_common_help();
+    powercap_sampler_destroy(&sampler);
+    return ret;
+  }
+
+  if (!strcmp(output, "-")) {
+    fd = STDOUT_FILENO;
+  } else if ((fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0) {
+    ret = -errno;
+    perror("Failed to open output file");
+    powercap_sampler_destroy(&sampler);
+    return ret;
+  }
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handle_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  if ((ret = writer_start(&wr, fd, (size_t) buffer_size.val))) {
+    errno = -ret;
+    perror("Failed to start writer");
+  } else {
+    /* submit once the buffer can't fit another record */
+    record_size = output_binary_record_size(&sampler);
+    ret = record(&sampler, &wr, flags, interval_us, duration_us,
+                 buffer_size.val > record_size ? (size_t) buffer_size.val - record_size : 0);
+    if (ret) {
+      errno = -ret;
+      perror("Failed to record zones");
+    }
+    if ((ret2 = writer_finish(&wr))) {
+      errno = -ret2;
+      perror("Failed to write output");
+      ret = ret ? ret : ret2;
+    }
+  }
+  writer_destroy(&wr);
+  if (fd != STDOUT_FILENO && close(fd) && !ret) {
+    ret = -errno;
+    perror("Failed to close output file");
+  }
+  powercap_sampler_destroy(&sampler);
+  return ret;
+}
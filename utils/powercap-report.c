@@ -0,0 +1,271 @@
+/**
+ * Summarize a binary recording from powercap-record (or powercap-info -f binary).
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap-digest.h"
+#include "powercap-sampler.h"
+#include "util-format.h"
+
+#define MAX_THRESHOLDS 16
+
+typedef struct zone_stats {
+  /* derived power of the samples that have it, in constant memory */
+  powercap_digest power_uw;
+  uint64_t energy_uj;
+  /* time covered by samples with derived power */
+  int64_t power_ns;
+  int64_t above_ns[MAX_THRESHOLDS];
+} zone_stats;
+
+typedef struct report {
+  binary_header header;
+  zone_stats* zones;
+  /* time each constraint's zone spent at or above its power limit, and time the limit was known */
+  int64_t* cap_ns;
+  int64_t* limit_ns;
+  uint64_t thresholds_uw[MAX_THRESHOLDS];
+  uint32_t nthresholds;
+  uint64_t nrecords;
+  int64_t duration_ns;
+} report;
+
+static const char short_options[] = "hf:t:";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"file",                required_argument,  NULL, 'f'},
+  {"threshold",           required_argument,  NULL, 't'},
+  {0, 0, 0, 0}
+};
+
+static void print_usage(void) {
+  printf("Usage: powercap-report -f FILE [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -f, --file=FILE              [REQUIRED] The recording, or - for stdin\n");
+  printf("  -t, --threshold=WATTS        Report time each zone spent above this power\n");
+  printf("                               May be repeated, up to %d times\n", MAX_THRESHOLDS);
+  printf("\nFor each zone, prints energy, average and peak power, power percentiles, and time above thresholds.\n");
+  printf("Power percentiles are estimated in constant memory, to within 1%%.\n");
+  printf("If the recording includes power limits (powercap-record -l), also prints time at or above each limit.\n");
+}
+
+static int parse_watts(const char* optarg, uint64_t* uw, int* cont) {
+  char* end;
+  double w;
+  errno = 0;
+  w = strtod(optarg, &end);
+  if (end == optarg || *end != '\0' || errno || !(w >= 0) || w * 1000000 > (double) UINT64_MAX) {
+    *cont = 0;
+    return -EINVAL;
+  }
+  *uw = (uint64_t) (w * 1000000);
+  return 0;
+}
+
+static int accumulate(report* r, const powercap_sampler_snapshot* snap) {
+  const binary_zone* z;
+  const powercap_sampler_zone_values* v;
+  const powercap_sampler_constraint_values* cv;
+  zone_stats* zs;
+  uint32_t i;
+  uint32_t j;
+  int ret;
+  for (i = 0; i < r->header.nzones; i++) {
+    z = &r->header.zones[i];
+    v = &snap->zones[i];
+    zs = &r->zones[i];
+    if (v->valid & POWERCAP_SAMPLER_ZONE_ENERGY) {
+      zs->energy_uj = v->total_energy_uj;
+    }
+    if (!(v->valid & POWERCAP_SAMPLER_ZONE_POWER)) {
+      continue;
+    }
+    if ((ret = powercap_digest_add(&zs->power_uw, v->power_uw))) {
+      return ret;
+    }
+    zs->power_ns += snap->elapsed_ns;
+    for (j = 0; j < r->nthresholds; j++) {
+      if (v->power_uw > r->thresholds_uw[j]) {
+        zs->above_ns[j] += snap->elapsed_ns;
+      }
+    }
+    for (j = z->constraint_index; j < z->constraint_index + z->nconstraints; j++) {
+      cv = &snap->constraints[j];
+      if ((cv->valid & POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT) && cv->power_limit_uw) {
+        r->limit_ns[j] += snap->elapsed_ns;
+        if (v->power_uw >= cv->power_limit_uw) {
+          r->cap_ns[j] += snap->elapsed_ns;
+        }
+      }
+    }
+  }
+  r->duration_ns = snap->time_ns;
+  r->nrecords++;
+  return 0;
+}
+
+static double percentile(const zone_stats* zs, double p) {
+  uint64_t uw = 0;
+  powercap_digest_quantile(&zs->power_uw, p / 100.0, &uw);
+  return uw / 1000000.0;
+}
+
+static void print_zone(const report* r, uint32_t i) {
+  const binary_zone* z = &r->header.zones[i];
+  const zone_stats* zs = &r->zones[i];
+  const binary_constraint* c;
+  uint32_t j;
+  printf("Zone %s", z->control_type);
+  for (j = 0; j < z->depth; j++) {
+    printf(":%"PRIu32, z->zones[j]);
+  }
+  if (z->name[0]) {
+    printf(" (%s)", z->name);
+  }
+  printf("\n");
+  printf("  Energy: %.6f J\n", zs->energy_uj / 1000000.0);
+  if (!zs->power_uw.count) {
+    printf("  Power: not available\n");
+    return;
+  }
+  printf("  Average power: %.3f W\n", zs->power_ns > 0 ? zs->energy_uj * 1000.0 / zs->power_ns : 0);
+  printf("  Peak power: %.3f W\n", zs->power_uw.max / 1000000.0);
+  printf("  Power percentiles: p50 %.3f W, p90 %.3f W, p99 %.3f W\n",
+         percentile(zs, 50), percentile(zs, 90), percentile(zs, 99));
+  for (j = 0; j < r->nthresholds; j++) {
+    printf("  Time above %.3f W: %.3f s (%.1f%%)\n", r->thresholds_uw[j] / 1000000.0, zs->above_ns[j] / 1e9,
+           zs->power_ns > 0 ? 100.0 * zs->above_ns[j] / zs->power_ns : 0);
+  }
+  for (j = 0; j < z->nconstraints; j++) {
+    c = &z->constraints[j];
+    if (r->limit_ns[z->constraint_index + j] > 0) {
+      printf("  Constraint %"PRIu32" (%s) time at or above limit: %.3f s (%.1f%%)\n", c->num,
+             c->name[0] ? c->name : "unnamed", r->cap_ns[z->constraint_index + j] / 1e9,
+             100.0 * r->cap_ns[z->constraint_index + j] / r->limit_ns[z->constraint_index + j]);
+    }
+  }
+}
+
+static int read_recording(FILE* f, report* r) {
+  powercap_sampler_snapshot snap;
+  uint32_t i;
+  int ret;
+  if ((ret = binary_read_header(f, &r->header))) {
+    return ret;
+  }
+  if ((r->zones = calloc(r->header.nzones ? r->header.nzones : 1, sizeof(zone_stats))) == NULL ||
+      (r->cap_ns = calloc(r->header.nconstraints ? r->header.nconstraints : 1, sizeof(int64_t))) == NULL ||
+      (r->limit_ns = calloc(r->header.nconstraints ? r->header.nconstraints : 1, sizeof(int64_t))) == NULL) {
+    return -errno;
+  }
+  for (i = 0; i < r->header.nzones; i++) {
+    powercap_digest_init(&r->zones[i].power_uw);
+  }
+  if ((ret = binary_snapshot_init(&r->header, &snap))) {
+    return ret;
+  }
+  while ((ret = binary_read_record(f, &r->header, &snap)) > 0) {
+    if ((ret = accumulate(r, &snap))) {
+      break;
+    }
+  }
+  powercap_sampler_snapshot_destroy(&snap);
+  return ret;
+}
+
+static void report_destroy(report* r) {
+  free(r->zones);
+  free(r->cap_ns);
+  free(r->limit_ns);
+  binary_header_destroy(&r->header);
+}
+
+int main(int argc, char** argv) {
+  const char* file = NULL;
+  report r;
+  FILE* f;
+  uint32_t i;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  memset(&r, 0, sizeof(report));
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'f':
+      if (file) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      file = optarg;
+      break;
+    case 't':
+      if (r.nthresholds == MAX_THRESHOLDS) {
+        cont = 0;
+        ret = -EINVAL;
+        break;
+      }
+      ret = parse_watts(optarg, &r.thresholds_uw[r.nthresholds++], &cont);
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (!file) {
+    fprintf(stderr, "Must specify -f/--file\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+
+  if (!strcmp(file, "-")) {
+    f = stdin;
+  } else if ((f = fopen(file, "rb")) == NULL) {
+    ret = -errno;
+    perror("Failed to open recording");
+    return ret;
+  }
+  if ((ret = read_recording(f, &r))) {
+    errno = -ret;
+    perror(errno == EINVAL ? "Invalid or truncated recording" : "Failed to read recording");
+  }
+  if (f != stdin) {
+    fclose(f);
+  }
+  /* a truncated recording, e.g., from an interrupted writer, is still summarized up to the last full record */
+  if (r.nrecords) {
+    printf("Recording: %"PRIu32" zone(s), %"PRIu64" samples, %.3f s\n", r.header.nzones, r.nrecords,
+           r.duration_ns / 1e9);
+    for (i = 0; i < r.header.nzones; i++) {
+      print_zone(&r, i);
+    }
+  }
+  report_destroy(&r);
+  return ret;
+}
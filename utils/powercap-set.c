@@ -10,9 +10,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "powercap-sysfs.h"
+#include "util-batch.h"
 #include "util-common.h"
 
-static const char short_options[] = "hp:z:c:je:l:s:";
+static const char short_options[] = "hp:z:c:je:l:s:b:n";
 static const struct option long_options[] = {
   {"help",                no_argument,        NULL, 'h'},
   {"package",             required_argument,  NULL, 'p'},
@@ -23,11 +24,14 @@ static const struct option long_options[] = {
   {"z-enabled",           required_argument,  NULL, 'e'},
   {"c-power-limit",       required_argument,  NULL, 'l'},
   {"c-time-window",       required_argument,  NULL, 's'},
+  {"batch",               required_argument,  NULL, 'b'},
+  {"dry-run",             no_argument,        NULL, 'n'},
   {0, 0, 0, 0}
 };
 
 static void print_usage(void) {
   printf("Usage: powercap-set -p NAME -z ZONE(S) [OPTION]...\n");
+  printf("   or: powercap-set -p NAME -b FILE [-n]\n");
   printf("Options:\n");
   printf("  -h, --help                   Print this message and exit\n");
   printf("  -p, --control-type=NAME      [REQUIRED] The powercap control type name\n");
@@ -43,6 +47,13 @@ static void print_usage(void) {
   printf("The following constraint-level arguments may be used together and require -c/--constraint:\n");
   printf("  -l, --c-power-limit=UW       Set constraint power limit\n");
   printf("  -s, --c-time-window=US       Set constraint time window\n");
+  printf("The following arguments replace all of the above except -p/--control-type:\n");
+  printf("  -b, --batch=FILE             Apply the settings in FILE, or - for stdin\n");
+  printf("  -n, --dry-run                Validate the batch settings and print them, but don't apply them\n");
+  printf("\nEach batch line is a zone followed by settings, where any zone number may be '*' for all zones:\n");
+  printf("  ZONE(S) [z-energy] [z-enabled=1|0] [constraint=NUM|NAME|* [c-power-limit=UW] [c-time-window=US]]\n");
+  printf("E.g., to limit constraint 0 of all top-level zones: \"* constraint=0 c-power-limit=50000000\"\n");
+  printf("All settings are validated before any are applied.\n");
   printf("\nPower units: microwatts (uW)\n");
   printf("Time units: microseconds (us)\n");
 }
@@ -62,6 +73,8 @@ int main(int argc, char** argv) {
   u32_param enabled = {0, 0};
   u64_param power_limit = {0, 0};
   u64_param time_window = {0, 0};
+  const char* batch_file = NULL;
+  int dry_run = 0;
   int c;
   int cont = 1;
   int ret = 0;
@@ -105,6 +118,16 @@ int main(int argc, char** argv) {
     case 's':
       ret = set_u64_param(&time_window, optarg, &cont);
       break;
+    case 'b':
+      if (batch_file) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      batch_file = optarg;
+      break;
+    case 'n':
+      dry_run = 1;
+      break;
     case '?':
     default:
       cont = 0;
@@ -119,6 +142,14 @@ int main(int argc, char** argv) {
   } else if (!is_valid_control_type(control_type)) {
     fprintf(stderr, "Must specify -p/--control-type; value must not be empty or contain any '.' or '/' characters\n");
     ret = -EINVAL;
+  } else if (batch_file) {
+    if (depth || constraint.set || reset_energy || enabled.set || power_limit.set || time_window.set) {
+      fprintf(stderr, "-b/--batch cannot be used with -z/--zone, -c/--constraint, or zone/constraint-level arguments\n");
+      ret = -EINVAL;
+    }
+  } else if (dry_run) {
+    fprintf(stderr, "-n/--dry-run requires -b/--batch\n");
+    ret = -EINVAL;
   } else if (!depth) {
     fprintf(stderr, "Must specify -z/--zone\n");
     ret = -EINVAL;
@@ -139,6 +170,13 @@ int main(int argc, char** argv) {
     return ret;
   }
 
+  if (batch_file) {
+    if ((ret = batch_run(control_type, MAX_ZONE_DEPTH, 1, batch_file, dry_run))) {
+      print_common_help();
+    }
+    return ret;
+  }
+
   /* Check if control type/zones/constraint exist */
   if (powercap_sysfs_control_type_exists(control_type)) {
     fprintf(stderr, "Control type does not exist\n");
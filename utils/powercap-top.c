@@ -0,0 +1,395 @@
+/**
+ * Interactive per-zone power monitor.
+ *
+ * All zones are discovered and opened once, then each interval only their energy counters, power limits, and time
+ * windows are re-read.
+ * Each frame is written to the terminal at once.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-sampler.h"
+#include "powercap-sysfs.h"
+#include "util-common.h"
+#include "util-format.h"
+#include "util-watch.h"
+
+#define CLEAR_SCREEN "\033[H\033[2J"
+
+typedef struct top {
+  powercap_sampler sampler;
+  powercap_sampler_snapshot snap;
+  /* time each constraint has spent at its limit since start_ns */
+  int64_t* cap_ns;
+  int64_t start_ns;
+  uint64_t interval_us;
+  double threshold;
+  int batch;
+  output_buffer out;
+} top;
+
+static volatile sig_atomic_t stop;
+
+static struct termios saved_termios;
+static int have_termios;
+
+static const char short_options[] = "hp:d:n:t:b";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"control-type",        required_argument,  NULL, 'p'},
+  {"delay",               required_argument,  NULL, 'd'},
+  {"iterations",          required_argument,  NULL, 'n'},
+  {"threshold",           required_argument,  NULL, 't'},
+  {"batch",               no_argument,        NULL, 'b'},
+  {0, 0, 0, 0}
+};
+
+static void print_usage(void) {
+  printf("Usage: powercap-top [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -p, --control-type=NAME      Only show zones of this control type (all by default)\n");
+  printf("  -d, --delay=SECONDS          The refresh interval (1 by default)\n");
+  printf("                               Fractional seconds are allowed, e.g., 0.1 for 10 Hz\n");
+  printf("  -n, --iterations=N           Exit after N refreshes (run until interrupted by default)\n");
+  printf("  -t, --threshold=PERCENT      Count time at cap while power is at least this percent\n");
+  printf("                               of a constraint's power limit (95 by default)\n");
+  printf("  -b, --batch                  Append plain frames instead of refreshing the terminal\n");
+  printf("\nIn interactive mode, press 'q' to quit or 'r' to reset time-at-cap counters.\n");
+  printf("Power is derived from energy counters over each interval; '-' marks values that aren't available.\n");
+}
+
+static void print_common_help(void) {
+  printf("Considerations for common errors:\n");
+  printf("- Ensure that a powercap control type exists (may require loading a kernel module, e.g., intel_rapl)\n");
+}
+
+static void handle_signal(int sig) {
+  (void) sig;
+  stop = 1;
+}
+
+static void restore_terminal(void) {
+  if (have_termios) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+    have_termios = 0;
+  }
+}
+
+/* Read single keypresses without echo */
+static void setup_terminal(void) {
+  struct termios t;
+  if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_termios)) {
+    return;
+  }
+  t = saved_termios;
+  t.c_lflag &= (tcflag_t) ~(ICANON | ECHO);
+  t.c_cc[VMIN] = 1;
+  t.c_cc[VTIME] = 0;
+  if (!tcsetattr(STDIN_FILENO, TCSANOW, &t)) {
+    have_termios = 1;
+  }
+}
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Sleep until the deadline; returns a key that was pressed in the meantime, 0 otherwise, or -1 if interrupted */
+static int wait_until(int64_t deadline_ns, int interactive) {
+  struct pollfd pfd;
+  struct timespec ts;
+  int64_t remaining;
+  char key;
+  int ret;
+  while (!stop) {
+    if (interactive) {
+      if ((remaining = deadline_ns - now_ns()) <= 0) {
+        return 0;
+      }
+      pfd.fd = STDIN_FILENO;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      ret = poll(&pfd, 1, (int) ((remaining + 999999) / 1000000));
+      if (ret == 0) {
+        return 0;
+      }
+      if (ret > 0) {
+        if (read(STDIN_FILENO, &key, 1) == 1) {
+          return (unsigned char) key;
+        }
+        /* stdin closed, stop polling it */
+        interactive = 0;
+      }
+    } else {
+      ts.tv_sec = (time_t) (deadline_ns / 1000000000);
+      ts.tv_nsec = (long) (deadline_ns % 1000000000);
+      if (!clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {
+        return 0;
+      }
+    }
+  }
+  return -1;
+}
+
+static void reset_caps(top* t) {
+  memset(t->cap_ns, 0, (t->sampler.nconstraints ? t->sampler.nconstraints : 1) * sizeof(int64_t));
+  t->start_ns = t->snap.time_ns;
+}
+
+static void update_caps(top* t) {
+  const powercap_sampler_zone* z;
+  const powercap_sampler_zone_values* v;
+  const powercap_sampler_constraint_values* cv;
+  uint32_t i;
+  uint32_t j;
+  for (i = 0; i < t->sampler.nzones; i++) {
+    z = &t->sampler.zones[i];
+    v = &t->snap.zones[i];
+    if (!(v->valid & POWERCAP_SAMPLER_ZONE_POWER)) {
+      continue;
+    }
+    for (j = z->constraint_index; j < z->constraint_index + z->nconstraints; j++) {
+      cv = &t->snap.constraints[j];
+      if ((cv->valid & POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT) && cv->power_limit_uw &&
+          v->power_uw >= cv->power_limit_uw * t->threshold) {
+        t->cap_ns[j] += t->snap.elapsed_ns;
+      }
+    }
+  }
+}
+
+static int render_zone(top* t, uint32_t i, double total_s) {
+  const powercap_sampler_zone* z = &t->sampler.zones[i];
+  const powercap_sampler_zone_values* v = &t->snap.zones[i];
+  const powercap_sampler_constraint_values* cv;
+  char label[64];
+  char power[16];
+  char limit[16];
+  char pct[16];
+  char cap[16];
+  size_t off;
+  uint32_t j;
+  int ret;
+  off = (size_t) snprintf(label, sizeof(label), "%s", z->control_type);
+  for (j = 0; j < z->depth && off < sizeof(label); j++) {
+    off += (size_t) snprintf(label + off, sizeof(label) - off, ":%"PRIu32, z->zones[j]);
+  }
+  if (v->valid & POWERCAP_SAMPLER_ZONE_POWER) {
+    snprintf(power, sizeof(power), "%.3f", v->power_uw / 1000000.0);
+  } else {
+    snprintf(power, sizeof(power), "-");
+  }
+  if ((ret = output_buffer_printf(&t->out, "%-20.20s %-16.16s %10s", label, z->name, power))) {
+    return ret;
+  }
+  for (j = 0; j < z->nconstraints; j++) {
+    cv = &t->snap.constraints[z->constraint_index + j];
+    snprintf(limit, sizeof(limit), "-");
+    snprintf(pct, sizeof(pct), "-");
+    if ((cv->valid & POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT) && cv->power_limit_uw) {
+      snprintf(limit, sizeof(limit), "%.3f", cv->power_limit_uw / 1000000.0);
+      if (v->valid & POWERCAP_SAMPLER_ZONE_POWER) {
+        snprintf(pct, sizeof(pct), "%.1f", 100.0 * v->power_uw / cv->power_limit_uw);
+      }
+    }
+    snprintf(cap, sizeof(cap), "%.1f", total_s > 0 ? 100.0 * t->cap_ns[z->constraint_index + j] / 1e9 / total_s : 0);
+    /* constraints after the first go on their own lines, under the first */
+    if ((j && (ret = output_buffer_printf(&t->out, "%48s", ""))) ||
+        (ret = output_buffer_printf(&t->out, "  %-12.12s %10s %7s %8s\n",
+                                    z->constraints[j].name[0] ? z->constraints[j].name : "-", limit, pct, cap))) {
+      return ret;
+    }
+  }
+  return z->nconstraints ? 0 : output_buffer_printf(&t->out, "\n");
+}
+
+static int render(top* t) {
+  double total_s = (t->snap.time_ns - t->start_ns) / 1000000000.0;
+  uint32_t i;
+  int ret;
+  if ((!t->batch && (ret = output_buffer_printf(&t->out, CLEAR_SCREEN))) ||
+      (ret = output_buffer_printf(&t->out, "powercap-top - %.1f s, interval %.3f s, at cap: power >= %.0f%% of limit\n\n",
+                                  total_s, t->interval_us / 1000000.0, t->threshold * 100)) ||
+      (ret = output_buffer_printf(&t->out, "%-20s %-16s %10s  %-12s %10s %7s %8s\n", "ZONE", "NAME", "POWER (W)",
+                                  "CONSTRAINT", "LIMIT (W)", "LIMIT %", "AT CAP %"))) {
+    return ret;
+  }
+  for (i = 0; i < t->sampler.nzones; i++) {
+    if ((ret = render_zone(t, i, total_s))) {
+      return ret;
+    }
+  }
+  if (t->batch && (ret = output_buffer_printf(&t->out, "\n"))) {
+    return ret;
+  }
+  return output_buffer_flush(&t->out, STDOUT_FILENO);
+}
+
+static int run(top* t, uint64_t iterations) {
+  const uint32_t flags = POWERCAP_SAMPLER_READ_ENERGY | POWERCAP_SAMPLER_READ_LIMITS;
+  int interactive = !t->batch && have_termios;
+  int64_t next_ns;
+  uint64_t n;
+  int key;
+  int ret;
+  if ((ret = powercap_sampler_sample(&t->sampler, &t->snap, flags))) {
+    return ret;
+  }
+  reset_caps(t);
+  next_ns = t->snap.time_ns;
+  for (n = 0; !iterations || n < iterations; n++) {
+    next_ns += (int64_t) t->interval_us * 1000;
+    while ((key = wait_until(next_ns, interactive)) > 0) {
+      if (key == 'q') {
+        return 0;
+      } else if (key == 'r') {
+        reset_caps(t);
+      }
+    }
+    if (key < 0) {
+      /* interrupted */
+      return 0;
+    }
+    if ((ret = powercap_sampler_sample(&t->sampler, &t->snap, flags))) {
+      return ret;
+    }
+    update_caps(t);
+    if ((ret = render(t))) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  const char* control_type = NULL;
+  u64_param iterations = {0, 0};
+  u32_param threshold = {95, 0};
+  struct sigaction sa;
+  top t;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  memset(&t, 0, sizeof(top));
+  t.interval_us = 1000000;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'p':
+      if (control_type) {
+        fprintf(stderr, "Only one control type may be specified\n");
+        cont = 0;
+        ret = -EINVAL;
+        break;
+      }
+      control_type = optarg;
+      break;
+    case 'd':
+      ret = watch_parse_interval(optarg, &t.interval_us, &cont);
+      break;
+    case 'n':
+      ret = set_u64_param(&iterations, optarg, &cont);
+      break;
+    case 't':
+      ret = set_u32_param(&threshold, optarg, &cont);
+      break;
+    case 'b':
+      t.batch = 1;
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (control_type && !is_valid_control_type(control_type)) {
+    fprintf(stderr, "-p/--control-type must not be empty or contain any '.' or '/' characters\n");
+    ret = -EINVAL;
+  } else if (iterations.set && !iterations.val) {
+    fprintf(stderr, "-n/--iterations must be > 0\n");
+    ret = -EINVAL;
+  } else if (!threshold.val || threshold.val > 100) {
+    fprintf(stderr, "-t/--threshold must be in range (0, 100]\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+  t.threshold = threshold.val / 100.0;
+
+  /* Discover and open zones */
+  powercap_sampler_init(&t.sampler);
+  if (control_type && powercap_sysfs_control_type_exists(control_type)) {
+    fprintf(stderr, "Control type does not exist\n");
+    ret = -EINVAL;
+  } else if ((ret = control_type ? powercap_sampler_add_zone_tree(&t.sampler, control_type, NULL, 0, 1)
+                                 : add_all_control_types(&t.sampler))) {
+    errno = -ret;
+    perror("Failed to open zone files");
+  } else if (!t.sampler.nzones) {
+    fprintf(stderr, "No zones found\n");
+    ret = -ENODEV;
+  }
+  if (ret) {
+    print_common_help();
+    powercap_sampler_destroy(&t.sampler);
+    return ret;
+  }
+
+  output_buffer_init(&t.out);
+  if ((ret = powercap_sampler_snapshot_init(&t.sampler, &t.snap))) {
+    perror("powercap_sampler_snapshot_init");
+  } else if ((t.cap_ns = calloc(t.sampler.nconstraints ? t.sampler.nconstraints : 1, sizeof(int64_t))) == NULL) {
+    ret = -errno;
+    perror("calloc");
+  } else {
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    if (!t.batch) {
+      setup_terminal();
+    }
+    if ((ret = run(&t, iterations.val))) {
+      errno = -ret;
+      perror("Failed to read zones");
+    }
+    restore_terminal();
+  }
+
+  free(t.cap_ns);
+  powercap_sampler_snapshot_destroy(&t.snap);
+  output_buffer_destroy(&t.out);
+  powercap_sampler_destroy(&t.sampler);
+  return ret;
+}
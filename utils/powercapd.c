@@ -0,0 +1,249 @@
+/**
+ * Serve RAPL energy readings and arbitrated cap requests to unprivileged local clients.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <grp.h>
+#include <inttypes.h>
+#include <pwd.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-daemon.h"
+#include "powercap-rapl.h"
+
+static const char short_options[] = "hs:m:g:f:";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"socket",              required_argument,  NULL, 's'},
+  {"mode",                required_argument,  NULL, 'm'},
+  {"group",               required_argument,  NULL, 'g'},
+  {"fd-group",            required_argument,  NULL, 'f'},
+  {0, 0, 0, 0}
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig) {
+  (void) sig;
+  running = 0;
+}
+
+static void print_usage(void) {
+  printf("Usage: powercapd [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -s, --socket=PATH            The socket to listen on (%s by default)\n", POWERCAP_DAEMON_DEFAULT_PATH);
+  printf("  -m, --mode=MODE              The socket's octal permissions (0660 by default)\n");
+  printf("  -g, --group=NAME             The socket's group (the daemon's group by default)\n");
+  printf("  -f, --fd-group=NAME          Pass read-only file descriptors to clients in this group (or root)\n");
+  printf("\nClients with access to the socket can read all zones' energy counters and lower power limits.\n");
+  printf("Each file descriptor and cap request is logged to stdout.\n");
+}
+
+static void print_common_help(void) {
+  printf("Considerations for common errors:\n");
+  printf("- Ensure that the intel_rapl kernel module is loaded\n");
+  printf("- Ensure that you run with administrative (super-user) privileges\n");
+}
+
+static int lookup_group(const char* name, gid_t* gid) {
+  const struct group* grp;
+  if ((grp = getgrnam(name)) == NULL) {
+    return -EINVAL;
+  }
+  *gid = grp->gr_gid;
+  return 0;
+}
+
+static int is_group_member(uid_t uid, gid_t gid, gid_t group) {
+  struct passwd* pw;
+  gid_t groups[256];
+  int ngroups = 256;
+  int i;
+  if (gid == group) {
+    return 1;
+  }
+  if ((pw = getpwuid(uid)) == NULL || getgrouplist(pw->pw_name, pw->pw_gid, groups, &ngroups) < 0) {
+    return 0;
+  }
+  for (i = 0; i < ngroups; i++) {
+    if (groups[i] == group) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Who may receive file descriptors; cap requests are allowed to all clients with access to the socket */
+typedef struct fd_policy {
+  int enabled;
+  gid_t gid;
+} fd_policy;
+
+/* Authorize and audit requests for file descriptors and caps */
+static int authorize(void* ctx, powercap_daemon_request request, pid_t pid, uid_t uid, gid_t gid, uint32_t pkg) {
+  const fd_policy* policy = (const fd_policy*) ctx;
+  int allow;
+  if (request == POWERCAP_DAEMON_REQUEST_CAPS) {
+    allow = 1;
+  } else {
+    allow = policy->enabled && (!uid || is_group_member(uid, gid, policy->gid));
+  }
+  printf("%ld: %s package %"PRIu32" %s for pid %ld, uid %lu, gid %lu\n", (long) time(NULL),
+         allow ? "allowing" : "denying", pkg, request == POWERCAP_DAEMON_REQUEST_CAPS ? "caps" : "file descriptors",
+         (long) pid, (unsigned long) uid, (unsigned long) gid);
+  fflush(stdout);
+  return allow;
+}
+
+static void destroy_pkgs(powercap_rapl_pkg* pkgs, uint32_t npkgs) {
+  for (; npkgs; npkgs--) {
+    powercap_rapl_destroy(&pkgs[npkgs - 1]);
+  }
+  free(pkgs);
+}
+
+static int init_pkgs(powercap_rapl_pkg** pkgs, uint32_t* npkgs) {
+  uint32_t i;
+  int ret = 0;
+  if (!(*npkgs = powercap_rapl_get_num_packages())) {
+    ret = errno ? -errno : -ENOENT;
+    perror("No RAPL packages found");
+    return ret;
+  }
+  if ((*pkgs = calloc(*npkgs, sizeof(powercap_rapl_pkg))) == NULL) {
+    ret = -errno;
+    perror("calloc");
+    return ret;
+  }
+  for (i = 0; i < *npkgs && !ret; i++) {
+    if ((ret = powercap_rapl_init(i, &(*pkgs)[i], 0))) {
+      perror("powercap_rapl_init");
+    }
+  }
+  if (ret) {
+    /* the package that failed cleaned up after itself */
+    destroy_pkgs(*pkgs, i - 1);
+  }
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  powercap_daemon d;
+  powercap_rapl_pkg* pkgs = NULL;
+  struct sigaction sa;
+  gid_t sock_gid = (gid_t) -1;
+  fd_policy policy = { 0, 0 };
+  const char* path = POWERCAP_DAEMON_DEFAULT_PATH;
+  const char* group = NULL;
+  const char* fd_group = NULL;
+  unsigned long mode = 0660;
+  char* end;
+  uint32_t npkgs = 0;
+  int lfd;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 's':
+      path = optarg;
+      break;
+    case 'm':
+      errno = 0;
+      mode = strtoul(optarg, &end, 8);
+      if (errno || end == optarg || *end || mode > 0777) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      break;
+    case 'g':
+      group = optarg;
+      break;
+    case 'f':
+      fd_group = optarg;
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (group && (ret = lookup_group(group, &sock_gid))) {
+    fprintf(stderr, "Unknown group: %s\n", group);
+  } else if (fd_group && (ret = lookup_group(fd_group, &policy.gid))) {
+    fprintf(stderr, "Unknown group: %s\n", fd_group);
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+
+  if ((ret = init_pkgs(&pkgs, &npkgs))) {
+    print_common_help();
+    return ret;
+  }
+  if ((lfd = powercap_daemon_listen(path)) < 0) {
+    ret = lfd;
+    perror("Failed to listen");
+    destroy_pkgs(pkgs, npkgs);
+    return ret;
+  }
+  if (chmod(path, (mode_t) mode) || (group && chown(path, (uid_t) -1, sock_gid))) {
+    ret = -errno;
+    perror("Failed to set socket permissions");
+    destroy_pkgs(pkgs, npkgs);
+  } else if ((ret = powercap_daemon_init(&d, lfd, pkgs, npkgs))) {
+    perror("powercap_daemon_init");
+    destroy_pkgs(pkgs, npkgs);
+  } else {
+    /* the daemon owns the packages now, but not the array */
+    free(pkgs);
+    policy.enabled = fd_group != NULL;
+    powercap_daemon_set_broker(&d, authorize, &policy);
+  }
+
+  if (!ret) {
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    while (running) {
+      /* a timeout bounds the delay of a signal that arrives just before polling */
+      if ((ret = powercap_daemon_poll(&d, 1000))) {
+        perror("powercap_daemon_poll");
+        running = 0;
+      }
+    }
+    /* restores power limits */
+    if (powercap_daemon_destroy(&d) && !ret) {
+      ret = -errno;
+      perror("powercap_daemon_destroy");
+    }
+  }
+  close(lfd);
+  unlink(path);
+  return ret;
+}
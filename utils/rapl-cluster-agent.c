@@ -0,0 +1,250 @@
+/**
+ * Report RAPL package power to a powercap-cluster-coordinator and enforce the node cap it assigns.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-cluster.h"
+#include "powercap-rapl.h"
+#include "powercap-rapl-budget.h"
+#include "util-common.h"
+#include "util-socket.h"
+
+static const char short_options[] = "ha:n:m:i:";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"address",             required_argument,  NULL, 'a'},
+  {"node",                required_argument,  NULL, 'n'},
+  {"min",                 required_argument,  NULL, 'm'},
+  {"interval",            required_argument,  NULL, 'i'},
+  {0, 0, 0, 0}
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig) {
+  (void) sig;
+  running = 0;
+}
+
+static void print_usage(void) {
+  printf("Usage: rapl-cluster-agent [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -a, --address=ADDRESS        The coordinator's address (required)\n");
+  printf("  -n, --node=ID                This node's unique ID (required)\n");
+  printf("  -m, --min=UW                 The minimum power limit for each package (required)\n");
+  printf("  -i, --interval=MS            The reporting interval (1000 by default)\n");
+  printf("\nAddresses are either unix:PATH or HOST:PORT.\n");
+  printf("Package long-term power limits are restored on exit.\n");
+  printf("\nPower units: microwatts (uW)\n");
+  printf("Time units: milliseconds (ms)\n");
+}
+
+static void print_common_help(void) {
+  printf("Considerations for common errors:\n");
+  printf("- Ensure that the intel_rapl kernel module is loaded\n");
+  printf("- Ensure that you run with administrative (super-user) privileges\n");
+}
+
+static int64_t ms_until(const struct timespec* deadline) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t) (deadline->tv_sec - now.tv_sec) * 1000 + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+}
+
+static int run(powercap_rapl_budget* budget, const char* address, uint32_t node, uint32_t interval) {
+  powercap_cluster_agent agent;
+  powercap_cluster_node_info info;
+  powercap_cluster_report report;
+  struct timespec deadline;
+  int64_t timeout;
+  uint64_t cap;
+  uint32_t i;
+  int fd;
+  int ret;
+  info.id = node;
+  info.min_power_uw = 0;
+  info.max_power_uw = 0;
+  for (i = 0; i < budget->npkgs; i++) {
+    info.min_power_uw += budget->pkgs[i].min_power_uw;
+    info.max_power_uw += budget->pkgs[i].max_power_uw;
+  }
+  if ((fd = socket_connect(address)) < 0) {
+    perror("Failed to connect to coordinator");
+    return fd;
+  }
+  if ((ret = powercap_cluster_agent_init(&agent, fd, &info, 1))) {
+    perror("Failed to register with coordinator");
+    close(fd);
+    return ret;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  while (running && !ret) {
+    deadline.tv_sec += interval / 1000;
+    deadline.tv_nsec += (long) (interval % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+    while (running && !ret && (timeout = ms_until(&deadline)) > 0) {
+      if ((ret = powercap_cluster_agent_recv(&agent, (int) timeout)) > 0) {
+        powercap_cluster_agent_get_cap(&agent, node, &cap);
+        powercap_rapl_budget_set_budget(budget, cap);
+        ret = 0;
+      } else if (ret < 0) {
+        perror("Failed to receive from coordinator");
+      }
+    }
+    if (running && !ret) {
+      if ((ret = powercap_rapl_budget_update(budget)) == -EAGAIN) {
+        ret = 0;
+      } else if (ret) {
+        perror("Failed to update package power limits");
+      } else {
+        report.id = node;
+        report.power_uw = 0;
+        report.demand_uw = 0;
+        for (i = 0; i < budget->npkgs; i++) {
+          report.power_uw += budget->pkgs[i].power_uw;
+          report.demand_uw += budget->pkgs[i].demand_uw;
+        }
+        if ((ret = powercap_cluster_agent_report(&agent, &report, 1))) {
+          perror("Failed to report to coordinator");
+        }
+      }
+    }
+  }
+  powercap_cluster_agent_destroy(&agent);
+  close(fd);
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  powercap_rapl_budget budget;
+  powercap_rapl_budget_config cfg;
+  powercap_rapl_pkg* pkgs = NULL;
+  uint64_t* limits = NULL;
+  struct sigaction sa;
+  const char* address = NULL;
+  u32_param node = {0, 0};
+  u64_param min = {0, 0};
+  u32_param interval = {1000, 0};
+  uint32_t npkgs;
+  uint32_t ninit = 0;
+  uint32_t i;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'a':
+      address = optarg;
+      break;
+    case 'n':
+      ret = set_u32_param(&node, optarg, &cont);
+      break;
+    case 'm':
+      ret = set_u64_param(&min, optarg, &cont);
+      break;
+    case 'i':
+      ret = set_u32_param(&interval, optarg, &cont);
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (address == NULL || !node.set || !min.set) {
+    fprintf(stderr, "Must specify -a/--address, -n/--node, and -m/--min\n");
+    ret = -EINVAL;
+  } else if (!interval.val) {
+    fprintf(stderr, "Interval must be > 0\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+
+  if (!(npkgs = powercap_rapl_get_num_packages())) {
+    perror("Failed to get number of packages");
+    print_common_help();
+    return -ENODEV;
+  }
+  if ((pkgs = calloc(npkgs, sizeof(powercap_rapl_pkg))) == NULL ||
+      (limits = calloc(npkgs, sizeof(uint64_t))) == NULL) {
+    perror("calloc");
+    free(pkgs);
+    return -ENOMEM;
+  }
+  for (ninit = 0; ninit < npkgs; ninit++) {
+    if ((ret = powercap_rapl_init(ninit, &pkgs[ninit], 0))) {
+      perror("Failed to initialize package");
+      print_common_help();
+      break;
+    }
+    if ((ret = powercap_rapl_get_power_limit_uw(&pkgs[ninit], POWERCAP_RAPL_ZONE_PACKAGE,
+                                                POWERCAP_RAPL_CONSTRAINT_LONG, &limits[ninit]))) {
+      perror("Failed to get package power limit");
+      powercap_rapl_destroy(&pkgs[ninit]);
+      break;
+    }
+  }
+
+  if (!ret) {
+    /* start from the current limits; the coordinator's first cap will replace this budget */
+    powercap_rapl_budget_config_default(&cfg);
+    cfg.min_power_uw = min.val;
+    for (i = 0; i < npkgs; i++) {
+      cfg.budget_uw += limits[i];
+    }
+    if ((ret = powercap_rapl_budget_init(&budget, pkgs, npkgs, &cfg))) {
+      perror("Failed to initialize power budget");
+    } else {
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = handle_signal;
+      sigaction(SIGINT, &sa, NULL);
+      sigaction(SIGTERM, &sa, NULL);
+      ret = run(&budget, address, node.val, interval.val);
+      powercap_rapl_budget_destroy(&budget);
+    }
+    for (i = 0; i < npkgs; i++) {
+      if (powercap_rapl_set_power_limit_uw(&pkgs[i], POWERCAP_RAPL_ZONE_PACKAGE, POWERCAP_RAPL_CONSTRAINT_LONG,
+                                           limits[i])) {
+        perror("Failed to restore power limit");
+      }
+    }
+  }
+
+  for (i = 0; i < ninit; i++) {
+    powercap_rapl_destroy(&pkgs[i]);
+  }
+  free(limits);
+  free(pkgs);
+  return ret;
+}
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include "powercap-rapl-sysfs.h"
 #include "util-common.h"
+#include "util-watch.h"
 
 static void print_headers(uint32_t pkg, uint32_t do_pkg, uint32_t sz, int is_sz) {
   if (do_pkg) {
@@ -104,7 +105,7 @@ static void print_num_subzones(uint32_t pkg) {
   printf("%"PRIu32"\n", sz);
 }
 
-static const char short_options[] = "hvnp:z:c:jJexlsUy";
+static const char short_options[] = "hvnp:z:c:i:f:mjJexlsUy";
 static const struct option long_options[] = {
   {"help",                no_argument,        NULL, 'h'},
   {"verbose",             no_argument,        NULL, 'v'},
@@ -112,6 +113,9 @@ static const struct option long_options[] = {
   {"package",             required_argument,  NULL, 'p'},
   {"subzone",             required_argument,  NULL, 'z'},
   {"constraint",          required_argument,  NULL, 'c'},
+  {"watch",               required_argument,  NULL, 'i'},
+  {"format",              required_argument,  NULL, 'f'},
+  {"telemetry",           no_argument,        NULL, 'm'},
   {"z-energy",            no_argument,        NULL, 'j'},
   {"z-max-energy-range",  no_argument,        NULL, 'J'},
   {"z-enabled",           no_argument,        NULL, 'e'},
@@ -134,6 +138,15 @@ static void print_usage(void) {
   printf("                               E.g., for package 0, but not subzones: \"-p 0:\"\n");
   printf("  -z, --subzone=SUBZONE        The package subzone number (none by default)\n");
   printf("  -c, --constraint=CONSTRAINT  The constraint number (none by default)\n");
+  printf("  -i, --watch=SECONDS          Keep files open and print zone power and any changed\n");
+  printf("                               energy/enabled/limit values every interval\n");
+  printf("                               Cannot be used with -c/--constraint or the options below\n");
+  printf("  -f, --format=FORMAT          Output format: text (default), json, csv, or binary\n");
+  printf("                               Non-text formats print all zones and constraints once,\n");
+  printf("                               or every interval with -i/--watch\n");
+  printf("                               Cannot be used with -c/--constraint or the options below\n");
+  printf("  -m, --telemetry              Also watch CPU frequencies, idle states, and thermal zones\n");
+  printf("                               Requires -i/--watch or -f/--format=json\n");
   printf("All remaining options below are mutually exclusive:\n");
   printf("  -n, --nzones                 Print the number of packages found, or the number\n");
   printf("                               of subzones found if -p/--package is set\n");
@@ -165,6 +178,12 @@ int main(int argc, char** argv) {
   u32_param package = {0, 0};
   u32_param subzone = {0, 0};
   u32_param constraint = {0, 0};
+  uint32_t zones[2];
+  uint64_t interval_us = 0;
+  output_format format = OUTPUT_FORMAT_TEXT;
+  int format_set = 0;
+  int telemetry = 0;
+  watch w;
   int recurse = 1;
   int verbose = 0;
   int unique_set = 0;
@@ -198,6 +217,26 @@ int main(int argc, char** argv) {
     case 'c':
       ret = set_u32_param(&constraint, optarg, &cont);
       break;
+    case 'i':
+      if (interval_us) {
+        cont = 0;
+        ret = -EINVAL;
+        break;
+      }
+      ret = watch_parse_interval(optarg, &interval_us, &cont);
+      break;
+    case 'f':
+      if (format_set) {
+        cont = 0;
+        ret = -EINVAL;
+        break;
+      }
+      format_set = 1;
+      ret = parse_output_format(optarg, &format, &cont);
+      break;
+    case 'm':
+      telemetry = 1;
+      break;
     case 'n':
     case 'j':
     case 'J':
@@ -228,6 +267,13 @@ int main(int argc, char** argv) {
   /* Verify argument combinations */
   if (ret) {
     fprintf(stderr, "Unknown or duplicate arguments\n");
+  } else if ((interval_us || format != OUTPUT_FORMAT_TEXT) && (constraint.set || unique_set)) {
+    fprintf(stderr, "-i/--watch and -f/--format cannot be used with -c/--constraint or zone/constraint-specific outputs\n");
+    ret = -EINVAL;
+  } else if (telemetry && (format == OUTPUT_FORMAT_TEXT ? !interval_us : format != OUTPUT_FORMAT_JSON)) {
+    /* CSV and binary have fixed schemas with no place for other telemetry */
+    fprintf(stderr, "-m/--telemetry requires -i/--watch with text output, or -f/--format=json\n");
+    ret = -EINVAL;
   } else {
     switch (unique_set) {
     case 'n':
@@ -280,7 +326,29 @@ int main(int argc, char** argv) {
   }
 
   /* Perform requested action */
-  if (unique_set) {
+  if (interval_us || format != OUTPUT_FORMAT_TEXT) {
+    /* Open files once, then print a snapshot, or power and changed values every interval until interrupted */
+    zones[0] = package.val;
+    zones[1] = subzone.val;
+    if (!(ret = watch_init(&w, format))) {
+      if (subzone.set) {
+        ret = watch_add_zone_tree(&w, "intel-rapl", zones, 2, 0);
+      } else {
+        ret = watch_add_zone_tree(&w, "intel-rapl", zones, package.set ? 1 : 0, recurse);
+      }
+      if (!ret && telemetry) {
+        ret = watch_add_telemetry(&w);
+      }
+    }
+    if (ret) {
+      errno = -ret;
+      perror("Failed to open zone files");
+    } else if ((ret = interval_us ? watch_run(&w, interval_us) : watch_once(&w))) {
+      errno = -ret;
+      perror("Failed to read zones");
+    }
+    watch_destroy(&w);
+  } else if (unique_set) {
     switch (unique_set) {
     case 'n':
       /* Print number of packages or subzones */
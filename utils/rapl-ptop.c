@@ -0,0 +1,338 @@
+/**
+ * Per-process RAPL energy monitor.
+ *
+ * Packages and process stat files are opened once, then each interval only energy counters and changed process
+ * lists are re-read (see powercap-proc.h).
+ * Each frame is written to the terminal at once.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-proc.h"
+#include "powercap-rapl.h"
+#include "util-common.h"
+#include "util-format.h"
+#include "util-watch.h"
+
+#define CLEAR_SCREEN "\033[H\033[2J"
+#define DEFAULT_LINES 20
+
+typedef struct ptop {
+  powercap_proc proc;
+  /* sorted for display */
+  const powercap_proc_entry** entries;
+  uint32_t nentries_max;
+  int64_t start_ns;
+  int64_t time_ns;
+  uint64_t interval_us;
+  uint32_t lines;
+  int sort_total;
+  int batch;
+  output_buffer out;
+} ptop;
+
+static volatile sig_atomic_t stop;
+
+static const char short_options[] = "hd:n:l:ab";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"delay",               required_argument,  NULL, 'd'},
+  {"iterations",          required_argument,  NULL, 'n'},
+  {"lines",               required_argument,  NULL, 'l'},
+  {"accumulated",         no_argument,        NULL, 'a'},
+  {"batch",               no_argument,        NULL, 'b'},
+  {0, 0, 0, 0}
+};
+
+static void print_usage(void) {
+  printf("Usage: rapl-ptop [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -d, --delay=SECONDS          The refresh interval (1 by default)\n");
+  printf("                               Fractional seconds are allowed, e.g., 0.1 for 10 Hz\n");
+  printf("  -n, --iterations=N           Exit after N refreshes (run until interrupted by default)\n");
+  printf("  -l, --lines=N                Show the top N processes (%d by default)\n", DEFAULT_LINES);
+  printf("  -a, --accumulated            Sort by energy since start instead of power in the last interval\n");
+  printf("  -b, --batch                  Append plain frames instead of refreshing the terminal\n");
+  printf("\nEnergy is estimated from package and core energy counters, apportioned by each process's share\n");
+  printf("of busy CPU time. Processes that exited in the last interval are marked with '*'.\n");
+}
+
+static void print_common_help(void) {
+  printf("Considerations for common errors:\n");
+  printf("- Ensure that the intel_rapl kernel module is loaded\n");
+  printf("- Ensure that you have read access to the energy_uj files (may require administrative privileges)\n");
+}
+
+static void handle_signal(int sig) {
+  (void) sig;
+  stop = 1;
+}
+
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Returns 0 at the deadline, or -1 if interrupted */
+static int wait_until(int64_t deadline_ns) {
+  struct timespec ts;
+  ts.tv_sec = (time_t) (deadline_ns / 1000000000);
+  ts.tv_nsec = (long) (deadline_ns % 1000000000);
+  while (!stop) {
+    if (!clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/* Each process's stat file is held open, so allow as many as possible */
+static void raise_fd_limit(void) {
+  struct rlimit rl;
+  if (!getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+}
+
+static void destroy_pkgs(powercap_rapl_pkg* pkgs, uint32_t npkgs) {
+  for (; npkgs; npkgs--) {
+    powercap_rapl_destroy(&pkgs[npkgs - 1]);
+  }
+  free(pkgs);
+}
+
+static int init_pkgs(powercap_rapl_pkg** pkgs, uint32_t* npkgs) {
+  uint32_t i;
+  int ret = 0;
+  if (!(*npkgs = powercap_rapl_get_num_packages())) {
+    ret = errno ? -errno : -ENOENT;
+    perror("No RAPL packages found");
+    return ret;
+  }
+  if ((*pkgs = calloc(*npkgs, sizeof(powercap_rapl_pkg))) == NULL) {
+    ret = -errno;
+    perror("calloc");
+    return ret;
+  }
+  for (i = 0; i < *npkgs && !ret; i++) {
+    if ((ret = powercap_rapl_init(i, &(*pkgs)[i], 1))) {
+      perror("powercap_rapl_init");
+    }
+  }
+  if (ret) {
+    /* the package that failed cleaned up after itself */
+    destroy_pkgs(*pkgs, i - 1);
+  }
+  return ret;
+}
+
+static int compare_power(const void* a, const void* b) {
+  const powercap_proc_entry* x = *(const powercap_proc_entry* const*) a;
+  const powercap_proc_entry* y = *(const powercap_proc_entry* const*) b;
+  if (x->cpu_delta_ticks != y->cpu_delta_ticks) {
+    return x->cpu_delta_ticks < y->cpu_delta_ticks ? 1 : -1;
+  }
+  if (x->pkg_energy_uj != y->pkg_energy_uj) {
+    return x->pkg_energy_uj < y->pkg_energy_uj ? 1 : -1;
+  }
+  return x->pid < y->pid ? -1 : 1;
+}
+
+static int compare_total(const void* a, const void* b) {
+  const powercap_proc_entry* x = *(const powercap_proc_entry* const*) a;
+  const powercap_proc_entry* y = *(const powercap_proc_entry* const*) b;
+  if (x->pkg_energy_uj != y->pkg_energy_uj) {
+    return x->pkg_energy_uj < y->pkg_energy_uj ? 1 : -1;
+  }
+  return compare_power(a, b);
+}
+
+/* Share of the interval's energy, in W */
+static double share_w(const powercap_proc_entry* e, uint64_t delta_uj, uint64_t total_ticks, double interval_s) {
+  return total_ticks && interval_s > 0 ? delta_uj * ((double) e->cpu_delta_ticks / total_ticks) / 1e6 / interval_s : 0;
+}
+
+static int render(ptop* t, double interval_s) {
+  const powercap_proc* p = &t->proc;
+  const powercap_proc_entry** tmp;
+  const powercap_proc_entry* e;
+  uint64_t total_ticks = 0;
+  long ticks_per_s = sysconf(_SC_CLK_TCK);
+  double cpu_pct;
+  uint32_t n = 0;
+  uint32_t i;
+  int ret;
+  if (p->nentries > t->nentries_max) {
+    if ((tmp = realloc(t->entries, p->nentries * sizeof(*t->entries))) == NULL) {
+      return -errno;
+    }
+    t->entries = tmp;
+    t->nentries_max = p->nentries;
+  }
+  for (i = 0; i < p->nslots; i++) {
+    if (p->slots[i].pid) {
+      t->entries[n++] = &p->slots[i];
+      total_ticks += p->slots[i].cpu_delta_ticks;
+    }
+  }
+  /* the same denominator as powercap_proc_sample(...) */
+  if (p->busy_delta_ticks > total_ticks) {
+    total_ticks = p->busy_delta_ticks;
+  }
+  qsort(t->entries, n, sizeof(*t->entries), t->sort_total ? compare_total : compare_power);
+  if ((!t->batch && (ret = output_buffer_printf(&t->out, CLEAR_SCREEN))) ||
+      (ret = output_buffer_printf(&t->out, "rapl-ptop - %.1f s, interval %.3f s, %"PRIu32" processes, "
+                                  "package %.3f W, core %.3f W\n\n",
+                                  (t->time_ns - t->start_ns) / 1000000000.0, interval_s, n,
+                                  interval_s > 0 ? p->pkg_delta_uj / 1e6 / interval_s : 0,
+                                  interval_s > 0 ? p->core_delta_uj / 1e6 / interval_s : 0)) ||
+      (ret = output_buffer_printf(&t->out, "%10s %-16s %7s %10s %10s %12s %12s\n", "PID", "COMMAND", "CPU %",
+                                  "PKG (W)", "CORE (W)", "PKG (J)", "CORE (J)"))) {
+    return ret;
+  }
+  for (i = 0; i < n && i < t->lines; i++) {
+    e = t->entries[i];
+    cpu_pct = interval_s > 0 && ticks_per_s > 0 ? 100.0 * e->cpu_delta_ticks / ticks_per_s / interval_s : 0;
+    if ((ret = output_buffer_printf(&t->out, "%10"PRIu32"%c%-16s %7.1f %10.3f %10.3f %12.3f %12.3f\n",
+                                    e->pid, e->alive ? ' ' : '*', e->comm, cpu_pct,
+                                    share_w(e, p->pkg_delta_uj, total_ticks, interval_s),
+                                    share_w(e, p->core_delta_uj, total_ticks, interval_s),
+                                    e->pkg_energy_uj / 1e6, e->core_energy_uj / 1e6))) {
+      return ret;
+    }
+  }
+  if (t->batch && (ret = output_buffer_printf(&t->out, "\n"))) {
+    return ret;
+  }
+  return output_buffer_flush(&t->out, STDOUT_FILENO);
+}
+
+static int run(ptop* t, uint64_t iterations) {
+  int64_t next_ns;
+  int64_t prev_ns;
+  uint64_t n;
+  int ret;
+  if ((ret = powercap_proc_sample(&t->proc))) {
+    return ret;
+  }
+  t->start_ns = t->time_ns = next_ns = now_ns();
+  for (n = 0; !iterations || n < iterations; n++) {
+    next_ns += (int64_t) t->interval_us * 1000;
+    if (wait_until(next_ns)) {
+      /* interrupted */
+      return 0;
+    }
+    prev_ns = t->time_ns;
+    if ((ret = powercap_proc_sample(&t->proc))) {
+      return ret;
+    }
+    t->time_ns = now_ns();
+    if ((ret = render(t, (t->time_ns - prev_ns) / 1000000000.0))) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  u64_param iterations = {0, 0};
+  u32_param lines = {DEFAULT_LINES, 0};
+  powercap_rapl_pkg* pkgs = NULL;
+  uint32_t npkgs = 0;
+  struct sigaction sa;
+  ptop t;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  memset(&t, 0, sizeof(ptop));
+  t.interval_us = 1000000;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'd':
+      ret = watch_parse_interval(optarg, &t.interval_us, &cont);
+      break;
+    case 'n':
+      ret = set_u64_param(&iterations, optarg, &cont);
+      break;
+    case 'l':
+      ret = set_u32_param(&lines, optarg, &cont);
+      break;
+    case 'a':
+      t.sort_total = 1;
+      break;
+    case 'b':
+      t.batch = 1;
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (iterations.set && !iterations.val) {
+    fprintf(stderr, "-n/--iterations must be > 0\n");
+    ret = -EINVAL;
+  } else if (!lines.val) {
+    fprintf(stderr, "-l/--lines must be > 0\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+  t.lines = lines.val;
+
+  if ((ret = init_pkgs(&pkgs, &npkgs))) {
+    print_common_help();
+    return ret;
+  }
+  raise_fd_limit();
+  output_buffer_init(&t.out);
+  if ((ret = powercap_proc_init(&t.proc, NULL, pkgs, npkgs))) {
+    perror("powercap_proc_init");
+  } else {
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    if ((ret = run(&t, iterations.val))) {
+      errno = -ret;
+      perror("Failed to sample");
+    }
+    powercap_proc_destroy(&t.proc);
+  }
+
+  free(t.entries);
+  output_buffer_destroy(&t.out);
+  destroy_pkgs(pkgs, npkgs);
+  return ret;
+}
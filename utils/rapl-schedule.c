@@ -0,0 +1,304 @@
+/**
+ * Apply a timed RAPL power cap profile.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap.h"
+#include "powercap-rapl.h"
+#include "powercap-schedule.h"
+#include "util-common.h"
+
+#define MAX_TARGETS 64
+
+static const char short_options[] = "hf:t:s:nr";
+static const struct option long_options[] = {
+  {"help",                no_argument,        NULL, 'h'},
+  {"file",                required_argument,  NULL, 'f'},
+  {"target",              required_argument,  NULL, 't'},
+  {"spin",                required_argument,  NULL, 's'},
+  {"dry-run",             no_argument,        NULL, 'n'},
+  {"restore",             no_argument,        NULL, 'r'},
+  {0, 0, 0, 0}
+};
+
+static const char* ZONE_NAMES[] = { "package", "core", "uncore", "dram", "psys" };
+static const char* CONSTRAINT_NAMES[] = { "long", "short" };
+
+typedef struct target_spec {
+  uint32_t pkg;
+  powercap_rapl_zone zone;
+  powercap_rapl_constraint constraint;
+} target_spec;
+
+static void print_usage(void) {
+  printf("Usage: rapl-schedule [OPTION]...\n");
+  printf("Options:\n");
+  printf("  -h, --help                   Print this message and exit\n");
+  printf("  -f, --file=FILE              The schedule file, or - for stdin (required)\n");
+  printf("  -t, --target=PKG:ZONE:CONSTRAINT\n");
+  printf("                               A constraint the schedule refers to; repeat for each target, in order\n");
+  printf("                               ZONE is one of: package, core, uncore, dram, psys\n");
+  printf("                               CONSTRAINT is one of: long, short\n");
+  printf("  -s, --spin=US                Busy-wait this long before each step for lower jitter (0 by default)\n");
+  printf("  -n, --dry-run                Validate the schedule, but don't apply it\n");
+  printf("  -r, --restore                Restore the targets' original values when finished\n");
+  printf("\nEach schedule line is: OFFSET_US TARGET POWER_LIMIT_UW [TIME_WINDOW_US]\n");
+  printf("TARGET is the index of a -t/--target option; use - to leave a value unchanged; '#' starts a comment.\n");
+  printf("\nPower units: microwatts (uW)\n");
+  printf("Time units: microseconds (us)\n");
+}
+
+static void print_common_help(void) {
+  printf("Considerations for common errors:\n");
+  printf("- Ensure that the intel_rapl kernel module is loaded\n");
+  printf("- Ensure that you run with administrative (super-user) privileges\n");
+}
+
+static int parse_name(const char* s, size_t len, const char* const* names, uint32_t n, uint32_t* idx) {
+  for (*idx = 0; *idx < n; (*idx)++) {
+    if (strlen(names[*idx]) == len && !strncmp(s, names[*idx], len)) {
+      return 0;
+    }
+  }
+  return -EINVAL;
+}
+
+static int parse_target(const char* optarg, target_spec* t) {
+  const char* zone;
+  const char* constraint;
+  char* end;
+  uint32_t idx;
+  errno = 0;
+  t->pkg = strtoul(optarg, &end, 0);
+  if (end == optarg || *end != ':' || errno) {
+    return -EINVAL;
+  }
+  zone = end + 1;
+  if ((constraint = strchr(zone, ':')) == NULL ||
+      parse_name(zone, (size_t) (constraint - zone), ZONE_NAMES, 5, &idx)) {
+    return -EINVAL;
+  }
+  t->zone = (powercap_rapl_zone) idx;
+  constraint++;
+  if (parse_name(constraint, strlen(constraint), CONSTRAINT_NAMES, 2, &idx)) {
+    return -EINVAL;
+  }
+  t->constraint = (powercap_rapl_constraint) idx;
+  return 0;
+}
+
+static const powercap_constraint* get_constraint(const powercap_rapl_pkg* pkg, const target_spec* t) {
+  const powercap_rapl_zone_files* zf;
+  switch (t->zone) {
+  case POWERCAP_RAPL_ZONE_PACKAGE:
+    zf = &pkg->pkg;
+    break;
+  case POWERCAP_RAPL_ZONE_CORE:
+    zf = &pkg->core;
+    break;
+  case POWERCAP_RAPL_ZONE_UNCORE:
+    zf = &pkg->uncore;
+    break;
+  case POWERCAP_RAPL_ZONE_DRAM:
+    zf = &pkg->dram;
+    break;
+  case POWERCAP_RAPL_ZONE_PSYS:
+  default:
+    zf = &pkg->psys;
+    break;
+  }
+  return t->constraint == POWERCAP_RAPL_CONSTRAINT_LONG ? &zf->constraint_long : &zf->constraint_short;
+}
+
+static void print_report(const powercap_schedule_result* results, uint32_t nsteps) {
+  int64_t late;
+  int64_t max_late = 0;
+  int64_t sum_late = 0;
+  uint32_t i;
+  printf("step planned_us actual_us late_us write_us\n");
+  for (i = 0; i < nsteps; i++) {
+    late = results[i].actual_ns - results[i].planned_ns;
+    max_late = late > max_late ? late : max_late;
+    sum_late += late;
+    printf("%"PRIu32" %"PRId64".%03"PRId64" %"PRId64".%03"PRId64" %"PRId64".%03"PRId64" %"PRId64".%03"PRId64"\n", i,
+           results[i].planned_ns / 1000, results[i].planned_ns % 1000,
+           results[i].actual_ns / 1000, results[i].actual_ns % 1000,
+           late / 1000, late % 1000,
+           results[i].write_ns / 1000, results[i].write_ns % 1000);
+  }
+  if (nsteps) {
+    printf("late_us: mean=%.3f max=%.3f\n", sum_late / (nsteps * 1000.0), max_late / 1000.0);
+  }
+}
+
+int main(int argc, char** argv) {
+  target_spec specs[MAX_TARGETS];
+  const powercap_constraint* targets[MAX_TARGETS];
+  uint64_t saved_limits[MAX_TARGETS];
+  uint64_t saved_windows[MAX_TARGETS];
+  powercap_rapl_pkg* pkgs = NULL;
+  int* pkg_init = NULL;
+  powercap_schedule sched;
+  powercap_schedule_step* steps = NULL;
+  powercap_schedule_result* results = NULL;
+  const char* file = NULL;
+  u64_param spin = {0, 0};
+  uint32_t ntargets = 0;
+  uint32_t npkgs;
+  uint32_t nsteps = 0;
+  uint32_t bad;
+  uint32_t i;
+  int dry_run = 0;
+  int restore = 0;
+  FILE* f;
+  int c;
+  int cont = 1;
+  int ret = 0;
+
+  /* Parse command-line arguments */
+  while (cont) {
+    c = getopt_long(argc, argv, short_options, long_options, NULL);
+    switch (c) {
+    case -1:
+      cont = 0;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    case 'f':
+      file = optarg;
+      break;
+    case 't':
+      if (ntargets == MAX_TARGETS || parse_target(optarg, &specs[ntargets])) {
+        cont = 0;
+        ret = -EINVAL;
+      } else {
+        ntargets++;
+      }
+      break;
+    case 's':
+      ret = set_u64_param(&spin, optarg, &cont);
+      break;
+    case 'n':
+      dry_run = 1;
+      break;
+    case 'r':
+      restore = 1;
+      break;
+    case '?':
+    default:
+      cont = 0;
+      ret = -EINVAL;
+      break;
+    }
+  }
+
+  /* Verify argument combinations */
+  if (ret) {
+    fprintf(stderr, "Invalid arguments\n");
+  } else if (file == NULL || !ntargets) {
+    fprintf(stderr, "Must specify -f/--file and at least one -t/--target\n");
+    ret = -EINVAL;
+  }
+  if (ret) {
+    print_usage();
+    return ret;
+  }
+
+  /* Load the schedule */
+  if ((f = strcmp(file, "-") ? fopen(file, "r") : stdin) == NULL) {
+    perror(file);
+    return -errno;
+  }
+  ret = powercap_schedule_parse(f, &steps, &nsteps, &bad);
+  if (f != stdin) {
+    fclose(f);
+  }
+  if (ret) {
+    if (ret == -EINVAL) {
+      fprintf(stderr, "%s: syntax error on line %"PRIu32"\n", file, bad);
+    } else {
+      perror("Failed to read schedule");
+    }
+    return ret;
+  }
+
+  /* Open the targets */
+  if (!(npkgs = powercap_rapl_get_num_packages())) {
+    perror("Failed to get number of packages");
+    print_common_help();
+    free(steps);
+    return -ENODEV;
+  }
+  if ((pkgs = calloc(npkgs, sizeof(powercap_rapl_pkg))) == NULL || (pkg_init = calloc(npkgs, sizeof(int))) == NULL ||
+      (results = calloc(nsteps ? nsteps : 1, sizeof(powercap_schedule_result))) == NULL) {
+    perror("calloc");
+    ret = -ENOMEM;
+  }
+  for (i = 0; i < ntargets && !ret; i++) {
+    if (specs[i].pkg >= npkgs) {
+      fprintf(stderr, "Target %"PRIu32": package does not exist\n", i);
+      ret = -EINVAL;
+    } else if (!pkg_init[specs[i].pkg]) {
+      if ((ret = powercap_rapl_init(specs[i].pkg, &pkgs[specs[i].pkg], dry_run))) {
+        perror("Failed to initialize package");
+        print_common_help();
+      } else {
+        pkg_init[specs[i].pkg] = 1;
+      }
+    }
+    if (!ret && !powercap_rapl_is_constraint_supported(&pkgs[specs[i].pkg], specs[i].zone, specs[i].constraint)) {
+      fprintf(stderr, "Target %"PRIu32": constraint is not supported\n", i);
+      ret = -EINVAL;
+    }
+    if (!ret) {
+      targets[i] = get_constraint(&pkgs[specs[i].pkg], &specs[i]);
+      if (restore && (powercap_constraint_get_power_limit_uw(targets[i], &saved_limits[i]) ||
+                      powercap_constraint_get_time_window_us(targets[i], &saved_windows[i]))) {
+        perror("Failed to save original values");
+        ret = -errno;
+      }
+    }
+  }
+
+  /* Validate and run */
+  if (!ret && !(ret = powercap_schedule_init(&sched, targets, ntargets))) {
+    sched.spin_us = spin.val;
+    if ((ret = powercap_schedule_validate(&sched, steps, nsteps, &bad))) {
+      fprintf(stderr, "Invalid step %"PRIu32" (counting from 0, excluding blank lines): offsets must not decrease, "
+              "targets must exist, and values must be within the constraint's bounds\n", bad);
+    } else if (dry_run) {
+      printf("Schedule is valid: %"PRIu32" step(s)\n", nsteps);
+    } else {
+      if ((ret = powercap_schedule_run(&sched, steps, nsteps, results))) {
+        perror("Failed to apply schedule");
+      }
+      print_report(results, nsteps);
+      for (i = 0; i < ntargets && restore; i++) {
+        if (powercap_constraint_set_power_limit_uw(targets[i], saved_limits[i]) ||
+            powercap_constraint_set_time_window_us(targets[i], saved_windows[i])) {
+          perror("Failed to restore original values");
+        }
+      }
+    }
+    powercap_schedule_destroy(&sched);
+  }
+
+  for (i = 0; i < npkgs && pkg_init != NULL; i++) {
+    if (pkg_init[i]) {
+      powercap_rapl_destroy(&pkgs[i]);
+    }
+  }
+  free(results);
+  free(pkg_init);
+  free(pkgs);
+  free(steps);
+  return ret;
+}
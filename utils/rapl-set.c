@@ -10,9 +10,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "powercap-rapl-sysfs.h"
+#include "util-batch.h"
 #include "util-common.h"
 
-static const char short_options[] = "hp:z:c:e:l:s:";
+static const char short_options[] = "hp:z:c:e:l:s:b:n";
 static const struct option long_options[] = {
   {"help",                no_argument,        NULL, 'h'},
   {"package",             required_argument,  NULL, 'p'},
@@ -21,6 +22,8 @@ static const struct option long_options[] = {
   {"z-enabled",           required_argument,  NULL, 'e'},
   {"c-power-limit",       required_argument,  NULL, 'l'},
   {"c-time-window",       required_argument,  NULL, 's'},
+  {"batch",               required_argument,  NULL, 'b'},
+  {"dry-run",             no_argument,        NULL, 'n'},
   {0, 0, 0, 0}
 };
 
@@ -36,8 +39,15 @@ static void print_usage(void) {
   printf("The following constraint-level arguments may be used together and require -c/--constraint (-z/--subzone is optional):\n");
   printf("  -l, --c-power-limit=UW       Set constraint power limit\n");
   printf("  -s, --c-time-window=US       Set constraint time window\n");
+  printf("The following arguments replace all of the above:\n");
+  printf("  -b, --batch=FILE             Apply the settings in FILE, or - for stdin\n");
+  printf("  -n, --dry-run                Validate the batch settings and print them, but don't apply them\n");
   printf("\nA package is a zone with constraints.\n");
   printf("Subzones are a package's child domains, including power planes.\n");
+  printf("\nEach batch line is a package or package:subzone followed by settings, where either may be '*' for all:\n");
+  printf("  PACKAGE[:SUBZONE] [z-enabled=1|0] [constraint=NUM|NAME|* [c-power-limit=UW] [c-time-window=US]]\n");
+  printf("E.g., to limit all packages: \"* constraint=long_term c-power-limit=50000000\"\n");
+  printf("All settings are validated before any are applied.\n");
   printf("\nPower units: microwatts (uW)\n");
   printf("Time units: microseconds (us)\n");
 }
@@ -55,6 +65,8 @@ int main(int argc, char** argv) {
   u32_param enabled = {0, 0};
   u64_param power_limit = {0, 0};
   u64_param time_window = {0, 0};
+  const char* batch_file = NULL;
+  int dry_run = 0;
   int c;
   int cont = 1;
   int ret = 0;
@@ -87,6 +99,16 @@ int main(int argc, char** argv) {
     case 's':
       ret = set_u64_param(&time_window, optarg, &cont);
       break;
+    case 'b':
+      if (batch_file) {
+        cont = 0;
+        ret = -EINVAL;
+      }
+      batch_file = optarg;
+      break;
+    case 'n':
+      dry_run = 1;
+      break;
     case '?':
     default:
       cont = 0;
@@ -98,6 +120,14 @@ int main(int argc, char** argv) {
   /* Verify argument combinations */
   if (ret) {
     fprintf(stderr, "Invalid arguments\n");
+  } else if (batch_file) {
+    if (package.set || subzone.set || constraint.set || enabled.set || power_limit.set || time_window.set) {
+      fprintf(stderr, "-b/--batch cannot be used with other arguments\n");
+      ret = -EINVAL;
+    }
+  } else if (dry_run) {
+    fprintf(stderr, "-n/--dry-run requires -b/--batch\n");
+    ret = -EINVAL;
   } else if (constraint.set && !(power_limit.set || time_window.set)) {
     fprintf(stderr, "Must set at least one constraint-level argument when using -c/--constraint\n");
     ret = -EINVAL;
@@ -113,6 +143,14 @@ int main(int argc, char** argv) {
     return ret;
   }
 
+  if (batch_file) {
+    /* packages and their subzones, as in the rest of rapl-set */
+    if ((ret = batch_run("intel-rapl", 2, 0, batch_file, dry_run))) {
+      print_common_help();
+    }
+    return ret;
+  }
+
   /* Check if package/subzone/constraint exist */
   if (rapl_sysfs_pkg_exists(package.val)) {
     fprintf(stderr, "Package does not exist\n");
@@ -0,0 +1,654 @@
+/**
+ * Apply many zone/constraint settings read from a file, discovering the powercap tree once.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "powercap.h"
+#include "powercap-sysfs.h"
+#include "util-batch.h"
+#include "util-common.h"
+
+#define WILDCARD UINT32_MAX
+/* enough for MAX_ZONE_DEPTH 32-bit numbers and separators */
+#define ZONE_PATH_SIZE (MAX_ZONE_DEPTH * 11 + 1)
+
+typedef enum constraint_select {
+  CONSTRAINT_NONE,
+  CONSTRAINT_NUM,
+  CONSTRAINT_ALL,
+  CONSTRAINT_NAME,
+} constraint_select;
+
+/* One parsed line, before wildcard expansion */
+typedef struct batch_rule {
+  uint32_t zones[MAX_ZONE_DEPTH];
+  uint32_t depth;
+  constraint_select select;
+  u32_param constraint;
+  char constraint_name[MAX_NAME_SIZE];
+  int reset_energy;
+  u32_param enabled;
+  u64_param power_limit;
+  u64_param time_window;
+} batch_rule;
+
+typedef struct apply_group {
+  batch* b;
+  uint32_t top;
+  pthread_t thread;
+  int started;
+} apply_group;
+
+static const char* const op_keys[] = {
+  [BATCH_OP_ENERGY] = "z-energy",
+  [BATCH_OP_ENABLED] = "z-enabled",
+  [BATCH_OP_POWER_LIMIT] = "c-power-limit",
+  [BATCH_OP_TIME_WINDOW] = "c-time-window",
+};
+
+static const char* const op_errors[] = {
+  [BATCH_OP_ENERGY] = "Error setting energy counter",
+  [BATCH_OP_ENABLED] = "Error setting enabled/disabled",
+  [BATCH_OP_POWER_LIMIT] = "Error setting power limit",
+  [BATCH_OP_TIME_WINDOW] = "Error setting time window",
+};
+
+static void line_error(const char* file, uint32_t line, const char* fmt, ...) {
+  va_list args;
+  fprintf(stderr, "%s:%"PRIu32": ", file, line);
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+
+static const char* zone_path(const batch_zone* z, char* buf, size_t size) {
+  size_t len = 0;
+  uint32_t i;
+  buf[0] = '\0';
+  for (i = 0; i < z->depth && len < size; i++) {
+    len += snprintf(buf + len, size - len, i ? ":%"PRIu32 : "%"PRIu32, z->zones[i]);
+  }
+  return buf;
+}
+
+static int add_zone(batch* b, const uint32_t* zones, uint32_t depth, uint32_t* zones_size) {
+  batch_zone* tmp;
+  batch_zone* z;
+  uint32_t n;
+  if (b->nzones == *zones_size) {
+    n = *zones_size ? 2 * *zones_size : 16;
+    if ((tmp = realloc(b->zones, n * sizeof(batch_zone))) == NULL) {
+      return -errno;
+    }
+    b->zones = tmp;
+    *zones_size = n;
+  }
+  z = &b->zones[b->nzones];
+  memset(z, 0, sizeof(batch_zone));
+  memcpy(z->zones, zones, depth * sizeof(uint32_t));
+  z->depth = depth;
+  for (n = 0; !powercap_sysfs_constraint_exists(b->control_type, zones, depth, n); n++);
+  if (n && (z->constraints = calloc(n, sizeof(batch_constraint))) == NULL) {
+    return -errno;
+  }
+  z->nconstraints = n;
+  b->nzones++;
+  return 0;
+}
+
+/* Add all zones at this depth and below */
+static int discover(batch* b, uint32_t* zones, uint32_t depth, uint32_t* zones_size) {
+  int ret = 0;
+  for (zones[depth - 1] = 0; !ret && !powercap_sysfs_zone_exists(b->control_type, zones, depth); zones[depth - 1]++) {
+    if (!(ret = add_zone(b, zones, depth, zones_size)) && depth < b->max_depth) {
+      ret = discover(b, zones, depth + 1, zones_size);
+    }
+  }
+  return ret;
+}
+
+int batch_init(batch* b, const char* control_type, uint32_t max_depth, int allow_energy, int read_only) {
+  uint32_t zones[MAX_ZONE_DEPTH];
+  uint32_t zones_size = 0;
+  int ret;
+  if (b == NULL || control_type == NULL || !max_depth || max_depth > MAX_ZONE_DEPTH) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(b, 0, sizeof(batch));
+  b->control_type = control_type;
+  b->max_depth = max_depth;
+  b->allow_energy = allow_energy;
+  b->read_only = read_only;
+  if (powercap_sysfs_control_type_exists(control_type)) {
+    errno = ENOENT;
+    return -errno;
+  }
+  if ((ret = discover(b, zones, 1, &zones_size))) {
+    batch_destroy(b);
+  }
+  return ret;
+}
+
+void batch_destroy(batch* b) {
+  batch_zone* z;
+  uint32_t i;
+  uint32_t j;
+  if (b == NULL) {
+    return;
+  }
+  for (i = 0; i < b->nzones; i++) {
+    z = &b->zones[i];
+    if (z->opened) {
+      powercap_sysfs_zone_close(&z->fds);
+    }
+    for (j = 0; j < z->nconstraints; j++) {
+      if (z->constraints[j].opened) {
+        powercap_sysfs_constraint_close(&z->constraints[j].fds);
+      }
+    }
+    free(z->constraints);
+  }
+  free(b->zones);
+  free(b->ops);
+  memset(b, 0, sizeof(batch));
+}
+
+static int open_zone(const batch* b, batch_zone* z) {
+  int ret;
+  if (!z->opened) {
+    if ((ret = powercap_sysfs_zone_open(&z->fds, b->control_type, z->zones, z->depth, b->read_only))) {
+      return ret;
+    }
+    z->opened = 1;
+  }
+  return 0;
+}
+
+static int open_constraint(const batch* b, batch_zone* z, uint32_t n) {
+  batch_constraint* c = &z->constraints[n];
+  int ret;
+  if (!c->opened) {
+    if ((ret = powercap_sysfs_constraint_open(&c->fds, b->control_type, z->zones, z->depth, n, b->read_only))) {
+      return ret;
+    }
+    c->opened = 1;
+  }
+  return 0;
+}
+
+/* Wildcards are WILDCARD in zones */
+static int parse_zone_pattern(const char* tok, uint32_t* zones, uint32_t max_depth, uint32_t* depth) {
+  char copy[ZONE_PATH_SIZE];
+  char* z;
+  char* ptr;
+  char* end;
+  unsigned long val;
+  size_t len = strlen(tok);
+  if (!len || len >= sizeof(copy) || tok[0] == ':' || tok[len - 1] == ':' || strstr(tok, "::")) {
+    return -EINVAL;
+  }
+  memcpy(copy, tok, len + 1);
+  *depth = 0;
+  for (z = strtok_r(copy, ":", &ptr); z; z = strtok_r(NULL, ":", &ptr)) {
+    if (*depth == max_depth) {
+      return -ENOBUFS;
+    }
+    if (!strcmp(z, "*")) {
+      zones[(*depth)++] = WILDCARD;
+      continue;
+    }
+    /* strtoul() would accept a sign, and silently negate or truncate out-of-range values */
+    if (*z < '0' || *z > '9') {
+      return -EINVAL;
+    }
+    errno = 0;
+    val = strtoul(z, &end, 10);
+    if (*end != '\0' || errno == ERANGE || val >= WILDCARD) {
+      return -EINVAL;
+    }
+    zones[(*depth)++] = (uint32_t) val;
+  }
+  return 0;
+}
+
+static int parse_setting(batch_rule* r, char* tok, int allow_energy) {
+  char* val = strchr(tok, '=');
+  if (val == NULL) {
+    if (!strcmp(tok, "z-energy") && allow_energy && !r->reset_energy) {
+      r->reset_energy = 1;
+      return 0;
+    }
+    return -EINVAL;
+  }
+  *val++ = '\0';
+  if (!strcmp(tok, "constraint")) {
+    if (r->select != CONSTRAINT_NONE) {
+      return -EINVAL;
+    }
+    if (!strcmp(val, "*")) {
+      r->select = CONSTRAINT_ALL;
+    } else if (!set_u32_param(&r->constraint, val, NULL)) {
+      r->select = CONSTRAINT_NUM;
+    } else if (*val && strlen(val) < MAX_NAME_SIZE) {
+      /* not a number, so match by name */
+      strcpy(r->constraint_name, val);
+      r->select = CONSTRAINT_NAME;
+    } else {
+      return -EINVAL;
+    }
+    return 0;
+  }
+  if (!strcmp(tok, "z-enabled")) {
+    return set_u32_param(&r->enabled, val, NULL) || r->enabled.val > 1 ? -EINVAL : 0;
+  }
+  if (!strcmp(tok, "c-power-limit")) {
+    return set_u64_param(&r->power_limit, val, NULL);
+  }
+  if (!strcmp(tok, "c-time-window")) {
+    return set_u64_param(&r->time_window, val, NULL);
+  }
+  return -EINVAL;
+}
+
+static int zone_matches(const batch_zone* z, const batch_rule* r) {
+  uint32_t i;
+  if (z->depth != r->depth) {
+    return 0;
+  }
+  for (i = 0; i < r->depth; i++) {
+    if (r->zones[i] != WILDCARD && r->zones[i] != z->zones[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* The op index of a zone's or constraint's file, so that later settings replace earlier ones without a search */
+static uint32_t* op_index(batch* b, uint32_t zone, uint32_t constraint, batch_op_type type) {
+  batch_zone* z = &b->zones[zone];
+  switch (type) {
+  case BATCH_OP_ENERGY:
+  case BATCH_OP_ENABLED:
+    return &z->ops[type - BATCH_OP_ENERGY];
+  case BATCH_OP_POWER_LIMIT:
+  case BATCH_OP_TIME_WINDOW:
+  default:
+    return &z->constraints[constraint].ops[type - BATCH_OP_POWER_LIMIT];
+  }
+}
+
+static int add_op(batch* b, uint32_t zone, uint32_t constraint, batch_op_type type, uint64_t val, uint32_t line) {
+  uint32_t* idx = op_index(b, zone, constraint, type);
+  batch_op* tmp;
+  batch_op* op;
+  uint32_t n;
+  if (*idx) {
+    op = &b->ops[*idx - 1];
+    op->val = val;
+    op->line = line;
+    return 0;
+  }
+  if (b->nops == b->ops_size) {
+    n = b->ops_size ? 2 * b->ops_size : 32;
+    if ((tmp = realloc(b->ops, n * sizeof(batch_op))) == NULL) {
+      return -errno;
+    }
+    b->ops = tmp;
+    b->ops_size = n;
+  }
+  op = &b->ops[b->nops++];
+  op->zone = zone;
+  op->constraint = constraint;
+  op->type = type;
+  op->val = val;
+  op->line = line;
+  op->err = 0;
+  *idx = b->nops;
+  return 0;
+}
+
+static int check_constraint(batch* b, uint32_t zone, uint32_t n, const batch_rule* r, const char* file,
+                            uint32_t line) {
+  batch_zone* z = &b->zones[zone];
+  const powercap_constraint* c = &z->constraints[n].fds;
+  char path[ZONE_PATH_SIZE];
+  uint64_t min;
+  uint64_t max;
+  int ret;
+  zone_path(z, path, sizeof(path));
+  if ((ret = open_constraint(b, z, n))) {
+    line_error(file, line, "Zone %s constraint %"PRIu32": %s", path, n, strerror(-ret));
+    return ret;
+  }
+  if (r->power_limit.set) {
+    if (c->power_limit_uw <= 0) {
+      line_error(file, line, "Zone %s constraint %"PRIu32" has no power limit", path, n);
+      return -EINVAL;
+    }
+    if (c->min_power_uw > 0 && !powercap_constraint_get_min_power_uw(c, &min) && r->power_limit.val < min) {
+      line_error(file, line, "Zone %s constraint %"PRIu32": power limit %"PRIu64" is below the minimum %"PRIu64,
+                 path, n, r->power_limit.val, min);
+      return -EINVAL;
+    }
+    /* some drivers report a maximum of 0 when it's unknown */
+    if (c->max_power_uw > 0 && !powercap_constraint_get_max_power_uw(c, &max) && max && r->power_limit.val > max) {
+      line_error(file, line, "Zone %s constraint %"PRIu32": power limit %"PRIu64" is above the maximum %"PRIu64,
+                 path, n, r->power_limit.val, max);
+      return -EINVAL;
+    }
+    if ((ret = add_op(b, zone, n, BATCH_OP_POWER_LIMIT, r->power_limit.val, line))) {
+      return ret;
+    }
+  }
+  if (r->time_window.set) {
+    if (c->time_window_us <= 0) {
+      line_error(file, line, "Zone %s constraint %"PRIu32" has no time window", path, n);
+      return -EINVAL;
+    }
+    if (c->min_time_window_us > 0 && !powercap_constraint_get_min_time_window_us(c, &min) &&
+        r->time_window.val < min) {
+      line_error(file, line, "Zone %s constraint %"PRIu32": time window %"PRIu64" is below the minimum %"PRIu64,
+                 path, n, r->time_window.val, min);
+      return -EINVAL;
+    }
+    if (c->max_time_window_us > 0 && !powercap_constraint_get_max_time_window_us(c, &max) && max &&
+        r->time_window.val > max) {
+      line_error(file, line, "Zone %s constraint %"PRIu32": time window %"PRIu64" is above the maximum %"PRIu64,
+                 path, n, r->time_window.val, max);
+      return -EINVAL;
+    }
+    if ((ret = add_op(b, zone, n, BATCH_OP_TIME_WINDOW, r->time_window.val, line))) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+static int constraint_selected(const batch* b, batch_zone* z, uint32_t n, const batch_rule* r) {
+  char name[MAX_NAME_SIZE];
+  switch (r->select) {
+  case CONSTRAINT_NUM:
+    return n == r->constraint.val;
+  case CONSTRAINT_ALL:
+    return 1;
+  case CONSTRAINT_NAME:
+    return !open_constraint(b, z, n) && z->constraints[n].fds.name > 0 &&
+           powercap_constraint_get_name(&z->constraints[n].fds, name, sizeof(name)) > 0 &&
+           !strcmp(name, r->constraint_name);
+  case CONSTRAINT_NONE:
+  default:
+    return 0;
+  }
+}
+
+static int check_zone(batch* b, uint32_t zone, const batch_rule* r, const char* file, uint32_t line) {
+  batch_zone* z = &b->zones[zone];
+  char path[ZONE_PATH_SIZE];
+  uint32_t matched = 0;
+  uint32_t n;
+  int ret;
+  zone_path(z, path, sizeof(path));
+  if (r->reset_energy || r->enabled.set) {
+    if ((ret = open_zone(b, z))) {
+      line_error(file, line, "Zone %s: %s", path, strerror(-ret));
+      return ret;
+    }
+    if (r->reset_energy) {
+      if (z->fds.energy_uj <= 0) {
+        line_error(file, line, "Zone %s has no energy counter", path);
+        return -EINVAL;
+      }
+      if ((ret = add_op(b, zone, 0, BATCH_OP_ENERGY, 0, line))) {
+        return ret;
+      }
+    }
+    if (r->enabled.set) {
+      if (z->fds.enabled <= 0) {
+        line_error(file, line, "Zone %s cannot be enabled/disabled", path);
+        return -EINVAL;
+      }
+      if ((ret = add_op(b, zone, 0, BATCH_OP_ENABLED, r->enabled.val, line))) {
+        return ret;
+      }
+    }
+  }
+  if (r->select == CONSTRAINT_NONE) {
+    return 0;
+  }
+  for (n = 0; n < z->nconstraints; n++) {
+    if (constraint_selected(b, z, n, r)) {
+      matched++;
+      if ((ret = check_constraint(b, zone, n, r, file, line))) {
+        return ret;
+      }
+    }
+  }
+  if (!matched) {
+    line_error(file, line, "Zone %s has no matching constraint", path);
+    return -EINVAL;
+  }
+  return 0;
+}
+
+/* Apply a rule to every zone it matches */
+static int expand_rule(batch* b, const batch_rule* r, const char* pattern, const char* file, uint32_t line) {
+  uint32_t matched = 0;
+  uint32_t i;
+  int ret = 0;
+  for (i = 0; i < b->nzones; i++) {
+    if (zone_matches(&b->zones[i], r)) {
+      matched++;
+      if ((ret = check_zone(b, i, r, file, line))) {
+        return ret;
+      }
+    }
+  }
+  if (!matched) {
+    line_error(file, line, "No zone matches %s", pattern);
+    return -EINVAL;
+  }
+  return 0;
+}
+
+static int check_rule(const batch_rule* r, const char* file, uint32_t line) {
+  int is_constraint_setting = r->power_limit.set || r->time_window.set;
+  if (r->select != CONSTRAINT_NONE && !is_constraint_setting) {
+    line_error(file, line, "Must set c-power-limit and/or c-time-window when using constraint");
+  } else if (r->select == CONSTRAINT_NONE && is_constraint_setting) {
+    line_error(file, line, "Must specify constraint when using c-power-limit or c-time-window");
+  } else if (!(r->reset_energy || r->enabled.set || is_constraint_setting)) {
+    line_error(file, line, "Nothing to do");
+  } else {
+    return 0;
+  }
+  return -EINVAL;
+}
+
+int batch_read(batch* b, FILE* f, const char* file) {
+  batch_rule r;
+  char* buf = NULL;
+  size_t size = 0;
+  char* pattern;
+  char* tok;
+  char* ptr;
+  uint32_t line = 0;
+  int err;
+  int ret = 0;
+  if (b == NULL || f == NULL || file == NULL) {
+    errno = EINVAL;
+    return -errno;
+  }
+  /* keep going after errors so that every invalid line is reported */
+  while (getline(&buf, &size, f) >= 0) {
+    line++;
+    if ((tok = strchr(buf, '#')) != NULL) {
+      *tok = '\0';
+    }
+    if ((pattern = strtok_r(buf, " \t\r\n", &ptr)) == NULL) {
+      continue;
+    }
+    memset(&r, 0, sizeof(batch_rule));
+    if ((err = parse_zone_pattern(pattern, r.zones, b->max_depth, &r.depth))) {
+      line_error(file, line, "Invalid zone: %s", pattern);
+    }
+    while (!err && (tok = strtok_r(NULL, " \t\r\n", &ptr)) != NULL) {
+      if ((err = parse_setting(&r, tok, b->allow_energy))) {
+        line_error(file, line, "Invalid setting: %s", tok);
+      }
+    }
+    if (!err && !(err = check_rule(&r, file, line))) {
+      err = expand_rule(b, &r, pattern, file, line);
+    }
+    if (err) {
+      ret = err;
+    }
+  }
+  if (ferror(f)) {
+    ret = -errno;
+    perror("Failed to read batch file");
+  }
+  free(buf);
+  return ret;
+}
+
+void batch_print(const batch* b) {
+  const batch_op* op;
+  char path[ZONE_PATH_SIZE];
+  uint32_t i;
+  for (i = 0; i < b->nops; i++) {
+    op = &b->ops[i];
+    zone_path(&b->zones[op->zone], path, sizeof(path));
+    switch (op->type) {
+    case BATCH_OP_ENERGY:
+      printf("%s %s\n", path, op_keys[op->type]);
+      break;
+    case BATCH_OP_ENABLED:
+      printf("%s %s=%"PRIu64"\n", path, op_keys[op->type], op->val);
+      break;
+    case BATCH_OP_POWER_LIMIT:
+    case BATCH_OP_TIME_WINDOW:
+    default:
+      printf("%s constraint=%"PRIu32" %s=%"PRIu64"\n", path, op->constraint, op_keys[op->type], op->val);
+      break;
+    }
+  }
+}
+
+static int apply_op(const batch* b, const batch_op* op) {
+  const batch_zone* z = &b->zones[op->zone];
+  switch (op->type) {
+  case BATCH_OP_ENERGY:
+    /* the zone's energy_uj descriptor is opened read-only */
+    return powercap_sysfs_zone_reset_energy_uj(b->control_type, z->zones, z->depth);
+  case BATCH_OP_ENABLED:
+    return powercap_zone_set_enabled(&z->fds, (int) op->val);
+  case BATCH_OP_POWER_LIMIT:
+    return powercap_constraint_set_power_limit_uw(&z->constraints[op->constraint].fds, op->val);
+  case BATCH_OP_TIME_WINDOW:
+    return powercap_constraint_set_time_window_us(&z->constraints[op->constraint].fds, op->val);
+  default:
+    return -EINVAL;
+  }
+}
+
+/* Perform a top-level zone's writes in file order */
+static void* apply_group_run(void* arg) {
+  apply_group* g = (apply_group*) arg;
+  batch_op* op;
+  uint32_t i;
+  for (i = 0; i < g->b->nops; i++) {
+    op = &g->b->ops[i];
+    if (g->b->zones[op->zone].zones[0] == g->top) {
+      op->err = apply_op(g->b, op);
+    }
+  }
+  return NULL;
+}
+
+int batch_apply(batch* b) {
+  apply_group* groups;
+  char path[ZONE_PATH_SIZE];
+  uint32_t ngroups = 0;
+  uint32_t top;
+  uint32_t i;
+  uint32_t j;
+  int ret = 0;
+  if (b == NULL || b->read_only) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (!b->nops) {
+    return 0;
+  }
+  if ((groups = calloc(b->nops, sizeof(apply_group))) == NULL) {
+    return -errno;
+  }
+  for (i = 0; i < b->nops; i++) {
+    top = b->zones[b->ops[i].zone].zones[0];
+    for (j = 0; j < ngroups && groups[j].top != top; j++);
+    if (j == ngroups) {
+      groups[ngroups].b = b;
+      groups[ngroups++].top = top;
+    }
+  }
+  /* zones in different top-level zones (e.g., packages) are independent, so don't serialize their writes */
+  for (i = 1; i < ngroups; i++) {
+    groups[i].started = !pthread_create(&groups[i].thread, NULL, apply_group_run, &groups[i]);
+  }
+  apply_group_run(&groups[0]);
+  for (i = 1; i < ngroups; i++) {
+    if (groups[i].started) {
+      pthread_join(groups[i].thread, NULL);
+    } else {
+      apply_group_run(&groups[i]);
+    }
+  }
+  free(groups);
+  for (i = 0; i < b->nops; i++) {
+    if (b->ops[i].err) {
+      ret = b->ops[i].err;
+      fprintf(stderr, "%s (zone %s, line %"PRIu32"): %s\n", op_errors[b->ops[i].type],
+              zone_path(&b->zones[b->ops[i].zone], path, sizeof(path)), b->ops[i].line, strerror(-ret));
+    }
+  }
+  return ret;
+}
+
+int batch_run(const char* control_type, uint32_t max_depth, int allow_energy, const char* file, int dry_run) {
+  batch b;
+  FILE* f;
+  int ret;
+  if (!strcmp(file, "-")) {
+    f = stdin;
+  } else if ((f = fopen(file, "r")) == NULL) {
+    ret = -errno;
+    perror("Failed to open batch file");
+    return ret;
+  }
+  if ((ret = batch_init(&b, control_type, max_depth, allow_energy, dry_run))) {
+    perror(ret == -ENOENT ? "Control type does not exist" : "Failed to discover zones");
+  } else {
+    if (!(ret = batch_read(&b, f, f == stdin ? "<stdin>" : file))) {
+      if (dry_run) {
+        batch_print(&b);
+      } else {
+        ret = batch_apply(&b);
+      }
+    }
+    batch_destroy(&b);
+  }
+  if (f != stdin) {
+    fclose(f);
+  }
+  return ret;
+}
@@ -0,0 +1,108 @@
+/**
+ * Apply many zone/constraint settings read from a file, discovering the powercap tree once.
+ *
+ * Each non-empty line has a zone path followed by settings, e.g.:
+ *   0:* constraint=long_term c-power-limit=50000000 c-time-window=976
+ *   * z-enabled=1
+ * Zone path components may be '*' to match all zones at that level.
+ * Text after a '#' is a comment.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _UTIL_BATCH_H
+#define _UTIL_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "powercap.h"
+#include "util-common.h"
+
+typedef enum batch_op_type {
+  BATCH_OP_ENERGY,
+  BATCH_OP_ENABLED,
+  BATCH_OP_POWER_LIMIT,
+  BATCH_OP_TIME_WINDOW,
+} batch_op_type;
+
+typedef struct batch_constraint {
+  powercap_constraint fds;
+  int opened;
+  /* 1 + the index of the power limit and time window ops, or 0 if none */
+  uint32_t ops[2];
+} batch_constraint;
+
+typedef struct batch_zone {
+  uint32_t zones[MAX_ZONE_DEPTH];
+  uint32_t depth;
+  powercap_zone fds;
+  int opened;
+  /* 1 + the index of the energy and enabled ops, or 0 if none */
+  uint32_t ops[2];
+  batch_constraint* constraints;
+  uint32_t nconstraints;
+} batch_zone;
+
+typedef struct batch_op {
+  uint32_t zone;
+  uint32_t constraint;
+  batch_op_type type;
+  uint64_t val;
+  uint32_t line;
+  int err;
+} batch_op;
+
+typedef struct batch {
+  const char* control_type;
+  uint32_t max_depth;
+  int allow_energy;
+  int read_only;
+  /* the control type's zone tree, in depth-first order */
+  batch_zone* zones;
+  uint32_t nzones;
+  /* the writes to perform, in file order, with later settings of the same file replacing earlier ones */
+  batch_op* ops;
+  uint32_t nops;
+  uint32_t ops_size;
+} batch;
+
+/*
+ * Discover the control type's zones up to max_depth.
+ * If read_only, files are opened only to validate settings (i.e., for a dry run).
+ * Returns 0 on success, negative error code on failure.
+ */
+int batch_init(batch* b, const char* control_type, uint32_t max_depth, int allow_energy, int read_only);
+
+void batch_destroy(batch* b);
+
+/*
+ * Parse all lines, expand wildcards, and validate settings against zone/constraint bounds.
+ * Errors are reported to stderr with the file name and line number; nothing is written.
+ * Returns 0 on success, negative error code if any line is invalid.
+ */
+int batch_read(batch* b, FILE* f, const char* file);
+
+/* Print the writes that would be performed */
+void batch_print(const batch* b);
+
+/*
+ * Perform the writes, concurrently for each top-level zone (e.g., package).
+ * Returns 0 on success, negative error code if any write failed.
+ */
+int batch_apply(batch* b);
+
+/*
+ * Read settings from a file (or stdin if file is "-") and apply them, or only print them if dry_run.
+ * Returns 0 on success, negative error code on failure.
+ */
+int batch_run(const char* control_type, uint32_t max_depth, int allow_energy, const char* file, int dry_run);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,898 @@
+/**
+ * Machine-readable (JSON, CSV, binary, and OpenMetrics) output of sampler snapshots.
+ *
+ * JSON output is one object per line, CSV output is one row per zone and per constraint, and binary output is a zone
+ * table followed by fixed-size records.
+ * Only JSON output includes other telemetry (CPU frequencies, idle states, and thermal zones) the sampler may have.
+ * OpenMetrics output is a text exposition of a single snapshot, in base units (joules, watts, and seconds).
+ * Unavailable values are omitted from JSON and left empty in CSV; binary records carry validity masks.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "powercap-sampler.h"
+#include "util-format.h"
+
+int parse_output_format(const char* optarg, output_format* fmt, int* cont) {
+  if (optarg == NULL) {
+    *cont = 0;
+    return -EINVAL;
+  }
+  if (!strcmp(optarg, "text")) {
+    *fmt = OUTPUT_FORMAT_TEXT;
+  } else if (!strcmp(optarg, "json")) {
+    *fmt = OUTPUT_FORMAT_JSON;
+  } else if (!strcmp(optarg, "csv")) {
+    *fmt = OUTPUT_FORMAT_CSV;
+  } else if (!strcmp(optarg, "binary")) {
+    *fmt = OUTPUT_FORMAT_BINARY;
+  } else {
+    *cont = 0;
+    return -EINVAL;
+  }
+  return 0;
+}
+
+void output_buffer_init(output_buffer* b) {
+  memset(b, 0, sizeof(output_buffer));
+}
+
+void output_buffer_destroy(output_buffer* b) {
+  free(b->data);
+  memset(b, 0, sizeof(output_buffer));
+}
+
+int output_buffer_reserve(output_buffer* b, size_t len) {
+  char* tmp;
+  size_t size;
+  if (b->len + len <= b->size) {
+    return 0;
+  }
+  for (size = b->size ? b->size : 4096; size < b->len + len; size *= 2);
+  if ((tmp = realloc(b->data, size)) == NULL) {
+    return -errno;
+  }
+  b->data = tmp;
+  b->size = size;
+  return 0;
+}
+
+int output_buffer_append(output_buffer* b, const void* data, size_t len) {
+  int ret;
+  if ((ret = output_buffer_reserve(b, len))) {
+    return ret;
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+  return 0;
+}
+
+int output_buffer_printf(output_buffer* b, const char* fmt, ...) {
+  va_list args;
+  int n;
+  int ret;
+  if ((ret = output_buffer_reserve(b, 1))) {
+    return ret;
+  }
+  va_start(args, fmt);
+  n = vsnprintf(b->data + b->len, b->size - b->len, fmt, args);
+  va_end(args);
+  if (n < 0) {
+    return -errno;
+  }
+  if ((size_t) n >= b->size - b->len) {
+    /* didn't fit, grow and try again (includes space for the terminating NUL) */
+    if ((ret = output_buffer_reserve(b, (size_t) n + 1))) {
+      return ret;
+    }
+    va_start(args, fmt);
+    n = vsnprintf(b->data + b->len, b->size - b->len, fmt, args);
+    va_end(args);
+    if (n < 0) {
+      return -errno;
+    }
+  }
+  b->len += (size_t) n;
+  return 0;
+}
+
+int output_buffer_flush(output_buffer* b, int fd) {
+  size_t off = 0;
+  ssize_t n;
+  while (off < b->len) {
+    if ((n = write(fd, b->data + off, b->len - off)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    off += (size_t) n;
+  }
+  b->len = 0;
+  return 0;
+}
+
+static int append_zone_path(output_buffer* b, const powercap_sampler_zone* z) {
+  uint32_t i;
+  int ret = 0;
+  for (i = 0; !ret && i < z->depth; i++) {
+    ret = output_buffer_printf(b, i ? ":%"PRIu32 : "%"PRIu32, z->zones[i]);
+  }
+  return ret;
+}
+
+/* Names come from sysfs or the user, so escape anything JSON doesn't allow in a string */
+static int append_json_string(output_buffer* b, const char* s) {
+  int ret;
+  if ((ret = output_buffer_append(b, "\"", 1))) {
+    return ret;
+  }
+  for (; !ret && s != NULL && *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      ret = output_buffer_printf(b, "\\%c", *s);
+    } else if ((unsigned char) *s < 0x20) {
+      ret = output_buffer_printf(b, "\\u%04x", (unsigned int) (unsigned char) *s);
+    } else {
+      ret = output_buffer_append(b, s, 1);
+    }
+  }
+  return ret ? ret : output_buffer_append(b, "\"", 1);
+}
+
+static int append_json_u64(output_buffer* b, const char* key, uint64_t val) {
+  return output_buffer_printf(b, ",\"%s\":%"PRIu64, key, val);
+}
+
+static int append_json_zone(output_buffer* b, const powercap_sampler_zone* z, const powercap_sampler_zone_values* v,
+                            const powercap_sampler_constraint_values* cv) {
+  const powercap_sampler_constraint* c;
+  uint32_t i;
+  int ret;
+  if ((ret = output_buffer_printf(b, "{\"control_type\":")) ||
+      (ret = append_json_string(b, z->control_type)) ||
+      (ret = output_buffer_printf(b, ",\"zone\":\"")) ||
+      (ret = append_zone_path(b, z)) ||
+      (ret = output_buffer_printf(b, "\",\"name\":")) ||
+      (ret = append_json_string(b, z->name)) ||
+      (z->max_energy_range_uj && (ret = append_json_u64(b, "max_energy_range_uj", z->max_energy_range_uj))) ||
+      (z->max_power_range_uw && (ret = append_json_u64(b, "max_power_range_uw", z->max_power_range_uw))) ||
+      ((v->valid & POWERCAP_SAMPLER_ZONE_ENERGY) && (ret = append_json_u64(b, "energy_uj", v->energy_uj))) ||
+      ((v->valid & POWERCAP_SAMPLER_ZONE_ENERGY) &&
+       (ret = append_json_u64(b, "total_energy_uj", v->total_energy_uj))) ||
+      ((v->valid & POWERCAP_SAMPLER_ZONE_POWER) && (ret = append_json_u64(b, "power_uw", v->power_uw))) ||
+      ((v->valid & POWERCAP_SAMPLER_ZONE_POWER_UW) && (ret = append_json_u64(b, "power_file_uw", v->power_file_uw))) ||
+      ((v->valid & POWERCAP_SAMPLER_ZONE_ENABLED) && (ret = append_json_u64(b, "enabled", v->enabled))) ||
+      (ret = output_buffer_printf(b, ",\"constraints\":["))) {
+    return ret;
+  }
+  for (i = 0; i < z->nconstraints; i++) {
+    c = &z->constraints[i];
+    if ((ret = output_buffer_printf(b, "%s{\"constraint\":%"PRIu32",\"name\":", i ? "," : "", c->num)) ||
+        (ret = append_json_string(b, c->name)) ||
+        ((cv[i].valid & POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT) &&
+         (ret = append_json_u64(b, "power_limit_uw", cv[i].power_limit_uw))) ||
+        ((cv[i].valid & POWERCAP_SAMPLER_CONSTRAINT_TIME_WINDOW) &&
+         (ret = append_json_u64(b, "time_window_us", cv[i].time_window_us))) ||
+        (c->min_power_uw && (ret = append_json_u64(b, "min_power_uw", c->min_power_uw))) ||
+        (c->max_power_uw && (ret = append_json_u64(b, "max_power_uw", c->max_power_uw))) ||
+        (c->min_time_window_us && (ret = append_json_u64(b, "min_time_window_us", c->min_time_window_us))) ||
+        (c->max_time_window_us && (ret = append_json_u64(b, "max_time_window_us", c->max_time_window_us))) ||
+        (ret = output_buffer_append(b, "}", 1))) {
+      return ret;
+    }
+  }
+  return output_buffer_append(b, "]}", 2);
+}
+
+/* Arrays of other telemetry, only for the kinds the sampler has */
+static int append_json_telemetry(output_buffer* b, const powercap_sampler* sampler,
+                                 const powercap_sampler_snapshot* snap) {
+  const powercap_sampler_cpuidle* c;
+  uint32_t i;
+  int ret = 0;
+  if (sampler->ncpufreqs) {
+    ret = output_buffer_printf(b, ",\"cpufreq\":[");
+    for (i = 0; !ret && i < sampler->ncpufreqs; i++) {
+      if (!(ret = output_buffer_printf(b, "%s{\"cpu\":%"PRIu32, i ? "," : "", sampler->cpufreqs[i].cpu)) &&
+          !((snap->cpufreqs[i].valid & POWERCAP_SAMPLER_CPUFREQ_FREQ) &&
+            (ret = append_json_u64(b, "freq_khz", snap->cpufreqs[i].freq_khz)))) {
+        ret = output_buffer_append(b, "}", 1);
+      }
+    }
+    ret = ret ? ret : output_buffer_append(b, "]", 1);
+  }
+  if (!ret && sampler->ncpuidles) {
+    ret = output_buffer_printf(b, ",\"cpuidle\":[");
+    for (i = 0; !ret && i < sampler->ncpuidles; i++) {
+      c = &sampler->cpuidles[i];
+      if (!(ret = output_buffer_printf(b, "%s{\"cpu\":%"PRIu32",\"state\":%"PRIu32",\"name\":", i ? "," : "",
+                                       c->cpu, c->state)) &&
+          !(ret = append_json_string(b, c->name)) &&
+          !((snap->cpuidles[i].valid & POWERCAP_SAMPLER_CPUIDLE_TIME) &&
+            (ret = append_json_u64(b, "time_us", snap->cpuidles[i].time_us))) &&
+          !((snap->cpuidles[i].valid & POWERCAP_SAMPLER_CPUIDLE_USAGE) &&
+            (ret = append_json_u64(b, "usage", snap->cpuidles[i].usage)))) {
+        ret = output_buffer_append(b, "}", 1);
+      }
+    }
+    ret = ret ? ret : output_buffer_append(b, "]", 1);
+  }
+  if (!ret && sampler->nthermals) {
+    ret = output_buffer_printf(b, ",\"thermal\":[");
+    for (i = 0; !ret && i < sampler->nthermals; i++) {
+      if (!(ret = output_buffer_printf(b, "%s{\"zone\":%"PRIu32",\"type\":", i ? "," : "",
+                                       sampler->thermals[i].zone)) &&
+          !(ret = append_json_string(b, sampler->thermals[i].type)) &&
+          !((snap->thermals[i].valid & POWERCAP_SAMPLER_THERMAL_TEMP) &&
+            (ret = output_buffer_printf(b, ",\"temp_mc\":%"PRId64, snap->thermals[i].temp_mc)))) {
+        ret = output_buffer_append(b, "}", 1);
+      }
+    }
+    ret = ret ? ret : output_buffer_append(b, "]", 1);
+  }
+  return ret;
+}
+
+static int format_json(output_buffer* b, const powercap_sampler* sampler, const powercap_sampler_snapshot* snap,
+                       int64_t time_ns) {
+  uint32_t i;
+  int ret;
+  if ((ret = output_buffer_printf(b, "{\"time_ns\":%"PRId64",\"elapsed_ns\":%"PRId64",\"zones\":[", time_ns,
+                                  snap->elapsed_ns))) {
+    return ret;
+  }
+  for (i = 0; i < sampler->nzones; i++) {
+    if ((i && (ret = output_buffer_append(b, ",", 1))) ||
+        (ret = append_json_zone(b, &sampler->zones[i], &snap->zones[i],
+                                &snap->constraints[sampler->zones[i].constraint_index]))) {
+      return ret;
+    }
+  }
+  if ((ret = output_buffer_append(b, "]", 1)) || (ret = append_json_telemetry(b, sampler, snap))) {
+    return ret;
+  }
+  return output_buffer_append(b, "}\n", 2);
+}
+
+static const char csv_header[] =
+  "time_ns,elapsed_ns,control_type,zone,name,constraint,energy_uj,total_energy_uj,power_uw,power_file_uw,enabled,"
+  "power_limit_uw,time_window_us,max_energy_range_uj,max_power_range_uw,min_power_uw,max_power_uw,"
+  "min_time_window_us,max_time_window_us\n";
+
+/* Quote a field only if it needs it */
+static int append_csv_string(output_buffer* b, const char* s) {
+  int ret = 0;
+  if (s == NULL || strpbrk(s, ",\"\r\n") == NULL) {
+    return s == NULL ? 0 : output_buffer_printf(b, "%s", s);
+  }
+  if ((ret = output_buffer_append(b, "\"", 1))) {
+    return ret;
+  }
+  for (; !ret && *s; s++) {
+    ret = *s == '"' ? output_buffer_append(b, "\"\"", 2) : output_buffer_append(b, s, 1);
+  }
+  return ret ? ret : output_buffer_append(b, "\"", 1);
+}
+
+/* A comma, then the value if it's available */
+static int append_csv_u64(output_buffer* b, int have, uint64_t val) {
+  return have ? output_buffer_printf(b, ",%"PRIu64, val) : output_buffer_append(b, ",", 1);
+}
+
+static int append_csv_prefix(output_buffer* b, const powercap_sampler_zone* z, const powercap_sampler_snapshot* snap,
+                             int64_t time_ns) {
+  int ret;
+  if ((ret = output_buffer_printf(b, "%"PRId64",%"PRId64",", time_ns, snap->elapsed_ns)) ||
+      (ret = append_csv_string(b, z->control_type)) ||
+      (ret = output_buffer_append(b, ",", 1)) ||
+      (ret = append_zone_path(b, z)) ||
+      (ret = output_buffer_append(b, ",", 1))) {
+    return ret;
+  }
+  return 0;
+}
+
+static int format_csv(output_buffer* b, const powercap_sampler* sampler, const powercap_sampler_snapshot* snap,
+                      int64_t time_ns) {
+  const powercap_sampler_zone* z;
+  const powercap_sampler_zone_values* v;
+  const powercap_sampler_constraint* c;
+  const powercap_sampler_constraint_values* cv;
+  uint32_t i;
+  uint32_t j;
+  int ret;
+  for (i = 0; i < sampler->nzones; i++) {
+    z = &sampler->zones[i];
+    v = &snap->zones[i];
+    if ((ret = append_csv_prefix(b, z, snap, time_ns)) ||
+        (ret = append_csv_string(b, z->name)) ||
+        (ret = output_buffer_append(b, ",", 1)) ||
+        (ret = append_csv_u64(b, v->valid & POWERCAP_SAMPLER_ZONE_ENERGY, v->energy_uj)) ||
+        (ret = append_csv_u64(b, v->valid & POWERCAP_SAMPLER_ZONE_ENERGY, v->total_energy_uj)) ||
+        (ret = append_csv_u64(b, v->valid & POWERCAP_SAMPLER_ZONE_POWER, v->power_uw)) ||
+        (ret = append_csv_u64(b, v->valid & POWERCAP_SAMPLER_ZONE_POWER_UW, v->power_file_uw)) ||
+        (ret = append_csv_u64(b, v->valid & POWERCAP_SAMPLER_ZONE_ENABLED, v->enabled)) ||
+        (ret = output_buffer_printf(b, ",,")) ||
+        (ret = append_csv_u64(b, z->max_energy_range_uj != 0, z->max_energy_range_uj)) ||
+        (ret = append_csv_u64(b, z->max_power_range_uw != 0, z->max_power_range_uw)) ||
+        (ret = output_buffer_printf(b, ",,,,\n"))) {
+      return ret;
+    }
+    for (j = 0; j < z->nconstraints; j++) {
+      c = &z->constraints[j];
+      cv = &snap->constraints[z->constraint_index + j];
+      if ((ret = append_csv_prefix(b, z, snap, time_ns)) ||
+          (ret = append_csv_string(b, c->name)) ||
+          (ret = output_buffer_printf(b, ",%"PRIu32",,,,,", c->num)) ||
+          (ret = append_csv_u64(b, cv->valid & POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT, cv->power_limit_uw)) ||
+          (ret = append_csv_u64(b, cv->valid & POWERCAP_SAMPLER_CONSTRAINT_TIME_WINDOW, cv->time_window_us)) ||
+          (ret = output_buffer_printf(b, ",,")) ||
+          (ret = append_csv_u64(b, c->min_power_uw != 0, c->min_power_uw)) ||
+          (ret = append_csv_u64(b, c->max_power_uw != 0, c->max_power_uw)) ||
+          (ret = append_csv_u64(b, c->min_time_window_us != 0, c->min_time_window_us)) ||
+          (ret = append_csv_u64(b, c->max_time_window_us != 0, c->max_time_window_us)) ||
+          (ret = output_buffer_append(b, "\n", 1))) {
+        return ret;
+      }
+    }
+  }
+  return 0;
+}
+
+static int append_u32(output_buffer* b, uint32_t val) {
+  return output_buffer_append(b, &val, sizeof(val));
+}
+
+static int append_u64(output_buffer* b, uint64_t val) {
+  return output_buffer_append(b, &val, sizeof(val));
+}
+
+static int append_name(output_buffer* b, const char* name) {
+  char buf[POWERCAP_SAMPLER_NAME_SIZE] = { 0 };
+  if (name != NULL) {
+    memcpy(buf, name, strnlen(name, sizeof(buf) - 1));
+  }
+  return output_buffer_append(b, buf, sizeof(buf));
+}
+
+/*
+ * Header: magic, u32 nzones, u32 nconstraints, then for each zone:
+ *   char control_type[32], char name[32], u32 depth, u32 zones[depth], u64 max_energy_range_uj,
+ *   u64 max_power_range_uw, u32 nconstraints, then for each constraint:
+ *     char name[32], u32 num, u64 min_power_uw, u64 max_power_uw, u64 min_time_window_us, u64 max_time_window_us
+ */
+static int format_binary_header(output_buffer* b, const powercap_sampler* sampler) {
+  const powercap_sampler_zone* z;
+  const powercap_sampler_constraint* c;
+  uint32_t i;
+  uint32_t j;
+  int ret;
+  if ((ret = output_buffer_append(b, OUTPUT_BINARY_MAGIC, OUTPUT_BINARY_MAGIC_SIZE)) ||
+      (ret = append_u32(b, sampler->nzones)) ||
+      (ret = append_u32(b, sampler->nconstraints))) {
+    return ret;
+  }
+  for (i = 0; i < sampler->nzones; i++) {
+    z = &sampler->zones[i];
+    if ((ret = append_name(b, z->control_type)) ||
+        (ret = append_name(b, z->name)) ||
+        (ret = append_u32(b, z->depth)) ||
+        (z->depth && (ret = output_buffer_append(b, z->zones, z->depth * sizeof(uint32_t)))) ||
+        (ret = append_u64(b, z->max_energy_range_uj)) ||
+        (ret = append_u64(b, z->max_power_range_uw)) ||
+        (ret = append_u32(b, z->nconstraints))) {
+      return ret;
+    }
+    for (j = 0; j < z->nconstraints; j++) {
+      c = &z->constraints[j];
+      if ((ret = append_name(b, c->name)) ||
+          (ret = append_u32(b, c->num)) ||
+          (ret = append_u64(b, c->min_power_uw)) ||
+          (ret = append_u64(b, c->max_power_uw)) ||
+          (ret = append_u64(b, c->min_time_window_us)) ||
+          (ret = append_u64(b, c->max_time_window_us))) {
+        return ret;
+      }
+    }
+  }
+  return 0;
+}
+
+/*
+ * Record: i64 time_ns, i64 elapsed_ns, then for each zone:
+ *   u32 valid, u32 enabled, u64 energy_uj, u64 total_energy_uj, u64 power_uw, u64 power_file_uw
+ * then for each constraint (in zone order):
+ *   u32 valid, u32 reserved, u64 power_limit_uw, u64 time_window_us
+ */
+static int format_binary(output_buffer* b, const powercap_sampler* sampler, const powercap_sampler_snapshot* snap,
+                         int64_t time_ns) {
+  const powercap_sampler_zone_values* v;
+  const powercap_sampler_constraint_values* cv;
+  uint32_t i;
+  int ret;
+  if ((ret = append_u64(b, (uint64_t) time_ns)) ||
+      (ret = append_u64(b, (uint64_t) snap->elapsed_ns))) {
+    return ret;
+  }
+  for (i = 0; i < sampler->nzones; i++) {
+    v = &snap->zones[i];
+    if ((ret = append_u32(b, v->valid)) ||
+        (ret = append_u32(b, v->enabled)) ||
+        (ret = append_u64(b, v->energy_uj)) ||
+        (ret = append_u64(b, v->total_energy_uj)) ||
+        (ret = append_u64(b, v->power_uw)) ||
+        (ret = append_u64(b, v->power_file_uw))) {
+      return ret;
+    }
+  }
+  for (i = 0; i < sampler->nconstraints; i++) {
+    cv = &snap->constraints[i];
+    if ((ret = append_u32(b, cv->valid)) ||
+        (ret = append_u32(b, 0)) ||
+        (ret = append_u64(b, cv->power_limit_uw)) ||
+        (ret = append_u64(b, cv->time_window_us))) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+size_t output_binary_record_size(const powercap_sampler* sampler) {
+  return 2 * sizeof(uint64_t) + sampler->nzones * (2 * sizeof(uint32_t) + 4 * sizeof(uint64_t)) +
+         sampler->nconstraints * (2 * sizeof(uint32_t) + 2 * sizeof(uint64_t));
+}
+
+int output_format_header(output_buffer* b, output_format fmt, const powercap_sampler* sampler) {
+  switch (fmt) {
+  case OUTPUT_FORMAT_CSV:
+    return output_buffer_append(b, csv_header, sizeof(csv_header) - 1);
+  case OUTPUT_FORMAT_BINARY:
+    return format_binary_header(b, sampler);
+  case OUTPUT_FORMAT_TEXT:
+  case OUTPUT_FORMAT_JSON:
+  default:
+    return 0;
+  }
+}
+
+int output_format_snapshot(output_buffer* b, output_format fmt, const powercap_sampler* sampler,
+                           const powercap_sampler_snapshot* snap, int64_t time_ns) {
+  switch (fmt) {
+  case OUTPUT_FORMAT_JSON:
+    return format_json(b, sampler, snap, time_ns);
+  case OUTPUT_FORMAT_CSV:
+    return format_csv(b, sampler, snap, time_ns);
+  case OUTPUT_FORMAT_BINARY:
+    return format_binary(b, sampler, snap, time_ns);
+  case OUTPUT_FORMAT_TEXT:
+  default:
+    errno = EINVAL;
+    return -errno;
+  }
+}
+
+/* OpenMetrics families; values are integers in micro-units (or plain units if scale is 1) */
+typedef struct om_family {
+  const char* name;
+  const char* type;
+  const char* unit;
+  const char* help;
+  uint64_t scale;
+} om_family;
+
+typedef enum om_zone_metric {
+  OM_ZONE_ENERGY,
+  OM_ZONE_POWER,
+  OM_ZONE_POWER_UW,
+  OM_ZONE_ENABLED,
+  OM_ZONE_MAX_ENERGY_RANGE,
+  OM_ZONE_MAX_POWER_RANGE,
+  OM_ZONE_COUNT
+} om_zone_metric;
+
+typedef enum om_constraint_metric {
+  OM_CONSTRAINT_POWER_LIMIT,
+  OM_CONSTRAINT_TIME_WINDOW,
+  OM_CONSTRAINT_MIN_POWER,
+  OM_CONSTRAINT_MAX_POWER,
+  OM_CONSTRAINT_MIN_TIME_WINDOW,
+  OM_CONSTRAINT_MAX_TIME_WINDOW,
+  OM_CONSTRAINT_COUNT
+} om_constraint_metric;
+
+static const om_family om_zone_families[OM_ZONE_COUNT] = {
+  [OM_ZONE_ENERGY] = {"powercap_energy_joules", "counter", "joules",
+                      "Energy consumed since the first sample, corrected for counter overflow", 1000000},
+  [OM_ZONE_POWER] = {"powercap_power_watts", "gauge", "watts",
+                     "Average power between the last two samples, derived from energy", 1000000},
+  [OM_ZONE_POWER_UW] = {"powercap_reported_power_watts", "gauge", "watts", "Power reported by the zone", 1000000},
+  [OM_ZONE_ENABLED] = {"powercap_enabled", "gauge", NULL, "Whether the zone is enabled", 1},
+  [OM_ZONE_MAX_ENERGY_RANGE] = {"powercap_max_energy_range_joules", "gauge", "joules",
+                                "Range of the zone's energy counter", 1000000},
+  [OM_ZONE_MAX_POWER_RANGE] = {"powercap_max_power_range_watts", "gauge", "watts",
+                               "Range of the zone's reported power", 1000000},
+};
+
+static const om_family om_constraint_families[OM_CONSTRAINT_COUNT] = {
+  [OM_CONSTRAINT_POWER_LIMIT] = {"powercap_constraint_power_limit_watts", "gauge", "watts",
+                                 "Constraint power limit", 1000000},
+  [OM_CONSTRAINT_TIME_WINDOW] = {"powercap_constraint_time_window_seconds", "gauge", "seconds",
+                                 "Constraint time window", 1000000},
+  [OM_CONSTRAINT_MIN_POWER] = {"powercap_constraint_min_power_watts", "gauge", "watts",
+                               "Minimum allowed power limit", 1000000},
+  [OM_CONSTRAINT_MAX_POWER] = {"powercap_constraint_max_power_watts", "gauge", "watts",
+                               "Maximum allowed power limit", 1000000},
+  [OM_CONSTRAINT_MIN_TIME_WINDOW] = {"powercap_constraint_min_time_window_seconds", "gauge", "seconds",
+                                     "Minimum allowed time window", 1000000},
+  [OM_CONSTRAINT_MAX_TIME_WINDOW] = {"powercap_constraint_max_time_window_seconds", "gauge", "seconds",
+                                     "Maximum allowed time window", 1000000},
+};
+
+/* Returns 1 and sets val if the metric is available, 0 otherwise */
+static int om_zone_value(om_zone_metric m, const powercap_sampler_zone* z, const powercap_sampler_zone_values* v,
+                         uint64_t* val) {
+  switch (m) {
+  case OM_ZONE_ENERGY:
+    *val = v->total_energy_uj;
+    return (v->valid & POWERCAP_SAMPLER_ZONE_ENERGY) != 0;
+  case OM_ZONE_POWER:
+    *val = v->power_uw;
+    return (v->valid & POWERCAP_SAMPLER_ZONE_POWER) != 0;
+  case OM_ZONE_POWER_UW:
+    *val = v->power_file_uw;
+    return (v->valid & POWERCAP_SAMPLER_ZONE_POWER_UW) != 0;
+  case OM_ZONE_ENABLED:
+    *val = (uint64_t) v->enabled;
+    return (v->valid & POWERCAP_SAMPLER_ZONE_ENABLED) != 0;
+  case OM_ZONE_MAX_ENERGY_RANGE:
+    *val = z->max_energy_range_uj;
+    return *val != 0;
+  case OM_ZONE_MAX_POWER_RANGE:
+    *val = z->max_power_range_uw;
+    return *val != 0;
+  case OM_ZONE_COUNT:
+  default:
+    return 0;
+  }
+}
+
+static int om_constraint_value(om_constraint_metric m, const powercap_sampler_constraint* c,
+                               const powercap_sampler_constraint_values* cv, uint64_t* val) {
+  switch (m) {
+  case OM_CONSTRAINT_POWER_LIMIT:
+    *val = cv->power_limit_uw;
+    return (cv->valid & POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT) != 0;
+  case OM_CONSTRAINT_TIME_WINDOW:
+    *val = cv->time_window_us;
+    return (cv->valid & POWERCAP_SAMPLER_CONSTRAINT_TIME_WINDOW) != 0;
+  case OM_CONSTRAINT_MIN_POWER:
+    *val = c->min_power_uw;
+    break;
+  case OM_CONSTRAINT_MAX_POWER:
+    *val = c->max_power_uw;
+    break;
+  case OM_CONSTRAINT_MIN_TIME_WINDOW:
+    *val = c->min_time_window_us;
+    break;
+  case OM_CONSTRAINT_MAX_TIME_WINDOW:
+    *val = c->max_time_window_us;
+    break;
+  case OM_CONSTRAINT_COUNT:
+  default:
+    return 0;
+  }
+  return *val != 0;
+}
+
+/* Label values come from sysfs, so escape what OpenMetrics requires */
+static int append_om_label(output_buffer* b, const char* key, const char* s) {
+  int ret;
+  if ((ret = output_buffer_printf(b, "%s=\"", key))) {
+    return ret;
+  }
+  for (; !ret && s != NULL && *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      ret = output_buffer_printf(b, "\\%c", *s);
+    } else if (*s == '\n') {
+      ret = output_buffer_append(b, "\\n", 2);
+    } else {
+      ret = output_buffer_append(b, s, 1);
+    }
+  }
+  return ret ? ret : output_buffer_append(b, "\"", 1);
+}
+
+static int append_om_zone_labels(output_buffer* b, const powercap_sampler_zone* z) {
+  int ret;
+  if ((ret = output_buffer_append(b, "{", 1)) ||
+      (ret = append_om_label(b, "control_type", z->control_type)) ||
+      (ret = output_buffer_append(b, ",zone=\"", 7)) ||
+      (ret = append_zone_path(b, z)) ||
+      (ret = output_buffer_append(b, "\",", 2))) {
+    return ret;
+  }
+  return append_om_label(b, "name", z->name);
+}
+
+int output_openmetrics_family(output_buffer* b, const char* name, const char* type, const char* unit,
+                              const char* help) {
+  int ret;
+  if ((ret = output_buffer_printf(b, "# TYPE %s %s\n", name, type)) ||
+      (unit && (ret = output_buffer_printf(b, "# UNIT %s %s\n", name, unit)))) {
+    return ret;
+  }
+  return output_buffer_printf(b, "# HELP %s %s\n", name, help);
+}
+
+/* Values are exact decimals, e.g., 1234567 uJ is 1.234567 J */
+static int append_om_value(output_buffer* b, uint64_t val, uint64_t scale) {
+  if (scale == 1) {
+    return output_buffer_printf(b, " %"PRIu64"\n", val);
+  }
+  return output_buffer_printf(b, " %"PRIu64".%06"PRIu64"\n", val / scale, val % scale);
+}
+
+static int append_om_zone_family(output_buffer* b, const powercap_sampler* sampler,
+                                 const powercap_sampler_snapshot* snap, om_zone_metric m, double created_s) {
+  const om_family* f = &om_zone_families[m];
+  const int is_counter = !strcmp(f->type, "counter");
+  uint64_t val;
+  uint32_t i;
+  int ret;
+  if ((ret = output_openmetrics_family(b, f->name, f->type, f->unit, f->help))) {
+    return ret;
+  }
+  for (i = 0; i < sampler->nzones; i++) {
+    if (!om_zone_value(m, &sampler->zones[i], &snap->zones[i], &val)) {
+      continue;
+    }
+    if ((ret = output_buffer_printf(b, "%s%s", f->name, is_counter ? "_total" : "")) ||
+        (ret = append_om_zone_labels(b, &sampler->zones[i])) ||
+        (ret = output_buffer_append(b, "}", 1)) ||
+        (ret = append_om_value(b, val, f->scale))) {
+      return ret;
+    }
+    if (is_counter && created_s > 0 &&
+        ((ret = output_buffer_printf(b, "%s_created", f->name)) ||
+         (ret = append_om_zone_labels(b, &sampler->zones[i])) ||
+         (ret = output_buffer_printf(b, "} %.3f\n", created_s)))) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+static int append_om_constraint_family(output_buffer* b, const powercap_sampler* sampler,
+                                       const powercap_sampler_snapshot* snap, om_constraint_metric m) {
+  const om_family* f = &om_constraint_families[m];
+  const powercap_sampler_zone* z;
+  uint64_t val;
+  uint32_t i;
+  uint32_t j;
+  int ret;
+  if ((ret = output_openmetrics_family(b, f->name, f->type, f->unit, f->help))) {
+    return ret;
+  }
+  for (i = 0; i < sampler->nzones; i++) {
+    z = &sampler->zones[i];
+    for (j = 0; j < z->nconstraints; j++) {
+      if (!om_constraint_value(m, &z->constraints[j], &snap->constraints[z->constraint_index + j], &val)) {
+        continue;
+      }
+      if ((ret = output_buffer_append(b, f->name, strlen(f->name))) ||
+          (ret = append_om_zone_labels(b, z)) ||
+          (ret = output_buffer_printf(b, ",constraint=\"%"PRIu32"\",", z->constraints[j].num)) ||
+          (ret = append_om_label(b, "constraint_name", z->constraints[j].name)) ||
+          (ret = output_buffer_append(b, "}", 1)) ||
+          (ret = append_om_value(b, val, f->scale))) {
+        return ret;
+      }
+    }
+  }
+  return 0;
+}
+
+int output_format_openmetrics(output_buffer* b, const powercap_sampler* sampler,
+                              const powercap_sampler_snapshot* snap, double created_s) {
+  uint32_t m;
+  int ret = 0;
+  for (m = 0; !ret && m < OM_ZONE_COUNT; m++) {
+    ret = append_om_zone_family(b, sampler, snap, (om_zone_metric) m, created_s);
+  }
+  for (m = 0; !ret && m < OM_CONSTRAINT_COUNT; m++) {
+    ret = append_om_constraint_family(b, sampler, snap, (om_constraint_metric) m);
+  }
+  return ret;
+}
+
+/* Sanity limits for zone tables read from files */
+#define BINARY_MAX_ZONES 65536
+#define BINARY_MAX_DEPTH 64
+
+static int read_exact(FILE* f, void* buf, size_t len) {
+  if (fread(buf, 1, len, f) != len) {
+    errno = ferror(f) ? EIO : EINVAL;
+    return -errno;
+  }
+  return 0;
+}
+
+static int read_u32(FILE* f, uint32_t* val) {
+  return read_exact(f, val, sizeof(*val));
+}
+
+static int read_u64(FILE* f, uint64_t* val) {
+  return read_exact(f, val, sizeof(*val));
+}
+
+static int read_name(FILE* f, char* name) {
+  int ret;
+  if (!(ret = read_exact(f, name, POWERCAP_SAMPLER_NAME_SIZE))) {
+    name[POWERCAP_SAMPLER_NAME_SIZE - 1] = '\0';
+  }
+  return ret;
+}
+
+static int read_binary_zone(FILE* f, binary_zone* z) {
+  uint32_t i;
+  int ret;
+  if ((ret = read_name(f, z->control_type)) ||
+      (ret = read_name(f, z->name)) ||
+      (ret = read_u32(f, &z->depth))) {
+    return ret;
+  }
+  if (z->depth > BINARY_MAX_DEPTH) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (z->depth && (z->zones = malloc(z->depth * sizeof(uint32_t))) == NULL) {
+    return -errno;
+  }
+  if ((z->depth && (ret = read_exact(f, z->zones, z->depth * sizeof(uint32_t)))) ||
+      (ret = read_u64(f, &z->max_energy_range_uj)) ||
+      (ret = read_u64(f, &z->max_power_range_uw)) ||
+      (ret = read_u32(f, &z->nconstraints))) {
+    return ret;
+  }
+  if (z->nconstraints > BINARY_MAX_ZONES) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (z->nconstraints && (z->constraints = calloc(z->nconstraints, sizeof(binary_constraint))) == NULL) {
+    return -errno;
+  }
+  for (i = 0; i < z->nconstraints; i++) {
+    if ((ret = read_name(f, z->constraints[i].name)) ||
+        (ret = read_u32(f, &z->constraints[i].num)) ||
+        (ret = read_u64(f, &z->constraints[i].min_power_uw)) ||
+        (ret = read_u64(f, &z->constraints[i].max_power_uw)) ||
+        (ret = read_u64(f, &z->constraints[i].min_time_window_us)) ||
+        (ret = read_u64(f, &z->constraints[i].max_time_window_us))) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int binary_read_header(FILE* f, binary_header* h) {
+  char magic[OUTPUT_BINARY_MAGIC_SIZE];
+  uint32_t nzones;
+  uint32_t nconstraints = 0;
+  uint32_t i;
+  int ret;
+  memset(h, 0, sizeof(binary_header));
+  if ((ret = read_exact(f, magic, sizeof(magic)))) {
+    return ret;
+  }
+  if (memcmp(magic, OUTPUT_BINARY_MAGIC, OUTPUT_BINARY_MAGIC_SIZE)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((ret = read_u32(f, &nzones)) || (ret = read_u32(f, &h->nconstraints))) {
+    return ret;
+  }
+  if (nzones > BINARY_MAX_ZONES) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if (nzones && (h->zones = calloc(nzones, sizeof(binary_zone))) == NULL) {
+    return -errno;
+  }
+  h->nzones = nzones;
+  for (i = 0; i < h->nzones; i++) {
+    if ((ret = read_binary_zone(f, &h->zones[i]))) {
+      binary_header_destroy(h);
+      return ret;
+    }
+    h->zones[i].constraint_index = nconstraints;
+    nconstraints += h->zones[i].nconstraints;
+  }
+  if (nconstraints != h->nconstraints) {
+    binary_header_destroy(h);
+    errno = EINVAL;
+    return -errno;
+  }
+  return 0;
+}
+
+void binary_header_destroy(binary_header* h) {
+  uint32_t i;
+  for (i = 0; i < h->nzones; i++) {
+    free(h->zones[i].zones);
+    free(h->zones[i].constraints);
+  }
+  free(h->zones);
+  memset(h, 0, sizeof(binary_header));
+}
+
+int binary_snapshot_init(const binary_header* h, powercap_sampler_snapshot* snap) {
+  memset(snap, 0, sizeof(powercap_sampler_snapshot));
+  /* allocate at least one of each to avoid 0-size allocations */
+  if ((snap->zones = calloc(h->nzones ? h->nzones : 1, sizeof(powercap_sampler_zone_values))) == NULL) {
+    return -errno;
+  }
+  if ((snap->constraints = calloc(h->nconstraints ? h->nconstraints : 1,
+                                  sizeof(powercap_sampler_constraint_values))) == NULL) {
+    free(snap->zones);
+    snap->zones = NULL;
+    return -errno;
+  }
+  snap->nzones = h->nzones;
+  snap->nconstraints = h->nconstraints;
+  return 0;
+}
+
+int binary_read_record(FILE* f, const binary_header* h, powercap_sampler_snapshot* snap) {
+  powercap_sampler_zone_values* v;
+  powercap_sampler_constraint_values* cv;
+  uint64_t time_ns;
+  uint32_t reserved;
+  size_t n;
+  uint32_t i;
+  int ret;
+  if (snap->nzones != h->nzones || snap->nconstraints != h->nconstraints) {
+    errno = EINVAL;
+    return -errno;
+  }
+  if ((n = fread(&time_ns, 1, sizeof(time_ns), f)) != sizeof(time_ns)) {
+    /* a clean end of stream is only between records */
+    if (n || ferror(f)) {
+      errno = ferror(f) ? EIO : EINVAL;
+      return -errno;
+    }
+    return 0;
+  }
+  snap->time_ns = (int64_t) time_ns;
+  if ((ret = read_u64(f, &time_ns))) {
+    return ret;
+  }
+  snap->elapsed_ns = (int64_t) time_ns;
+  for (i = 0; i < h->nzones; i++) {
+    v = &snap->zones[i];
+    if ((ret = read_u32(f, &v->valid)) ||
+        (ret = read_u32(f, &v->enabled)) ||
+        (ret = read_u64(f, &v->energy_uj)) ||
+        (ret = read_u64(f, &v->total_energy_uj)) ||
+        (ret = read_u64(f, &v->power_uw)) ||
+        (ret = read_u64(f, &v->power_file_uw))) {
+      return ret;
+    }
+  }
+  for (i = 0; i < h->nconstraints; i++) {
+    cv = &snap->constraints[i];
+    if ((ret = read_u32(f, &cv->valid)) ||
+        (ret = read_u32(f, &reserved)) ||
+        (ret = read_u64(f, &cv->power_limit_uw)) ||
+        (ret = read_u64(f, &cv->time_window_us))) {
+      return ret;
+    }
+  }
+  return 1;
+}
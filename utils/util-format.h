@@ -0,0 +1,121 @@
+/**
+ * Machine-readable (JSON, CSV, binary, and OpenMetrics) output of sampler snapshots.
+ *
+ * Output is accumulated in a buffer so that each snapshot is emitted with a single write.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _UTIL_FORMAT_H
+#define _UTIL_FORMAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "powercap-sampler.h"
+
+typedef enum output_format {
+  OUTPUT_FORMAT_TEXT = 0,
+  OUTPUT_FORMAT_JSON,
+  OUTPUT_FORMAT_CSV,
+  OUTPUT_FORMAT_BINARY
+} output_format;
+
+/* Binary stream magic, followed by the zone table then one record per snapshot (host byte order) */
+#define OUTPUT_BINARY_MAGIC "PCAPBIN1"
+#define OUTPUT_BINARY_MAGIC_SIZE 8
+
+typedef struct output_buffer {
+  char* data;
+  size_t len;
+  size_t size;
+} output_buffer;
+
+/* Parse "text", "json", "csv", or "binary"; returns 0 on success, -EINVAL on failure */
+int parse_output_format(const char* optarg, output_format* fmt, int* cont);
+
+void output_buffer_init(output_buffer* b);
+
+void output_buffer_destroy(output_buffer* b);
+
+/* Ensure space for at least len more bytes; returns 0 on success, negative error code on failure */
+int output_buffer_reserve(output_buffer* b, size_t len);
+
+/* Append to the buffer; return 0 on success, negative error code on failure */
+int output_buffer_append(output_buffer* b, const void* data, size_t len);
+
+int output_buffer_printf(output_buffer* b, const char* fmt, ...);
+
+/* Write out the buffer contents in one write (retrying only for partial writes), then clear the buffer */
+int output_buffer_flush(output_buffer* b, int fd);
+
+/* Append the format's stream header (CSV column names or the binary zone table), if any */
+int output_format_header(output_buffer* b, output_format fmt, const powercap_sampler* sampler);
+
+/* The size of each binary record for the sampler's zones */
+size_t output_binary_record_size(const powercap_sampler* sampler);
+
+/* Append one snapshot; time_ns is relative to the start of output */
+int output_format_snapshot(output_buffer* b, output_format fmt, const powercap_sampler* sampler,
+                           const powercap_sampler_snapshot* snap, int64_t time_ns);
+
+/* Append an OpenMetrics metric family's metadata; unit may be NULL */
+int output_openmetrics_family(output_buffer* b, const char* name, const char* type, const char* unit,
+                              const char* help);
+
+/*
+ * Append OpenMetrics families for one snapshot's zones and constraints, without the terminating "# EOF".
+ * If created_s > 0, it's reported as the (Unix) creation time of energy counters.
+ */
+int output_format_openmetrics(output_buffer* b, const powercap_sampler* sampler,
+                              const powercap_sampler_snapshot* snap, double created_s);
+
+/* A zone table entry read back from a binary stream */
+typedef struct binary_constraint {
+  char name[POWERCAP_SAMPLER_NAME_SIZE];
+  uint32_t num;
+  uint64_t min_power_uw;
+  uint64_t max_power_uw;
+  uint64_t min_time_window_us;
+  uint64_t max_time_window_us;
+} binary_constraint;
+
+typedef struct binary_zone {
+  char control_type[POWERCAP_SAMPLER_NAME_SIZE];
+  char name[POWERCAP_SAMPLER_NAME_SIZE];
+  uint32_t depth;
+  uint32_t* zones;
+  uint64_t max_energy_range_uj;
+  uint64_t max_power_range_uw;
+  binary_constraint* constraints;
+  uint32_t nconstraints;
+  /* index of this zone's first constraint in records */
+  uint32_t constraint_index;
+} binary_zone;
+
+typedef struct binary_header {
+  binary_zone* zones;
+  uint32_t nzones;
+  uint32_t nconstraints;
+} binary_header;
+
+/* Read and validate a binary stream's zone table; returns 0 on success, negative error code on failure */
+int binary_read_header(FILE* f, binary_header* h);
+
+void binary_header_destroy(binary_header* h);
+
+/* Allocate a snapshot sized for a zone table; returns 0 on success, negative error code on failure */
+int binary_snapshot_init(const binary_header* h, powercap_sampler_snapshot* snap);
+
+/* Read the next record; returns 1 on success, 0 at the end of the stream, negative error code on failure */
+int binary_read_record(FILE* f, const binary_header* h, powercap_sampler_snapshot* snap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
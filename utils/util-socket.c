@@ -0,0 +1,133 @@
+/**
+ * Stream socket utilities.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "util-socket.h"
+
+#define UNIX_PREFIX "unix:"
+#define LISTEN_BACKLOG 128
+
+static int unix_addr(const char* address, struct sockaddr_un* addr) {
+  const char* path = address + strlen(UNIX_PREFIX);
+  if (strlen(path) == 0 || strlen(path) >= sizeof(addr->sun_path)) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memset(addr, 0, sizeof(struct sockaddr_un));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, path);
+  return 0;
+}
+
+static int is_unix(const char* address) {
+  return !strncmp(address, UNIX_PREFIX, strlen(UNIX_PREFIX));
+}
+
+/* Splits "HOST:PORT" at the last colon; host is NULL if empty */
+static int tcp_addrinfo(const char* address, int passive, struct addrinfo** res) {
+  struct addrinfo hints;
+  char host[256];
+  const char* port = strrchr(address, ':');
+  size_t len;
+  int ret;
+  if (port == NULL || (len = (size_t) (port - address)) >= sizeof(host) || !*++port) {
+    errno = EINVAL;
+    return -errno;
+  }
+  memcpy(host, address, len);
+  host[len] = '\0';
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+  if ((ret = getaddrinfo(len ? host : NULL, port, &hints, res))) {
+    fprintf(stderr, "%s: %s\n", address, gai_strerror(ret));
+    errno = EINVAL;
+    return -errno;
+  }
+  return 0;
+}
+
+int socket_listen(const char* address) {
+  struct sockaddr_un un;
+  struct addrinfo* res;
+  struct addrinfo* ai;
+  int one = 1;
+  int fd = -1;
+  if (is_unix(address)) {
+    if (unix_addr(address, &un) || (fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+      return -errno;
+    }
+    unlink(un.sun_path);
+    if (bind(fd, (const struct sockaddr*) &un, sizeof(un)) || listen(fd, LISTEN_BACKLOG)) {
+      close(fd);
+      return -errno;
+    }
+    return fd;
+  }
+  if (tcp_addrinfo(address, 1, &res)) {
+    return -errno;
+  }
+  for (ai = res; ai != NULL; ai = ai->ai_next) {
+    if ((fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol)) < 0) {
+      continue;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (!bind(fd, ai->ai_addr, ai->ai_addrlen) && !listen(fd, LISTEN_BACKLOG)) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd < 0 ? -errno : fd;
+}
+
+int socket_connect(const char* address) {
+  struct sockaddr_un un;
+  struct addrinfo* res;
+  struct addrinfo* ai;
+  int fd = -1;
+  if (is_unix(address)) {
+    if (unix_addr(address, &un) || (fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+      return -errno;
+    }
+    if (connect(fd, (const struct sockaddr*) &un, sizeof(un))) {
+      close(fd);
+      return -errno;
+    }
+    return fd;
+  }
+  if (tcp_addrinfo(address, 0, &res)) {
+    return -errno;
+  }
+  for (ai = res; ai != NULL; ai = ai->ai_next) {
+    if ((fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol)) < 0) {
+      continue;
+    }
+    if (!connect(fd, ai->ai_addr, ai->ai_addrlen)) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd < 0 ? -errno : fd;
+}
+
+void socket_unlink(const char* address) {
+  struct sockaddr_un un;
+  if (is_unix(address) && !unix_addr(address, &un)) {
+    unlink(un.sun_path);
+  }
+}
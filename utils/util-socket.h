@@ -0,0 +1,39 @@
+/**
+ * Stream socket utilities.
+ *
+ * Addresses are either "unix:PATH" for a Unix domain socket or "HOST:PORT" for TCP.
+ * An empty HOST when listening means all interfaces.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+
+#ifndef _UTIL_SOCKET_H
+#define _UTIL_SOCKET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create a listening socket; an existing Unix socket file is replaced.
+ * Returns the file descriptor, or a negative value on error.
+ */
+int socket_listen(const char* address);
+
+/**
+ * Connect to a listening socket.
+ * Returns the file descriptor, or a negative value on error.
+ */
+int socket_connect(const char* address);
+
+/**
+ * Remove the file for a Unix socket address, if any.
+ */
+void socket_unlink(const char* address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
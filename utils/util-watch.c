@@ -0,0 +1,349 @@
+/**
+ * Periodically print dynamic zone/constraint values, keeping files open between reads.
+ *
+ * Files are opened once by a sampler, then each interval only the dynamic files (energy, power, enabled, power limits,
+ * and time windows) are re-read.
+ * In text format, zone power and CPU idle state residencies are printed each interval and other values only when they
+ * change (including their first reading); machine-readable formats print every value each interval, with each
+ * snapshot's output written at once.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "powercap-sampler.h"
+#include "util-common.h"
+#include "util-format.h"
+#include "util-watch.h"
+
+#define POWERCAP_PATH "/sys/class/powercap"
+#define MAX_CONTROL_TYPES 64
+
+int watch_init(watch* w, output_format format) {
+  memset(w, 0, sizeof(watch));
+  w->format = format;
+  output_buffer_init(&w->out);
+  return powercap_sampler_init(&w->sampler);
+}
+
+void watch_destroy(watch* w) {
+  if (w->have_snap) {
+    powercap_sampler_snapshot_destroy(&w->snap);
+    powercap_sampler_snapshot_destroy(&w->prev);
+  }
+  powercap_sampler_destroy(&w->sampler);
+  output_buffer_destroy(&w->out);
+  memset(w, 0, sizeof(watch));
+}
+
+int watch_add_zone_tree(watch* w, const char* control_type, const uint32_t* zones, uint32_t depth, int recurse) {
+  return powercap_sampler_add_zone_tree(&w->sampler, control_type, zones, depth, recurse);
+}
+
+/* A system without cpufreq, cpuidle, or thermal support just has nothing to add */
+int watch_add_telemetry(watch* w) {
+  int ret;
+  if (((ret = powercap_sampler_add_cpufreq(&w->sampler, NULL)) && ret != -ENOENT) ||
+      ((ret = powercap_sampler_add_cpuidle(&w->sampler, NULL)) && ret != -ENOENT) ||
+      ((ret = powercap_sampler_add_thermal(&w->sampler, NULL)) && ret != -ENOENT)) {
+    return ret;
+  }
+  return 0;
+}
+
+static int cmp_str(const void* a, const void* b) {
+  return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+/* Control types are the powercap directory entries that aren't zones (zones are named like "intel-rapl:0") */
+int add_all_control_types(powercap_sampler* sampler) {
+  char* names[MAX_CONTROL_TYPES];
+  struct dirent* entry;
+  DIR* dir;
+  size_t n = 0;
+  size_t i;
+  int ret = 0;
+  if ((dir = opendir(POWERCAP_PATH)) == NULL) {
+    return -errno;
+  }
+  while (n < MAX_CONTROL_TYPES && (entry = readdir(dir)) != NULL) {
+    if (strchr(entry->d_name, ':') == NULL && is_valid_control_type(entry->d_name)) {
+      if ((names[n] = strdup(entry->d_name)) == NULL) {
+        ret = -errno;
+        break;
+      }
+      n++;
+    }
+  }
+  closedir(dir);
+  /* sorted for a stable display order */
+  qsort(names, n, sizeof(char*), cmp_str);
+  for (i = 0; i < n; i++) {
+    if (!ret) {
+      ret = powercap_sampler_add_zone_tree(sampler, names[i], NULL, 0, 1);
+    }
+    free(names[i]);
+  }
+  return ret;
+}
+
+int watch_parse_interval(const char* optarg, uint64_t* interval_us, int* cont) {
+  char* end;
+  double sec;
+  errno = 0;
+  sec = optarg ? strtod(optarg, &end) : 0;
+  if (!optarg || end == optarg || *end != '\0' || errno || !(sec > 0) || sec * 1000000 > (double) UINT64_MAX) {
+    *cont = 0;
+    return -EINVAL;
+  }
+  *interval_us = (uint64_t) (sec * 1000000);
+  if (!*interval_us) {
+    *interval_us = 1;
+  }
+  return 0;
+}
+
+/* Snapshots are created once all zones are added */
+static int prepare(watch* w) {
+  int ret;
+  if (w->have_snap) {
+    return 0;
+  }
+  if ((ret = powercap_sampler_snapshot_init(&w->sampler, &w->snap))) {
+    return ret;
+  }
+  if ((ret = powercap_sampler_snapshot_init(&w->sampler, &w->prev))) {
+    powercap_sampler_snapshot_destroy(&w->snap);
+    return ret;
+  }
+  w->have_snap = 1;
+  return output_format_header(&w->out, w->format, &w->sampler);
+}
+
+static int sample(watch* w) {
+  int ret;
+  if ((ret = powercap_sampler_sample(&w->sampler, &w->snap, POWERCAP_SAMPLER_READ_ALL))) {
+    return ret;
+  }
+  if (w->sampler.nsamples == 1) {
+    w->start_ns = w->snap.time_ns;
+  }
+  return 0;
+}
+
+int watch_once(watch* w) {
+  int ret;
+  if ((ret = prepare(w)) || (ret = sample(w)) ||
+      (ret = output_format_snapshot(&w->out, w->format, &w->sampler, &w->snap, w->snap.time_ns - w->start_ns))) {
+    return ret;
+  }
+  return output_buffer_flush(&w->out, STDOUT_FILENO);
+}
+
+static void print_zone(const powercap_sampler_zone* z, int* printed) {
+  uint32_t i;
+  if (!*printed) {
+    printf("Zone %"PRIu32, z->zones[0]);
+    for (i = 1; i < z->depth; i++) {
+      printf(":%"PRIu32, z->zones[i]);
+    }
+    if (z->name[0]) {
+      printf(" (%s)", z->name);
+    }
+    *printed = 1;
+  }
+}
+
+/* Print "name: value" indented under the zone if the value is new or changed */
+static void print_change(const powercap_sampler_zone* z, int* printed, uint32_t in, const char* name, uint64_t val,
+                         int have_old, uint64_t old) {
+  if (!have_old || val != old) {
+    print_zone(z, printed);
+    printf("\n");
+    indent(in);
+    printf("%s: %"PRIu64, name, val);
+  }
+}
+
+static void print_constraint(const watch* w, const powercap_sampler_zone* z, uint32_t idx, int* printed) {
+  const powercap_sampler_constraint_values* cv = &w->snap.constraints[idx];
+  const powercap_sampler_constraint_values* old = &w->prev.constraints[idx];
+  uint32_t num = z->constraints[idx - z->constraint_index].num;
+  char name[48];
+  if (cv->valid & POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT) {
+    snprintf(name, sizeof(name), "constraint %"PRIu32" power_limit_uw", num);
+    print_change(z, printed, 1, name, cv->power_limit_uw,
+                 w->have_prev && (old->valid & POWERCAP_SAMPLER_CONSTRAINT_POWER_LIMIT), old->power_limit_uw);
+  }
+  if (cv->valid & POWERCAP_SAMPLER_CONSTRAINT_TIME_WINDOW) {
+    snprintf(name, sizeof(name), "constraint %"PRIu32" time_window_us", num);
+    print_change(z, printed, 1, name, cv->time_window_us,
+                 w->have_prev && (old->valid & POWERCAP_SAMPLER_CONSTRAINT_TIME_WINDOW), old->time_window_us);
+  }
+}
+
+static void print_text_zone(const watch* w, uint32_t i) {
+  const powercap_sampler_zone* z = &w->sampler.zones[i];
+  const powercap_sampler_zone_values* v = &w->snap.zones[i];
+  const powercap_sampler_zone_values* old = &w->prev.zones[i];
+  int printed = 0;
+  uint32_t j;
+  if (v->valid & POWERCAP_SAMPLER_ZONE_POWER) {
+    print_zone(z, &printed);
+    printf(": %.3f W", v->power_uw / 1000000.0);
+  }
+  if (v->valid & POWERCAP_SAMPLER_ZONE_POWER_UW) {
+    print_change(z, &printed, 1, "power_uw", v->power_file_uw,
+                 w->have_prev && (old->valid & POWERCAP_SAMPLER_ZONE_POWER_UW), old->power_file_uw);
+  }
+  if (v->valid & POWERCAP_SAMPLER_ZONE_ENABLED) {
+    print_change(z, &printed, 1, "enabled", v->enabled,
+                 w->have_prev && (old->valid & POWERCAP_SAMPLER_ZONE_ENABLED), old->enabled);
+  }
+  for (j = 0; j < z->nconstraints; j++) {
+    print_constraint(w, z, z->constraint_index + j, &printed);
+  }
+  if (printed) {
+    printf("\n");
+  }
+}
+
+static void print_cpu(uint32_t cpu, int* printed) {
+  if (!*printed) {
+    printf("CPU %"PRIu32, cpu);
+    *printed = 1;
+  }
+}
+
+/* Idle state residency is the share of the interval spent in the state */
+static void print_cpuidle(const watch* w, uint32_t i, int* printed) {
+  const powercap_sampler_cpuidle* c = &w->sampler.cpuidles[i];
+  const powercap_sampler_cpuidle_values* v = &w->snap.cpuidles[i];
+  const powercap_sampler_cpuidle_values* old = &w->prev.cpuidles[i];
+  if ((v->valid & old->valid & POWERCAP_SAMPLER_CPUIDLE_TIME) && v->time_us >= old->time_us &&
+      w->snap.elapsed_ns > 0) {
+    print_cpu(c->cpu, printed);
+    printf("\n");
+    indent(1);
+    printf("state %"PRIu32" (%s): %.1f%%", c->state, c->name,
+           (v->time_us - old->time_us) * 100000.0 / w->snap.elapsed_ns);
+  }
+}
+
+/* CPUs are printed in order, with their frequency and idle states together */
+static void print_text_cpus(const watch* w) {
+  const powercap_sampler_cpufreq_values* v;
+  const powercap_sampler_cpufreq_values* old;
+  uint32_t i = 0;
+  uint32_t j = 0;
+  uint32_t cpu;
+  int printed;
+  while (i < w->sampler.ncpufreqs || j < w->sampler.ncpuidles) {
+    cpu = j < w->sampler.ncpuidles ? w->sampler.cpuidles[j].cpu : UINT32_MAX;
+    if (i < w->sampler.ncpufreqs && w->sampler.cpufreqs[i].cpu < cpu) {
+      cpu = w->sampler.cpufreqs[i].cpu;
+    }
+    printed = 0;
+    if (i < w->sampler.ncpufreqs && w->sampler.cpufreqs[i].cpu == cpu) {
+      v = &w->snap.cpufreqs[i];
+      old = &w->prev.cpufreqs[i];
+      if ((v->valid & POWERCAP_SAMPLER_CPUFREQ_FREQ) &&
+          (!w->have_prev || !(old->valid & POWERCAP_SAMPLER_CPUFREQ_FREQ) || v->freq_khz != old->freq_khz)) {
+        print_cpu(cpu, &printed);
+        printf("\n");
+        indent(1);
+        printf("freq_khz: %"PRIu64, v->freq_khz);
+      }
+      i++;
+    }
+    for (; j < w->sampler.ncpuidles && w->sampler.cpuidles[j].cpu == cpu; j++) {
+      print_cpuidle(w, j, &printed);
+    }
+    if (printed) {
+      printf("\n");
+    }
+  }
+}
+
+static void print_text_thermal(const watch* w, uint32_t i) {
+  const powercap_sampler_thermal* t = &w->sampler.thermals[i];
+  const powercap_sampler_thermal_values* v = &w->snap.thermals[i];
+  const powercap_sampler_thermal_values* old = &w->prev.thermals[i];
+  if ((v->valid & POWERCAP_SAMPLER_THERMAL_TEMP) &&
+      (!w->have_prev || !(old->valid & POWERCAP_SAMPLER_THERMAL_TEMP) || v->temp_mc != old->temp_mc)) {
+    printf("Thermal zone %"PRIu32" (%s)\n", t->zone, t->type);
+    indent(1);
+    printf("temp_mc: %"PRId64"\n", v->temp_mc);
+  }
+}
+
+/* Keep the values text output compares against */
+static void save_prev(watch* w) {
+  memcpy(w->prev.zones, w->snap.zones, w->snap.nzones * sizeof(powercap_sampler_zone_values));
+  memcpy(w->prev.constraints, w->snap.constraints, w->snap.nconstraints * sizeof(powercap_sampler_constraint_values));
+  memcpy(w->prev.cpufreqs, w->snap.cpufreqs, w->snap.ncpufreqs * sizeof(powercap_sampler_cpufreq_values));
+  memcpy(w->prev.cpuidles, w->snap.cpuidles, w->snap.ncpuidles * sizeof(powercap_sampler_cpuidle_values));
+  memcpy(w->prev.thermals, w->snap.thermals, w->snap.nthermals * sizeof(powercap_sampler_thermal_values));
+}
+
+static int print_text(watch* w) {
+  uint32_t i;
+  printf("[%.3f s]\n", (w->snap.time_ns - w->start_ns) / 1000000000.0);
+  for (i = 0; i < w->sampler.nzones; i++) {
+    print_text_zone(w, i);
+  }
+  print_text_cpus(w);
+  for (i = 0; i < w->sampler.nthermals; i++) {
+    print_text_thermal(w, i);
+  }
+  save_prev(w);
+  w->have_prev = 1;
+  return fflush(stdout) ? -errno : 0;
+}
+
+int watch_run(watch* w, uint64_t interval_us) {
+  struct timespec next;
+  int64_t next_ns;
+  int ret;
+  if ((ret = prepare(w)) || (ret = sample(w))) {
+    return ret;
+  }
+  /* text output starts after the first interval, once power and idle state residencies are known */
+  if (w->format == OUTPUT_FORMAT_TEXT) {
+    memcpy(w->prev.cpuidles, w->snap.cpuidles, w->snap.ncpuidles * sizeof(powercap_sampler_cpuidle_values));
+  } else if ((ret = output_format_snapshot(&w->out, w->format, &w->sampler, &w->snap, 0)) ||
+             (ret = output_buffer_flush(&w->out, STDOUT_FILENO))) {
+    return ret;
+  }
+  next_ns = w->start_ns;
+  for (;;) {
+    /* absolute deadlines, so printing doesn't cause drift */
+    next_ns += (int64_t) interval_us * 1000;
+    next.tv_sec = (time_t) (next_ns / 1000000000);
+    next.tv_nsec = (long) (next_ns % 1000000000);
+    while ((ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL)) == EINTR);
+    if (ret) {
+      errno = ret;
+      return -errno;
+    }
+    if ((ret = sample(w))) {
+      return ret;
+    }
+    if (w->format == OUTPUT_FORMAT_TEXT) {
+      ret = print_text(w);
+    } else if (!(ret = output_format_snapshot(&w->out, w->format, &w->sampler, &w->snap,
+                                              w->snap.time_ns - w->start_ns))) {
+      ret = output_buffer_flush(&w->out, STDOUT_FILENO);
+    }
+    if (ret) {
+      return ret;
+    }
+  }
+}
@@ -0,0 +1,58 @@
+/**
+ * Periodically print dynamic zone/constraint values, keeping files open between reads.
+ *
+ * @author Connor Imes
+ * @date 2026-10-19
+ */
+#ifndef _UTIL_WATCH_H
+#define _UTIL_WATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include "powercap-sampler.h"
+#include "util-format.h"
+
+typedef struct watch {
+  powercap_sampler sampler;
+  powercap_sampler_snapshot snap;
+  /* the last printed text values, to detect changes */
+  powercap_sampler_snapshot prev;
+  int have_prev;
+  int have_snap;
+  int64_t start_ns;
+  output_format format;
+  output_buffer out;
+} watch;
+
+/* Returns 0 on success, negative error code on failure */
+int watch_init(watch* w, output_format format);
+
+void watch_destroy(watch* w);
+
+/* Add a zone and (if recurse) its subzones; returns 0 on success, negative error code on failure */
+int watch_add_zone_tree(watch* w, const char* control_type, const uint32_t* zones, uint32_t depth, int recurse);
+
+/* Add CPU frequencies, idle states, and thermal zones, where present; returns 0 on success, negative error code on
+ * failure */
+int watch_add_telemetry(watch* w);
+
+/* Add all zones of all control types; returns 0 on success, negative error code on failure */
+int add_all_control_types(powercap_sampler* sampler);
+
+/* Parse a positive interval in (possibly fractional) seconds; returns 0 on success, -EINVAL on failure */
+int watch_parse_interval(const char* optarg, uint64_t* interval_us, int* cont);
+
+/* Write a single snapshot in a machine-readable format; returns 0 on success, negative error code on failure */
+int watch_once(watch* w);
+
+/* Print power and changed values every interval; returns only on error */
+int watch_run(watch* w, uint64_t interval_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif